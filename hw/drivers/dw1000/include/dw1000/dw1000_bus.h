@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_bus.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Shared SPI bus scheduler
+ *
+ * @details Instances configured with the same spi_sem share one bus. Instead of all of them pending on
+ * the semaphore, each access asks the scheduler for the bus with a class: IRQ for accesses made from the
+ * interrupt task of the instance, BULK for transfers of at least DW1000_BUS_BULK_MIN bytes and NORMAL
+ * for the rest. When the owner releases the bus it is handed straight to the next waiter, highest class
+ * first, devices in round robin order within a class and in arrival order within a device. A waiter
+ * passed over DW1000_BUS_AGING times goes first whatever its class, so no device starves.
+ *
+ * The semaphore stays held from one owner to the next and is released once nobody waits, so code
+ * outside of the driver pending on it still sees a single bus. An asynchronous engine waiting for the
+ * bus is started by the releasing context itself, which batches the queued requests of several radios
+ * back to back from the completion interrupt, and gives the bus away between its accesses to waiters
+ * of a higher class on the other radios.
+ */
+
+#ifndef _DW1000_BUS_H_
+#define _DW1000_BUS_H_
+
+#include <stdint.h>
+#include <syscfg/syscfg.h>
+#include <dpl/dpl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DW1000_BUS_MAX_DEVS     (3)                             //!< Instances sharing one bus
+#define DW1000_BUS_BULK_MIN     MYNEWT_VAL(DW1000_BUS_BULK_MIN) //!< Shortest transfer scheduled as bulk
+#define DW1000_BUS_AGING        MYNEWT_VAL(DW1000_BUS_AGING)    //!< Grants a waiter may be passed over
+
+//! Scheduling classes, highest first.
+typedef enum _dw1000_bus_prio_t{
+    DW1000_BUS_PRIO_IRQ,                        //!< Accesses from the interrupt task of the instance
+    DW1000_BUS_PRIO_NORMAL,                     //!< Accesses from any other task
+    DW1000_BUS_PRIO_BULK,                       //!< Transfers of at least DW1000_BUS_BULK_MIN bytes
+    DW1000_BUS_PRIO_NUM
+}dw1000_bus_prio_t;
+
+struct _dw1000_dev_instance_t;
+
+//! Request for the bus queued while another instance owns it.
+typedef struct _dw1000_bus_waiter_t{
+    STAILQ_ENTRY(_dw1000_bus_waiter_t) next;    //!< Queue linkage
+    struct _dw1000_dev_instance_t * inst;       //!< Instance asking for the bus
+    struct dpl_sem sem;                         //!< Released on grant, unused by the asynchronous engine
+    uint32_t queued;                            //!< os_cputime when queued
+    uint32_t seq;                               //!< Order of arrival on the bus
+    uint8_t prio;                               //!< dw1000_bus_prio_t
+    uint8_t bypassed;                           //!< Times passed over while first in its queue
+    uint8_t async:1;                            //!< Start the asynchronous engine of inst on grant
+    uint8_t resume:1;                           //!< Asynchronous engine that gave the bus away with requests under way
+    uint8_t waiting:1;                          //!< On a queue
+    uint8_t granted:1;                          //!< Bus handed over, set in the releasing context
+}dw1000_bus_waiter_t;
+
+//! Contention statistics of one class.
+typedef struct _dw1000_bus_class_stats_t{
+    uint32_t grants;                            //!< Bus granted
+    uint32_t contended;                         //!< Grants that had to wait for another owner
+    uint32_t aged;                              //!< Grants forced by DW1000_BUS_AGING
+    uint32_t wait_usec_total;                   //!< Time spent waiting, contended grants
+    uint32_t wait_usec_max;                     //!< Longest wait
+}dw1000_bus_class_stats_t;
+
+//! SPI bus shared by the instances configured with the same spi_sem.
+typedef struct _dw1000_bus_t{
+    struct dpl_sem * spi_sem;                   //!< Semaphore of the bus, held while an instance owns it
+    struct _dw1000_dev_instance_t * owner;      //!< Instance the bus is granted to, NULL when free
+    struct _dw1000_dev_instance_t * devs[DW1000_BUS_MAX_DEVS];  //!< Instances attached
+    uint8_t ndevs;                              //!< Entries used in devs
+    uint8_t last;                               //!< Index in devs of the last contended grant, round robin start
+    uint16_t nwaiting;                          //!< Waiters queued
+    uint32_t seq;                               //!< Arrivals, numbers the waiters
+    STAILQ_HEAD(, _dw1000_bus_waiter_t) queue[DW1000_BUS_MAX_DEVS][DW1000_BUS_PRIO_NUM];  //!< Waiters per device and class
+    uint32_t handoffs;                          //!< Grants passed straight from one owner to the next
+    uint32_t yields;                            //!< Asynchronous engines that gave the bus away between accesses
+    uint32_t dev_grants[DW1000_BUS_MAX_DEVS];   //!< Grants per device
+    dw1000_bus_class_stats_t stats[DW1000_BUS_PRIO_NUM];    //!< Grants per class
+}dw1000_bus_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_BUS_H_ */
@@ -50,6 +50,11 @@ extern "C" {
 #include <hal/hal_spi.h>
 #include <dw1000/dw1000_regs.h>
 #include <dw1000/dw1000_stats.h>
+#include <dw1000/dw1000_latency.h>
+#include <dw1000/dw1000_spi_cal.h>
+#include <dw1000/dw1000_tx_tmpl.h>
+#include <dw1000/dw1000_bus.h>
+#include <dw1000/dw1000_wake.h>
 #include <dpl/dpl.h>
 
 #define DWT_DEVICE_ID   (0xDECA0130) //!< Decawave Device ID 
@@ -97,6 +102,7 @@ typedef enum _dw1000_extension_id_t{
     DW1000_NMGR_CMD,                         //!< UWB command support
     DW1000_CIR,                              //!< Channel impulse response 
     DW1000_OT,                               //!< Openthread
+    DW1000_CIR_STREAM,                       //!< Streaming CIR capture
     DW1000_RTDOA = 0x30,                     //!< RTDoA
     DW1000_RTDOA_BH,                         //!< RTDoA Backhaul
     DW1000_SURVEY = 0x40,
@@ -114,6 +120,77 @@ typedef struct _dw1000_cmd{
     uint32_t subaddress:15;           //!< Indicates subaddress of register 
 }dw1000_cmd_t;
 
+#define DW1000_XFER_LIST_MAX        MYNEWT_VAL(DW1000_XFER_LIST_MAX)   //!< Maximum register accesses per transfer list
+
+//! Register access queued on a transfer list.
+typedef struct _dw1000_xfer_t{
+    uint8_t header[3];                //!< Transaction header, bit 7 of header[0] is set for writes
+    uint8_t header_len;               //!< Length of the header (1 to 3 bytes)
+    uint16_t length;                  //!< Length of the data phase
+    uint8_t * buffer;                 //!< Source of a write or destination of a read
+}dw1000_xfer_t;
+
+//! Transfer list, executed by dw1000_xfer_list_submit with a single acquisition of the SPI bus.
+typedef struct _dw1000_xfer_list_t{
+    uint16_t nxfers;                  //!< Number of queued register accesses
+    uint16_t nvals;                   //!< Number of used entries in vals
+    dw1000_xfer_t xfers[DW1000_XFER_LIST_MAX];  //!< Queued register accesses, executed in order
+    uint64_t vals[DW1000_XFER_LIST_MAX];        //!< Storage for values queued by dw1000_xfer_list_write_reg
+}dw1000_xfer_list_t;
+
+//! Host owned configuration registers kept in the shadow cache.
+typedef enum _dw1000_shadow_reg_t{
+    DW1000_SHADOW_SYS_CFG,            //!< SYS_CFG, reserved bits cleared with SYS_CFG_MASK
+    DW1000_SHADOW_SYS_MASK,           //!< SYS_MASK
+    DW1000_SHADOW_TX_FCTRL,           //!< TX_FCTRL, octets 0 to 3
+    DW1000_SHADOW_NREGS
+}dw1000_shadow_reg_t;
+
+//! Write-through cache of registers only the host writes. Invalidated on reset, sleep and wakeup.
+typedef struct _dw1000_shadow_t{
+    uint32_t regs[DW1000_SHADOW_NREGS];   //!< Last value written to or read from the device
+    uint32_t valid;                       //!< Bit n set while regs[n] matches the device
+    uint32_t hits;                        //!< SPI reads avoided
+    uint32_t misses;                      //!< Reads that went to the device
+    uint32_t writes_elided;               //!< Writes skipped by dw1000_shadow_update, value unchanged
+    uint32_t invalidations;               //!< Resets, sleeps and wakeups
+}dw1000_shadow_t;
+
+//! Registers of a profile, in the order they are written.
+typedef enum _dw1000_profile_reg_t{
+    DW1000_PROFILE_LDE_REPC,
+    DW1000_PROFILE_LDE_CFG1,
+    DW1000_PROFILE_LDE_CFG2,
+    DW1000_PROFILE_FS_PLLCFG,
+    DW1000_PROFILE_FS_PLLTUNE,
+    DW1000_PROFILE_RF_RXCTRLH,
+    DW1000_PROFILE_RF_TXCTRL,
+    DW1000_PROFILE_DRX_TUNE0B,
+    DW1000_PROFILE_DRX_TUNE1A,
+    DW1000_PROFILE_DRX_TUNE1B,
+    DW1000_PROFILE_DRX_TUNE4H,
+    DW1000_PROFILE_DRX_TUNE2,
+    DW1000_PROFILE_DRX_SFDTOC,
+    DW1000_PROFILE_AGC_TUNE2,
+    DW1000_PROFILE_AGC_TUNE1,
+    DW1000_PROFILE_USR_SFD,
+    DW1000_PROFILE_CHAN_CTRL,
+    DW1000_PROFILE_TC_PGDELAY,
+    DW1000_PROFILE_TX_POWER,
+    DW1000_PROFILE_NREGS
+}dw1000_profile_reg_t;
+
+//! Profile registers as last written to the device, see dw1000_profile.h. Invalidated with the shadow cache.
+typedef struct _dw1000_profile_state_t{
+    uint32_t regs[DW1000_PROFILE_NREGS];        //!< Last value written
+    uint32_t valid;                             //!< Bit n set while regs[n] matches the device
+    uint32_t applies;                           //!< Profiles applied
+    uint32_t writes;                            //!< Registers written
+    uint32_t writes_elided;                     //!< Registers already holding the value
+    uint32_t apply_usec;                        //!< Duration of the last apply
+    uint32_t apply_usec_max;                    //!< Longest apply
+}dw1000_profile_state_t;
+
 //! Structure of DW1000 device status.
 typedef struct _dw1000_dev_status_t{
     uint32_t selfmalloc:1;            //!< Internal flag for memory garbage collection 
@@ -244,12 +321,41 @@ typedef struct _phy_attributes_t{
 
 struct _dw1000_dev_instance_t;
 
+//! Asynchronous request, a transfer list clocked out with hal_spi_txrx_noblock from the SPI completion interrupt.
+typedef struct _dw1000_async_req_t{
+    STAILQ_ENTRY(_dw1000_async_req_t) next;     //!< Pending or completed queue linkage
+    dw1000_xfer_list_t list;                    //!< Register accesses, executed in order
+    void (* complete_cb)(struct _dw1000_dev_instance_t *, struct _dw1000_async_req_t *); //!< Called from the completed queue on the instance eventq, may be NULL
+    struct dpl_eventq * evq;                    //!< Queue ev is posted to
+    struct dpl_event * ev;                      //!< Posted from the completion interrupt, may be NULL
+    void * arg;                                 //!< Free for the caller
+    volatile uint8_t done;                      //!< Set from the completion interrupt once every access is done
+    uint8_t waiting;                            //!< A task is blocked in dw1000_async_wait
+    uint8_t header_sent;                        //!< Header of list.xfers[xfer] clocked out
+    uint16_t xfer;                              //!< Access in progress
+    uint16_t offset;                            //!< Bytes of the data phase started
+}dw1000_async_req_t;
+
+//! Asynchronous access queues of an instance.
+typedef struct _dw1000_async_t{
+    STAILQ_HEAD(, _dw1000_async_req_t) pending;     //!< Submitted requests, the first one is on the bus
+    STAILQ_HEAD(, _dw1000_async_req_t) completed;   //!< Completed requests whose complete_cb has not run
+    struct dpl_event complete_ev;               //!< Drains the completed queue on the instance eventq
+    struct dpl_sem done_sem;                    //!< Released when a waited for request completes
+    uint8_t busy;                               //!< Requests pending, the engine holds or waits for the SPI bus
+    dw1000_bus_waiter_t bus_waiter;             //!< Queued while another instance owns the bus
+    uint32_t submitted;                         //!< Requests submitted
+    uint32_t completions;                       //!< Requests completed
+}dw1000_async_t;
+
 //! Structure of extension callbacks structure common for mac layer.
 typedef struct _dw1000_mac_interface_t dw1000_mac_interface_t;
 typedef struct _dw1000_mac_interface_t {
     struct _status{
         uint16_t selfmalloc:1;            //!< Internal flag for memory garbage collection
         uint16_t initialized:1;           //!< Instance allocated
+        uint16_t rx_fallback:1;           //!< rx_complete_cb only sees frames no other interface consumed
+        uint16_t rx_any:1;                //!< rx_complete_cb is offered every frame, rx_fctrl and the code range only select the payloads it reads
     } status;
     uint16_t id;
     void *inst_ptr;                   //!< Pointer to instance
@@ -264,20 +370,114 @@ typedef struct _dw1000_mac_interface_t {
     bool (* complete_cb)    (struct _dw1000_dev_instance_t *, struct _dw1000_mac_interface_t *);    //!< Completion event interface callback  
     bool (* sleep_cb)       (struct _dw1000_dev_instance_t *, struct _dw1000_mac_interface_t *);    //!< Wakeup event interface callback  
     bool (* start_tx_error_cb) (struct _dw1000_dev_instance_t *, struct _dw1000_mac_interface_t *);    //!< Start error event interface callback  
+    uint16_t rx_fctrl;                //!< Frame control offered to rx_complete_cb, a one octet value matches blinks, 0 matches all frames
+    uint16_t rx_code_min;             //!< Lowest frame code offered to rx_complete_cb, needs rx_fctrl
+    uint16_t rx_code_max;             //!< Highest frame code offered to rx_complete_cb, 0 matches all codes
+#if MYNEWT_VAL(DW1000_MAC_STATS)
+    uint32_t rx_hits;                 //!< Frames offered to rx_complete_cb and consumed
+    uint32_t rx_misses;               //!< Frames offered to rx_complete_cb and declined
+#endif
+#if MYNEWT_VAL(DW1000_LATENCY)
+    dw1000_latency_hist_t rx_latency; //!< Time spent in rx_complete_cb
+#endif
     SLIST_ENTRY(_dw1000_mac_interface_t) next;                    //!< Next callback in the list
 }dw1000_mac_interface_t;
 
+//! Events dispatched to the registered interfaces.
+typedef enum _dw1000_mac_event_t{
+    DW1000_MAC_EV_TX_COMPLETE,        //!< tx_complete_cb, stops at the first handler returning true
+    DW1000_MAC_EV_RX_COMPLETE,        //!< rx_complete_cb, demuxed on frame control and code, stops at the first handler returning true
+    DW1000_MAC_EV_CIR_COMPLETE,       //!< cir_complete_cb
+    DW1000_MAC_EV_RX_TIMEOUT,         //!< rx_timeout_cb
+    DW1000_MAC_EV_RX_ERROR,           //!< rx_error_cb
+    DW1000_MAC_EV_RESET,              //!< reset_cb
+    DW1000_MAC_EV_SLEEP,              //!< sleep_cb
+    DW1000_MAC_EV_NUM
+}dw1000_mac_event_t;
+
+#define DW1000_MAC_INTERFACE_MAX    MYNEWT_VAL(DW1000_MAC_INTERFACE_MAX)   //!< Interfaces per instance
+
+#if DW1000_MAC_INTERFACE_MAX > 32
+#error "DW1000_MAC_INTERFACE_MAX is limited to 32 by the rx route masks"
+#endif
+
+//! Non NULL handler of an event, in registration order.
+typedef struct _dw1000_mac_handler_t{
+    bool (* cb)(struct _dw1000_dev_instance_t *, struct _dw1000_mac_interface_t *);   //!< Callback
+    dw1000_mac_interface_t * cbs;     //!< Interface passed to the callback
+}dw1000_mac_handler_t;
+
+//! Range of rx route keys, see dw1000_mac_classify(), and the rx handlers that receive them.
+typedef struct _dw1000_mac_route_t{
+    uint64_t key_min;                 //!< First key
+    uint64_t key_max;                 //!< Last key
+    uint32_t handlers;                //!< Bit n set for handlers[DW1000_MAC_EV_RX_COMPLETE][n]
+}dw1000_mac_route_t;
+
+//! Per event handler tables and rx routes, compiled from interface_cbs whenever an interface is added or removed.
+typedef struct _dw1000_mac_dispatch_t{
+    uint8_t nhandlers[DW1000_MAC_EV_NUM];                                   //!< Handlers per event
+    uint8_t nroutes;                                                        //!< Routes in use
+    uint8_t nfallback;                                                      //!< Handlers in the fallback chain
+    uint32_t rx_default;                                                    //!< Rx handlers for frames without a route
+    uint32_t rx_any;                                                        //!< Rx handlers of rx_default that only read the payload of routed frames
+    dw1000_mac_handler_t handlers[DW1000_MAC_EV_NUM][DW1000_MAC_INTERFACE_MAX];  //!< Handlers per event
+    dw1000_mac_route_t routes[2 * DW1000_MAC_INTERFACE_MAX];                //!< Disjoint, sorted by key
+    dw1000_mac_handler_t fallback[DW1000_MAC_INTERFACE_MAX];                //!< Rx handlers of unclaimed frames
+}dw1000_mac_dispatch_t;
+
+//! Frame types known to the rx classifier.
+typedef enum _dw1000_mac_ftype_t{
+    DW1000_MAC_FTYPE_UNKNOWN,         //!< Only fctrl and seq_num decoded
+    DW1000_MAC_FTYPE_BLINK,           //!< One octet frame control and 64-bit source, as ieee_blink_frame_t
+    DW1000_MAC_FTYPE_STD,             //!< 16-bit addresses and compressed PAN ID, as ieee_std_frame_t
+}dw1000_mac_ftype_t;
+
+//! Header of the received frame, decoded once by dw1000_mac_classify() before the rx callbacks run.
+typedef struct _dw1000_mac_frame_desc_t{
+    uint8_t type;                     //!< dw1000_mac_ftype_t
+    uint8_t seq_num;                  //!< Sequence number
+    uint16_t fctrl;                   //!< Frame control, the first octet only for blinks
+    uint16_t PANID;                   //!< PAN ID, std frames
+    uint16_t dst_address;             //!< Destination address, std frames
+    uint16_t src_address;             //!< Source address, std frames
+    uint16_t code;                    //!< Frame code, std frames long enough to carry one
+    uint64_t euid;                    //!< Source EUID, blinks
+    uint8_t has_code:1;               //!< code is valid
+    uint8_t hdr_only:1;               //!< Only the header is offered, the payload was not read unless an rx handler reads every payload
+    uint8_t hdr_len;                  //!< Octets decoded, the payload follows
+    uint64_t key;                     //!< Route key, fctrl << 17 | has_code << 16 | code
+}dw1000_mac_frame_desc_t;
+
 //! Device instance parameters.
 typedef struct _dw1000_dev_instance_t{
     struct os_dev uwb_dev;                      //!< Has to be here for cast in create_dev to work 
     struct dpl_sem * spi_sem;                   //!< Pointer to global spi bus semaphore
     struct dpl_sem spi_nb_sem;                  //!< Semaphore for nonblocking rd/wr operations
+    dw1000_bus_t * bus;                         //!< Scheduler of the bus shared by the instances with the same spi_sem
+    uint8_t bus_dev;                            //!< Index of the instance in bus->devs
+    void * irq_task_id;                         //!< Interrupt task, its accesses are scheduled as DW1000_BUS_PRIO_IRQ
+    uint16_t spi_rd_noblock_min;                //!< Reads of at least this many bytes use the nonblocking path
+    uint16_t spi_wr_noblock_min;                //!< Writes of at least this many bytes, header included, use the nonblocking path
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+    dw1000_spi_cal_t spi_cal;                   //!< Measured cost curves of the blocking and nonblocking paths
+#endif
+    dw1000_async_t async;                       //!< Asynchronous access queues
+    uint16_t tx_tmpl_top;                       //!< First TX buffer octet not allocated to a template
+    uint32_t tx_tmpl_epoch;                     //!< Incremented whenever the resident templates are lost
+    dw1000_wake_t wake;                         //!< Configuration restored on wakeup
+    dw1000_profile_state_t profile;             //!< Profile registers last applied
     struct dpl_sem tx_sem;                      //!< semphore for low level mac/phy functions
     struct dpl_mutex mutex;                     //!< os_mutex
     uint32_t epoch; 
     uint8_t idx;                                //!< instance number number {0, 1, 2 etc}
 
     SLIST_HEAD(,_dw1000_mac_interface_t) interface_cbs;
+    dw1000_mac_dispatch_t dispatch;             //!< Handler tables compiled from interface_cbs
+    dw1000_mac_frame_desc_t frame_desc;         //!< Header of the frame passed to rx_complete_cb
+#if MYNEWT_VAL(DW1000_LATENCY)
+    dw1000_latency_t latency;                   //!< Interrupt path latency histograms
+#endif
 
 #if MYNEWT_VAL(DW1000_LWIP)
     void (* lwip_rx_complete_cb) (struct _dw1000_dev_instance_t *);
@@ -316,7 +516,6 @@ typedef struct _dw1000_dev_instance_t{
     uint8_t otp_vbat;              //!< OTP parameter for voltage 
     uint8_t otp_temp;              //!< OTP parameter for temperature
     uint8_t xtal_trim;             //!< Crystal trim
-    uint32_t sys_cfg_reg;          //!< System config register
     uint32_t tx_fctrl;             //!< Transmit frame control register parameter 
     uint32_t sys_status;           //!< SYS_STATUS_ID for current event
     uint16_t rx_antenna_delay;     //!< Receive antenna delay
@@ -337,6 +536,7 @@ typedef struct _dw1000_dev_instance_t{
     dw1000_dev_config_t config;                    //!< DW1000 device configurations  
     dw1000_dev_control_t control;                  //!< DW1000 device control parameters      
     dw1000_dev_status_t status;                    //!< DW1000 device status 
+    dw1000_shadow_t shadow;                        //!< Shadow cache of host owned registers
     uint16_t role;                                 //!< Roles for this device
     struct _phy_attributes_t attrib;
     
@@ -356,6 +556,20 @@ dw1000_dev_status_t dw1000_read(dw1000_dev_instance_t * inst, uint16_t reg, uint
 dw1000_dev_status_t dw1000_write(dw1000_dev_instance_t * inst, uint16_t reg, uint16_t subaddress, uint8_t * buffer, uint16_t length);
 uint64_t dw1000_read_reg(dw1000_dev_instance_t * inst, uint16_t reg, uint16_t subaddress, size_t nsize);
 void dw1000_write_reg(dw1000_dev_instance_t * inst, uint16_t reg, uint16_t subaddress, uint64_t val, size_t nsize);
+void dw1000_xfer_list_init(dw1000_xfer_list_t * list);
+void dw1000_xfer_list_read(dw1000_xfer_list_t * list, uint16_t reg, uint16_t subaddress, uint8_t * buffer, uint16_t length);
+void dw1000_xfer_list_write(dw1000_xfer_list_t * list, uint16_t reg, uint16_t subaddress, uint8_t * buffer, uint16_t length);
+void dw1000_xfer_list_write_reg(dw1000_xfer_list_t * list, uint16_t reg, uint16_t subaddress, uint64_t val, size_t nbytes);
+dw1000_dev_status_t dw1000_xfer_list_submit(dw1000_dev_instance_t * inst, dw1000_xfer_list_t * list);
+void dw1000_async_init(dw1000_async_req_t * req, void (* complete_cb)(struct _dw1000_dev_instance_t *, dw1000_async_req_t *), void * arg);
+void dw1000_async_submit(dw1000_dev_instance_t * inst, dw1000_async_req_t * req);
+dpl_error_t dw1000_async_wait(dw1000_dev_instance_t * inst, dw1000_async_req_t * req, dpl_time_t timeout);
+uint32_t dw1000_shadow_read(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg);
+void dw1000_shadow_write(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg, uint32_t val);
+void dw1000_shadow_update(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg, uint32_t val);
+bool dw1000_shadow_queue(dw1000_dev_instance_t * inst, dw1000_xfer_list_t * list, dw1000_shadow_reg_t reg, uint32_t val);
+void dw1000_shadow_modify(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg, uint32_t clear, uint32_t set);
+void dw1000_shadow_invalidate(dw1000_dev_instance_t * inst);
 void dw1000_dev_set_sleep_timer(dw1000_dev_instance_t * inst, uint16_t count);
 void dw1000_dev_configure_sleep(dw1000_dev_instance_t * inst);
 dw1000_dev_status_t dw1000_dev_enter_sleep(dw1000_dev_instance_t * inst);
@@ -49,6 +49,14 @@ void hal_dw1000_read_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t
 void hal_dw1000_write(struct _dw1000_dev_instance_t * inst, const uint8_t * cmd, uint8_t cmd_size, uint8_t * buffer, uint16_t length);
 void hal_dw1000_write_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t * cmd, uint8_t cmd_size, uint8_t * buffer, uint16_t length);
 dpl_error_t hal_dw1000_rw_noblock_wait(struct _dw1000_dev_instance_t * inst, dpl_time_t timeout);
+void hal_dw1000_xfer(struct _dw1000_dev_instance_t * inst, const struct _dw1000_xfer_t * xfers, uint16_t nxfers);
+void hal_dw1000_async_start(struct _dw1000_dev_instance_t * inst);
+void hal_dw1000_bus_attach(struct _dw1000_dev_instance_t * inst);
+uint8_t hal_dw1000_bus_prio(struct _dw1000_dev_instance_t * inst, uint32_t length);
+dpl_error_t hal_dw1000_bus_acquire(struct _dw1000_dev_instance_t * inst, uint8_t prio, dpl_time_t timeout);
+void hal_dw1000_bus_release(struct _dw1000_dev_instance_t * inst);
+void hal_dw1000_bus_clear(struct _dw1000_dev_instance_t * inst);
+void hal_dw1000_bus_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...));
 
 void hal_dw1000_wakeup(struct _dw1000_dev_instance_t * inst);
 int hal_dw1000_get_rst(struct _dw1000_dev_instance_t * inst);
@@ -0,0 +1,122 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_latency.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Interrupt path latency histograms
+ *
+ * @details With DW1000_LATENCY set the driver timestamps the DW1000 IRQ edge with os_cputime and keeps a
+ * log2 histogram, in us, per stage of the interrupt path: IRQ to the interrupt event running, the status
+ * and frame SPI reads, the rx and tx callback chains, IRQ to the end of the interrupt event and IRQ to the
+ * next dw1000_start_rx()/dw1000_start_tx(). Each interface also gets a histogram of its rx_complete_cb.
+ * Recording is an increment and a compare; with DW1000_LATENCY unset the macros expand to nothing and no
+ * storage is reserved.
+ */
+
+#ifndef _DW1000_LATENCY_H_
+#define _DW1000_LATENCY_H_
+
+#include <stdint.h>
+#include <syscfg/syscfg.h>
+#include <os/os_cputime.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DW1000_LATENCY_BINS     (16)    //!< bins[0] counts 0us, bins[n] [2^(n-1), 2^n) us, the last one everything above
+
+//! Stages of the interrupt path.
+typedef enum _dw1000_latency_stage_t{
+    DW1000_LAT_IRQ_TO_TASK,             //!< IRQ edge to dw1000_interrupt_ev_cb running
+    DW1000_LAT_SPI_STATUS,              //!< SYS_STATUS and RX_FINFO read
+    DW1000_LAT_SPI_FRAME,               //!< Frame, timestamps and diagnostics read
+    DW1000_LAT_RX_CHAIN,                //!< rx_complete_cb chain
+    DW1000_LAT_TX_CHAIN,                //!< tx_complete_cb chain
+    DW1000_LAT_IRQ_TO_DONE,             //!< IRQ edge to dw1000_interrupt_ev_cb returning
+    DW1000_LAT_IRQ_TO_RX_START,         //!< IRQ edge to the receiver being enabled again
+    DW1000_LAT_IRQ_TO_TX_START,         //!< IRQ edge to the next dw1000_start_tx
+    DW1000_LAT_NUM
+}dw1000_latency_stage_t;
+
+//! Log2 histogram of a latency.
+typedef struct _dw1000_latency_hist_t{
+    uint32_t bins[DW1000_LATENCY_BINS]; //!< Samples per bin
+    uint32_t max;                       //!< Largest sample in us
+}dw1000_latency_hist_t;
+
+//! Latency state of an instance.
+typedef struct _dw1000_latency_t{
+    uint32_t irq_ts;                    //!< os_cputime of the last IRQ edge
+    uint8_t pending;                    //!< IRQ_TO_RX_START and IRQ_TO_TX_START bits not yet recorded for irq_ts
+    dw1000_latency_hist_t hist[DW1000_LAT_NUM];     //!< Histogram per stage
+}dw1000_latency_t;
+
+/**
+ * API to add a sample to a histogram.
+ *
+ * @param hist   Pointer to dw1000_latency_hist_t.
+ * @param ticks  Latency in os_cputime ticks
+ * @return void
+ */
+static inline void
+dw1000_latency_record(dw1000_latency_hist_t * hist, uint32_t ticks)
+{
+    uint32_t us = os_cputime_ticks_to_usecs(ticks);
+    int bin = us ? 32 - __builtin_clz(us) : 0;
+
+    hist->bins[bin < DW1000_LATENCY_BINS ? bin : DW1000_LATENCY_BINS - 1]++;
+    if (us > hist->max)
+        hist->max = us;
+}
+
+struct _dw1000_dev_instance_t;
+void dw1000_latency_clear(struct _dw1000_dev_instance_t * inst);
+void dw1000_latency_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...));
+
+#if MYNEWT_VAL(DW1000_LATENCY)
+#define DW1000_LAT_STAMP(__t) uint32_t __t = os_cputime_get32()
+#define DW1000_LAT_RECORD(__hist, __t) dw1000_latency_record(__hist, os_cputime_get32() - (__t))
+#define DW1000_LAT_SINCE(__inst, __stage, __t) DW1000_LAT_RECORD(&(__inst)->latency.hist[__stage], __t)
+#define DW1000_LAT_IRQ(__inst) do { \
+    (__inst)->latency.irq_ts = os_cputime_get32(); \
+    (__inst)->latency.pending = (1 << DW1000_LAT_IRQ_TO_RX_START) | (1 << DW1000_LAT_IRQ_TO_TX_START); \
+    } while (0)
+#define DW1000_LAT_FROM_IRQ(__inst, __stage) DW1000_LAT_SINCE(__inst, __stage, (__inst)->latency.irq_ts)
+#define DW1000_LAT_FIRST_FROM_IRQ(__inst, __stage) do { \
+    if ((__inst)->latency.pending & (1 << (__stage))) { \
+        (__inst)->latency.pending &= ~(1 << (__stage)); \
+        DW1000_LAT_FROM_IRQ(__inst, __stage); } \
+    } while (0)
+#else
+#define DW1000_LAT_STAMP(__t)
+#define DW1000_LAT_RECORD(__hist, __t)
+#define DW1000_LAT_SINCE(__inst, __stage, __t)
+#define DW1000_LAT_IRQ(__inst) do {} while (0)
+#define DW1000_LAT_FROM_IRQ(__inst, __stage)
+#define DW1000_LAT_FIRST_FROM_IRQ(__inst, __stage) do {} while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_LATENCY_H_ */
@@ -164,6 +164,9 @@ typedef struct _dw1000_mac_deviceentcnts_t{
 void dw1000_mac_remove_interface(dw1000_dev_instance_t * inst, dw1000_extension_id_t id);
 void dw1000_mac_append_interface(dw1000_dev_instance_t* inst, dw1000_mac_interface_t * cbs);
 dw1000_mac_interface_t * dw1000_mac_get_interface(dw1000_dev_instance_t * inst, dw1000_extension_id_t id);
+void dw1000_mac_dispatch_rebuild(dw1000_dev_instance_t * inst);
+bool dw1000_mac_dispatch(dw1000_dev_instance_t * inst, dw1000_mac_event_t event);
+void dw1000_mac_classify(dw1000_dev_instance_t * inst);
 struct _dw1000_dev_status_t dw1000_mac_init(struct _dw1000_dev_instance_t * inst, struct _dw1000_dev_config_t * config);
 struct _dw1000_dev_status_t dw1000_mac_config(struct _dw1000_dev_instance_t * inst, dw1000_dev_config_t * config);
 void dw1000_tasks_init(struct _dw1000_dev_instance_t * inst);
@@ -181,6 +184,8 @@ struct _dw1000_dev_status_t dw1000_stop_rx(struct _dw1000_dev_instance_t * inst)
 void dw1000_write_tx_fctrl(struct _dw1000_dev_instance_t * inst, uint16_t txFrameLength, uint16_t txBufferOffset);
 struct _dw1000_dev_status_t dw1000_sync_rxbufptrs(struct _dw1000_dev_instance_t * inst);
 struct _dw1000_dev_status_t dw1000_read_accdata(struct _dw1000_dev_instance_t * inst, uint8_t *buffer, uint16_t len, uint16_t accOffset);
+void dw1000_read_accdata_async(struct _dw1000_dev_instance_t * inst, dw1000_async_req_t * req, uint8_t *buffer, uint16_t accOffset, uint16_t len);
+void dw1000_accdata_clocks_queue(dw1000_xfer_list_t * list, uint16_t pmsc_ctrl, bool enable);
 struct _dw1000_dev_status_t dw1000_enable_autoack(struct _dw1000_dev_instance_t * inst, uint8_t delay);
 struct _dw1000_dev_status_t dw1000_set_dblrxbuff(struct _dw1000_dev_instance_t * inst, bool flag);
 void dw1000_set_callbacks(struct _dw1000_dev_instance_t * inst, dw1000_dev_cb_t cb_TxDone, dw1000_dev_cb_t cb_RxOk, dw1000_dev_cb_t cb_RxTo, dw1000_dev_cb_t cb_RxErr);
@@ -0,0 +1,73 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_profile.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Precompiled PHY/MAC register profiles
+ *
+ * @details dw1000_profile_compile() turns a dw1000_dev_config_t into the values of the registers
+ * dw1000_mac_config() and dw1000_phy_config_txrf() program: channel, PRF, data rate, preamble, SFD,
+ * AGC, LDE and TX power. A compiled profile only depends on the configuration, so an application
+ * switching between a few of them, e.g. channel hopping or a ranging and a data rate, compiles each
+ * once and keeps it. dw1000_profile_apply() writes the registers whose value differs from what the
+ * instance last applied, as transfer lists, together with SYS_CFG and TX_FCTRL through the shadow
+ * cache, so going back to a profile costs only the registers it does not share with the current one.
+ * dw1000_mac_config() is a compile followed by an apply.
+ */
+
+#ifndef _DW1000_PROFILE_H_
+#define _DW1000_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <dw1000/dw1000_dev.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Configuration compiled into register values.
+typedef struct _dw1000_profile_t{
+    dw1000_dev_config_t config;                 //!< Configuration compiled, becomes inst->config when applied
+    uint32_t regs[DW1000_PROFILE_NREGS];        //!< Register values
+    uint32_t present;                           //!< Bit n set when the configuration programs regs[n]
+    uint32_t sys_cfg_clear;                     //!< SYS_CFG bits owned by the profile
+    uint32_t sys_cfg_set;                       //!< SYS_CFG bits set among them
+    uint32_t tx_fctrl;                          //!< TX_FCTRL preamble, PRF and data rate
+}dw1000_profile_t;
+
+//! Set register _reg of a profile being compiled, e.g. DW1000_PROFILE_SET(profile, CHAN_CTRL, val)
+#define DW1000_PROFILE_SET(_profile, _reg, _val) do { \
+        (_profile)->regs[DW1000_PROFILE_##_reg] = (_val); \
+        (_profile)->present |= 1UL << DW1000_PROFILE_##_reg; \
+    } while (0)
+
+void dw1000_profile_compile(dw1000_profile_t * profile, dw1000_dev_config_t * config);
+dw1000_dev_status_t dw1000_profile_apply(dw1000_dev_instance_t * inst, dw1000_profile_t * profile);
+bool dw1000_profile_equal(dw1000_profile_t * a, dw1000_profile_t * b);
+void dw1000_profile_invalidate(dw1000_dev_instance_t * inst);
+void dw1000_profile_dump(dw1000_dev_instance_t * inst, int (* print)(const char *, ...));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_PROFILE_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_spi_cal.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Blocking vs non-blocking SPI threshold calibration
+ *
+ * @details dw1000_read() and dw1000_write() send short transfers with the blocking byte loop and long
+ * ones through hal_spi_txrx_noblock() and spi_nb_sem. Where the two cost the same depends on the MCU,
+ * its SPI driver and the baudrate, so rather than only trusting DW1000_DEVICE_SPI_RD_MAX_NOBLOCK and
+ * DW1000_DEVICE_SPI_WR_MAX_NOBLOCK, DW1000_SPI_CALIBRATE has dw1000_dev_config() time both paths over
+ * a grid of sizes, reading RX_BUFFER and writing TX_BUFFER, and set the per direction thresholds from
+ * where the curves cross. The curves are kept on the instance and printed with "dw1000 spi".
+ */
+
+#ifndef _DW1000_SPI_CAL_H_
+#define _DW1000_SPI_CAL_H_
+
+#include <stdint.h>
+#include <syscfg/syscfg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DW1000_SPI_CAL_NSIZES   (14)    //!< Transfer sizes timed, see dw1000_spi_cal_sizes
+#define DW1000_SPI_CAL_REPS     (16)    //!< Transfers per size and round
+#define DW1000_SPI_CAL_ROUNDS   (4)     //!< Rounds per size, the fastest one is kept
+
+//! Payload sizes, in bytes, the calibration times.
+extern const uint16_t dw1000_spi_cal_sizes[DW1000_SPI_CAL_NSIZES];
+
+//! Measured cost curves, ns per transfer at each of dw1000_spi_cal_sizes.
+typedef struct _dw1000_spi_cal_t{
+    uint32_t rd_block_ns[DW1000_SPI_CAL_NSIZES];    //!< hal_dw1000_read
+    uint32_t rd_noblock_ns[DW1000_SPI_CAL_NSIZES];  //!< hal_dw1000_read_noblock
+    uint32_t wr_block_ns[DW1000_SPI_CAL_NSIZES];    //!< hal_dw1000_write
+    uint32_t wr_noblock_ns[DW1000_SPI_CAL_NSIZES];  //!< hal_dw1000_write_noblock
+}dw1000_spi_cal_t;
+
+struct _dw1000_dev_instance_t;
+uint16_t dw1000_spi_cal_threshold(const uint32_t * block_ns, const uint32_t * noblock_ns);
+void dw1000_spi_calibrate(struct _dw1000_dev_instance_t * inst);
+void dw1000_spi_cal_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_SPI_CAL_H_ */
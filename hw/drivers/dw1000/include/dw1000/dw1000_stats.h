@@ -50,6 +50,15 @@ STATS_SECT_START(mac_stat_section)
     STATS_SECT_ENTRY(LDE_err)
     STATS_SECT_ENTRY(RX_err)
     STATS_SECT_ENTRY(TXBUF_err)
+    STATS_SECT_ENTRY(RX_routed)
+    STATS_SECT_ENTRY(RX_default)
+    STATS_SECT_ENTRY(RX_fallback)
+    STATS_SECT_ENTRY(RX_unclaimed)
+    STATS_SECT_ENTRY(RX_hdr_only)
+    STATS_SECT_ENTRY(RX_dropped)
+    STATS_SECT_ENTRY(RX_foreign_pan)
+    STATS_SECT_ENTRY(rx_bytes_skipped)
+    STATS_SECT_ENTRY(tx_bytes_saved)
 STATS_SECT_END
 #endif
 
@@ -0,0 +1,320 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_time.h
+ * @author paul kettle
+ * @date 2019
+ * @brief 40-bit device time unit arithmetic
+ *
+ * @details The DW1000 system time, TX and RX stamps count device time units (DTU) of 1/(128*499.2MHz),
+ * about 15.65ps, in a 40-bit counter that wraps every 17.2s. Delays are configured in UWB microseconds
+ * (UUS) of 2^16 DTU, and delayed TX/RX ignores the low 9 bits of DX_TIME. This header holds the wrap-safe
+ * add, difference and compare, the UUS and delayed transmit helpers and exact integer conversions to and
+ * from ns and us, plus batch forms of the conversions for buffers of stamps.
+ *
+ * Everything is static inline and integer only; the ns/us conversions use the exact ratio
+ * 1 ns = 39936/625 DTU and round to nearest.
+ */
+
+#ifndef _DW1000_TIME_H_
+#define _DW1000_TIME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DW1000_DTU_BITS         (40)
+#define DW1000_DTU_MASK         (0xFFFFFFFFFFULL)       //!< 40-bit counter
+#define DW1000_DTU_UUS_SHIFT    (16)                    //!< 1 UUS = 2^16 DTU
+#define DW1000_DTU_DX_MASK      (0x1FFULL)              //!< Bits ignored by delayed TX/RX
+#define DW1000_DTU_PER_NS_NUM   (39936)                 //!< DTU per ns, numerator
+#define DW1000_DTU_PER_NS_DEN   (625)                   //!< DTU per ns, denominator
+
+typedef uint64_t dw1000_dtu_t;      //!< 40-bit timestamp, upper 24 bits always zero
+
+/**
+ * API to reduce a value to the 40-bit counter range.
+ *
+ * @param t  Timestamp or sum of timestamps
+ * @return dw1000_dtu_t
+ */
+static inline dw1000_dtu_t
+dw1000_dtu_wrap(uint64_t t)
+{
+    return t & DW1000_DTU_MASK;
+}
+
+/**
+ * API to add a signed offset to a timestamp.
+ *
+ * @param t      Timestamp
+ * @param delta  Offset in DTU, either sign
+ * @return dw1000_dtu_t
+ */
+static inline dw1000_dtu_t
+dw1000_dtu_add(dw1000_dtu_t t, int64_t delta)
+{
+    return (t + (uint64_t)delta) & DW1000_DTU_MASK;
+}
+
+/**
+ * API to measure the forward interval from b to a, in [0, 2^40).
+ *
+ * @param a  Later timestamp
+ * @param b  Earlier timestamp
+ * @return uint64_t
+ */
+static inline uint64_t
+dw1000_dtu_sub(dw1000_dtu_t a, dw1000_dtu_t b)
+{
+    return (a - b) & DW1000_DTU_MASK;
+}
+
+/**
+ * API to measure the shortest signed interval a - b, in [-2^39, 2^39).
+ *
+ * @param a  Timestamp
+ * @param b  Timestamp
+ * @return int64_t
+ */
+static inline int64_t
+dw1000_dtu_diff(dw1000_dtu_t a, dw1000_dtu_t b)
+{
+    return (int64_t)((a - b) << (64 - DW1000_DTU_BITS)) >> (64 - DW1000_DTU_BITS);
+}
+
+/**
+ * API to test whether a precedes b by less than half the counter range.
+ *
+ * @param a  Timestamp
+ * @param b  Timestamp
+ * @return bool
+ */
+static inline bool
+dw1000_dtu_before(dw1000_dtu_t a, dw1000_dtu_t b)
+{
+    return dw1000_dtu_diff(a, b) < 0;
+}
+
+/**
+ * API to test whether a follows b by less than half the counter range.
+ *
+ * @param a  Timestamp
+ * @param b  Timestamp
+ * @return bool
+ */
+static inline bool
+dw1000_dtu_after(dw1000_dtu_t a, dw1000_dtu_t b)
+{
+    return dw1000_dtu_diff(a, b) > 0;
+}
+
+/**
+ * API to extend a 40-bit timestamp to 64 bits next to a reference that is already extended,
+ * e.g. to keep a monotonic epoch across wraps.
+ *
+ * @param ref  64-bit reference within 2^39 DTU of t
+ * @param t    40-bit timestamp
+ * @return uint64_t
+ */
+static inline uint64_t
+dw1000_dtu_extend(uint64_t ref, dw1000_dtu_t t)
+{
+    return ref + dw1000_dtu_diff(t, dw1000_dtu_wrap(ref));
+}
+
+/**
+ * API to convert UWB microseconds to DTU.
+ *
+ * @param uus  Interval in UUS
+ * @return uint64_t
+ */
+static inline uint64_t
+dw1000_uus_to_dtu(uint64_t uus)
+{
+    return uus << DW1000_DTU_UUS_SHIFT;
+}
+
+/**
+ * API to convert DTU to whole UWB microseconds, truncating.
+ *
+ * @param dtu  Interval in DTU
+ * @return uint64_t
+ */
+static inline uint64_t
+dw1000_dtu_to_uus(uint64_t dtu)
+{
+    return dtu >> DW1000_DTU_UUS_SHIFT;
+}
+
+/**
+ * API to align a time to the resolution of DX_TIME. Works on extended 64-bit times too.
+ *
+ * @param t  Timestamp
+ * @return uint64_t
+ */
+static inline uint64_t
+dw1000_dtu_dx_align(uint64_t t)
+{
+    return t & ~DW1000_DTU_DX_MASK;
+}
+
+/**
+ * API to compute the DX_TIME of a delayed transmission or reception.
+ *
+ * @param t      Reference timestamp
+ * @param delay  Delay in DTU
+ * @return dw1000_dtu_t  Wrapped and aligned to the DX_TIME resolution
+ */
+static inline dw1000_dtu_t
+dw1000_dtu_dx_time(dw1000_dtu_t t, uint64_t delay)
+{
+    return (t + delay) & DW1000_DTU_MASK & ~DW1000_DTU_DX_MASK;
+}
+
+/**
+ * API to predict the TX stamp of a delayed transmission, which the DW1000 reports with the
+ * antenna delay added to DX_TIME.
+ *
+ * @param dx_time        Programmed DX_TIME
+ * @param antenna_delay  TX antenna delay in DTU
+ * @return dw1000_dtu_t
+ */
+static inline dw1000_dtu_t
+dw1000_dtu_tx_stamp(dw1000_dtu_t dx_time, uint16_t antenna_delay)
+{
+    return (dx_time + antenna_delay) & DW1000_DTU_MASK;
+}
+
+/* Round to nearest, half away from zero, for a positive divisor */
+static inline int64_t
+dw1000_dtu_div_round(int64_t num, int64_t den)
+{
+    return (num >= 0) ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+/**
+ * API to convert an interval in DTU to ns.
+ *
+ * @param dtu  Interval, at most 2^53 DTU in magnitude
+ * @return int64_t
+ */
+static inline int64_t
+dw1000_dtu_to_ns(int64_t dtu)
+{
+    return dw1000_dtu_div_round(dtu * DW1000_DTU_PER_NS_DEN, DW1000_DTU_PER_NS_NUM);
+}
+
+/**
+ * API to convert an interval in ns to DTU.
+ *
+ * @param ns  Interval, at most 2^47 ns in magnitude
+ * @return int64_t
+ */
+static inline int64_t
+dw1000_ns_to_dtu(int64_t ns)
+{
+    return dw1000_dtu_div_round(ns * DW1000_DTU_PER_NS_NUM, DW1000_DTU_PER_NS_DEN);
+}
+
+/**
+ * API to convert an interval in DTU to us.
+ *
+ * @param dtu  Interval, at most 2^53 DTU in magnitude
+ * @return int64_t
+ */
+static inline int64_t
+dw1000_dtu_to_us(int64_t dtu)
+{
+    return dw1000_dtu_div_round(dtu * DW1000_DTU_PER_NS_DEN, DW1000_DTU_PER_NS_NUM * 1000LL);
+}
+
+/**
+ * API to convert an interval in us to DTU.
+ *
+ * @param us  Interval, at most 2^37 us in magnitude
+ * @return int64_t
+ */
+static inline int64_t
+dw1000_us_to_dtu(int64_t us)
+{
+    return dw1000_dtu_div_round(us * DW1000_DTU_PER_NS_NUM * 1000LL, DW1000_DTU_PER_NS_DEN);
+}
+
+/**
+ * API to compute the signed intervals of a buffer of timestamps from a common reference,
+ * e.g. the reception times of a TDoA round against the master epoch.
+ *
+ * @param ts   Timestamps
+ * @param ref  Reference timestamp
+ * @param out  Intervals ts[i] - ref in DTU, may alias ts
+ * @param n    Number of timestamps
+ * @return void
+ */
+static inline void
+dw1000_dtu_diff_batch(const dw1000_dtu_t * ts, dw1000_dtu_t ref, int64_t * out, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = dw1000_dtu_diff(ts[i], ref);
+    }
+}
+
+/**
+ * API to convert a buffer of intervals from DTU to ns.
+ *
+ * @param dtu  Intervals in DTU
+ * @param ns   Intervals in ns, may alias dtu
+ * @param n    Number of intervals
+ * @return void
+ */
+static inline void
+dw1000_dtu_to_ns_batch(const int64_t * dtu, int64_t * ns, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++) {
+        ns[i] = dw1000_dtu_to_ns(dtu[i]);
+    }
+}
+
+/**
+ * API to extend a buffer of 40-bit timestamps, in time order, to 64 bits.
+ *
+ * @param ref  64-bit reference within 2^39 DTU of ts[0]
+ * @param ts   Timestamps, successive ones less than 2^39 DTU apart
+ * @param out  Extended timestamps, may alias ts
+ * @param n    Number of timestamps
+ * @return uint64_t  The last extended timestamp, the reference for the next buffer
+ */
+static inline uint64_t
+dw1000_dtu_extend_batch(uint64_t ref, const dw1000_dtu_t * ts, uint64_t * out, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++) {
+        ref = out[i] = dw1000_dtu_extend(ref, ts[i]);
+    }
+    return ref;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_TIME_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_tx_tmpl.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Resident TX frame templates
+ *
+ * @details Periodic services send the same frame over and over with only the sequence number, a
+ * timestamp or a few payload fields changed. A template reserves a fixed area of the TX buffer above
+ * DW1000_TX_TMPL_BASE for one such frame and keeps a host copy of what is resident there.
+ * dw1000_tx_tmpl_write() then only sends the octets that differ from the copy and points TX_FCTRL
+ * at the template, instead of rewriting the whole frame at offset 0 with dw1000_write_tx().
+ *
+ * The resident copies are dropped whenever the device may have lost its TX buffer, see
+ * dw1000_shadow_invalidate(), or a dw1000_write_tx() reached into the template area; the next
+ * write of each template is then a full one.
+ */
+
+#ifndef _DW1000_TX_TMPL_H_
+#define _DW1000_TX_TMPL_H_
+
+#include <stdint.h>
+#include <syscfg/syscfg.h>
+#include <dpl/dpl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DW1000_TX_TMPL_BASE     MYNEWT_VAL(DW1000_TX_TMPL_BASE)    //!< First TX buffer octet used by templates
+#define DW1000_TX_TMPL_LEN      MYNEWT_VAL(DW1000_TX_TMPL_LEN)     //!< Longest frame held by a template
+
+//! Frame kept resident in the TX buffer.
+typedef struct _dw1000_tx_tmpl_t{
+    uint16_t offset;                    //!< Offset in the TX buffer
+    uint16_t size;                      //!< Octets reserved, 0 until allocated
+    uint16_t len;                       //!< Length of the resident frame
+    uint32_t epoch;                     //!< inst->tx_tmpl_epoch when the resident frame was written in full
+    uint32_t writes;                    //!< Frames written
+    uint32_t full_writes;               //!< Frames written in full
+    uint32_t bytes_written;             //!< Octets sent over SPI, command headers included
+    uint32_t bytes_saved;               //!< Octets a full dw1000_write_tx() would have sent on top
+    uint8_t resident[DW1000_TX_TMPL_LEN];   //!< Host copy of the resident frame
+}dw1000_tx_tmpl_t;
+
+struct _dw1000_dev_instance_t;
+dpl_error_t dw1000_tx_tmpl_alloc(struct _dw1000_dev_instance_t * inst, dw1000_tx_tmpl_t * tmpl, uint16_t size);
+struct _dw1000_dev_status_t dw1000_tx_tmpl_write(struct _dw1000_dev_instance_t * inst, dw1000_tx_tmpl_t * tmpl,
+                                                 uint8_t * frame, uint16_t len);
+void dw1000_tx_tmpl_invalidate(struct _dw1000_dev_instance_t * inst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_TX_TMPL_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_wake.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Wakeup configuration restore
+ *
+ * @details The AON block reloads most of the configuration on wakeup, but not all of it, the antenna
+ * delays kept in the LDE being the known casualty. Instead of rewriting a fixed set of registers one
+ * access at a time and dropping the shadow cache, dw1000_dev_enter_sleep() snapshots the host
+ * configured registers and the wakeups read them back to learn which ones, besides the antenna
+ * delays, the device lost and which it kept. A register is only known to be kept once it survived
+ * holding something other than its reset value. A wakeup rewrites the lost registers, together with
+ * clearing the wakeup events, as one transfer list, and keeps the shadow cache valid since the device
+ * then holds what it held before sleeping.
+ *
+ * The time from dw1000_dev_wakeup() to the device answering and to the configuration being restored,
+ * after which the receiver can be enabled, is recorded for each wakeup.
+ */
+
+#ifndef _DW1000_WAKE_H_
+#define _DW1000_WAKE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <syscfg/syscfg.h>
+#include <dpl/dpl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DW1000_WAKE_NREGS       (14)    //!< Host configured registers checked across sleep
+#define DW1000_WAKE_REG_LEN     (5)     //!< Longest of them, TX_FCTRL
+
+//! Configuration kept across sleep and wakeup latency.
+typedef struct _dw1000_wake_t{
+    uint8_t vals[DW1000_WAKE_NREGS][DW1000_WAKE_REG_LEN];  //!< Register values when entering sleep
+    uint32_t snapped;                   //!< Bit n set while vals[n] holds the value when entering sleep
+    uint32_t lost;                      //!< Bit n set for the registers a wakeup was found to change
+    uint32_t kept;                      //!< Bit n set for the registers a wakeup was found to keep, never snapped
+    uint32_t shadow_valid;              //!< Shadow cache entries valid when entering sleep
+    uint8_t armed:1;                    //!< Entered sleep with a snapshot, the next wakeup restores it
+    uint32_t wakeups;                   //!< Wakeups restored from a snapshot
+    uint32_t wake_usec;                 //!< Last wakeup, dw1000_dev_wakeup() to the device answering
+    uint32_t wake_usec_max;             //!< Longest wake_usec
+    uint32_t ready_usec;                //!< Last wakeup, dw1000_dev_wakeup() to the configuration restored
+    uint32_t ready_usec_max;            //!< Longest ready_usec
+    uint32_t ready_usec_total;          //!< Sum of ready_usec over the wakeups restored from a snapshot
+}dw1000_wake_t;
+
+struct _dw1000_dev_instance_t;
+void dw1000_wake_snapshot(struct _dw1000_dev_instance_t * inst);
+bool dw1000_wake_restore(struct _dw1000_dev_instance_t * inst);
+void dw1000_wake_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_WAKE_H_ */
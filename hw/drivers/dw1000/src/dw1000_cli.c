@@ -32,6 +32,7 @@
 #include <dw1000/dw1000_hal.h>
 #include <dw1000/dw1000_dev.h>
 #include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_profile.h>
 
 #include <shell/shell.h>
 #include <console/console.h>
@@ -56,6 +57,11 @@ static int dw1000_cli_cmd(int argc, char **argv);
 #if MYNEWT_VAL(SHELL_CMD_HELP)
 const struct shell_param cmd_dw1000_param[] = {
     {"dump", "[instance] dump all registers"},
+    {"lat", "[instance] [clear] interrupt path latency histograms"},
+    {"spi", "[instance] blocking/nonblocking spi thresholds and cost curves"},
+    {"bus", "[instance] [clear] shared spi bus contention statistics"},
+    {"wake", "[instance] wakeup restore and latency"},
+    {"profile", "[instance] phy/mac profile switches"},
     {NULL,NULL},
 };
 
@@ -121,6 +127,16 @@ dw1000_dump_registers(struct _dw1000_dev_instance_t * inst)
         }
     }
     console_printf("{\"inst->tx_sem\"=\"0x%0X\"}\n", dpl_sem_get_count(&inst->tx_sem));
+    console_printf("{\"shadow\":{\"hits\"=%lu,\"misses\"=%lu,\"writes_elided\"=%lu,\"invalidations\"=%lu}}\n",
+                   (unsigned long)inst->shadow.hits, (unsigned long)inst->shadow.misses,
+                   (unsigned long)inst->shadow.writes_elided, (unsigned long)inst->shadow.invalidations);
+#if MYNEWT_VAL(DW1000_MAC_STATS)
+    dw1000_mac_interface_t * cbs = NULL;
+    SLIST_FOREACH(cbs, &inst->interface_cbs, next){
+        console_printf("{\"interface\":{\"id\"=%u,\"rx_hits\"=%lu,\"rx_misses\"=%lu}}\n",
+                       cbs->id, (unsigned long)cbs->rx_hits, (unsigned long)cbs->rx_misses);
+    }
+#endif
 #if MYNEWT_VAL(RNG_ENABLED)
     dw1000_rng_instance_t *rng = (dw1000_rng_instance_t*)dw1000_mac_find_cb_inst_ptr(inst, DW1000_RNG);
     if (rng)
@@ -168,6 +184,54 @@ dw1000_cli_cmd(int argc, char **argv)
         }
         inst = hal_dw1000_inst(inst_n);
         dw1000_dump_registers(inst);
+    } else if (!strcmp(argv[1], "lat")) {
+        if (argc < 3) {
+            inst_n=0;
+        } else {
+            inst_n = strtol(argv[2], NULL, 0);
+        }
+        inst = hal_dw1000_inst(inst_n);
+        if (argc > 3 && !strcmp(argv[3], "clear")) {
+            dw1000_latency_clear(inst);
+        } else {
+            dw1000_latency_dump(inst, console_printf);
+        }
+    } else if (!strcmp(argv[1], "spi")) {
+        if (argc < 3) {
+            inst_n=0;
+        } else {
+            inst_n = strtol(argv[2], NULL, 0);
+        }
+        inst = hal_dw1000_inst(inst_n);
+        dw1000_spi_cal_dump(inst, console_printf);
+    } else if (!strcmp(argv[1], "bus")) {
+        if (argc < 3) {
+            inst_n=0;
+        } else {
+            inst_n = strtol(argv[2], NULL, 0);
+        }
+        inst = hal_dw1000_inst(inst_n);
+        if (argc > 3 && !strcmp(argv[3], "clear")) {
+            hal_dw1000_bus_clear(inst);
+        } else {
+            hal_dw1000_bus_dump(inst, console_printf);
+        }
+    } else if (!strcmp(argv[1], "wake")) {
+        if (argc < 3) {
+            inst_n=0;
+        } else {
+            inst_n = strtol(argv[2], NULL, 0);
+        }
+        inst = hal_dw1000_inst(inst_n);
+        dw1000_wake_dump(inst, console_printf);
+    } else if (!strcmp(argv[1], "profile")) {
+        if (argc < 3) {
+            inst_n=0;
+        } else {
+            inst_n = strtol(argv[2], NULL, 0);
+        }
+        inst = hal_dw1000_inst(inst_n);
+        dw1000_profile_dump(inst, console_printf);
     } else {
         console_printf("Unknown cmd\n");
     }
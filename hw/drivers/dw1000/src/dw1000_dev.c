@@ -40,6 +40,7 @@
 #include <dw1000/dw1000_regs.h>
 #include <dw1000/dw1000_hal.h>
 #include <dw1000/dw1000_phy.h>
+#include <dw1000/dw1000_profile.h>
 
 #define DIAGMSG(s,u) printf(s,u)
 #ifndef DIAGMSG
@@ -80,7 +81,7 @@ dw1000_read(dw1000_dev_instance_t * inst, uint16_t reg, uint16_t subaddress, uin
     /* Possible issue here when reading shorter amounts of data
      * using the nonblocking read with double buffer. Asserts on 
      * mutex releases seen in calling function when reading frames of length 8 */
-    if (length < MYNEWT_VAL(DW1000_DEVICE_SPI_RD_MAX_NOBLOCK)) {
+    if (length < inst->spi_rd_noblock_min) {
         hal_dw1000_read(inst, header, len, buffer, length);
     } else {
         hal_dw1000_read_noblock(inst, header, len, buffer, length);
@@ -122,7 +123,7 @@ dw1000_write(dw1000_dev_instance_t * inst, uint16_t reg, uint16_t subaddress, ui
 
     uint8_t len = cmd.subaddress?(cmd.extended?3:2):1; 
     /* Only use non-blocking write if the length of the write justifies it */
-    if (len+length < 4) {
+    if (len + length < inst->spi_wr_noblock_min) {
         hal_dw1000_write(inst, header, len, buffer, length);
     } else {
         hal_dw1000_write_noblock(inst, header, len, buffer, length);
@@ -213,6 +214,384 @@ dw1000_write_reg(dw1000_dev_instance_t * inst, uint16_t reg, uint16_t subaddress
     hal_dw1000_write(inst, header, len, buffer.array, nbytes);
 } 
 
+/**
+ * API to reset a transfer list to empty.
+ *
+ * @param list      Pointer to dw1000_xfer_list_t.
+ * @return void
+ */
+void
+dw1000_xfer_list_init(dw1000_xfer_list_t * list)
+{
+    list->nxfers = 0;
+    list->nvals = 0;
+}
+
+/**
+ * Queue a register access on a transfer list.
+ *
+ * @param list          Pointer to dw1000_xfer_list_t.
+ * @param operation     0 for read, 1 for write.
+ * @param reg           Register id.
+ * @param subaddress    Offset within the register.
+ * @param buffer        Source of a write or destination of a read.
+ * @param length        Length of the data phase.
+ * @return void
+ */
+static void
+dw1000_xfer_list_add(dw1000_xfer_list_t * list, uint8_t operation, uint16_t reg, uint16_t subaddress, uint8_t * buffer, uint16_t length)
+{
+    assert(reg <= 0x3F); // Record number is limited to 6-bits.
+    assert((subaddress <= 0x7FFF) && ((subaddress + length) <= 0x7FFF)); // Index and sub-addressable area are limited to 15-bits.
+    assert(list->nxfers < DW1000_XFER_LIST_MAX);
+
+    dw1000_cmd_t cmd = {
+        .reg = reg,
+        .subindex = subaddress != 0,
+        .operation = operation,
+        .extended = subaddress > 0x7F,
+        .subaddress = subaddress
+    };
+
+    dw1000_xfer_t * xfer = &list->xfers[list->nxfers++];
+    xfer->header[0] = cmd.operation << 7 | cmd.subindex << 6 | cmd.reg;
+    xfer->header[1] = cmd.extended << 7 | (uint8_t) (subaddress);
+    xfer->header[2] = (uint8_t) (subaddress >> 7);
+    xfer->header_len = cmd.subaddress?(cmd.extended?3:2):1;
+    xfer->buffer = buffer;
+    xfer->length = length;
+}
+
+/**
+ * API to queue a read on a transfer list. The buffer is filled when the list is submitted.
+ *
+ * @param list          Pointer to dw1000_xfer_list_t.
+ * @param reg           Register from where data is read.
+ * @param subaddress    Address where data is read.
+ * @param buffer        Result is stored in buffer.
+ * @param length        Represents buffer length.
+ * @return void
+ */
+void
+dw1000_xfer_list_read(dw1000_xfer_list_t * list, uint16_t reg, uint16_t subaddress, uint8_t * buffer, uint16_t length)
+{
+    dw1000_xfer_list_add(list, 0, reg, subaddress, buffer, length);
+}
+
+/**
+ * API to queue a write on a transfer list. The buffer must remain valid until the list is submitted.
+ *
+ * @param list          Pointer to dw1000_xfer_list_t.
+ * @param reg           Register into where data is written.
+ * @param subaddress    Address where writing of data begins.
+ * @param buffer        Data to be written.
+ * @param length        Represents buffer length.
+ * @return void
+ */
+void
+dw1000_xfer_list_write(dw1000_xfer_list_t * list, uint16_t reg, uint16_t subaddress, uint8_t * buffer, uint16_t length)
+{
+    dw1000_xfer_list_add(list, 1, reg, subaddress, buffer, length);
+}
+
+/**
+ * API to queue a register write on a transfer list, the value is copied into the list.
+ *
+ * @param list          Pointer to dw1000_xfer_list_t.
+ * @param reg           Register into where data is written.
+ * @param subaddress    Address where writing of data begins.
+ * @param val           Value to be written.
+ * @param nbytes        Length of data.
+ * @return void
+ */
+void
+dw1000_xfer_list_write_reg(dw1000_xfer_list_t * list, uint16_t reg, uint16_t subaddress, uint64_t val, size_t nbytes)
+{
+    assert(nbytes <= sizeof(uint64_t));
+    assert(list->nvals < DW1000_XFER_LIST_MAX);
+
+    uint64_t * p = &list->vals[list->nvals++];
+    *p = val;
+    dw1000_xfer_list_add(list, 1, reg, subaddress, (uint8_t *) p, nbytes);
+}
+
+/**
+ * API to execute a transfer list. All accesses are performed in order, each in its own chip select
+ * frame, with a single acquisition of the SPI bus and without completion callbacks in between.
+ * The list is empty on return.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param list  Pointer to dw1000_xfer_list_t.
+ * @return dw1000_dev_status_t
+ */
+dw1000_dev_status_t
+dw1000_xfer_list_submit(dw1000_dev_instance_t * inst, dw1000_xfer_list_t * list)
+{
+    if (list->nxfers)
+        hal_dw1000_xfer(inst, list->xfers, list->nxfers);
+    dw1000_xfer_list_init(list);
+    return inst->status;
+}
+
+/**
+ * Drains the completed queue of an instance, running the complete_cb of each request in completion order.
+ *
+ * @param ev  Pointer to the async.complete_ev of the instance.
+ * @return void
+ */
+static void
+dw1000_async_complete_ev_cb(struct dpl_event * ev)
+{
+    dw1000_dev_instance_t * inst = (dw1000_dev_instance_t *)dpl_event_get_arg(ev);
+    dw1000_async_req_t * req;
+    os_sr_t sr;
+
+    do {
+        OS_ENTER_CRITICAL(sr);
+        req = STAILQ_FIRST(&inst->async.completed);
+        if (req)
+            STAILQ_REMOVE_HEAD(&inst->async.completed, next);
+        OS_EXIT_CRITICAL(sr);
+        if (req)
+            req->complete_cb(inst, req);
+    } while (req);
+}
+
+/**
+ * API to prepare an asynchronous request. Queue the accesses on req->list with dw1000_xfer_list_read,
+ * dw1000_xfer_list_write and dw1000_xfer_list_write_reg, then hand it to dw1000_async_submit.
+ * To be told from the completion interrupt instead, set req->evq and req->ev.
+ *
+ * @param req          Pointer to dw1000_async_req_t.
+ * @param complete_cb  Called on the instance eventq once the request is done, may be NULL.
+ * @param arg          Stored in req->arg.
+ * @return void
+ */
+void
+dw1000_async_init(dw1000_async_req_t * req, void (* complete_cb)(struct _dw1000_dev_instance_t *, dw1000_async_req_t *), void * arg)
+{
+    assert(req);
+    memset(req, 0, sizeof(*req));
+    dw1000_xfer_list_init(&req->list);
+    req->complete_cb = complete_cb;
+    req->arg = arg;
+    req->done = 1;
+}
+
+/**
+ * API to submit an asynchronous request. The accesses are clocked out with hal_spi_txrx_noblock from the
+ * SPI completion interrupt while the caller carries on. Requests of an instance run and complete in
+ * submission order, back to back on a single acquisition of the SPI bus, and a blocking access issued
+ * after a submit waits for the pending queue to drain, unless made from the interrupt task while the
+ * engine runs bulk requests. The list is kept, the same request can be submitted again once it is
+ * done; with a complete_cb, only from or after the complete_cb.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param req   Pointer to dw1000_async_req_t, must remain valid until done.
+ * @return void
+ */
+void
+dw1000_async_submit(dw1000_dev_instance_t * inst, dw1000_async_req_t * req)
+{
+    bool start;
+    os_sr_t sr;
+
+    assert(inst && req);
+    assert(req->done);
+    req->done = 0;
+    req->waiting = 0;
+    req->header_sent = 0;
+    req->xfer = 0;
+    req->offset = 0;
+
+    OS_ENTER_CRITICAL(sr);
+    STAILQ_INSERT_TAIL(&inst->async.pending, req, next);
+    inst->async.submitted++;
+    start = !inst->async.busy;
+    inst->async.busy = 1;
+    OS_EXIT_CRITICAL(sr);
+
+    if (start)
+        hal_dw1000_async_start(inst);
+}
+
+/**
+ * API to block until an asynchronous request is done. The task sleeps on a semaphore released from the
+ * completion interrupt, so it may be called from the instance eventq. One task at a time may wait on
+ * an instance.
+ *
+ * @param inst     Pointer to dw1000_dev_instance_t.
+ * @param req      Pointer to dw1000_async_req_t.
+ * @param timeout  Time in os_ticks to wait, use DPL_TIMEOUT_NEVER to wait indefinitely
+ * @return dpl_error_t DPL_OK once done, DPL_TIMEOUT otherwise
+ */
+dpl_error_t
+dw1000_async_wait(dw1000_dev_instance_t * inst, dw1000_async_req_t * req, dpl_time_t timeout)
+{
+    dpl_error_t err;
+    os_sr_t sr;
+
+    assert(inst && req);
+    while (1) {
+        OS_ENTER_CRITICAL(sr);
+        req->waiting = !req->done;
+        OS_EXIT_CRITICAL(sr);
+        if (!req->waiting)
+            return DPL_OK;
+
+        /* A token left by an earlier wait that timed out only costs another turn of the loop */
+        err = dpl_sem_pend(&inst->async.done_sem, timeout);
+        if (err != DPL_OK) {
+            OS_ENTER_CRITICAL(sr);
+            req->waiting = 0;
+            OS_EXIT_CRITICAL(sr);
+            return req->done ? DPL_OK : err;
+        }
+    }
+}
+
+//! Location and access mask of each shadowed register
+static const struct {
+    uint16_t reg;
+    uint16_t subaddress;
+    uint32_t mask;
+} g_shadow_regs[DW1000_SHADOW_NREGS] = {
+    [DW1000_SHADOW_SYS_CFG] = {SYS_CFG_ID, 0, SYS_CFG_MASK},
+    [DW1000_SHADOW_SYS_MASK] = {SYS_MASK_ID, 0, 0xFFFFFFFFUL},
+    [DW1000_SHADOW_TX_FCTRL] = {TX_FCTRL_ID, 0, 0xFFFFFFFFUL},
+};
+
+/**
+ * API to read a host owned register through the shadow cache. Only the first read after an
+ * invalidation goes over SPI. The caller holds inst->mutex when the value is used for a
+ * read-modify-write.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param reg   Shadowed register.
+ * @return uint32_t
+ */
+uint32_t
+dw1000_shadow_read(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg)
+{
+    assert(reg < DW1000_SHADOW_NREGS);
+
+    if (inst->shadow.valid & (1UL << reg)) {
+        inst->shadow.hits++;
+        return inst->shadow.regs[reg];
+    }
+    inst->shadow.misses++;
+    inst->shadow.regs[reg] = g_shadow_regs[reg].mask & dw1000_read_reg(inst, g_shadow_regs[reg].reg,
+        g_shadow_regs[reg].subaddress, sizeof(uint32_t));
+#if MYNEWT_VAL(DW1000_REG_SHADOW)
+    inst->shadow.valid |= 1UL << reg;
+#endif
+    return inst->shadow.regs[reg];
+}
+
+/**
+ * API to write a host owned register, the shadow is updated with the value written.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param reg   Shadowed register.
+ * @param val   Value to be written.
+ * @return void
+ */
+void
+dw1000_shadow_write(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg, uint32_t val)
+{
+    assert(reg < DW1000_SHADOW_NREGS);
+
+    val &= g_shadow_regs[reg].mask;
+    dw1000_write_reg(inst, g_shadow_regs[reg].reg, g_shadow_regs[reg].subaddress, val, sizeof(uint32_t));
+    inst->shadow.regs[reg] = val;
+#if MYNEWT_VAL(DW1000_REG_SHADOW)
+    inst->shadow.valid |= 1UL << reg;
+#endif
+}
+
+/**
+ * API to write a host owned register only when the value differs from the shadow, e.g. TX_FCTRL
+ * ahead of a frame of the same length as the previous one.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param reg   Shadowed register.
+ * @param val   Value to be written.
+ * @return void
+ */
+void
+dw1000_shadow_update(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg, uint32_t val)
+{
+    assert(reg < DW1000_SHADOW_NREGS);
+
+    if ((inst->shadow.valid & (1UL << reg)) && inst->shadow.regs[reg] == (val & g_shadow_regs[reg].mask)) {
+        inst->shadow.writes_elided++;
+        return;
+    }
+    dw1000_shadow_write(inst, reg, val);
+}
+
+/**
+ * API to queue the write of a host owned register on a transfer list, skipped like
+ * dw1000_shadow_update() when the shadow already holds the value. The shadow is updated right
+ * away, the list has to be submitted before the register is used.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param list  Transfer list with room for one more access.
+ * @param reg   Shadowed register.
+ * @param val   Value to be written.
+ * @return true if the write was queued
+ */
+bool
+dw1000_shadow_queue(dw1000_dev_instance_t * inst, dw1000_xfer_list_t * list, dw1000_shadow_reg_t reg, uint32_t val)
+{
+    assert(reg < DW1000_SHADOW_NREGS);
+
+    val &= g_shadow_regs[reg].mask;
+    if ((inst->shadow.valid & (1UL << reg)) && inst->shadow.regs[reg] == val) {
+        inst->shadow.writes_elided++;
+        return false;
+    }
+    dw1000_xfer_list_write_reg(list, g_shadow_regs[reg].reg, g_shadow_regs[reg].subaddress, val, sizeof(uint32_t));
+    inst->shadow.regs[reg] = val;
+#if MYNEWT_VAL(DW1000_REG_SHADOW)
+    inst->shadow.valid |= 1UL << reg;
+#endif
+    return true;
+}
+
+/**
+ * API to clear and set bits of a host owned register. Once the shadow is valid this is a single
+ * SPI write instead of a read-modify-write.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param reg    Shadowed register.
+ * @param clear  Bits to clear.
+ * @param set    Bits to set, applied after clear.
+ * @return void
+ */
+void
+dw1000_shadow_modify(dw1000_dev_instance_t * inst, dw1000_shadow_reg_t reg, uint32_t clear, uint32_t set)
+{
+    dw1000_shadow_write(inst, reg, (dw1000_shadow_read(inst, reg) & ~clear) | set);
+}
+
+/**
+ * API to mark every shadowed and profile register as unknown, and the resident TX templates as lost.
+ * Called whenever the device may have lost or reloaded its configuration: soft reset, entering sleep
+ * and wakeup.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_shadow_invalidate(dw1000_dev_instance_t * inst)
+{
+    inst->shadow.valid = 0;
+    inst->shadow.invalidations++;
+    dw1000_profile_invalidate(inst);
+    dw1000_tx_tmpl_invalidate(inst);
+}
+
 /**
  * API to do softreset on dw1000 by writing data into PMSC_CTRL0_SOFTRESET_OFFSET.
  *
@@ -236,6 +615,7 @@ dw1000_softreset(dw1000_dev_instance_t * inst)
     os_cputime_delay_usecs(10);
 
     dw1000_write_reg(inst, PMSC_ID, PMSC_CTRL0_SOFTRESET_OFFSET, PMSC_CTRL0_RESET_CLEAR, sizeof(uint8_t)); // Clear reset
+    dw1000_shadow_invalidate(inst);
 }
 
 /**
@@ -270,8 +650,19 @@ dw1000_dev_init(struct os_dev *odev, void *arg)
     assert(err == DPL_OK);
     err = dpl_sem_init(&inst->spi_nb_sem, 0x1);
     assert(err == DPL_OK);
+    err = dpl_sem_init(&inst->async.done_sem, 0);
+    assert(err == DPL_OK);
+    STAILQ_INIT(&inst->async.pending);
+    STAILQ_INIT(&inst->async.completed);
+    dpl_event_init(&inst->async.complete_ev, dw1000_async_complete_ev_cb, (void *)inst);
+    inst->spi_rd_noblock_min = MYNEWT_VAL(DW1000_DEVICE_SPI_RD_MAX_NOBLOCK);
+    inst->spi_wr_noblock_min = MYNEWT_VAL(DW1000_DEVICE_SPI_WR_MAX_NOBLOCK);
+    inst->tx_tmpl_top = DW1000_TX_TMPL_BASE;
+    hal_dw1000_bus_attach(inst);
 
     SLIST_INIT(&inst->interface_cbs);
+    dw1000_mac_dispatch_rebuild(inst);
+    dw1000_shadow_invalidate(inst);
 
     return OS_OK;
 }
@@ -324,6 +715,9 @@ retry:
     assert(rc == 0);
     rc = hal_spi_enable(inst->spi_num);
     assert(rc == 0);
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+    dw1000_spi_calibrate(inst);
+#endif
 
     inst->PANID = MYNEWT_VAL(PANID);
     inst->my_short_address = inst->partID & 0xffff;
@@ -431,6 +825,7 @@ dw1000_dev_configure_sleep(dw1000_dev_instance_t * inst)
     else
         reg &= ~(AON_CFG0_WAKE_CNT | AON_CFG0_SLEEP_EN);
     dw1000_write_reg(inst, AON_ID, AON_CFG0_OFFSET, reg, sizeof(uint16_t));
+    inst->wake.lost = inst->wake.kept = 0;     // What survives sleep depends on the on-wake settings
 }
 
 /**
@@ -446,10 +841,12 @@ dw1000_dev_enter_sleep(dw1000_dev_instance_t * inst)
     dpl_error_t err = dpl_mutex_pend(&inst->mutex, DPL_WAIT_FOREVER);
     assert(err == DPL_OK);
     
-    /* Upload always on array configuration and enter sleep */
+    /* Snapshot what the wakeup has to restore, then upload always on array configuration and enter sleep */
+    dw1000_wake_snapshot(inst);
     dw1000_write_reg(inst, AON_ID, AON_CTRL_OFFSET, 0x0, sizeof(uint16_t));
     dw1000_write_reg(inst, AON_ID, AON_CTRL_OFFSET, AON_CTRL_SAVE, sizeof(uint16_t));
     inst->status.sleeping = 1;
+    dw1000_shadow_invalidate(inst);
 
     // Critical region, unlock mutex
     err = dpl_mutex_release(&inst->mutex);
@@ -468,24 +865,39 @@ dw1000_dev_wakeup(dw1000_dev_instance_t * inst)
 {
     int timeout=5;
     uint32_t devid;
+    uint32_t t0 = os_cputime_get32();
+    bool restored;
     // Critical region, atomic lock with mutex
     dpl_error_t err = dpl_mutex_pend(&inst->mutex, DPL_WAIT_FOREVER);
     assert(err == DPL_OK);
 
-    devid = dw1000_read_reg(inst, DEV_ID_ID, 0, sizeof(uint32_t));
+    devid = (uint32_t)dw1000_read_reg(inst, DEV_ID_ID, 0, sizeof(uint32_t));
 
     while (devid != 0xDECA0130 && --timeout)
     {
         hal_dw1000_wakeup(inst);
-        devid = dw1000_read_reg(inst, DEV_ID_ID, 0, sizeof(uint32_t));
+        devid = (uint32_t)dw1000_read_reg(inst, DEV_ID_ID, 0, sizeof(uint32_t));
     }
     inst->status.sleeping = (devid != DWT_DEVICE_ID);
-    dw1000_write_reg(inst, SYS_STATUS_ID, 0, SYS_STATUS_SLP2INIT, sizeof(uint32_t));
-    dw1000_write_reg(inst, SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_ERR, sizeof(uint32_t));
+    inst->wake.wake_usec = os_cputime_ticks_to_usecs(os_cputime_get32() - t0);
 
-    /* Antenna delays lost in deep sleep ? */
-    dw1000_phy_set_rx_antennadelay(inst, inst->rx_antenna_delay);
-    dw1000_phy_set_tx_antennadelay(inst, inst->tx_antenna_delay);
+    restored = !inst->status.sleeping && dw1000_wake_restore(inst);
+    if (!restored) {
+        dw1000_shadow_invalidate(inst);   // Configuration is reloaded from the AON array, if at all
+        dw1000_write_reg(inst, SYS_STATUS_ID, 0, SYS_STATUS_SLP2INIT, sizeof(uint32_t));
+        dw1000_write_reg(inst, SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_ERR, sizeof(uint32_t));
+
+        /* Antenna delays lost in deep sleep ? */
+        dw1000_phy_set_rx_antennadelay(inst, inst->rx_antenna_delay);
+        dw1000_phy_set_tx_antennadelay(inst, inst->tx_antenna_delay);
+    }
+    inst->wake.ready_usec = os_cputime_ticks_to_usecs(os_cputime_get32() - t0);
+    if (inst->wake.wake_usec > inst->wake.wake_usec_max)
+        inst->wake.wake_usec_max = inst->wake.wake_usec;
+    if (inst->wake.ready_usec > inst->wake.ready_usec_max)
+        inst->wake.ready_usec_max = inst->wake.ready_usec;
+    if (restored)
+        inst->wake.ready_usec_total += inst->wake.ready_usec;
 
     // Critical region, unlock mutex
     err = dpl_mutex_release(&inst->mutex);
@@ -291,6 +291,353 @@ hal_dw1000_reset(struct _dw1000_dev_instance_t * inst)
     os_cputime_delay_usecs(5000);
 }
 
+/* Schedulers of the SPI buses, one per distinct spi_sem */
+static dw1000_bus_t hal_dw1000_buses[DW1000_BUS_MAX_DEVS];
+
+static void hal_dw1000_async_begin(struct _dw1000_dev_instance_t * inst);
+
+/**
+ * API to attach an instance to the scheduler of its SPI bus, the instances configured with the same
+ * spi_sem share one. Called by dw1000_dev_init, attaching an instance again has no effect.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+hal_dw1000_bus_attach(struct _dw1000_dev_instance_t * inst)
+{
+    dw1000_bus_t * bus = NULL;
+    os_sr_t sr;
+
+    assert(inst->spi_sem);
+    OS_ENTER_CRITICAL(sr);
+    for (int i = 0; i < DW1000_BUS_MAX_DEVS && bus == NULL; i++) {
+        if (hal_dw1000_buses[i].spi_sem == inst->spi_sem)
+            bus = &hal_dw1000_buses[i];
+    }
+    for (int i = 0; i < DW1000_BUS_MAX_DEVS && bus == NULL; i++) {
+        if (hal_dw1000_buses[i].spi_sem == NULL) {
+            bus = &hal_dw1000_buses[i];
+            bus->spi_sem = inst->spi_sem;
+            for (int d = 0; d < DW1000_BUS_MAX_DEVS; d++)
+                for (int p = 0; p < DW1000_BUS_PRIO_NUM; p++)
+                    STAILQ_INIT(&bus->queue[d][p]);
+        }
+    }
+    assert(bus);
+    if (inst->bus != bus || bus->devs[inst->bus_dev] != inst) {
+        assert(bus->ndevs < DW1000_BUS_MAX_DEVS);
+        inst->bus = bus;
+        inst->bus_dev = bus->ndevs;
+        bus->devs[bus->ndevs++] = inst;
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+/**
+ * API to pick the class of an access: transfers of at least DW1000_BUS_BULK_MIN bytes are bulk, the
+ * rest is scheduled as IRQ when made from the interrupt task of the instance and as NORMAL otherwise.
+ *
+ * @param inst    Pointer to dw1000_dev_instance_t.
+ * @param length  Bytes of the transfer.
+ * @return dw1000_bus_prio_t
+ */
+uint8_t
+hal_dw1000_bus_prio(struct _dw1000_dev_instance_t * inst, uint32_t length)
+{
+    if (length >= DW1000_BUS_BULK_MIN)
+        return DW1000_BUS_PRIO_BULK;
+    if (inst->irq_task_id && inst->irq_task_id == dpl_get_current_task_id())
+        return DW1000_BUS_PRIO_IRQ;
+    return DW1000_BUS_PRIO_NORMAL;
+}
+
+/* Makes inst the owner of the bus, called with interrupts disabled */
+static void
+hal_dw1000_bus_grant(dw1000_bus_t * bus, struct _dw1000_dev_instance_t * inst, uint8_t prio)
+{
+    bus->owner = inst;
+    bus->stats[prio].grants++;
+    bus->dev_grants[inst->bus_dev]++;
+}
+
+/* Queues a waiter behind the current owner, called with interrupts disabled */
+static void
+hal_dw1000_bus_enqueue(dw1000_bus_t * bus, dw1000_bus_waiter_t * waiter)
+{
+    waiter->queued = os_cputime_get32();
+    waiter->seq = bus->seq++;
+    waiter->bypassed = 0;
+    waiter->waiting = 1;
+    waiter->granted = 0;
+    STAILQ_INSERT_TAIL(&bus->queue[waiter->inst->bus_dev][waiter->prio], waiter, next);
+    bus->nwaiting++;
+}
+
+/* Takes a waiter off its queue, called with interrupts disabled */
+static void
+hal_dw1000_bus_dequeue(dw1000_bus_t * bus, dw1000_bus_waiter_t * waiter)
+{
+    STAILQ_REMOVE(&bus->queue[waiter->inst->bus_dev][waiter->prio], waiter, _dw1000_bus_waiter_t, next);
+    waiter->waiting = 0;
+    bus->nwaiting--;
+}
+
+/* First waiter of a queue that may have the bus. A blocking access issued after a submit waits for the
+ * asynchronous engine of its instance to drain the requests queued before it, as on an unshared bus:
+ * it may only go first while the engine waits for the bus to start on requests submitted later. The
+ * interrupt task is the exception, its accesses go ahead of a bulk engine parked between two accesses. */
+static dw1000_bus_waiter_t *
+hal_dw1000_bus_first(dw1000_bus_t * bus, uint8_t dev, uint8_t prio)
+{
+    dw1000_bus_waiter_t * waiter, * engine;
+
+    STAILQ_FOREACH(waiter, &bus->queue[dev][prio], next) {
+        if (waiter->async || !waiter->inst->async.busy)
+            break;
+        engine = &waiter->inst->async.bus_waiter;
+        if (engine->waiting && !engine->resume && (int32_t)(engine->seq - waiter->seq) > 0)
+            break;
+        if (engine->waiting && prio == DW1000_BUS_PRIO_IRQ && engine->prio == DW1000_BUS_PRIO_BULK)
+            break;
+    }
+    return waiter;
+}
+
+/* Takes the waiter the bus goes to next off its queue, called with interrupts disabled. Classes are
+ * served highest first and the devices within a class in round robin order, except that a waiter
+ * passed over DW1000_BUS_AGING times goes first. Every other waiter that could have had the bus
+ * counts as passed over. */
+static dw1000_bus_waiter_t *
+hal_dw1000_bus_next(dw1000_bus_t * bus)
+{
+    dw1000_bus_waiter_t * first[DW1000_BUS_PRIO_NUM][DW1000_BUS_MAX_DEVS];
+    dw1000_bus_waiter_t * next = NULL;
+    bool aged = false;
+
+    if (bus->nwaiting == 0)
+        return NULL;
+    for (uint8_t p = 0; p < DW1000_BUS_PRIO_NUM; p++) {
+        for (uint8_t k = 1; k <= bus->ndevs; k++) {
+            uint8_t d = (bus->last + k) % bus->ndevs;
+            dw1000_bus_waiter_t * waiter = hal_dw1000_bus_first(bus, d, p);
+
+            first[p][k - 1] = waiter;
+            if (waiter == NULL)
+                continue;
+            if (!aged && waiter->bypassed >= DW1000_BUS_AGING) {
+                next = waiter;
+                aged = true;
+            } else if (next == NULL) {
+                next = waiter;
+            }
+        }
+    }
+    if (next == NULL)
+        return NULL;
+
+    for (uint8_t p = 0; p < DW1000_BUS_PRIO_NUM; p++)
+        for (uint8_t k = 0; k < bus->ndevs; k++)
+            if (first[p][k] && first[p][k] != next && first[p][k]->bypassed < UINT8_MAX)
+                first[p][k]->bypassed++;
+
+    hal_dw1000_bus_dequeue(bus, next);
+    bus->last = next->inst->bus_dev;
+
+    dw1000_bus_class_stats_t * stats = &bus->stats[next->prio];
+    uint32_t wait = os_cputime_ticks_to_usecs(os_cputime_get32() - next->queued);
+    stats->contended++;
+    stats->aged += aged;
+    stats->wait_usec_total += wait;
+    stats->wait_usec_max = (wait > stats->wait_usec_max) ? wait : stats->wait_usec_max;
+    return next;
+}
+
+/**
+ * API to acquire the SPI bus of an instance. A free bus is taken at once, otherwise the caller waits
+ * for the scheduler to hand it over.
+ *
+ * @param inst     Pointer to dw1000_dev_instance_t.
+ * @param prio     dw1000_bus_prio_t of the access, see hal_dw1000_bus_prio().
+ * @param timeout  Time in os_ticks to wait for another instance to release the bus.
+ * @return dpl_error_t
+ */
+dpl_error_t
+hal_dw1000_bus_acquire(struct _dw1000_dev_instance_t * inst, uint8_t prio, dpl_time_t timeout)
+{
+    dw1000_bus_t * bus = inst->bus;
+    dw1000_bus_waiter_t waiter;
+    dpl_error_t err;
+    os_sr_t sr;
+
+    assert(bus);
+    waiter.inst = inst;
+    waiter.prio = prio;
+    waiter.async = 0;
+    err = dpl_sem_init(&waiter.sem, 0);
+    assert(err == DPL_OK);
+
+    OS_ENTER_CRITICAL(sr);
+    if (bus->owner == NULL) {
+        hal_dw1000_bus_grant(bus, inst, prio);
+        OS_EXIT_CRITICAL(sr);
+        /* Only a user of spi_sem outside of the driver can hold it now */
+        err = dpl_sem_pend(bus->spi_sem, DPL_TIMEOUT_NEVER);
+        assert(err == DPL_OK);
+        return DPL_OK;
+    }
+    hal_dw1000_bus_enqueue(bus, &waiter);
+    OS_EXIT_CRITICAL(sr);
+
+    err = dpl_sem_pend(&waiter.sem, timeout);
+    if (err != DPL_OK) {
+        OS_ENTER_CRITICAL(sr);
+        if (!waiter.granted) {
+            hal_dw1000_bus_dequeue(bus, &waiter);
+            OS_EXIT_CRITICAL(sr);
+            return err;
+        }
+        OS_EXIT_CRITICAL(sr);
+        /* Granted as the wait timed out, the release of waiter.sem is on its way */
+        err = dpl_sem_pend(&waiter.sem, DPL_TIMEOUT_NEVER);
+        assert(err == DPL_OK);
+    }
+    return DPL_OK;
+}
+
+/**
+ * API to release the SPI bus, also from interrupt context. The bus goes straight to the next waiter
+ * and spi_sem is only released when there is none.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t owning the bus.
+ * @return void
+ */
+void
+hal_dw1000_bus_release(struct _dw1000_dev_instance_t * inst)
+{
+    dw1000_bus_t * bus = inst->bus;
+    dw1000_bus_waiter_t * waiter;
+    dpl_error_t err;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    assert(bus->owner == inst);
+    waiter = hal_dw1000_bus_next(bus);
+    if (waiter) {
+        hal_dw1000_bus_grant(bus, waiter->inst, waiter->prio);
+        bus->handoffs++;
+        waiter->granted = 1;
+    } else {
+        bus->owner = NULL;
+    }
+    OS_EXIT_CRITICAL(sr);
+
+    if (waiter == NULL) {
+        err = dpl_sem_release(bus->spi_sem);
+        assert(err == DPL_OK);
+    } else if (waiter->async) {
+        hal_dw1000_async_begin(waiter->inst);
+    } else {
+        err = dpl_sem_release(&waiter->sem);
+        assert(err == DPL_OK);
+    }
+}
+
+/**
+ * Called by the asynchronous engine between two accesses. Gives the bus away when another instance
+ * waits with a higher class than the engine or has been passed over DW1000_BUS_AGING times, and a bulk
+ * engine to the interrupt task of its own instance; each access the engine starts instead counts as
+ * passing over the waiters of the other instances. The engine is queued again and resumes where it
+ * stopped once granted.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t owning the bus.
+ * @return true if the bus was given away
+ */
+static bool
+hal_dw1000_bus_yield(struct _dw1000_dev_instance_t * inst)
+{
+    dw1000_bus_t * bus = inst->bus;
+    dw1000_bus_waiter_t * self = &inst->async.bus_waiter;
+    bool yield = false;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    if (self->prio == DW1000_BUS_PRIO_BULK && !STAILQ_EMPTY(&bus->queue[inst->bus_dev][DW1000_BUS_PRIO_IRQ]))
+        yield = true;
+    for (uint8_t d = 0; d < bus->ndevs && bus->nwaiting; d++) {
+        if (d == inst->bus_dev)
+            continue;
+        for (uint8_t p = 0; p < DW1000_BUS_PRIO_NUM; p++) {
+            dw1000_bus_waiter_t * waiter = hal_dw1000_bus_first(bus, d, p);
+            if (waiter == NULL)
+                continue;
+            if (p < self->prio || waiter->bypassed >= DW1000_BUS_AGING)
+                yield = true;
+            else
+                waiter->bypassed++;
+        }
+    }
+    if (yield) {
+        bus->yields++;
+        self->resume = 1;
+        hal_dw1000_bus_enqueue(bus, self);
+    }
+    OS_EXIT_CRITICAL(sr);
+
+    if (yield)
+        hal_dw1000_bus_release(inst);
+    return yield;
+}
+
+/**
+ * API to clear the contention statistics of the bus of an instance.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+hal_dw1000_bus_clear(struct _dw1000_dev_instance_t * inst)
+{
+    dw1000_bus_t * bus = inst->bus;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    bus->handoffs = 0;
+    bus->yields = 0;
+    memset(bus->dev_grants, 0, sizeof(bus->dev_grants));
+    memset(bus->stats, 0, sizeof(bus->stats));
+    OS_EXIT_CRITICAL(sr);
+}
+
+/**
+ * API to print the contention statistics of the bus of an instance as json.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param print  printf like output function, console_printf on target.
+ * @return void
+ */
+void
+hal_dw1000_bus_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...))
+{
+    static const char * const names[DW1000_BUS_PRIO_NUM] = {"irq", "normal", "bulk"};
+    dw1000_bus_t * bus = inst->bus;
+
+    assert(bus && print);
+    print("{\"devs\":%u,\"handoffs\":%lu,\"yields\":%lu,\"dev_grants\":[", bus->ndevs,
+          (unsigned long)bus->handoffs, (unsigned long)bus->yields);
+    for (uint8_t d = 0; d < bus->ndevs; d++)
+        print(d ? ",%lu" : "%lu", (unsigned long)bus->dev_grants[d]);
+    print("]");
+    for (uint8_t p = 0; p < DW1000_BUS_PRIO_NUM; p++) {
+        dw1000_bus_class_stats_t * stats = &bus->stats[p];
+        print(",\"%s\":{\"grants\":%lu,\"contended\":%lu,\"aged\":%lu,\"wait_usec_avg\":%lu,\"wait_usec_max\":%lu}",
+              names[p], (unsigned long)stats->grants, (unsigned long)stats->contended, (unsigned long)stats->aged,
+              (unsigned long)(stats->contended ? stats->wait_usec_total / stats->contended : 0),
+              (unsigned long)stats->wait_usec_max);
+    }
+    print("}\n");
+}
+
 /**
  * API to perform a blocking read over SPI
  *
@@ -307,8 +654,7 @@ hal_dw1000_read(struct _dw1000_dev_instance_t * inst,
                 uint8_t * buffer, uint16_t length)
 {
     dpl_error_t err;
-    assert(inst->spi_sem);
-    err = dpl_sem_pend(inst->spi_sem, DPL_TIMEOUT_NEVER);
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, length), DPL_TIMEOUT_NEVER);
     assert(err == DPL_OK);
     hal_gpio_write(inst->ss_pin, 0);
 
@@ -318,8 +664,7 @@ hal_dw1000_read(struct _dw1000_dev_instance_t * inst,
 
     hal_gpio_write(inst->ss_pin, 1);
 
-    err = dpl_sem_release(inst->spi_sem);
-    assert(err == DPL_OK);
+    hal_dw1000_bus_release(inst);
 }
 
 
@@ -342,8 +687,7 @@ hal_dw1000_spi_txrx_cb(void *arg, int len)
         assert(err == DPL_OK);
     } else {
         hal_gpio_write(inst->ss_pin, 1);
-        err = dpl_sem_release(inst->spi_sem);
-        assert(err == DPL_OK);
+        hal_dw1000_bus_release(inst);
     }
 }
 
@@ -363,9 +707,8 @@ hal_dw1000_read_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t * cm
 {
     int rc;
     dpl_error_t err;
-    assert(inst->spi_sem);
 
-    err = dpl_sem_pend(inst->spi_sem, DPL_TIMEOUT_NEVER);
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, length), DPL_TIMEOUT_NEVER);
     assert(err == DPL_OK);
     
     hal_gpio_write(inst->ss_pin, 0);
@@ -382,11 +725,10 @@ hal_dw1000_read_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t * cm
         int bytes_to_read = (bytes_left > step) ? step : bytes_left;
         bytes_left-=bytes_to_read;
 
-        /* Only use the spi_nb_sem if needed */
-        if (bytes_left) {
-            err = dpl_sem_pend(&inst->spi_nb_sem, DPL_TIMEOUT_NEVER);
-            assert(err == DPL_OK);
-        }
+        /* Every round completes on spi_nb_sem, the bus may go to another instance
+         * as soon as it is released */
+        err = dpl_sem_pend(&inst->spi_nb_sem, DPL_TIMEOUT_NEVER);
+        assert(err == DPL_OK);
    
         rc = hal_spi_disable(inst->spi_num);
         rc |= hal_spi_set_txrx_cb(inst->spi_num, hal_dw1000_spi_txrx_cb, (void*)inst);   
@@ -397,22 +739,15 @@ hal_dw1000_read_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t * cm
                                   (void*)buffer+offset, bytes_to_read);
         assert(rc==DPL_OK);
 
-        /* Only wait for this round if there is more data to read */
-        if (bytes_left) {
-            err = dpl_sem_pend(&inst->spi_nb_sem, DPL_TIMEOUT_NEVER);
-            assert(err == DPL_OK);
+        err = dpl_sem_pend(&inst->spi_nb_sem, DPL_TIMEOUT_NEVER);
+        assert(err == DPL_OK);
 
-            err = dpl_sem_release(&inst->spi_nb_sem);
-            assert(err == DPL_OK);
-        }
+        err = dpl_sem_release(&inst->spi_nb_sem);
+        assert(err == DPL_OK);
     }
 
-    /* Reaquire semaphore after rx complete */
-    err = dpl_sem_pend(inst->spi_sem, DPL_TIMEOUT_NEVER);
-    assert(err == DPL_OK);
-
-    err = dpl_sem_release(inst->spi_sem);
-    assert(err == DPL_OK);
+    hal_gpio_write(inst->ss_pin, 1);
+    hal_dw1000_bus_release(inst);
 }
 
 
@@ -430,8 +765,7 @@ void
 hal_dw1000_write(struct _dw1000_dev_instance_t * inst, const uint8_t * cmd, uint8_t cmd_size, uint8_t * buffer, uint16_t length)
 {
     dpl_error_t err;
-    assert(inst->spi_sem);
-    err = dpl_sem_pend(inst->spi_sem, DPL_TIMEOUT_NEVER);
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, length), DPL_TIMEOUT_NEVER);
     assert(err == DPL_OK);
 
     hal_gpio_write(inst->ss_pin, 0);
@@ -441,8 +775,7 @@ hal_dw1000_write(struct _dw1000_dev_instance_t * inst, const uint8_t * cmd, uint
      
     hal_gpio_write(inst->ss_pin, 1);
 
-    err = dpl_sem_release(inst->spi_sem);
-    assert(err == DPL_OK);
+    hal_dw1000_bus_release(inst);
 }
 
 
@@ -462,8 +795,7 @@ hal_dw1000_write_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t * c
     int rc = OS_OK;
     dpl_error_t err;
     assert(length);
-    assert(inst->spi_sem);
-    err = dpl_sem_pend(inst->spi_sem, DPL_TIMEOUT_NEVER);
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, length), DPL_TIMEOUT_NEVER);
     assert(err == DPL_OK);
 
     hal_gpio_write(inst->ss_pin, 0);
@@ -505,19 +837,221 @@ hal_dw1000_write_noblock(struct _dw1000_dev_instance_t * inst, const uint8_t * c
 }
 
 /**
- * API to wait for a DMA transfer
+ * API to perform a list of register accesses over SPI. The bus is acquired once for the whole list
+ * and each access is framed by its own chip select, reads are clocked in blocks instead of a byte at a time.
+ *
+ * @param inst      Pointer to dw1000_dev_instance_t.
+ * @param xfers     Array of register accesses, bit 7 of the first header byte selects write.
+ * @param nxfers    Number of entries in xfers.
+ * @return void
+ */
+void
+hal_dw1000_xfer(struct _dw1000_dev_instance_t * inst, const struct _dw1000_xfer_t * xfers, uint16_t nxfers)
+{
+    dpl_error_t err;
+    uint32_t length = 0;
+
+    for (uint16_t i = 0; i < nxfers; i++)
+        length += xfers[i].length;
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, length), DPL_TIMEOUT_NEVER);
+    assert(err == DPL_OK);
+
+    for (uint16_t i = 0; i < nxfers; i++) {
+        const struct _dw1000_xfer_t * xfer = &xfers[i];
+
+        hal_gpio_write(inst->ss_pin, 0);
+        hal_spi_txrx(inst->spi_num, (void*)xfer->header, 0, xfer->header_len);
+        if (xfer->header[0] & 0x80) {
+            hal_spi_txrx(inst->spi_num, (void*)xfer->buffer, 0, xfer->length);
+        } else {
+            for (uint16_t offset = 0; offset < xfer->length; offset += MYNEWT_VAL(DW1000_HAL_SPI_BUFFER_SIZE)) {
+                uint16_t n = xfer->length - offset;
+                n = (n > MYNEWT_VAL(DW1000_HAL_SPI_BUFFER_SIZE)) ? MYNEWT_VAL(DW1000_HAL_SPI_BUFFER_SIZE) : n;
+                hal_spi_txrx(inst->spi_num, (void*)tx_buffer, xfer->buffer + offset, n);
+            }
+        }
+        hal_gpio_write(inst->ss_pin, 1);
+    }
+
+    hal_dw1000_bus_release(inst);
+}
+
+/**
+ * Advance the asynchronous engine of an instance by one SPI transfer: the header or the next chunk of
+ * the data phase of the access in progress. Completed requests are taken off the pending queue, their
+ * event posted and their complete_cb queued, and the bus is released once the pending queue is empty.
  *
  * @param inst  Pointer to dw1000_dev_instance_t.
- * @param timeout  Time in os_ticks to wait, use DPL_TIMEOUT_NEVER to wait indefinitely
  * @return void
  */
+static void
+hal_dw1000_async_step(struct _dw1000_dev_instance_t * inst)
+{
+    dw1000_async_t * async = &inst->async;
+    dw1000_async_req_t * req;
+    bool boundary = false;
+    os_sr_t sr;
+    int rc;
+
+    OS_ENTER_CRITICAL(sr);
+    req = STAILQ_FIRST(&async->pending);
+    OS_EXIT_CRITICAL(sr);
+
+    while (req) {
+        if (req->xfer < req->list.nxfers) {
+            const dw1000_xfer_t * xfer = &req->list.xfers[req->xfer];
+
+            if (!req->header_sent) {
+                /* Between two accesses the bus may go to another instance first */
+                if (boundary && hal_dw1000_bus_yield(inst))
+                    return;
+                req->header_sent = 1;
+                hal_gpio_write(inst->ss_pin, 0);
+                rc = hal_spi_txrx_noblock(inst->spi_num, (void*)xfer->header, 0, xfer->header_len);
+                assert(rc == 0);
+                return;
+            }
+            if (req->offset < xfer->length) {
+                /* Same chunking as hal_dw1000_read_noblock and hal_dw1000_write_noblock */
+                int step = (xfer->header[0] & 0x80) ? 255 : (MYNEWT_VAL(DW1000_HAL_SPI_BUFFER_SIZE) > 255) ? 255 :
+                    MYNEWT_VAL(DW1000_HAL_SPI_BUFFER_SIZE);
+                uint16_t offset = req->offset;
+                uint16_t n = (xfer->length - offset > step) ? step : xfer->length - offset;
+
+                req->offset += n;
+                if (xfer->header[0] & 0x80) {
+                    rc = hal_spi_txrx_noblock(inst->spi_num, (void*)xfer->buffer + offset, 0, n);
+                } else {
+                    rc = hal_spi_txrx_noblock(inst->spi_num, (void*)tx_buffer, (void*)xfer->buffer + offset, n);
+                }
+                assert(rc == 0);
+                return;
+            }
+            hal_gpio_write(inst->ss_pin, 1);
+            req->xfer++;
+            req->header_sent = 0;
+            req->offset = 0;
+            boundary = true;
+            continue;
+        }
+
+        /* The request may be reused as soon as done is set, take what is needed from it before */
+        struct dpl_eventq * evq = req->evq;
+        struct dpl_event * ev = req->ev;
+        bool has_cb = req->complete_cb != NULL;
+        bool waiting;
+
+        OS_ENTER_CRITICAL(sr);
+        STAILQ_REMOVE_HEAD(&async->pending, next);
+        if (has_cb)
+            STAILQ_INSERT_TAIL(&async->completed, req, next);
+        async->completions++;
+        waiting = req->waiting;
+        req->done = 1;
+        req = STAILQ_FIRST(&async->pending);
+        if (req == NULL)
+            async->busy = 0;
+        OS_EXIT_CRITICAL(sr);
+
+        if (ev)
+            dpl_eventq_put(evq, ev);
+        if (has_cb)
+            dpl_eventq_put(&inst->eventq, &async->complete_ev);
+        if (waiting)
+            dpl_sem_release(&async->done_sem);
+    }
+
+    hal_dw1000_bus_release(inst);
+}
+
+/**
+ * Interrupt context callback of the asynchronous engine.
+ *
+ * @param arg  Pointer to dw1000_dev_instance_t.
+ * @param len  Length of the completed transfer.
+ * @return void
+ */
+static void
+hal_dw1000_async_txrx_cb(void *arg, int len)
+{
+    hal_dw1000_async_step((struct _dw1000_dev_instance_t *)arg);
+}
+
+/**
+ * Hands the SPI completion interrupt to the asynchronous engine of an instance that was just granted
+ * the bus and clocks out the next transfer of its first pending request.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+static void
+hal_dw1000_async_begin(struct _dw1000_dev_instance_t * inst)
+{
+    int rc;
+
+    rc = hal_spi_disable(inst->spi_num);
+    rc |= hal_spi_set_txrx_cb(inst->spi_num, hal_dw1000_async_txrx_cb, (void*)inst);
+    rc |= hal_spi_enable(inst->spi_num);
+    assert(rc == 0);
+
+    hal_dw1000_async_step(inst);
+}
+
+/**
+ * API to start the asynchronous engine on the first pending request. Called by dw1000_async_submit
+ * from task context when the engine is idle. A free bus is acquired here, otherwise the engine is
+ * queued and started by whoever releases the bus to it; the bus is released from the completion
+ * interrupt once the pending queue has drained.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+hal_dw1000_async_start(struct _dw1000_dev_instance_t * inst)
+{
+    dw1000_bus_t * bus = inst->bus;
+    dw1000_bus_waiter_t * waiter = &inst->async.bus_waiter;
+    dw1000_async_req_t * req = STAILQ_FIRST(&inst->async.pending);
+    uint32_t length = 0;
+    dpl_error_t err;
+    os_sr_t sr;
+
+    assert(bus && req);
+    for (uint16_t i = 0; i < req->list.nxfers; i++)
+        length += req->list.xfers[i].length;
+    waiter->inst = inst;
+    waiter->prio = hal_dw1000_bus_prio(inst, length);
+    waiter->async = 1;
+    waiter->resume = 0;
+
+    OS_ENTER_CRITICAL(sr);
+    if (bus->owner) {
+        hal_dw1000_bus_enqueue(bus, waiter);
+        OS_EXIT_CRITICAL(sr);
+        return;
+    }
+    hal_dw1000_bus_grant(bus, inst, waiter->prio);
+    OS_EXIT_CRITICAL(sr);
+
+    err = dpl_sem_pend(bus->spi_sem, DPL_TIMEOUT_NEVER);
+    assert(err == DPL_OK);
+    hal_dw1000_async_begin(inst);
+}
+
+/**
+ * API to wait for a DMA transfer, the bus is released by the transfer once done.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param timeout  Time in os_ticks to wait, use DPL_TIMEOUT_NEVER to wait indefinitely
+ * @return dpl_error_t
+ */
 dpl_error_t
 hal_dw1000_rw_noblock_wait(struct _dw1000_dev_instance_t * inst, dpl_time_t timeout)
 {
     dpl_error_t err;
-    err = dpl_sem_pend(inst->spi_sem, timeout);
-    if (dpl_sem_get_count(inst->spi_sem) == 0) {
-        dpl_sem_release(inst->spi_sem);
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, 0), timeout);
+    if (err == DPL_OK) {
+        hal_dw1000_bus_release(inst);
     }
     return err;
 }
@@ -534,8 +1068,7 @@ hal_dw1000_wakeup(struct _dw1000_dev_instance_t * inst)
 {
     dpl_error_t err;
     os_sr_t sr;
-    assert(inst->spi_sem);
-    err = dpl_sem_pend(inst->spi_sem, DPL_TIMEOUT_NEVER);
+    err = hal_dw1000_bus_acquire(inst, hal_dw1000_bus_prio(inst, 0), DPL_TIMEOUT_NEVER);
     assert(err == DPL_OK);
 
     OS_ENTER_CRITICAL(sr);
@@ -544,19 +1077,21 @@ hal_dw1000_wakeup(struct _dw1000_dev_instance_t * inst)
     hal_gpio_write(inst->ss_pin, 0);
 
     // Need to hold chip select for a minimum of 600us
-    os_cputime_delay_usecs(2000);
+    os_cputime_delay_usecs(MYNEWT_VAL(DW1000_WAKEUP_CS_USEC));
 
     hal_gpio_write(inst->ss_pin, 1);
     hal_spi_enable(inst->spi_num);
 
-    // Waiting for XTAL to start and stabilise - 5ms safe
-    // (check PLL bit in IRQ?)
-    os_cputime_delay_usecs(5000);
-
     OS_EXIT_CRITICAL(sr);
 
-    err = dpl_sem_release(inst->spi_sem);
-    assert(err == DPL_OK);
+    // The device drives rst low while asleep and lets it go once the XTAL is up,
+    // rather than waiting the worst case of the XTAL start every time
+    uint32_t t0 = os_cputime_get32();
+    while (!hal_gpio_read(inst->rst_pin) &&
+           os_cputime_ticks_to_usecs(os_cputime_get32() - t0) < MYNEWT_VAL(DW1000_WAKEUP_XTAL_USEC))
+        ;
+
+    hal_dw1000_bus_release(inst);
 }
 
 /**
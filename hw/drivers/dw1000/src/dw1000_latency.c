@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_latency.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Interrupt path latency histograms
+ *
+ * @details Reporting side of dw1000_latency.h. The histograms are printed as one json object per stage
+ * and per interface, through console_printf from the shell or printf on Linux.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_latency.h>
+
+#if MYNEWT_VAL(DW1000_LATENCY)
+static const char * const g_stage_names[DW1000_LAT_NUM] = {
+    [DW1000_LAT_IRQ_TO_TASK] = "irq_to_task",
+    [DW1000_LAT_SPI_STATUS] = "spi_status",
+    [DW1000_LAT_SPI_FRAME] = "spi_frame",
+    [DW1000_LAT_RX_CHAIN] = "rx_chain",
+    [DW1000_LAT_TX_CHAIN] = "tx_chain",
+    [DW1000_LAT_IRQ_TO_DONE] = "irq_to_done",
+    [DW1000_LAT_IRQ_TO_RX_START] = "irq_to_rx_start",
+    [DW1000_LAT_IRQ_TO_TX_START] = "irq_to_tx_start",
+};
+
+static void
+dw1000_latency_print_hist(int (* print)(const char *, ...), const char * key, const char * name,
+                          const dw1000_latency_hist_t * hist)
+{
+    uint32_t n = 0;
+    int last = -1;
+
+    for (int i = 0; i < DW1000_LATENCY_BINS; i++) {
+        n += hist->bins[i];
+        if (hist->bins[i])
+            last = i;
+    }
+    print("{\"%s\":\"%s\",\"n\":%lu,\"max_us\":%lu,\"log2_us\":[", key, name,
+          (unsigned long)n, (unsigned long)hist->max);
+    for (int i = 0; i <= last; i++)
+        print(i ? ",%lu" : "%lu", (unsigned long)hist->bins[i]);
+    print("]}\n");
+}
+#endif
+
+/**
+ * API to reset the latency histograms of an instance and of its interfaces.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_latency_clear(struct _dw1000_dev_instance_t * inst)
+{
+    assert(inst);
+#if MYNEWT_VAL(DW1000_LATENCY)
+    dw1000_mac_interface_t * cbs = NULL;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    memset(inst->latency.hist, 0, sizeof(inst->latency.hist));
+    SLIST_FOREACH(cbs, &inst->interface_cbs, next){
+        memset(&cbs->rx_latency, 0, sizeof(cbs->rx_latency));
+    }
+    OS_EXIT_CRITICAL(sr);
+#endif
+}
+
+/**
+ * API to print the latency histograms of an instance and of its interfaces. Each histogram is a json
+ * object with the sample count, the largest sample and the bin counts, bin 0 for 0us and bin n for
+ * [2^(n-1), 2^n) us.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param print  printf like output function, e.g. console_printf
+ * @return void
+ */
+void
+dw1000_latency_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...))
+{
+    assert(inst && print);
+#if MYNEWT_VAL(DW1000_LATENCY)
+    dw1000_mac_interface_t * cbs = NULL;
+    char name[8];
+
+    for (int i = 0; i < DW1000_LAT_NUM; i++) {
+        dw1000_latency_print_hist(print, "stage", g_stage_names[i], &inst->latency.hist[i]);
+    }
+    SLIST_FOREACH(cbs, &inst->interface_cbs, next){
+        snprintf(name, sizeof(name), "%u", cbs->id);
+        dw1000_latency_print_hist(print, "rx_complete_cb", name, &cbs->rx_latency);
+    }
+#else
+    print("{\"latency\":\"disabled, set DW1000_LATENCY\"}\n");
+#endif
+}
@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 #include <math.h>
 #include <os/os.h>
@@ -45,6 +46,7 @@
 #include <dw1000/dw1000_phy.h>
 #include <dw1000/dw1000_stats.h>
 #include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_profile.h>
 
 
 #if MYNEWT_VAL(DW1000_MAC_STATS)
@@ -58,13 +60,24 @@ STATS_NAME_START(mac_stat_section)
     STATS_NAME(mac_stat_section, LDE_err)
     STATS_NAME(mac_stat_section, RX_err)
     STATS_NAME(mac_stat_section, TXBUF_err)
+    STATS_NAME(mac_stat_section, RX_routed)
+    STATS_NAME(mac_stat_section, RX_default)
+    STATS_NAME(mac_stat_section, RX_fallback)
+    STATS_NAME(mac_stat_section, RX_unclaimed)
+    STATS_NAME(mac_stat_section, RX_hdr_only)
+    STATS_NAME(mac_stat_section, RX_dropped)
+    STATS_NAME(mac_stat_section, RX_foreign_pan)
+    STATS_NAME(mac_stat_section, rx_bytes_skipped)
+    STATS_NAME(mac_stat_section, tx_bytes_saved)
 STATS_NAME_END(mac_stat_section)
 
 #define MAC_STATS_INC(__X) STATS_INC(inst->stat, __X)
 #define MAC_STATS_INCN(__X, __Y) STATS_INCN(inst->stat, __X, __Y)
+#define MAC_CBS_STATS_INC(__cbs, __X) ((__cbs)->__X++)
 #else
 #define MAC_STATS_INC(__X) {}
 #define MAC_STATS_INCN(__X, __Y) {}
+#define MAC_CBS_STATS_INC(__cbs, __X) {}
 #endif
 
 int dw1000_cli_register(void);
@@ -227,21 +240,20 @@ const double txpwr_compensation[] = {
 
 
 /**
- * API to configure the mac layer in dw1000
- * @param inst     Pointer to _dw1000_dev_instance_t.
- * @param config   Pointer to dw1000_dev_config_t.
- * @return dw1000_dev_status_t 
+ * API to compile a configuration into the register values of a profile, see dw1000_profile.h.
+ * Nothing is written to the device.
  *
+ * @param profile  Pointer to dw1000_profile_t, filled in.
+ * @param config   Pointer to dw1000_dev_config_t, copied into the profile.
+ * @return void
  */
-struct _dw1000_dev_status_t dw1000_mac_config(struct _dw1000_dev_instance_t * inst,
-                                              dw1000_dev_config_t * config)
+void
+dw1000_profile_compile(dw1000_profile_t * profile, dw1000_dev_config_t * config)
 {
-    if (config == NULL) {
-        config = &inst->config;
-    } else {
-        memcpy(&inst->config, config, sizeof(dw1000_dev_config_t));
-    }
-    
+    memset(profile, 0, sizeof(dw1000_profile_t));
+    memcpy(&profile->config, config, sizeof(dw1000_dev_config_t));
+    config = &profile->config;
+
     uint8_t nsSfd_result  = 0;
     uint8_t useDWnsSFD = 0;
     uint8_t chan = config->channel;
@@ -274,76 +286,73 @@ struct _dw1000_dev_status_t dw1000_mac_config(struct _dw1000_dev_instance_t * in
     assert((config->rx.phrMode == DWT_PHRMODE_STD) || (config->rx.phrMode == DWT_PHRMODE_EXT));
 #endif
     
+    profile->sys_cfg_clear = SYS_CFG_RXM110K | SYS_CFG_PHR_MODE_11 | SYS_CFG_RXAUTR;
+
     /* For 110 kbps we need a special setup */
     if(config->dataRate == DWT_BR_110K){
-        inst->sys_cfg_reg |= SYS_CFG_RXM110K;
+        profile->sys_cfg_set |= SYS_CFG_RXM110K;
         reg16 >>= 3; // lde_replicaCoeff must be divided by 8
-    }else{
-        inst->sys_cfg_reg &= (~SYS_CFG_RXM110K);
     }
 
-    inst->sys_cfg_reg &= ~SYS_CFG_PHR_MODE_11;
-    inst->sys_cfg_reg |= (SYS_CFG_PHR_MODE_11 & (((uint32_t)config->rx.phrMode) << SYS_CFG_PHR_MODE_SHFT));
+    profile->sys_cfg_set |= (SYS_CFG_PHR_MODE_11 & (((uint32_t)config->rx.phrMode) << SYS_CFG_PHR_MODE_SHFT));
     
-    if (inst->config.rxauto_enable) 
-        inst->sys_cfg_reg |=SYS_CFG_RXAUTR;
-    else
-        inst->sys_cfg_reg &= (~SYS_CFG_RXAUTR);
+    if (config->rxauto_enable) 
+        profile->sys_cfg_set |= SYS_CFG_RXAUTR;
     
-    dw1000_write_reg(inst, SYS_CFG_ID, 0, inst->sys_cfg_reg, sizeof(uint32_t));
     /* Set the lde_replicaCoeff */
-    dw1000_write_reg(inst, LDE_IF_ID, LDE_REPC_OFFSET, reg16, sizeof(uint16_t));
+    DW1000_PROFILE_SET(profile, LDE_REPC, reg16);
 
-    dw1000_phy_config_lde(inst, prfIndex);
+    /* LDE algorithm parameters, as dw1000_phy_config_lde */
+    DW1000_PROFILE_SET(profile, LDE_CFG1, LDE_PARAM1);
+    DW1000_PROFILE_SET(profile, LDE_CFG2, prfIndex ? LDE_PARAM3_64 : LDE_PARAM3_16);
 
     /* Configure PLL2/RF PLL block CFG/TUNE (for a given channel) */
-    dw1000_write_reg(inst, FS_CTRL_ID, FS_PLLCFG_OFFSET, fs_pll_cfg[chan_idx[chan]], sizeof(uint32_t));
-    dw1000_write_reg(inst, FS_CTRL_ID, FS_PLLTUNE_OFFSET, fs_pll_tune[chan_idx[chan]], sizeof(uint8_t));
+    DW1000_PROFILE_SET(profile, FS_PLLCFG, fs_pll_cfg[chan_idx[chan]]);
+    DW1000_PROFILE_SET(profile, FS_PLLTUNE, fs_pll_tune[chan_idx[chan]]);
 
     /* Configure RF RX blocks (for specified channel/bandwidth) */
-    dw1000_write_reg(inst, RF_CONF_ID, RF_RXCTRLH_OFFSET, rx_config[bw], sizeof(uint8_t));
+    DW1000_PROFILE_SET(profile, RF_RXCTRLH, rx_config[bw]);
 
     /* Configure RF TX blocks (for specified channel and PRF)
      * Configure RF TX control */
-    dw1000_write_reg(inst, RF_CONF_ID, RF_TXCTRL_OFFSET, tx_config[chan_idx[chan]], sizeof(uint32_t));
+    DW1000_PROFILE_SET(profile, RF_TXCTRL, tx_config[chan_idx[chan]]);
 
     /* Configure the baseband parameters (for specified PRF, bit rate, PAC, and SFD settings) */
     /* DTUNE0 */
-    dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE0b_OFFSET, sftsh[config->dataRate][config->rx.sfdType], sizeof(uint16_t));
+    DW1000_PROFILE_SET(profile, DRX_TUNE0B, sftsh[config->dataRate][config->rx.sfdType]);
     /* DTUNE1 */
-    dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE1a_OFFSET, dtune1[prfIndex], sizeof(uint16_t));
+    DW1000_PROFILE_SET(profile, DRX_TUNE1A, dtune1[prfIndex]);
 
     if(config->dataRate == DWT_BR_110K){
-        dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_110K, sizeof(uint16_t));
+        DW1000_PROFILE_SET(profile, DRX_TUNE1B, DRX_TUNE1b_110K);
     }else{
         if(config->tx.preambleLength == DWT_PLEN_64){
-            dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_6M8_PRE64, sizeof(uint16_t));
-            dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE64, sizeof(uint16_t));
+            DW1000_PROFILE_SET(profile, DRX_TUNE1B, DRX_TUNE1b_6M8_PRE64);
+            DW1000_PROFILE_SET(profile, DRX_TUNE4H, DRX_TUNE4H_PRE64);
         }else{
-            dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_850K_6M8, sizeof(uint16_t));
-            dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE128PLUS, sizeof(uint16_t));
+            DW1000_PROFILE_SET(profile, DRX_TUNE1B, DRX_TUNE1b_850K_6M8);
+            DW1000_PROFILE_SET(profile, DRX_TUNE4H, DRX_TUNE4H_PRE128PLUS);
         }
     }
 
     /* DTUNE2 */
-    dw1000_write_reg(inst, DRX_CONF_ID, DRX_TUNE2_OFFSET,
-                     digital_bb_config[prfIndex][config->rx.pacLength], sizeof(uint32_t));
+    DW1000_PROFILE_SET(profile, DRX_TUNE2, digital_bb_config[prfIndex][config->rx.pacLength]);
 
     /* DTUNE3 (SFD timeout) */
     /* Don't allow 0 - SFD timeout will always be enabled */
     if(config->rx.sfdTimeout == 0)
         config->rx.sfdTimeout= DWT_SFDTOC_DEF;
     
-    dw1000_write_reg(inst, DRX_CONF_ID, DRX_SFDTOC_OFFSET, config->rx.sfdTimeout, sizeof(uint16_t));
+    DW1000_PROFILE_SET(profile, DRX_SFDTOC, config->rx.sfdTimeout);
 
     /* Configure AGC parameters */
-    dw1000_write_reg(inst, AGC_CTRL_ID, AGC_TUNE2_OFFSET, agc_config.lo32, sizeof(uint32_t));
-    dw1000_write_reg(inst, AGC_CTRL_ID, AGC_TUNE1_OFFSET, agc_config.target[prfIndex], sizeof(uint16_t));
+    DW1000_PROFILE_SET(profile, AGC_TUNE2, agc_config.lo32);
+    DW1000_PROFILE_SET(profile, AGC_TUNE1, agc_config.target[prfIndex]);
 
     /* Set (non-standard) user SFD for improved performance, */
     if(config->rx.sfdType){
         /* Write non standard (DW) SFD length */
-        dw1000_write_reg(inst, USR_SFD_ID, 0x0, dwnsSFDlen[config->dataRate], sizeof(uint8_t));
+        DW1000_PROFILE_SET(profile, USR_SFD, dwnsSFDlen[config->dataRate]);
         nsSfd_result = 3 ;
         useDWnsSFD = 1 ;
     }
@@ -355,19 +364,35 @@ struct _dw1000_dev_status_t dw1000_mac_config(struct _dw1000_dev_instance_t * in
         (CHAN_CTRL_TX_PCOD_MASK & (((uint32_t)config->tx.preambleCodeIndex) << CHAN_CTRL_TX_PCOD_SHIFT)) | // TX Preamble Code
         (CHAN_CTRL_RX_PCOD_MASK & (((uint32_t)config->rx.preambleCodeIndex) << CHAN_CTRL_RX_PCOD_SHIFT)) ; // RX Preamble Code
 
-    dw1000_write_reg(inst, CHAN_CTRL_ID, 0, regval, sizeof(uint32_t)) ;
+    DW1000_PROFILE_SET(profile, CHAN_CTRL, regval);
+
+    /* TX spectrum, as dw1000_phy_config_txrf */
+    DW1000_PROFILE_SET(profile, TC_PGDELAY, config->txrf.PGdly);
+    DW1000_PROFILE_SET(profile, TX_POWER, config->txrf.power);
 
     /* Set up TX Preamble Size, PRF and Data Rate */
-    inst->tx_fctrl = (((uint32_t)(config->tx.preambleLength | config->prf)) << TX_FCTRL_TXPRF_SHFT) |
+    profile->tx_fctrl = (((uint32_t)(config->tx.preambleLength | config->prf)) << TX_FCTRL_TXPRF_SHFT) |
         (((uint32_t)config->dataRate) << TX_FCTRL_TXBR_SHFT);
-    dw1000_write_reg(inst, TX_FCTRL_ID, 0, inst->tx_fctrl, sizeof(uint32_t));
-    /* The SFD transmit pattern is initialised by the DW1000 upon a user TX request,
-     * but (due to an IC issue) it is not done for an auto-ACK TX.
-     * The SYS_CTRL write below works around this issue, by simultaneously initiating
-     * and aborting a transmission, which correctly initialises the SFD
-     * after its configuration or reconfiguration. */
-    /* Request TX start and TRX off at the same time */
-    dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF, sizeof(uint8_t));
+}
+
+/**
+ * API to configure the mac layer in dw1000, compiles the configuration into a profile and applies
+ * it. Only the registers that differ from the last profile applied are written.
+ *
+ * @param inst     Pointer to _dw1000_dev_instance_t.
+ * @param config   Pointer to dw1000_dev_config_t.
+ * @return dw1000_dev_status_t 
+ *
+ */
+struct _dw1000_dev_status_t dw1000_mac_config(struct _dw1000_dev_instance_t * inst,
+                                              dw1000_dev_config_t * config)
+{
+    dw1000_profile_t profile;
+
+    if (config == NULL)
+        config = &inst->config;
+    dw1000_profile_compile(&profile, config);
+    dw1000_profile_apply(inst, &profile);
 
 #if MYNEWT_VAL(DW1000_MAC_FILTERING)
     if(inst->config.framefilter_enabled){
@@ -484,6 +509,8 @@ struct _dw1000_dev_status_t dw1000_write_tx(struct _dw1000_dev_instance_t * inst
 
     if ((txBufferOffset + txFrameLength) <= 1024){
         dw1000_write(inst, TX_BUFFER_ID, txBufferOffset,  txFrameBytes, txFrameLength);
+        if (txBufferOffset + txFrameLength > DW1000_TX_TMPL_BASE)
+            dw1000_tx_tmpl_invalidate(inst);
         /* This is only valid if the offset is 0, and not always then either  */
         if (txBufferOffset == 0) {
             for (uint8_t i = 0; i< sizeof(inst->fctrl); i++)
@@ -521,7 +548,7 @@ inline void dw1000_write_tx_fctrl(struct _dw1000_dev_instance_t * inst, uint16_t
 
     // Write the frame length to the TX frame control register
     uint32_t tx_fctrl_reg = inst->tx_fctrl | (txFrameLength + 2)  | (((uint32_t)txBufferOffset) << TX_FCTRL_TXBOFFS_SHFT);
-    dw1000_write_reg(inst, TX_FCTRL_ID, 0, tx_fctrl_reg, sizeof(uint32_t));
+    dw1000_shadow_update(inst, DW1000_SHADOW_TX_FCTRL, tx_fctrl_reg);  // No SPI access when unchanged since the last frame
  
     err = dpl_mutex_release(&inst->mutex); 
     assert(err == DPL_OK);  
@@ -554,6 +581,7 @@ struct _dw1000_dev_status_t dw1000_start_tx(struct _dw1000_dev_instance_t * inst
     if (control.delay_start_enabled)
         sys_ctrl_reg |= SYS_CTRL_TXDLYS; 
 
+    DW1000_LAT_FIRST_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_TX_START);
     if (control.delay_start_enabled){
         dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, (uint8_t) sys_ctrl_reg, sizeof(uint8_t));
         uint16_t sys_status_reg = dw1000_read_reg(inst, SYS_STATUS_ID, 3, sizeof(uint16_t)); // Read at offset 3 to get the upper 2 bytes out of 5
@@ -645,6 +673,7 @@ struct _dw1000_dev_status_t dw1000_start_rx(struct _dw1000_dev_instance_t * inst
         sys_ctrl |= SYS_CTRL_RXDLYE;
 
     dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, sys_ctrl, sizeof(uint16_t));
+    DW1000_LAT_FIRST_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_RX_START);
     if (control.delay_start_enabled){   // check for errors    
         uint8_t sys_status = dw1000_read_reg(inst, SYS_STATUS_ID, 3, sizeof(uint8_t));  // Read 1 byte at offset 3 to get the 4th byte out of 5
         inst->status.start_rx_error = (sys_status & (SYS_STATUS_HPDWARN >> 24)) != 0;   
@@ -687,7 +716,7 @@ struct _dw1000_dev_status_t dw1000_stop_rx(struct _dw1000_dev_instance_t * inst)
 
     dw1000_set_rx_timeout(inst, 0);
 
-    uint32_t mask = dw1000_read_reg(inst, SYS_MASK_ID, 0 , sizeof(uint32_t)) ; // Read set interrupt mask
+    uint32_t mask = dw1000_shadow_read(inst, DW1000_SHADOW_SYS_MASK); // Set interrupt mask
     dw1000_write_reg(inst, SYS_MASK_ID, 0, 0, sizeof(uint32_t)) ; // Clear interrupt mask - so we don't get any unwanted events        
     dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, (uint8_t) SYS_CTRL_TRXOFF, sizeof(uint8_t)); // return to idle state
     dw1000_write_reg(inst, SYS_STATUS_ID, 0, (SYS_STATUS_ALL_TX | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_GOOD), sizeof(uint32_t));
@@ -792,16 +821,12 @@ dw1000_set_rx_timeout(struct _dw1000_dev_instance_t * inst, uint16_t timeout)
 
     inst->status.rx_timeout_error = 0;
 
-    uint32_t  sys_cfg_reg = SYS_CFG_MASK & dw1000_read_reg(inst, SYS_CFG_ID, 0, sizeof(uint32_t)); 
-
     inst->control.rx_timeout_enabled = timeout > 0;
     if(inst->control.rx_timeout_enabled) {
         dw1000_write_reg(inst, RX_FWTO_ID, RX_FWTO_OFFSET, timeout, sizeof(uint16_t));
-        sys_cfg_reg |= SYS_CFG_RXWTOE;
-        dw1000_write_reg(inst, SYS_CFG_ID, 0, sys_cfg_reg, sizeof(uint32_t));
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, 0, SYS_CFG_RXWTOE);
     }else{
-        sys_cfg_reg &= ~SYS_CFG_RXWTOE;
-        dw1000_write_reg(inst, SYS_CFG_ID, 0, sys_cfg_reg, sizeof(uint32_t));
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, SYS_CFG_RXWTOE, 0);
     }
           
     err = dpl_mutex_release(&inst->mutex);  
@@ -862,6 +887,51 @@ dw1000_read_accdata(struct _dw1000_dev_instance_t * inst, uint8_t *buffer, uint1
     return inst->status;
 }
 
+/**
+ * API to queue an accumulator read on an asynchronous request: the ACC clocks are forced on, the
+ * accumulator is read and the clocks are restored, in order, when the request is submitted with
+ * dw1000_async_submit. More accesses can be queued behind it on the same request. The current
+ * PMSC_CTRL0 is read here, with a blocking access.
+ *
+ * NOTE: As with dw1000_read_accdata the first octet read is a dummy octet.
+ *
+ * @param inst       Pointer to _dw1000_dev_instance_t.
+ * @param req        Pointer to dw1000_async_req_t, needs three free entries on its list.
+ * @param buffer     The buffer into which the data will be read, valid until the request is done.
+ * @param accOffset  The offset in the acc buffer from which to read the data.
+ * @param len        The length of data to read (in bytes).
+ * @return void
+ */
+void
+dw1000_read_accdata_async(struct _dw1000_dev_instance_t * inst, dw1000_async_req_t * req, uint8_t *buffer, uint16_t accOffset, uint16_t len)
+{
+    uint16_t pmsc_ctrl = (uint16_t) dw1000_read_reg(inst, PMSC_ID, PMSC_CTRL0_OFFSET, sizeof(uint16_t));
+
+    dw1000_accdata_clocks_queue(&req->list, pmsc_ctrl, true);
+    dw1000_xfer_list_read(&req->list, ACC_MEM_ID, accOffset, buffer, len);
+    dw1000_accdata_clocks_queue(&req->list, pmsc_ctrl, false);
+}
+
+/**
+ * API to queue forcing the ACC clocks on, or restoring them, on a transfer list. Lets a long
+ * accumulator read be split over several lists or requests, the clocks forced on ahead of the
+ * first and restored behind the last.
+ *
+ * @param list       Pointer to dw1000_xfer_list_t, needs one free entry.
+ * @param pmsc_ctrl  PMSC_CTRL0 as read before forcing the clocks on.
+ * @param enable     true to force the ACC clocks on, false to restore them.
+ * @return void
+ */
+void
+dw1000_accdata_clocks_queue(dw1000_xfer_list_t * list, uint16_t pmsc_ctrl, bool enable)
+{
+    /* Same clock settings as dw1000_phy_sysclk_ACC, both octets in one access */
+    if (enable)
+        dw1000_xfer_list_write_reg(list, PMSC_ID, PMSC_CTRL0_OFFSET, (pmsc_ctrl & 0xffb3) | 0x8048, sizeof(uint16_t));
+    else
+        dw1000_xfer_list_write_reg(list, PMSC_ID, PMSC_CTRL0_OFFSET, pmsc_ctrl & 0x7fb3, sizeof(uint16_t));
+}
+
 
 /**
  * API to enable the frame filtering - (the default option is to
@@ -885,16 +955,12 @@ dw1000_mac_framefilter(struct _dw1000_dev_instance_t * inst, uint16_t enable)
     dpl_error_t err = dpl_mutex_pend(&inst->mutex,  DPL_TIMEOUT_NEVER); // Block if request pending
     assert(err == DPL_OK);
 
-    uint32_t sys_cfg_reg = SYS_CFG_MASK & dw1000_read_reg(inst, SYS_CFG_ID, 0, sizeof(uint32_t)) ; // Read sysconfig register
-
     inst->config.framefilter_enabled = enable > 0;
-    if(inst->config.framefilter_enabled){   // Enable frame filtering and configure frame types
-        sys_cfg_reg &= ~(SYS_CFG_FF_ALL_EN);  // Clear all
-        sys_cfg_reg |= (enable & SYS_CFG_FF_ALL_EN) | SYS_CFG_FFE;
-    }else
-        sys_cfg_reg &= ~(SYS_CFG_FFE);
+    if(inst->config.framefilter_enabled)   // Enable frame filtering and configure frame types
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, SYS_CFG_FF_ALL_EN, (enable & SYS_CFG_FF_ALL_EN) | SYS_CFG_FFE);
+    else
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, SYS_CFG_FFE, 0);
 
-    dw1000_write_reg(inst, SYS_CFG_ID,0, sys_cfg_reg, sizeof(uint32_t)); 
     err = dpl_mutex_release(&inst->mutex);  
     assert(err == DPL_OK);
 
@@ -921,15 +987,11 @@ dw1000_set_autoack(struct _dw1000_dev_instance_t * inst, bool enable)
     dpl_error_t err = dpl_mutex_pend(&inst->mutex,  DPL_TIMEOUT_NEVER); // Block if request pending
     assert(err == DPL_OK);
 
-    uint32_t sys_cfg_reg = SYS_CFG_MASK & dw1000_read_reg(inst, SYS_CFG_ID, 0, sizeof(uint32_t)); // Read sysconfig register
-
     inst->config.autoack_enabled = enable > 0;    
     if(inst->config.autoack_enabled){
-        sys_cfg_reg |= SYS_CFG_AUTOACK;
-        dw1000_write_reg(inst, SYS_CFG_ID,0, sys_cfg_reg, sizeof(uint32_t));
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, 0, SYS_CFG_AUTOACK);
     } else {
-        sys_cfg_reg &= ~SYS_CFG_AUTOACK;
-        dw1000_write_reg(inst, SYS_CFG_ID,0, sys_cfg_reg, sizeof(uint32_t));
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, SYS_CFG_AUTOACK, 0);
     }
 
     err = dpl_mutex_release(&inst->mutex);  
@@ -1018,14 +1080,11 @@ dw1000_set_dblrxbuff(struct _dw1000_dev_instance_t * inst, bool enable)
     dpl_error_t err = dpl_mutex_pend(&inst->mutex,  DPL_TIMEOUT_NEVER); // Block if request pending
     assert(err == DPL_OK);
 
-    uint32_t sys_cfg_reg = SYS_CFG_MASK & dw1000_read_reg(inst, SYS_CFG_ID, 0, sizeof(uint32_t)); 
-
     inst->config.dblbuffon_enabled = enable;
     if(inst->config.dblbuffon_enabled)
-        sys_cfg_reg &= ~SYS_CFG_DIS_DRXB;
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, SYS_CFG_DIS_DRXB, 0);
     else
-        sys_cfg_reg |= SYS_CFG_DIS_DRXB;
-    dw1000_write_reg(inst, SYS_CFG_ID, 0, sys_cfg_reg, sizeof(uint32_t));
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_CFG, 0, SYS_CFG_DIS_DRXB);
     
     dw1000_sync_rxbufptrs(inst);
     
@@ -1035,6 +1094,53 @@ dw1000_set_dblrxbuff(struct _dw1000_dev_instance_t * inst, bool enable)
     return inst->status;
 }
 
+#define B20_SIGN_EXTEND_TEST (0x00100000UL)
+#define B20_SIGN_EXTEND_MASK (0xFFF00000UL)
+#define B18_SIGN_EXTEND_TEST (0x00040000UL)
+#define B18_SIGN_EXTEND_MASK (0xFFFC0000UL)
+
+/**
+ * Convert the raw carrier integrator register to a signed quantity.
+ *
+ * @param regval    Register value, 21-bit.
+ * @return int32_t
+ */
+static int32_t
+dw1000_carrier_integrator_from_reg(uint32_t regval)
+{
+    /* Check for a negative number */
+    if (regval & B20_SIGN_EXTEND_TEST) {
+        /* sign extend bit #20 to whole word */
+        regval |= B20_SIGN_EXTEND_MASK;
+    } else {
+        /* make sure upper bits are clear if not sign extending */
+        regval &= DRX_CARRIER_INT_MASK;
+    }
+    /* cast unsigned value to signed quantity */
+    return (int32_t) regval;
+}
+
+/**
+ * Convert the raw time tracking offset register to a signed quantity.
+ *
+ * @param regval    Register value, 19-bit.
+ * @return int32_t
+ */
+static int32_t
+dw1000_time_tracking_offset_from_reg(uint32_t regval)
+{
+    /* Check for a negative number */
+    if (regval & B18_SIGN_EXTEND_TEST) {
+        /* sign extend bit #18 to whole word */
+        regval |= B18_SIGN_EXTEND_MASK;
+    } else {
+        /* make sure upper bits are clear if not sign extending */
+        regval &= RX_TTCKO_RXTOFS_MASK;
+    }
+    /* cast unsigned value to signed quantity */
+    return (int32_t) regval;
+}
+
 /**
  * API for reading carrier integrator value
  *
@@ -1053,22 +1159,8 @@ dw1000_set_dblrxbuff(struct _dw1000_dev_instance_t * inst, bool enable)
 int32_t
 dw1000_read_carrier_integrator(struct _dw1000_dev_instance_t * inst)
 {
-#define B20_SIGN_EXTEND_TEST (0x00100000UL)
-#define B20_SIGN_EXTEND_MASK (0xFFF00000UL)
-    uint32_t  regval=0;
     /* Read 3 bytes (21-bit quantity) */
-    regval = dw1000_read_reg(inst, DRX_CONF_ID, DRX_CARRIER_INT_OFFSET, DRX_CARRIER_INT_LEN);
-
-    /* Check for a negative number */
-    if (regval & B20_SIGN_EXTEND_TEST) {
-        /* sign extend bit #20 to whole word */
-        regval |= B20_SIGN_EXTEND_MASK;
-    } else {
-        /* make sure upper bits are clear if not sign extending */
-        regval &= DRX_CARRIER_INT_MASK;
-    }
-    /* cast unsigned value to signed quantity */
-    return (int32_t) regval;
+    return dw1000_carrier_integrator_from_reg(dw1000_read_reg(inst, DRX_CONF_ID, DRX_CARRIER_INT_OFFSET, DRX_CARRIER_INT_LEN));
 }
 
 /**
@@ -1118,22 +1210,8 @@ dw1000_calc_clock_offset_ratio(struct _dw1000_dev_instance_t * inst, int32_t int
 int32_t
 dw1000_read_time_tracking_offset(struct _dw1000_dev_instance_t * inst)
 {
-#define B18_SIGN_EXTEND_TEST (0x00040000UL)
-#define B18_SIGN_EXTEND_MASK (0xFFFC0000UL)
-    uint32_t  regval=0;
     /* Read 3 bytes (19-bit quantity) */
-    regval = dw1000_read_reg(inst, RX_TTCKO_ID, 0, 3);
-
-    /* Check for a negative number */
-    if (regval & B18_SIGN_EXTEND_TEST) {
-        /* sign extend bit #18 to whole word */
-        regval |= B18_SIGN_EXTEND_MASK;
-    } else {
-        /* make sure upper bits are clear if not sign extending */
-        regval &= RX_TTCKO_RXTOFS_MASK;
-    }
-    /* cast unsigned value to signed quantity */
-    return (int32_t) regval;
+    return dw1000_time_tracking_offset_from_reg(dw1000_read_reg(inst, RX_TTCKO_ID, 0, 3));
 }
 
 /**
@@ -1222,6 +1300,7 @@ dw1000_tasks_init(struct _dw1000_dev_instance_t * inst)
 static void 
 dw1000_irq(void *arg){
     dw1000_dev_instance_t * inst = arg;
+    DW1000_LAT_IRQ(inst);
     dpl_eventq_put(&inst->eventq, &inst->interrupt_ev);   
 }
 
@@ -1235,6 +1314,7 @@ static void *
 dw1000_interrupt_task(void *arg)
 {
     dw1000_dev_instance_t * inst = arg;
+    inst->irq_task_id = dpl_get_current_task_id();
     while (1) {
         dpl_eventq_run(&inst->eventq);
     }
@@ -1271,6 +1351,8 @@ dw1000_mac_append_interface(dw1000_dev_instance_t* inst, dw1000_mac_interface_t
         SLIST_INSERT_AFTER(prev_cbs, cbs, next);
     }else
         SLIST_INSERT_HEAD(&inst->interface_cbs, cbs, next);
+
+    dw1000_mac_dispatch_rebuild(inst);
 }
 
 
@@ -1291,6 +1373,7 @@ dw1000_mac_remove_interface(dw1000_dev_instance_t * inst, dw1000_extension_id_t
             break;
         }
     }
+    dw1000_mac_dispatch_rebuild(inst);
     if(cbs != NULL && cbs->status.selfmalloc)
         free(cbs); 
 }
@@ -1315,6 +1398,373 @@ dw1000_mac_get_interface(dw1000_dev_instance_t * inst, dw1000_extension_id_t id)
 }
 
 
+#define DW1000_MAC_KEY_FCTRL_SHIFT  (17)
+#define DW1000_MAC_KEY_HAS_CODE     (1ULL << 16)
+#define DW1000_MAC_FCTRL_STD_MASK   (0xCC40)    //!< Address modes and PAN ID compression
+#define DW1000_MAC_FCTRL_STD        (0x8840)    //!< Short destination and source, compressed PAN ID
+#define DW1000_MAC_RX_HDR_LEN       (sizeof(ieee_std_frame_t))  //!< Octets read before the frame is classified, the longest header dw1000_mac_classify() decodes
+#define DW1000_MAC_PANID_BROADCAST  (0xFFFF)    //!< PAN ID of frames to every PAN
+#define DW1000_MAC_ADDR_BROADCAST   (0xFFFF)    //!< Short address of frames to every node
+
+/* Route keys an rx handler is filtered on, false for a handler that takes every frame */
+static bool
+dw1000_mac_route_keys(const dw1000_mac_interface_t * cbs, uint64_t * key_min, uint64_t * key_max)
+{
+    uint64_t base = (uint64_t)cbs->rx_fctrl << DW1000_MAC_KEY_FCTRL_SHIFT;
+
+    if (cbs->rx_fctrl == 0) {
+        assert(cbs->rx_code_max == 0);
+        return false;
+    }
+    if (cbs->rx_code_max == 0) {
+        *key_min = base;
+        *key_max = base | DW1000_MAC_KEY_HAS_CODE | 0xFFFF;
+    } else {
+        *key_min = base | DW1000_MAC_KEY_HAS_CODE | cbs->rx_code_min;
+        *key_max = base | DW1000_MAC_KEY_HAS_CODE | cbs->rx_code_max;
+    }
+    return true;
+}
+
+/* Split the key space at every filter bound, each piece is routed to the handlers covering it */
+static void
+dw1000_mac_route_build(dw1000_mac_dispatch_t * dispatch)
+{
+    const dw1000_mac_handler_t * handlers = dispatch->handlers[DW1000_MAC_EV_RX_COMPLETE];
+    uint64_t bounds[2 * DW1000_MAC_INTERFACE_MAX];
+    uint64_t key_min, key_max;
+    int nbounds = 0;
+
+    dispatch->nroutes = 0;
+    dispatch->rx_default = 0;
+    dispatch->rx_any = 0;
+    for (int i = 0; i < dispatch->nhandlers[DW1000_MAC_EV_RX_COMPLETE]; i++) {
+        if (handlers[i].cbs->status.rx_any) {
+            dispatch->rx_default |= 1UL << i;
+            dispatch->rx_any |= 1UL << i;
+        }
+        if (!dw1000_mac_route_keys(handlers[i].cbs, &key_min, &key_max)) {
+            dispatch->rx_default |= 1UL << i;
+            continue;
+        }
+        bounds[nbounds++] = key_min;
+        bounds[nbounds++] = key_max + 1;
+    }
+    for (int i = 1; i < nbounds; i++) {
+        uint64_t b = bounds[i];
+        int j = i;
+        for (; j > 0 && bounds[j - 1] > b; j--)
+            bounds[j] = bounds[j - 1];
+        bounds[j] = b;
+    }
+    for (int k = 0; k + 1 < nbounds; k++) {
+        uint32_t mask = dispatch->rx_default;
+        bool covered = false;
+        if (bounds[k] == bounds[k + 1])
+            continue;
+        for (int i = 0; i < dispatch->nhandlers[DW1000_MAC_EV_RX_COMPLETE]; i++) {
+            if (dw1000_mac_route_keys(handlers[i].cbs, &key_min, &key_max) &&
+                key_min <= bounds[k] && bounds[k] <= key_max) {
+                mask |= 1UL << i;
+                covered = true;
+            }
+        }
+        if (!covered)
+            continue;
+        dw1000_mac_route_t * prev = dispatch->nroutes ? &dispatch->routes[dispatch->nroutes - 1] : NULL;
+        if (prev && prev->handlers == mask && prev->key_max + 1 == bounds[k]) {
+            prev->key_max = bounds[k + 1] - 1;
+            continue;
+        }
+        dw1000_mac_route_t * route = &dispatch->routes[dispatch->nroutes++];
+        route->key_min = bounds[k];
+        route->key_max = bounds[k + 1] - 1;
+        route->handlers = mask;
+    }
+}
+
+/**
+ * API to compile the registered interfaces into per event tables of their non NULL callbacks, in
+ * registration order, and the rx routes. Called by dw1000_mac_append_interface() and
+ * dw1000_mac_remove_interface(); a service that changes its callbacks or frame filter after
+ * registering calls it again.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_mac_dispatch_rebuild(dw1000_dev_instance_t * inst)
+{
+    dw1000_mac_dispatch_t * dispatch = &inst->dispatch;
+    dw1000_mac_interface_t * cbs = NULL;
+
+    memset(dispatch->nhandlers, 0, sizeof(dispatch->nhandlers));
+    dispatch->nfallback = 0;
+    SLIST_FOREACH(cbs, &inst->interface_cbs, next){
+        for (int ev = 0; ev < DW1000_MAC_EV_NUM; ev++) {
+            bool (* cb)(struct _dw1000_dev_instance_t *, struct _dw1000_mac_interface_t *) = NULL;
+            dw1000_mac_handler_t * h;
+            switch (ev) {
+            case DW1000_MAC_EV_TX_COMPLETE: cb = cbs->tx_complete_cb; break;
+            case DW1000_MAC_EV_RX_COMPLETE: cb = cbs->rx_complete_cb; break;
+            case DW1000_MAC_EV_CIR_COMPLETE: cb = cbs->cir_complete_cb; break;
+            case DW1000_MAC_EV_RX_TIMEOUT: cb = cbs->rx_timeout_cb; break;
+            case DW1000_MAC_EV_RX_ERROR: cb = cbs->rx_error_cb; break;
+            case DW1000_MAC_EV_RESET: cb = cbs->reset_cb; break;
+            case DW1000_MAC_EV_SLEEP: cb = cbs->sleep_cb; break;
+            }
+            if (cb == NULL)
+                continue;
+
+            if (ev == DW1000_MAC_EV_RX_COMPLETE && cbs->status.rx_fallback) {
+                assert(dispatch->nfallback < DW1000_MAC_INTERFACE_MAX);
+                h = &dispatch->fallback[dispatch->nfallback++];
+            } else {
+                assert(dispatch->nhandlers[ev] < DW1000_MAC_INTERFACE_MAX);
+                h = &dispatch->handlers[ev][dispatch->nhandlers[ev]++];
+            }
+            h->cb = cb;
+            h->cbs = cbs;
+        }
+    }
+    dw1000_mac_route_build(dispatch);
+}
+
+/**
+ * API to decode the header of the received frame into inst->frame_desc, once for all the
+ * rx callbacks, and derive its route key.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t, with rxbuf, frame_len and fctrl of the frame.
+ * @return void
+ */
+void
+dw1000_mac_classify(dw1000_dev_instance_t * inst)
+{
+    dw1000_mac_frame_desc_t * desc = &inst->frame_desc;
+    uint16_t len = inst->frame_len;
+
+    memset(desc, 0, sizeof(*desc));
+    desc->fctrl = inst->fctrl;
+    switch (inst->fctrl_array[0]) {
+    case FCNTL_IEEE_BLINK_CCP_64:
+    case FCNTL_IEEE_BLINK_TAG_64:
+    case FCNTL_IEEE_BLINK_ANC_64:
+        desc->fctrl = inst->fctrl_array[0];
+        if (len < sizeof(ieee_blink_frame_t))
+            break;
+        ieee_blink_frame_t * blink = (ieee_blink_frame_t *) inst->rxbuf;
+        desc->type = DW1000_MAC_FTYPE_BLINK;
+        desc->seq_num = blink->seq_num;
+        desc->euid = blink->euid;
+        desc->hdr_len = sizeof(ieee_blink_frame_t);
+        break;
+    default:
+        if ((inst->fctrl & DW1000_MAC_FCTRL_STD_MASK) != DW1000_MAC_FCTRL_STD ||
+            len < offsetof(struct _ieee_std_frame_t, code)) {
+            if (len > offsetof(struct _ieee_std_frame_t, seq_num)) {
+                desc->seq_num = ((ieee_std_frame_t *) inst->rxbuf)->seq_num;
+                desc->hdr_len = offsetof(struct _ieee_std_frame_t, PANID);
+            }
+            break;
+        }
+        ieee_std_frame_t * frame = (ieee_std_frame_t *) inst->rxbuf;
+        desc->type = DW1000_MAC_FTYPE_STD;
+        desc->seq_num = frame->seq_num;
+        desc->PANID = frame->PANID;
+        desc->dst_address = frame->dst_address;
+        desc->src_address = frame->src_address;
+        desc->hdr_len = offsetof(struct _ieee_std_frame_t, code);
+        if (len >= sizeof(ieee_std_frame_t)) {
+            desc->code = frame->code;
+            desc->has_code = 1;
+            desc->hdr_len = sizeof(ieee_std_frame_t);
+        }
+    }
+    desc->key = ((uint64_t)desc->fctrl << DW1000_MAC_KEY_FCTRL_SHIFT) |
+                (desc->has_code ? DW1000_MAC_KEY_HAS_CODE | desc->code : 0);
+}
+
+/* Route of a key, by binary search, NULL for frames that only go to the unfiltered handlers */
+static const dw1000_mac_route_t *
+dw1000_mac_route_find(const dw1000_mac_dispatch_t * dispatch, uint64_t key)
+{
+    int lo = 0, hi = dispatch->nroutes - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const dw1000_mac_route_t * route = &dispatch->routes[mid];
+        if (key < route->key_min)
+            hi = mid - 1;
+        else if (key > route->key_max)
+            lo = mid + 1;
+        else
+            return route;
+    }
+    return NULL;
+}
+
+/* Every rx handler filters on the route key, or is only offered the header of the frames off its route */
+static bool
+dw1000_mac_rx_lazy(const dw1000_dev_instance_t * inst)
+{
+    return (inst->dispatch.rx_default & ~inst->dispatch.rx_any) == 0 && inst->dispatch.nfallback == 0;
+}
+
+//! What the rx handlers need of a classified frame.
+typedef enum _dw1000_mac_rx_need_t{
+    DW1000_MAC_RX_NONE,               //!< No handler takes the frame
+    DW1000_MAC_RX_FOREIGN_PAN,        //!< Addressed to another PAN
+    DW1000_MAC_RX_HEADER,             //!< Offered with its header only
+    DW1000_MAC_RX_FRAME,              //!< Offered in full
+}dw1000_mac_rx_need_t;
+
+/* What dw1000_mac_dispatch_rx() needs of the classified frame */
+static dw1000_mac_rx_need_t
+dw1000_mac_rx_need(const dw1000_dev_instance_t * inst)
+{
+    const dw1000_mac_dispatch_t * dispatch = &inst->dispatch;
+    const dw1000_mac_frame_desc_t * desc = &inst->frame_desc;
+
+#if MYNEWT_VAL(DW1000_RX_PANID_FILTER)
+    /* With the frame filter on the receiver drops them itself */
+    if (inst->config.framefilter_enabled == 0 && desc->type == DW1000_MAC_FTYPE_STD &&
+        desc->PANID != inst->PANID && desc->PANID != DW1000_MAC_PANID_BROADCAST)
+        return DW1000_MAC_RX_FOREIGN_PAN;
+#endif
+#if MYNEWT_VAL(DW1000_RX_DST_FILTER)
+    /* Frames to other nodes, their ranging traffic among them, only reach the unfiltered handlers and
+     * with their header */
+    if (inst->config.framefilter_enabled == 0 && desc->type == DW1000_MAC_FTYPE_STD &&
+        desc->dst_address != inst->my_short_address && desc->dst_address != DW1000_MAC_ADDR_BROADCAST)
+        return dispatch->rx_default ? DW1000_MAC_RX_HEADER : DW1000_MAC_RX_NONE;
+#endif
+    if (!dw1000_mac_rx_lazy(inst))
+        return DW1000_MAC_RX_FRAME;
+    if (dispatch->nroutes && dw1000_mac_route_find(dispatch, desc->key) != NULL)
+        return DW1000_MAC_RX_FRAME;
+    return dispatch->rx_default ? DW1000_MAC_RX_HEADER : DW1000_MAC_RX_NONE;
+}
+
+/* Offer a frame to the handlers set in mask, in registration order, until one consumes it */
+static bool
+dw1000_mac_offer(dw1000_dev_instance_t * inst, const dw1000_mac_handler_t * handlers, uint32_t mask)
+{
+    while (mask) {
+        const dw1000_mac_handler_t * h = &handlers[__builtin_ctz(mask)];
+        mask &= mask - 1;
+        DW1000_LAT_STAMP(t_cb);
+        bool consumed = h->cb(inst, h->cbs);
+        DW1000_LAT_RECORD(&h->cbs->rx_latency, t_cb);
+        if (consumed) {
+            MAC_CBS_STATS_INC(h->cbs, rx_hits);
+            return true;
+        }
+        MAC_CBS_STATS_INC(h->cbs, rx_misses);
+    }
+    return false;
+}
+
+/* Route the classified frame to its owners and the unfiltered handlers, then to the fallback chain */
+static bool __attribute__((noinline))
+dw1000_mac_route_rx(dw1000_dev_instance_t * inst)
+{
+    const dw1000_mac_dispatch_t * dispatch = &inst->dispatch;
+    const dw1000_mac_route_t * route = NULL;
+    uint32_t mask = dispatch->rx_default;
+
+    /* A frame offered with its header only is not routed */
+    if (dispatch->nroutes && !inst->frame_desc.hdr_only)
+        route = dw1000_mac_route_find(dispatch, inst->frame_desc.key);
+    if (route) {
+        mask = route->handlers;
+        MAC_STATS_INC(RX_routed);
+    } else {
+        MAC_STATS_INC(RX_default);
+    }
+    if (dw1000_mac_offer(inst, dispatch->handlers[DW1000_MAC_EV_RX_COMPLETE], mask))
+        return true;
+
+    if (dispatch->nfallback && !inst->frame_desc.hdr_only &&
+        dw1000_mac_offer(inst, dispatch->fallback, (uint32_t)((1ULL << dispatch->nfallback) - 1))) {
+        MAC_STATS_INC(RX_fallback);
+        return true;
+    }
+    MAC_STATS_INC(RX_unclaimed);
+    return false;
+}
+
+/* Every handler of an event other than rx_complete, tx_complete stops at the first one returning true.
+ * Out of line, as dw1000_mac_route_rx(), so the unfiltered rx walk in dw1000_mac_dispatch() saves no more
+ * registers than the interface list walk did */
+static bool __attribute__((noinline))
+dw1000_mac_dispatch_ev(dw1000_dev_instance_t * inst, dw1000_mac_event_t event)
+{
+    const dw1000_mac_handler_t * h = inst->dispatch.handlers[event];
+    const dw1000_mac_handler_t * end = h + inst->dispatch.nhandlers[event];
+    bool consume = (event == DW1000_MAC_EV_TX_COMPLETE);
+    bool consumed = false;
+
+    DW1000_LAT_STAMP(t_chain);
+    for (; h < end; h++) {
+        if (h->cb(inst, h->cbs) && consume) {
+            consumed = true;
+            break;
+        }
+    }
+    if (event == DW1000_MAC_EV_TX_COMPLETE)
+        DW1000_LAT_SINCE(inst, DW1000_LAT_TX_CHAIN, t_chain);
+    return consumed;
+}
+
+/**
+ * API to call the handlers of an event. tx_complete stops at the first handler that returns true,
+ * the other events reach every handler. A received frame, classified by dw1000_mac_classify(),
+ * is routed on its frame control and code to the interfaces whose rx_fctrl and code range match
+ * it and to those without a filter or with status.rx_any, in registration order, until one
+ * consumes it. A frame none of them consumes is then offered to the fallback chain, the
+ * interfaces with status.rx_fallback. Off their route the status.rx_any interfaces may only get
+ * the header of the frame, see frame_desc.hdr_only, and so do the unfiltered ones for a frame
+ * addressed to another node; such a frame is neither routed nor offered to the fallback chain.
+ * Without routes or fallback chain the rx handlers are simply walked in order, no dearer than the
+ * interface list was.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param event  dw1000_mac_event_t.
+ * @return bool  true if a handler consumed a tx_complete or rx_complete event
+ */
+bool
+dw1000_mac_dispatch(dw1000_dev_instance_t * inst, dw1000_mac_event_t event)
+{
+    const dw1000_mac_dispatch_t * dispatch = &inst->dispatch;
+    const dw1000_mac_handler_t * h = dispatch->handlers[DW1000_MAC_EV_RX_COMPLETE];
+    const dw1000_mac_handler_t * end = h + dispatch->nhandlers[DW1000_MAC_EV_RX_COMPLETE];
+    bool consumed = false;
+
+    if (event != DW1000_MAC_EV_RX_COMPLETE)
+        return dw1000_mac_dispatch_ev(inst, event);
+
+    DW1000_LAT_STAMP(t_chain);
+    if (dispatch->nroutes | dispatch->nfallback) {
+        consumed = dw1000_mac_route_rx(inst);
+    } else {
+        MAC_STATS_INC(RX_default);
+        for (; h < end; h++) {
+            DW1000_LAT_STAMP(t_cb);
+            consumed = h->cb(inst, h->cbs);
+            DW1000_LAT_RECORD(&h->cbs->rx_latency, t_cb);
+            if (consumed) {
+                MAC_CBS_STATS_INC(h->cbs, rx_hits);
+                break;
+            }
+            MAC_CBS_STATS_INC(h->cbs, rx_misses);
+        }
+        if (!consumed)
+            MAC_STATS_INC(RX_unclaimed);
+    }
+    DW1000_LAT_SINCE(inst, DW1000_LAT_RX_CHAIN, t_chain);
+    return consumed;
+}
+
 /**
  * Check for double buffer overrun error
  *
@@ -1361,8 +1811,24 @@ static void
 dw1000_interrupt_ev_cb(struct dpl_event *ev)
 {
     dw1000_dev_instance_t * inst = dpl_event_get_arg(ev);
-
-    inst->sys_status = dw1000_read_reg(inst, SYS_STATUS_ID, 0, sizeof(uint32_t)); // Read status register low 32bits
+    dw1000_xfer_list_t list;
+    uint32_t finfo = 0;
+    uint8_t hdr[DW1000_MAC_RX_HDR_LEN];
+
+    DW1000_LAT_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_TASK);
+    DW1000_LAT_STAMP(t_status);
+    /* Status and frame info are fetched together, the frame info is only used for good frames but reading
+     * it here saves a bus acquisition on the receive path. When the rx handlers may not need the payload
+     * and no transmission is pending, so does the header of the frame: the frame read then fetches the
+     * rest of the frame only for the frames a handler reads in full */
+    bool hdr_first = dw1000_mac_rx_lazy(inst) && dpl_sem_get_count(&inst->tx_sem) != 0;
+    dw1000_xfer_list_init(&list);
+    dw1000_xfer_list_read(&list, SYS_STATUS_ID, 0, (uint8_t *)&inst->sys_status, sizeof(uint32_t)); // Read status register low 32bits
+    dw1000_xfer_list_read(&list, RX_FINFO_ID, RX_FINFO_OFFSET, (uint8_t *)&finfo, sizeof(uint32_t));
+    if (hdr_first)
+        dw1000_xfer_list_read(&list, RX_BUFFER_ID, 0, hdr, sizeof(hdr));
+    dw1000_xfer_list_submit(inst, &list);
+    DW1000_LAT_SINCE(inst, DW1000_LAT_SPI_STATUS, t_status);
     //printf("inst->sys_status= %lX\n",inst->sys_status);
 
     // Set status flags
@@ -1389,6 +1855,7 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
             dw1000_phy_rx_reset(inst);
             dw1000_sync_rxbufptrs(inst);
             dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET+1, SYS_CTRL_RXENAB>>8, sizeof(uint8_t));
+            DW1000_LAT_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_DONE);
             return;
         }
 
@@ -1399,27 +1866,86 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
         if (inst->config.rxauto_enable == 0 && inst->config.dblbuffon_enabled) {
             /* Clearing the Status flags here makes doublebuffring with explicit rx-enable work, 
              * not entirely sure why though? */
-            dw1000_write_reg(inst, SYS_STATUS_ID, 1, (inst->sys_status&(SYS_STATUS_LDEDONE | SYS_STATUS_RXDFR | SYS_STATUS_RXFCG | SYS_STATUS_RXFCE | SYS_STATUS_RXDFR))>>8, sizeof(uint8_t));
-            dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET+1, SYS_CTRL_RXENAB>>8, sizeof(uint8_t));
+            dw1000_xfer_list_write_reg(&list, SYS_STATUS_ID, 1, (inst->sys_status&(SYS_STATUS_LDEDONE | SYS_STATUS_RXDFR | SYS_STATUS_RXFCG | SYS_STATUS_RXFCE | SYS_STATUS_RXDFR))>>8, sizeof(uint8_t));
+            dw1000_xfer_list_write_reg(&list, SYS_CTRL_ID, SYS_CTRL_OFFSET+1, SYS_CTRL_RXENAB>>8, sizeof(uint8_t));
+            dw1000_xfer_list_submit(inst, &list);
             inst->status.rx_restarted = 1;
         }
 
-        uint16_t finfo = dw1000_read_reg(inst, RX_FINFO_ID, RX_FINFO_OFFSET, sizeof(uint16_t));     // Read frame info - Only the first two bytes of the register are used here.
         inst->frame_len = (finfo & RX_FINFO_RXFL_MASK_1023) - 2;          // Report frame length - Standard frame length up to 127, extended frame length up to 1023 bytes
 
-        
+        /* Frame, timestamp and the diagnostics in a single transfer list. It is blocking so that it goes
+         * ahead of bulk asynchronous requests of this instance instead of queueing behind them. The first
+         * path index and amplitude follow the adjusted timestamp in RX_TIME, the preamble accumulation
+         * count comes from the frame info */
+        uint8_t rx_time[RX_TIME_RX_STAMP_LEN + sizeof(inst->rxdiag.rx_time)];
+        uint32_t cireg = 0;
+        uint64_t rxtime = 0;
+        uint16_t hdr_len = 0, rest = 0;
+        dw1000_mac_rx_need_t need = DW1000_MAC_RX_FRAME;
+
         assert(inst->frame_len < sizeof(inst->rxbuf));
-        if (inst->frame_len < sizeof(inst->rxbuf))
-            dw1000_read_rx(inst, inst->rxbuf, 0, inst->frame_len);            // Read the whole frame
-        
-        inst->fctrl = ((ieee_rng_request_frame_t * ) inst->rxbuf)->fctrl; 
+        if (inst->frame_len < sizeof(inst->rxbuf)){
+            /* With the header at hand dw1000_mac_rx_need() decides whether the rest is read at all */
+            if (hdr_first) {
+                hdr_len = (inst->frame_len < sizeof(hdr)) ? inst->frame_len : sizeof(hdr);
+                memcpy(inst->rxbuf, hdr, hdr_len);
+                MAC_STATS_INCN(rx_bytes, hdr_len);
+                inst->fctrl = ((ieee_rng_request_frame_t * ) inst->rxbuf)->fctrl;
+                dw1000_mac_classify(inst);
+                need = dw1000_mac_rx_need(inst);
+            }
+            rest = inst->frame_len - hdr_len;
+            if (need == DW1000_MAC_RX_FRAME && rest) {
+                dw1000_xfer_list_read(&list, RX_BUFFER_ID, hdr_len, inst->rxbuf + hdr_len, rest);
+                MAC_STATS_INCN(rx_bytes, rest);
+                rest = 0;
+            }
+        }
+        dw1000_xfer_list_read(&list, RX_TIME_ID, RX_TIME_RX_STAMP_OFFSET, rx_time, 
+                inst->config.rxdiag_enable ? sizeof(rx_time) : RX_TIME_RX_STAMP_LEN);
+        if(inst->config.rxdiag_enable)
+            dw1000_xfer_list_read(&list, RX_FQUAL_ID, 0, (uint8_t*)&inst->rxdiag.rx_fqual, sizeof(inst->rxdiag.rx_fqual));
+        if (inst->config.dblbuffon_enabled == 0)
+            dw1000_xfer_list_read(&list, DRX_CONF_ID, DRX_CARRIER_INT_OFFSET, (uint8_t*)&cireg, DRX_CARRIER_INT_LEN);
+        else if (inst->config.rxttcko_enable)
+            dw1000_xfer_list_read(&list, RX_TTCKO_ID, 0, (uint8_t*)&cireg, 3);
+
+        DW1000_LAT_STAMP(t_frame);
+        dw1000_xfer_list_submit(inst, &list);
+        DW1000_LAT_SINCE(inst, DW1000_LAT_SPI_FRAME, t_frame);
+        if(inst->config.rxdiag_enable)
+            inst->rxdiag.pacc_cnt = (finfo & RX_FINFO_RXPACC_MASK) >> RX_FINFO_RXPACC_SHIFT;
+
+        if (!hdr_first) {
+            inst->fctrl = ((ieee_rng_request_frame_t * ) inst->rxbuf)->fctrl; 
+            dw1000_mac_classify(inst);
+            need = dw1000_mac_rx_need(inst);
+        }
+        switch (need) {
+        case DW1000_MAC_RX_FRAME:
+            break;
+        case DW1000_MAC_RX_HEADER:
+            inst->frame_desc.hdr_only = 1;
+            MAC_STATS_INC(RX_hdr_only);
+            MAC_STATS_INCN(rx_bytes_skipped, rest);
+            break;
+        case DW1000_MAC_RX_FOREIGN_PAN:
+            MAC_STATS_INC(RX_foreign_pan);
+            /* Fall through, the frame is not reported */
+        case DW1000_MAC_RX_NONE:
+            MAC_STATS_INC(RX_dropped);
+            MAC_STATS_INCN(rx_bytes_skipped, rest);
+            break;
+        }
 
         if (inst->status.lde_error) // retest lde_error condition
             inst->status.lde_error = (dw1000_read_reg(inst, SYS_STATUS_ID, 1, sizeof(uint8_t))  & (SYS_STATUS_LDEDONE >> 8)) == 0;
         if (inst->status.lde_error) // LDE eror or LDE late
             MAC_STATS_INC(LDE_err);
         
-        inst->rxtimestamp = dw1000_read_rxtime(inst);  
+        memcpy(&rxtime, rx_time, RX_TIME_RX_STAMP_LEN);
+        inst->rxtimestamp = rxtime & 0x0FFFFFFFFFFULL;
 
         // Because of a previous frame not being received properly, AAT bit can be set upon the proper reception of a frame not requesting for
         // acknowledgement (ACK frame is not actually sent though). If the AAT bit is set, check ACK request bit in frame control to confirm (this
@@ -1432,15 +1958,15 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
         }
 
         // Collect RX Frame Quality diagnositics
-        if(inst->config.rxdiag_enable)  
-            dw1000_read_rxdiag(inst, &inst->rxdiag);
+        if(inst->config.rxdiag_enable)
+            memcpy(&inst->rxdiag.rx_time, &rx_time[RX_TIME_FP_INDEX_OFFSET], sizeof(inst->rxdiag.rx_time));
         
         // Toggle the Host side Receive Buffer Pointer
         if (inst->config.dblbuffon_enabled) {
             // The rxttcko is a poor replacement for the carrier_integrator but
             // better than nothing
             if (inst->config.rxttcko_enable) {
-                inst->rxttcko = dw1000_read_time_tracking_offset(inst);
+                inst->rxttcko = dw1000_time_tracking_offset_from_reg(cireg);
             }
 
             inst->status.overrun_error = dw1000_checkoverrun(inst);
@@ -1449,7 +1975,7 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
                  * mask out interrupt flags to avoid spurious interrupts when clearing status bits */
                 if (inst->config.rxauto_enable) {
                     if (dw1000_ic_and_host_ptrs_equal(inst)) {
-                        uint8_t mask = dw1000_read_reg(inst, SYS_MASK_ID, 1 , sizeof(uint8_t));
+                        uint8_t mask = dw1000_shadow_read(inst, DW1000_SHADOW_SYS_MASK) >> 8;
                         dw1000_write_reg(inst, SYS_MASK_ID, 1, 0, sizeof(uint8_t));
                         dw1000_write_reg(inst, SYS_STATUS_ID, 1, (inst->sys_status&(SYS_STATUS_LDEDONE | SYS_STATUS_RXDFR | SYS_STATUS_RXFCG | SYS_STATUS_RXFCE | SYS_STATUS_RXDFR))>>8, sizeof(uint8_t));
                         dw1000_write_reg(inst, SYS_MASK_ID, 1, mask, sizeof(uint8_t));
@@ -1470,38 +1996,30 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
             }
         }else{
             // carrier_integrator only avilable while in single buffer mode.
-            inst->carrier_integrator = dw1000_read_carrier_integrator(inst);
+            inst->carrier_integrator = dw1000_carrier_integrator_from_reg(cireg);
 #if MYNEWT_VAL(CIR_ENABLED)
             // Call CIR complete calbacks if present
             if(inst->config.cir_enable || inst->control.cir_enable) {
-                dw1000_mac_interface_t * cbs = NULL;
-                if(!(SLIST_EMPTY(&inst->interface_cbs))) {
-                    SLIST_FOREACH(cbs, &inst->interface_cbs, next) {
-                        if (cbs != NULL && cbs->cir_complete_cb) {
-                            if(cbs->cir_complete_cb(inst,cbs)) continue;
-                        }
-                    }   
-                }  
+                dw1000_mac_dispatch(inst, DW1000_MAC_EV_CIR_COMPLETE);
                 inst->control.cir_enable = false;
             }
 #endif
-            dw1000_write_reg(inst, SYS_STATUS_ID, 0, (SYS_STATUS_LDEDONE | SYS_STATUS_RXDFR | SYS_STATUS_RXFCG | SYS_STATUS_RXFCE | SYS_STATUS_RXDFR), sizeof(uint16_t)); 
+            dw1000_xfer_list_write_reg(&list, SYS_STATUS_ID, 0, (SYS_STATUS_LDEDONE | SYS_STATUS_RXDFR | SYS_STATUS_RXFCG | SYS_STATUS_RXFCE | SYS_STATUS_RXDFR), sizeof(uint16_t)); 
             if (inst->control.rxauto_disable == false){
-                dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_RXENAB, sizeof(uint16_t));
+                dw1000_xfer_list_write_reg(&list, SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_RXENAB, sizeof(uint16_t));
                 inst->status.rx_restarted = 1;
             }
+            dw1000_xfer_list_submit(inst, &list);
+            if (inst->status.rx_restarted) {
+                DW1000_LAT_FIRST_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_RX_START);
+            }
             inst->control.rxauto_disable = false;
 
         }
         
-        // Call the corresponding frame services callback if present
-        dw1000_mac_interface_t * cbs = NULL;
-        if(!(SLIST_EMPTY(&inst->interface_cbs))){ 
-            SLIST_FOREACH(cbs, &inst->interface_cbs, next){    
-            if (cbs != NULL && cbs->rx_complete_cb) 
-                if(cbs->rx_complete_cb(inst,cbs)) break;
-            }   
-        }  
+        // Call the corresponding frame services callback if present, a dropped frame is not reported
+        if (need == DW1000_MAC_RX_FRAME || need == DW1000_MAC_RX_HEADER)
+            dw1000_mac_dispatch(inst, DW1000_MAC_EV_RX_COMPLETE);
     }
 
     // Handle TX confirmation event
@@ -1527,13 +2045,7 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
         }
         
         // Call the corresponding callback if present
-        dw1000_mac_interface_t * cbs = NULL;
-        if(!(SLIST_EMPTY(&inst->interface_cbs))){ 
-            SLIST_FOREACH(cbs, &inst->interface_cbs, next){    
-            if (cbs!=NULL && cbs->tx_complete_cb) 
-                if(cbs->tx_complete_cb(inst,cbs)) break;
-            }   
-        }          
+        dw1000_mac_dispatch(inst, DW1000_MAC_EV_TX_COMPLETE);
     }
     // Tx buffer error
     if(inst->status.txbuf_error){
@@ -1554,22 +2066,23 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
     // Handle frame reception/preamble detect timeout events
     if(inst->status.rx_timeout_error){
         MAC_STATS_INC(RTO_cnt);
-        dw1000_write_reg(inst, SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_TO, sizeof(uint32_t)); // Clear RX timeout event bits        
         // Because of an issue with receiver restart after error conditions, an RX reset must be applied 
         // after any error or timeout event to ensure the next good frame's timestamp is computed correctly.
         // See section "RX Message timestamp" in DW1000 User Manual.
-        dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, (uint16_t)SYS_CTRL_TRXOFF, sizeof(uint16_t)) ; // Disable the radio
-        dw1000_phy_rx_reset(inst);
+        dw1000_xfer_list_write_reg(&list, SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_TO, sizeof(uint32_t)); // Clear RX timeout event bits
+        dw1000_xfer_list_write_reg(&list, SYS_CTRL_ID, SYS_CTRL_OFFSET, (uint16_t)SYS_CTRL_TRXOFF, sizeof(uint16_t)); // Disable the radio
+        dw1000_xfer_list_write_reg(&list, PMSC_ID, PMSC_CTRL0_SOFTRESET_OFFSET, PMSC_CTRL0_RESET_RX, sizeof(uint8_t)); // Set RX reset
+        dw1000_xfer_list_write_reg(&list, PMSC_ID, PMSC_CTRL0_SOFTRESET_OFFSET, PMSC_CTRL0_RESET_CLEAR, sizeof(uint8_t)); // Clear RX reset
+
+        dpl_error_t err = dpl_mutex_pend(&inst->mutex, DPL_TIMEOUT_NEVER);
+        assert(err == DPL_OK);
+        dw1000_xfer_list_submit(inst, &list);
+        err = dpl_mutex_release(&inst->mutex);
+        assert(err == DPL_OK);
 
         inst->control.cir_enable = false;
         // Call the corresponding frame services callback if present
-        dw1000_mac_interface_t * cbs = NULL;
-        if(!(SLIST_EMPTY(&inst->interface_cbs))){ 
-            SLIST_FOREACH(cbs, &inst->interface_cbs, next){    
-            if (cbs!=NULL && cbs->rx_timeout_cb) 
-                if(cbs->rx_timeout_cb(inst,cbs)) continue; 
-            }   
-        }      
+        dw1000_mac_dispatch(inst, DW1000_MAC_EV_RX_TIMEOUT);
     }
 
     // Handle RX errors events
@@ -1597,13 +2110,7 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
         dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET+1, SYS_CTRL_RXENAB>>8, sizeof(uint8_t));
 
         // Call the corresponding frame services callback if present
-        dw1000_mac_interface_t * cbs = NULL;
-        if(!(SLIST_EMPTY(&inst->interface_cbs))){ 
-            SLIST_FOREACH(cbs, &inst->interface_cbs, next){    
-            if (cbs!=NULL && cbs->rx_error_cb) 
-                if(cbs->rx_error_cb(inst,cbs)) continue;         
-            }   
-        }
+        dw1000_mac_dispatch(inst, DW1000_MAC_EV_RX_ERROR);
     }
 
     /* Clear SLP2INIT event bits */
@@ -1625,15 +2132,11 @@ dw1000_interrupt_ev_cb(struct dpl_event *ev)
 
         // Call the corresponding callback if present
         inst->status.sleeping = 0;
-        dw1000_mac_interface_t * cbs = NULL;
-        if(!(SLIST_EMPTY(&inst->interface_cbs))){ 
-            SLIST_FOREACH(cbs, &inst->interface_cbs, next){    
-            if (cbs!=NULL && cbs->sleep_cb) 
-                if (cbs->sleep_cb(inst,cbs)) continue; 
-            }   
-        }         
+        dw1000_mac_dispatch(inst, DW1000_MAC_EV_SLEEP);
+        DW1000_LAT_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_DONE);
         return;
     }
+    DW1000_LAT_FROM_IRQ(inst, DW1000_LAT_IRQ_TO_DONE);
 }
 
 
@@ -1860,6 +2363,8 @@ dw1000_configcwmode(struct _dw1000_dev_instance_t * inst, uint8_t chan)
     dw1000_write_reg(inst, PMSC_ID, PMSC_CTRL1_OFFSET,
                      PMSC_CTRL1_PKTSEQ_DISABLE, sizeof(uint16_t));
 
+    dw1000_profile_invalidate(inst);
+
     /* config RF pll (for a given channel) */
     /* configure PLL2/RF PLL block CFG */
     dw1000_write_reg(inst, FS_CTRL_ID, FS_PLLCFG_OFFSET,
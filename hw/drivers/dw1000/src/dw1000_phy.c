@@ -229,8 +229,8 @@ dw1000_dev_status_t dw1000_phy_init(struct _dw1000_dev_instance_t * inst, dw1000
     // Apply tx power settings */
     dw1000_phy_config_txrf(inst, txrf_config);
 
-    // Read system register / store local copy
-    inst->sys_cfg_reg = dw1000_read_reg(inst, SYS_CFG_ID, 0, sizeof(uint32_t)) ; // Read sysconfig register
+    // Read system register into the shadow cache
+    dw1000_shadow_read(inst, DW1000_SHADOW_SYS_CFG);
 
     return inst->status;
 }
@@ -262,6 +262,7 @@ void _dw1000_phy_load_microcode(struct _dw1000_dev_instance_t * inst)
  */
 void dw1000_phy_config_lde(struct _dw1000_dev_instance_t * inst, int prfIndex)
 {
+    inst->profile.valid &= ~((1UL << DW1000_PROFILE_LDE_CFG1) | (1UL << DW1000_PROFILE_LDE_CFG2));
     dw1000_write_reg(inst, LDE_IF_ID, LDE_CFG1_OFFSET, LDE_PARAM1, sizeof(uint8_t)); // 8-bit configuration register
 
     if(prfIndex)
@@ -286,6 +287,15 @@ void dw1000_phy_config_txrf(struct _dw1000_dev_instance_t * inst, dw1000_dev_txr
     dw1000_write_reg(inst, TX_CAL_ID, TC_PGDELAY_OFFSET, config->PGdly, sizeof(uint8_t));
     // Configure TX power
     dw1000_write_reg(inst, TX_POWER_ID, 0, config->power, sizeof(uint32_t));
+
+    // Keep the setting for dw1000_mac_config(), which programs it as part of the profile
+    if (config != &inst->config.txrf)
+        memcpy(&inst->config.txrf, config, sizeof(dw1000_dev_txrf_config_t));
+    inst->profile.regs[DW1000_PROFILE_TC_PGDELAY] = config->PGdly;
+    inst->profile.regs[DW1000_PROFILE_TX_POWER] = config->power;
+#if MYNEWT_VAL(DW1000_REG_SHADOW)
+    inst->profile.valid |= (1UL << DW1000_PROFILE_TC_PGDELAY) | (1UL << DW1000_PROFILE_TX_POWER);
+#endif
 }
 
 
@@ -345,8 +355,6 @@ void dw1000_phy_rx_reset(struct _dw1000_dev_instance_t * inst)
  */
 void dw1000_phy_forcetrxoff(struct _dw1000_dev_instance_t * inst)
 {
-    uint32_t mask = dw1000_read_reg(inst, SYS_MASK_ID, 0 , sizeof(uint32_t)) ; // Read set interrupt mask
-
     // Need to beware of interrupts occurring in the middle of following read modify write cycle
     // We can disable the radio, but before the status is cleared an interrupt can be set (e.g. the
     // event has just happened before the radio was disabled)
@@ -354,6 +362,8 @@ void dw1000_phy_forcetrxoff(struct _dw1000_dev_instance_t * inst)
 
     os_error_t err = dpl_mutex_pend(&inst->mutex, DPL_WAIT_FOREVER);
     assert(err == OS_OK);
+
+    uint32_t mask = dw1000_shadow_read(inst, DW1000_SHADOW_SYS_MASK); // Set interrupt mask
     
     dw1000_write_reg(inst, SYS_MASK_ID, 0, 0, sizeof(uint32_t)) ; // Clear interrupt mask - so we don't get any unwanted events
     dw1000_write_reg(inst, SYS_CTRL_ID, SYS_CTRL_OFFSET, (uint16_t)SYS_CTRL_TRXOFF, sizeof(uint16_t)) ; // Disable the radio
@@ -365,13 +375,7 @@ void dw1000_phy_forcetrxoff(struct _dw1000_dev_instance_t * inst)
         
     dw1000_write_reg(inst, SYS_MASK_ID, 0, mask, sizeof(uint32_t)); // Restore mask to what it was
 
-    dw1000_mac_interface_t * cbs = NULL;
-    if(!(SLIST_EMPTY(&inst->interface_cbs))){ 
-            SLIST_FOREACH(cbs, &inst->interface_cbs, next){    
-            if (cbs!=NULL && cbs->reset_cb) 
-                if(cbs->reset_cb(inst,cbs)) continue;          
-            }   
-    }      
+    dw1000_mac_dispatch(inst, DW1000_MAC_EV_RESET);
     // Enable/restore interrupts again...
     err = dpl_mutex_release(&inst->mutex);
     assert(err == OS_OK);
@@ -410,14 +414,10 @@ void dw1000_phy_interrupt_mask(struct _dw1000_dev_instance_t * inst, uint32_t bi
     dpl_error_t err = dpl_mutex_pend(&inst->mutex, DPL_WAIT_FOREVER);
     assert(err == DPL_OK);
 
-    uint32_t mask = dw1000_read_reg(inst, SYS_MASK_ID, 0, sizeof(uint32_t)) ; // Read register
-
     if(enable)
-        mask |= bitmask ;
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_MASK, 0, bitmask);
     else
-        mask &= ~bitmask ; // Clear the bit
-    
-    dw1000_write_reg(inst, SYS_MASK_ID, 0, mask, sizeof(uint32_t));
+        dw1000_shadow_modify(inst, DW1000_SHADOW_SYS_MASK, bitmask, 0); // Clear the bit
 
     // Critical region, unlock mutex
     err = dpl_mutex_release(&inst->mutex);
@@ -0,0 +1,185 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_profile.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Precompiled PHY/MAC register profiles
+ *
+ * @details Applying and comparing the profiles built by dw1000_profile_compile(), which lives in
+ * dw1000_mac.c next to the channel and baseband tables it reads.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_profile.h>
+
+//! Location and width of each profile register
+static const struct {
+    uint16_t reg;
+    uint16_t subaddress;
+    uint8_t len;
+} g_profile_regs[DW1000_PROFILE_NREGS] = {
+    [DW1000_PROFILE_LDE_REPC] = {LDE_IF_ID, LDE_REPC_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_LDE_CFG1] = {LDE_IF_ID, LDE_CFG1_OFFSET, sizeof(uint8_t)},
+    [DW1000_PROFILE_LDE_CFG2] = {LDE_IF_ID, LDE_CFG2_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_FS_PLLCFG] = {FS_CTRL_ID, FS_PLLCFG_OFFSET, sizeof(uint32_t)},
+    [DW1000_PROFILE_FS_PLLTUNE] = {FS_CTRL_ID, FS_PLLTUNE_OFFSET, sizeof(uint8_t)},
+    [DW1000_PROFILE_RF_RXCTRLH] = {RF_CONF_ID, RF_RXCTRLH_OFFSET, sizeof(uint8_t)},
+    [DW1000_PROFILE_RF_TXCTRL] = {RF_CONF_ID, RF_TXCTRL_OFFSET, sizeof(uint32_t)},
+    [DW1000_PROFILE_DRX_TUNE0B] = {DRX_CONF_ID, DRX_TUNE0b_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_DRX_TUNE1A] = {DRX_CONF_ID, DRX_TUNE1a_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_DRX_TUNE1B] = {DRX_CONF_ID, DRX_TUNE1b_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_DRX_TUNE4H] = {DRX_CONF_ID, DRX_TUNE4H_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_DRX_TUNE2] = {DRX_CONF_ID, DRX_TUNE2_OFFSET, sizeof(uint32_t)},
+    [DW1000_PROFILE_DRX_SFDTOC] = {DRX_CONF_ID, DRX_SFDTOC_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_AGC_TUNE2] = {AGC_CTRL_ID, AGC_TUNE2_OFFSET, sizeof(uint32_t)},
+    [DW1000_PROFILE_AGC_TUNE1] = {AGC_CTRL_ID, AGC_TUNE1_OFFSET, sizeof(uint16_t)},
+    [DW1000_PROFILE_USR_SFD] = {USR_SFD_ID, 0, sizeof(uint8_t)},
+    [DW1000_PROFILE_CHAN_CTRL] = {CHAN_CTRL_ID, 0, sizeof(uint32_t)},
+    [DW1000_PROFILE_TC_PGDELAY] = {TX_CAL_ID, TC_PGDELAY_OFFSET, sizeof(uint8_t)},
+    [DW1000_PROFILE_TX_POWER] = {TX_POWER_ID, 0, sizeof(uint32_t)},
+};
+
+/* Submits the list once it has no room left for another access */
+static void
+dw1000_profile_room(dw1000_dev_instance_t * inst, dw1000_xfer_list_t * list)
+{
+    if (list->nxfers == DW1000_XFER_LIST_MAX)
+        dw1000_xfer_list_submit(inst, list);
+}
+
+/**
+ * API to apply a compiled profile. SYS_CFG, the profile registers and TX_FCTRL are written in that
+ * order, skipping those already holding the value, as transfer lists of at most DW1000_XFER_LIST_MAX
+ * accesses. The configuration of the profile becomes inst->config.
+ *
+ * @param inst     Pointer to dw1000_dev_instance_t.
+ * @param profile  Pointer to dw1000_profile_t built by dw1000_profile_compile().
+ * @return dw1000_dev_status_t
+ */
+dw1000_dev_status_t
+dw1000_profile_apply(dw1000_dev_instance_t * inst, dw1000_profile_t * profile)
+{
+    dw1000_profile_state_t * state = &inst->profile;
+    uint32_t t0 = os_cputime_get32();
+    dw1000_xfer_list_t list;
+    bool changed = false;
+
+    dw1000_xfer_list_init(&list);
+    changed |= dw1000_shadow_queue(inst, &list, DW1000_SHADOW_SYS_CFG,
+                   (dw1000_shadow_read(inst, DW1000_SHADOW_SYS_CFG) & ~profile->sys_cfg_clear) | profile->sys_cfg_set);
+
+    for (uint8_t i = 0; i < DW1000_PROFILE_NREGS; i++) {
+        if (!(profile->present & (1UL << i)))
+            continue;
+        if ((state->valid & (1UL << i)) && state->regs[i] == profile->regs[i]) {
+            state->writes_elided++;
+            continue;
+        }
+        dw1000_profile_room(inst, &list);
+        dw1000_xfer_list_write_reg(&list, g_profile_regs[i].reg, g_profile_regs[i].subaddress,
+                                   profile->regs[i], g_profile_regs[i].len);
+        state->regs[i] = profile->regs[i];
+#if MYNEWT_VAL(DW1000_REG_SHADOW)
+        state->valid |= 1UL << i;
+#endif
+        state->writes++;
+        changed = true;
+    }
+
+    dw1000_profile_room(inst, &list);
+    inst->tx_fctrl = profile->tx_fctrl;
+    changed |= dw1000_shadow_queue(inst, &list, DW1000_SHADOW_TX_FCTRL, inst->tx_fctrl);
+
+    if (changed) {
+        /* The SFD transmit pattern is initialised by the DW1000 upon a user TX request,
+         * but (due to an IC issue) it is not done for an auto-ACK TX.
+         * The SYS_CTRL write below works around this issue, by simultaneously initiating
+         * and aborting a transmission, which correctly initialises the SFD
+         * after its configuration or reconfiguration. */
+        /* Request TX start and TRX off at the same time */
+        dw1000_profile_room(inst, &list);
+        dw1000_xfer_list_write_reg(&list, SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF, sizeof(uint8_t));
+    }
+    dw1000_xfer_list_submit(inst, &list);
+
+    memcpy(&inst->config, &profile->config, sizeof(dw1000_dev_config_t));
+    state->applies++;
+    state->apply_usec = os_cputime_ticks_to_usecs(os_cputime_get32() - t0);
+    if (state->apply_usec > state->apply_usec_max)
+        state->apply_usec_max = state->apply_usec;
+    return inst->status;
+}
+
+/**
+ * API to compare two compiled profiles.
+ *
+ * @param a  Pointer to dw1000_profile_t.
+ * @param b  Pointer to dw1000_profile_t.
+ * @return true if applying either programs the device the same way
+ */
+bool
+dw1000_profile_equal(dw1000_profile_t * a, dw1000_profile_t * b)
+{
+    if (a->present != b->present || a->sys_cfg_clear != b->sys_cfg_clear ||
+        a->sys_cfg_set != b->sys_cfg_set || a->tx_fctrl != b->tx_fctrl)
+        return false;
+    for (uint8_t i = 0; i < DW1000_PROFILE_NREGS; i++)
+        if ((a->present & (1UL << i)) && a->regs[i] != b->regs[i])
+            return false;
+    return true;
+}
+
+/**
+ * API to forget which profile registers the device holds, the next apply writes all of them.
+ * Called by dw1000_shadow_invalidate() and whenever these registers are written directly.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_profile_invalidate(dw1000_dev_instance_t * inst)
+{
+    inst->profile.valid = 0;
+}
+
+/**
+ * API to print the profile switch statistics as json.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param print  printf like output function, console_printf on target.
+ * @return void
+ */
+void
+dw1000_profile_dump(dw1000_dev_instance_t * inst, int (* print)(const char *, ...))
+{
+    dw1000_profile_state_t * state = &inst->profile;
+
+    assert(inst && print);
+    print("{\"applies\":%lu,\"writes\":%lu,\"writes_elided\":%lu,\"valid\":\"0x%05lx\",\"apply_usec\":%lu,\"apply_usec_max\":%lu}\n",
+          (unsigned long)state->applies, (unsigned long)state->writes, (unsigned long)state->writes_elided,
+          (unsigned long)state->valid, (unsigned long)state->apply_usec, (unsigned long)state->apply_usec_max);
+}
@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_spi_cal.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Blocking vs non-blocking SPI threshold calibration
+ *
+ * @details Each size is timed DW1000_SPI_CAL_ROUNDS times over DW1000_SPI_CAL_REPS transfers and the
+ * fastest round kept, which filters out preemption by higher priority tasks. The non-blocking path
+ * leaves the CPU to other tasks while the transfer runs, so it is kept unless it costs more than
+ * 1/DW1000_SPI_CAL_MARGIN over the blocking one. The threshold is taken where that excess last changes
+ * sign, interpolated linearly between the two grid points around it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <os/os.h>
+#include <os/os_cputime.h>
+
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_spi_cal.h>
+
+#define DW1000_SPI_CAL_MARGIN   (16)    //!< Non-blocking may cost up to 1/16 more than blocking
+
+const uint16_t dw1000_spi_cal_sizes[DW1000_SPI_CAL_NSIZES] = {
+    1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128
+};
+
+/* Cost of the non-blocking path over the blocking one and the margin */
+static int64_t
+dw1000_spi_cal_excess(const uint32_t * block_ns, const uint32_t * noblock_ns, int i)
+{
+    return (int64_t)noblock_ns[i] - block_ns[i] - block_ns[i] / DW1000_SPI_CAL_MARGIN;
+}
+
+/**
+ * API to pick the transfer size from which the non-blocking path costs no more than the blocking one,
+ * within 1/DW1000_SPI_CAL_MARGIN.
+ *
+ * @param block_ns    Blocking cost at each of dw1000_spi_cal_sizes
+ * @param noblock_ns  Non-blocking cost at each of dw1000_spi_cal_sizes
+ * @return uint16_t   Smallest size to send non-blocking, UINT16_MAX if blocking wins at the top of the
+ *                    grid and the curves do not converge
+ */
+uint16_t
+dw1000_spi_cal_threshold(const uint32_t * block_ns, const uint32_t * noblock_ns)
+{
+    const uint16_t * sizes = dw1000_spi_cal_sizes;
+    int last = -1;
+
+    assert(block_ns && noblock_ns);
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++) {
+        if (dw1000_spi_cal_excess(block_ns, noblock_ns, i) > 0)
+            last = i;
+    }
+    if (last < 0)
+        return sizes[0];
+
+    /* Line through the points around the last crossing, or the two last points to extrapolate */
+    int i = (last < DW1000_SPI_CAL_NSIZES - 1) ? last : last - 1;
+    int64_t d0 = dw1000_spi_cal_excess(block_ns, noblock_ns, i);
+    int64_t d1 = dw1000_spi_cal_excess(block_ns, noblock_ns, i + 1);
+    if (d1 >= d0)
+        return (last < DW1000_SPI_CAL_NSIZES - 1) ? sizes[last + 1] : UINT16_MAX;
+
+    int64_t span = sizes[i + 1] - sizes[i];
+    int64_t x = sizes[i] + (d0 * span + (d0 - d1) - 1) / (d0 - d1);
+    if (last < DW1000_SPI_CAL_NSIZES - 1) {
+        if (x <= sizes[last])
+            x = sizes[last] + 1;
+        if (x > sizes[last + 1])
+            x = sizes[last + 1];
+    }
+    return (x < UINT16_MAX) ? (uint16_t)x : UINT16_MAX;
+}
+
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+typedef void (* dw1000_spi_cal_xfer_t)(struct _dw1000_dev_instance_t * inst, const uint8_t * cmd,
+                                       uint8_t cmd_size, uint8_t * buffer, uint16_t length);
+
+/* Fastest of DW1000_SPI_CAL_ROUNDS rounds, in ns per transfer */
+static uint32_t
+dw1000_spi_cal_time(dw1000_dev_instance_t * inst, dw1000_spi_cal_xfer_t xfer, const uint8_t * cmd,
+                    uint8_t * buffer, uint16_t length)
+{
+    uint32_t best = UINT32_MAX;
+
+    for (int r = 0; r < DW1000_SPI_CAL_ROUNDS; r++) {
+        uint32_t t0 = os_cputime_get32();
+        for (int n = 0; n < DW1000_SPI_CAL_REPS; n++) {
+            xfer(inst, cmd, 1, buffer, length);
+        }
+        uint32_t us = os_cputime_ticks_to_usecs(os_cputime_get32() - t0);
+        if (us < best)
+            best = us;
+    }
+    return best * 1000 / DW1000_SPI_CAL_REPS;
+}
+#endif
+
+/**
+ * API to time the blocking and non-blocking SPI paths of an instance and set spi_rd_noblock_min and
+ * spi_wr_noblock_min from the result. Reads RX_BUFFER and overwrites TX_BUFFER, so it is meant to run
+ * from dw1000_dev_config(), before any frame is queued. Does nothing unless DW1000_SPI_CALIBRATE is set.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_spi_calibrate(struct _dw1000_dev_instance_t * inst)
+{
+    assert(inst);
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+    static uint8_t buffer[128];
+    const uint8_t rd_cmd[] = {RX_BUFFER_ID};
+    const uint8_t wr_cmd[] = {0x80 | TX_BUFFER_ID};
+    dw1000_spi_cal_t * cal = &inst->spi_cal;
+    uint16_t wr;
+
+    assert(sizeof(buffer) >= dw1000_spi_cal_sizes[DW1000_SPI_CAL_NSIZES - 1]);
+    memset(buffer, 0, sizeof(buffer));
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++) {
+        uint16_t length = dw1000_spi_cal_sizes[i];
+        cal->rd_block_ns[i] = dw1000_spi_cal_time(inst, hal_dw1000_read, rd_cmd, buffer, length);
+        cal->rd_noblock_ns[i] = dw1000_spi_cal_time(inst, hal_dw1000_read_noblock, rd_cmd, buffer, length);
+        cal->wr_block_ns[i] = dw1000_spi_cal_time(inst, hal_dw1000_write, wr_cmd, buffer, length);
+        cal->wr_noblock_ns[i] = dw1000_spi_cal_time(inst, hal_dw1000_write_noblock, wr_cmd, buffer, length);
+    }
+
+    inst->spi_rd_noblock_min = dw1000_spi_cal_threshold(cal->rd_block_ns, cal->rd_noblock_ns);
+    /* The write threshold counts the command header */
+    wr = dw1000_spi_cal_threshold(cal->wr_block_ns, cal->wr_noblock_ns);
+    inst->spi_wr_noblock_min = (wr < UINT16_MAX) ? wr + sizeof(wr_cmd) : wr;
+#endif
+}
+
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+static void
+dw1000_spi_cal_print_curve(int (* print)(const char *, ...), const char * name, const uint32_t * ns)
+{
+    print(",\"%s\":[", name);
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++)
+        print(i ? ",%lu" : "%lu", (unsigned long)ns[i]);
+    print("]");
+}
+#endif
+
+/**
+ * API to print the SPI thresholds of an instance and, with DW1000_SPI_CALIBRATE, the measured cost
+ * curves as a json object.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param print  printf like output function, e.g. console_printf
+ * @return void
+ */
+void
+dw1000_spi_cal_dump(struct _dw1000_dev_instance_t * inst, int (* print)(const char *, ...))
+{
+    assert(inst && print);
+    print("{\"rd_noblock_min\":%u,\"wr_noblock_min\":%u", inst->spi_rd_noblock_min, inst->spi_wr_noblock_min);
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+    print(",\"size\":[");
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++)
+        print(i ? ",%u" : "%u", dw1000_spi_cal_sizes[i]);
+    print("]");
+    dw1000_spi_cal_print_curve(print, "rd_block_ns", inst->spi_cal.rd_block_ns);
+    dw1000_spi_cal_print_curve(print, "rd_noblock_ns", inst->spi_cal.rd_noblock_ns);
+    dw1000_spi_cal_print_curve(print, "wr_block_ns", inst->spi_cal.wr_block_ns);
+    dw1000_spi_cal_print_curve(print, "wr_noblock_ns", inst->spi_cal.wr_noblock_ns);
+#endif
+    print("}\n");
+}
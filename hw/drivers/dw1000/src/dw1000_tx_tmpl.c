@@ -0,0 +1,171 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_tx_tmpl.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Resident TX frame templates
+ *
+ * @details Templates are carved out of the TX buffer from DW1000_TX_TMPL_BASE upwards and never
+ * freed, services allocate theirs once at init. A write compares the frame with the host copy of the
+ * resident one and sends each run of changed octets as its own write on one transfer list. Runs
+ * closer than the command header of a new write are merged, as is everything left once the list
+ * is full.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <os/os.h>
+#include <stats/stats.h>
+
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_stats.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_tx_tmpl.h>
+
+#define DW1000_TX_TMPL_HDR_LEN  (3)     //!< Command header of a write above offset 0x7F
+
+#if MYNEWT_VAL(DW1000_MAC_STATS)
+#define TMPL_STATS_INCN(__X, __Y) STATS_INCN(inst->stat, __X, __Y)
+#else
+#define TMPL_STATS_INCN(__X, __Y) {}
+#endif
+
+/**
+ * API to reserve the TX buffer area of a template. A template that already holds at least size
+ * octets keeps its area, so a service can call this again when it is reinitialised.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param tmpl  Template to allocate.
+ * @param size  Longest frame the template will hold, at most DW1000_TX_TMPL_LEN.
+ * @return dpl_error_t  DPL_ENOMEM when the frame is too long or the TX buffer is full, the template
+ *                      then falls back to dw1000_write_tx() at offset 0.
+ */
+dpl_error_t
+dw1000_tx_tmpl_alloc(struct _dw1000_dev_instance_t * inst, dw1000_tx_tmpl_t * tmpl, uint16_t size)
+{
+    dpl_error_t err;
+
+    assert(inst && tmpl);
+    if (tmpl->size && tmpl->size >= size)
+        return DPL_OK;
+
+    err = dpl_mutex_pend(&inst->mutex, DPL_TIMEOUT_NEVER);
+    assert(err == DPL_OK);
+    if (size <= DW1000_TX_TMPL_LEN && inst->tx_tmpl_top + size <= TX_BUFFER_LEN) {
+        tmpl->offset = inst->tx_tmpl_top;
+        tmpl->size = size;
+        tmpl->len = 0;
+        inst->tx_tmpl_top += size;
+    } else {
+        tmpl->size = 0;
+    }
+    err = dpl_mutex_release(&inst->mutex);
+    assert(err == DPL_OK);
+    return tmpl->size ? DPL_OK : DPL_ENOMEM;
+}
+
+/**
+ * API to write a frame through its template and point TX_FCTRL at it, in place of the
+ * dw1000_write_tx() and dw1000_write_tx_fctrl() pair. Only the octets that differ from the resident
+ * frame are sent, all of them after the resident frame was lost.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param tmpl   Template of the frame.
+ * @param frame  Frame to send, without the CRC.
+ * @param len    Length of the frame.
+ * @return dw1000_dev_status_t
+ */
+struct _dw1000_dev_status_t
+dw1000_tx_tmpl_write(struct _dw1000_dev_instance_t * inst, dw1000_tx_tmpl_t * tmpl, uint8_t * frame, uint16_t len)
+{
+    dw1000_xfer_list_t list;
+    uint16_t resident, sent = 0;
+    dpl_error_t err;
+
+    assert(inst && tmpl && frame);
+    if (tmpl->size == 0 || len > tmpl->size) {
+        dw1000_write_tx(inst, frame, 0, len);
+        dw1000_write_tx_fctrl(inst, len, 0);
+        return inst->status;
+    }
+
+    err = dpl_mutex_pend(&inst->mutex, DPL_TIMEOUT_NEVER);
+    assert(err == DPL_OK);
+
+    /* Octets past the resident frame count as changed */
+    resident = (tmpl->epoch == inst->tx_tmpl_epoch) ? tmpl->len : 0;
+    if (resident == 0)
+        tmpl->full_writes++;
+    dw1000_xfer_list_init(&list);
+    for (uint16_t i = 0; i < len; ) {
+        if (i < resident && frame[i] == tmpl->resident[i]) {
+            i++;
+            continue;
+        }
+        uint16_t start = i, end = ++i;
+        while (i < len) {
+            if (i < resident && frame[i] == tmpl->resident[i]) {
+                i++;
+            } else if (i - end > DW1000_TX_TMPL_HDR_LEN && list.nxfers < DW1000_XFER_LIST_MAX - 1) {
+                break;
+            } else {
+                end = ++i;
+            }
+        }
+        dw1000_xfer_list_write(&list, TX_BUFFER_ID, tmpl->offset + start, frame + start, end - start);
+        sent += DW1000_TX_TMPL_HDR_LEN + end - start;
+    }
+    dw1000_xfer_list_submit(inst, &list);
+
+    memcpy(tmpl->resident, frame, len);
+    tmpl->len = len;
+    tmpl->epoch = inst->tx_tmpl_epoch;
+    tmpl->writes++;
+    tmpl->bytes_written += sent;
+    if (sent < len + 1)
+        tmpl->bytes_saved += len + 1 - sent;   // Against a full write at offset 0, one octet of header
+    TMPL_STATS_INCN(tx_bytes, len);
+    TMPL_STATS_INCN(tx_bytes_saved, (sent < len + 1) ? len + 1 - sent : 0);
+
+    for (uint8_t i = 0; i < sizeof(inst->fctrl) && i < len; i++)
+        inst->fctrl_array[i] = frame[i];
+    inst->status.tx_frame_error = 0;
+    dw1000_write_tx_fctrl(inst, len, tmpl->offset);
+
+    err = dpl_mutex_release(&inst->mutex);
+    assert(err == DPL_OK);
+    return inst->status;
+}
+
+/**
+ * API to drop the resident copies of every template, the next write of each is a full one.
+ * Called by dw1000_shadow_invalidate() and by dw1000_write_tx() when it writes into the template area.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_tx_tmpl_invalidate(struct _dw1000_dev_instance_t * inst)
+{
+    inst->tx_tmpl_epoch++;
+}
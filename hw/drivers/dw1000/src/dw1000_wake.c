@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file dw1000_wake.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Wakeup configuration restore
+ *
+ * @details The registers in g_wake_regs are the ones the host configures and the device never changes
+ * by itself, so any difference between the value read after a wakeup and the one read before sleeping
+ * means the device lost it. A register found unchanged only shows it was kept if it held something
+ * other than its reset value, a lost one reading back as that; until then it stays unclassified and
+ * is snapshotted and checked on every wakeup. Snapshots and restores go out as transfer lists of at
+ * most DW1000_XFER_LIST_MAX accesses each.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_wake.h>
+
+//! Register checked across sleep.
+static const struct {
+    uint16_t reg;
+    uint16_t subaddress;
+    uint8_t len;
+    uint64_t reset;                 //!< Value after reset, and after a wakeup that lost it
+} g_wake_regs[DW1000_WAKE_NREGS] = {
+    {SYS_CFG_ID, 0, SYS_CFG_LEN, 0x00001200},
+    {SYS_MASK_ID, 0, SYS_MASK_LEN, 0},
+    {TX_FCTRL_ID, 0, TX_FCTRL_LEN, 0x0015400C},
+    {PANADR_ID, 0, PANADR_LEN, 0xFFFFFFFF},
+    {RX_FWTO_ID, 0, RX_FWTO_LEN, 0},
+    {ACK_RESP_T_ID, 0, ACK_RESP_T_LEN, 0},
+    {TX_POWER_ID, 0, TX_POWER_LEN, 0x1E080222},
+    {CHAN_CTRL_ID, 0, CHAN_CTRL_LEN, 0x00000055},
+    {TX_ANTD_ID, TX_ANTD_OFFSET, TX_ANTD_LEN, 0},
+    {AGC_CTRL_ID, AGC_TUNE1_OFFSET, AGC_TUNE1_LEN, 0x8870},
+    {DRX_CONF_ID, DRX_TUNE2_OFFSET, DRX_TUNE2_LEN, 0x311E0035},
+    {LDE_IF_ID, LDE_RXANTD_OFFSET, LDE_RXANTD_LEN, 0},
+    {LDE_IF_ID, LDE_CFG2_OFFSET, LDE_CFG2_LEN, 0},
+    {LDE_IF_ID, LDE_REPC_OFFSET, LDE_REPC_LEN, 0},
+};
+
+//! The antenna delays, known to be lost and rewritten by the CPLOCK interrupt as well, so never learned
+#define DW1000_WAKE_ANTD ((1UL << 8) | (1UL << 11))
+#define DW1000_WAKE_ALL ((1UL << DW1000_WAKE_NREGS) - 1)
+
+/* True if vals holds the reset value of register i */
+static bool
+dw1000_wake_is_reset(uint8_t i, const uint8_t * vals)
+{
+    for (uint8_t j = 0; j < g_wake_regs[i].len; j++)
+        if (vals[j] != (uint8_t)(g_wake_regs[i].reset >> (8 * j)))
+            return false;
+    return true;
+}
+
+/* Reads the registers in mask into vals, one transfer list per DW1000_XFER_LIST_MAX of them */
+static void
+dw1000_wake_read(dw1000_dev_instance_t * inst, uint32_t mask, uint8_t vals[][DW1000_WAKE_REG_LEN])
+{
+    dw1000_xfer_list_t list;
+
+    dw1000_xfer_list_init(&list);
+    for (uint8_t i = 0; i < DW1000_WAKE_NREGS; i++) {
+        if (!(mask & (1UL << i)))
+            continue;
+        if (list.nxfers == DW1000_XFER_LIST_MAX) {
+            dw1000_xfer_list_submit(inst, &list);
+            dw1000_xfer_list_init(&list);
+        }
+        dw1000_xfer_list_read(&list, g_wake_regs[i].reg, g_wake_regs[i].subaddress, vals[i], g_wake_regs[i].len);
+    }
+    if (list.nxfers)
+        dw1000_xfer_list_submit(inst, &list);
+}
+
+/**
+ * API to snapshot the configuration ahead of sleep, called by dw1000_dev_enter_sleep() with the
+ * instance mutex held. The registers a wakeup has shown to be kept are not read.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return void
+ */
+void
+dw1000_wake_snapshot(dw1000_dev_instance_t * inst)
+{
+    dw1000_wake_t * wake = &inst->wake;
+
+    wake->snapped = DW1000_WAKE_ALL & ~wake->kept;
+    dw1000_wake_read(inst, wake->snapped, wake->vals);
+    wake->shadow_valid = inst->shadow.valid;
+    wake->armed = 1;
+}
+
+/**
+ * API to bring the configuration back after a wakeup, called by dw1000_dev_wakeup() with the instance
+ * mutex held once the device answers. The unclassified registers are read back, those changed join
+ * the lost ones and those holding a value other than their reset value the kept ones. The wakeup
+ * events are then cleared and the lost registers rewritten in one transfer list.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return true if the snapshot was restored, false if the device did not enter sleep through
+ *         dw1000_dev_enter_sleep() and needs the full configuration
+ */
+bool
+dw1000_wake_restore(dw1000_dev_instance_t * inst)
+{
+    dw1000_wake_t * wake = &inst->wake;
+    dw1000_xfer_list_t list;
+
+    if (!wake->armed)
+        return false;
+    wake->armed = 0;
+
+    wake->lost |= DW1000_WAKE_ANTD;
+    uint32_t unknown = wake->snapped & ~wake->lost;
+    if (unknown) {
+        uint8_t now[DW1000_WAKE_NREGS][DW1000_WAKE_REG_LEN];
+
+        dw1000_wake_read(inst, unknown, now);
+        for (uint8_t i = 0; i < DW1000_WAKE_NREGS; i++) {
+            if (!(unknown & (1UL << i)))
+                continue;
+            if (memcmp(now[i], wake->vals[i], g_wake_regs[i].len))
+                wake->lost |= 1UL << i;
+            else if (!dw1000_wake_is_reset(i, now[i]))
+                wake->kept |= 1UL << i;
+        }
+    }
+
+    dw1000_xfer_list_init(&list);
+    dw1000_xfer_list_write_reg(&list, SYS_STATUS_ID, 0, SYS_STATUS_SLP2INIT | SYS_STATUS_ALL_RX_ERR, sizeof(uint32_t));
+    for (uint8_t i = 0; i < DW1000_WAKE_NREGS; i++) {
+        if (!(wake->lost & wake->snapped & (1UL << i)))
+            continue;
+        if (list.nxfers == DW1000_XFER_LIST_MAX) {
+            dw1000_xfer_list_submit(inst, &list);
+            dw1000_xfer_list_init(&list);
+        }
+        dw1000_xfer_list_write(&list, g_wake_regs[i].reg, g_wake_regs[i].subaddress, wake->vals[i], g_wake_regs[i].len);
+    }
+    dw1000_xfer_list_submit(inst, &list);
+
+    /* The device holds what it held before sleeping, the TX buffer aside */
+    inst->shadow.valid = wake->shadow_valid;
+    dw1000_tx_tmpl_invalidate(inst);
+    wake->wakeups++;
+    return true;
+}
+
+/**
+ * API to print the wakeup statistics as json.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param print  printf like output function, console_printf on target.
+ * @return void
+ */
+void
+dw1000_wake_dump(dw1000_dev_instance_t * inst, int (* print)(const char *, ...))
+{
+    dw1000_wake_t * wake = &inst->wake;
+
+    assert(inst && print);
+    print("{\"wakeups\":%lu,\"kept\":\"0x%04lx\",\"lost\":\"0x%04lx\",\"wake_usec\":%lu,\"wake_usec_max\":%lu,"
+          "\"ready_usec\":%lu,\"ready_usec_max\":%lu,\"ready_usec_avg\":%lu}\n",
+          (unsigned long)wake->wakeups, (unsigned long)wake->kept, (unsigned long)wake->lost,
+          (unsigned long)wake->wake_usec, (unsigned long)wake->wake_usec_max,
+          (unsigned long)wake->ready_usec, (unsigned long)wake->ready_usec_max,
+          (unsigned long)(wake->wakeups ? wake->ready_usec_total / wake->wakeups : 0));
+}
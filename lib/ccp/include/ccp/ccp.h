@@ -42,6 +42,9 @@ extern "C" {
 #include <dw1000/dw1000_dev.h>
 #include <dw1000/dw1000_mac.h>
 #include <dw1000/dw1000_ftypes.h>
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+#include <ccp/ccp_holdover.h>
+#endif
 #if MYNEWT_VAL(FS_XTALT_AUTOTUNE_ENABLED)
 #include <dsp/sosfilt.h>
 #include <dsp/polyval.h>
@@ -63,6 +66,7 @@ STATS_SECT_START(ccp_stat_section)
     STATS_SECT_ENTRY(tx_relay_error)
     STATS_SECT_ENTRY(tx_relay_ok)
     STATS_SECT_ENTRY(rx_timeout)
+    STATS_SECT_ENTRY(rx_holdover)
     STATS_SECT_ENTRY(reset)
 STATS_SECT_END
 #endif
@@ -129,6 +133,7 @@ typedef struct _dw1000_ccp_status_t{
     uint16_t start_rx_error:1;        //!< Set for start request error
     uint16_t rx_timeout_error:1;      //!< Receive timeout error 
     uint16_t timer_enabled:1;         //!< Indicates timer is enabled 
+    uint16_t holdover:1;              //!< Last beacon missed, epochs predicted
 }dw1000_ccp_status_t;
 
 //! Extension ids for services.
@@ -159,10 +164,15 @@ typedef struct _dw1000_ccp_instance_t{
     struct _wcs_instance_t * wcs;               //!< Wireless clock calibration 
 #endif
 
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+    ccp_holdover_t holdover;                    //!< Clock carried over missed beacons
+#endif
 #if MYNEWT_VAL(FS_XTALT_AUTOTUNE_ENABLED)
     struct _sos_instance_t * xtalt_sos;         //!< Sturcture of xtalt_sos
 #endif
     dw1000_mac_interface_t cbs;                     //!< MAC Layer Callbacks
+    dw1000_tx_tmpl_t tx_tmpl;                       //!< Resident master frame
+    dw1000_tx_tmpl_t relay_tmpl;                    //!< Resident relayed frame
     uint64_t master_euid;                           //!< Clock Master EUID, used to reset wcs if master changes
     struct dpl_sem sem;                             //!< Structure containing os semaphores
     struct dpl_event postprocess_event;             //!< Structure of callout_postprocess
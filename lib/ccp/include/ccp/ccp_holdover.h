@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file ccp_holdover.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Holdover of the master clock across missed ccp beacons
+ *
+ * @details A two state Kalman filter, master time and skew against the local clock, is run on the
+ * received beacons. When a beacon is missed the state is carried forward one interval to where the
+ * beacon should have been and the covariance grows with it, giving the guard the ccp listen window
+ * and the tdma slots need and a time quality to report. The step a beacon makes on its return is
+ * slewed out of the master time over CCP_HOLDOVER_SLEW intervals. Times are 40 bit dtu.
+ */
+
+#ifndef _CCP_HOLDOVER_H_
+#define _CCP_HOLDOVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CCP_HOLDOVER_DTU_PER_SEC    (499.2e6 * 128)     //!< Local clock rate
+
+//! Status of the holdover.
+typedef struct _ccp_holdover_status_t{
+    uint16_t initialized:1;           //!< A beacon has been received
+    uint16_t valid:1;                 //!< Skew known, at least two beacons received
+    uint16_t holdover:1;              //!< Last beacon missed and predicted
+    uint16_t lost:1;                  //!< Beyond CCP_HOLDOVER_MAX_MISSED beacons or CCP_HOLDOVER_MAX_GUARD
+}ccp_holdover_status_t;
+
+//! Counters of the holdover.
+typedef struct _ccp_holdover_stats_t{
+    uint32_t beacons;                 //!< Beacons received
+    uint32_t missed;                  //!< Beacons predicted
+    uint32_t holdovers;               //!< Outages entered
+    uint32_t reacquired;              //!< Outages ended by a beacon within the holdover
+    uint32_t lost;                    //!< Outages that ran out of holdover
+}ccp_holdover_stats_t;
+
+//! Holdover instance.
+typedef struct _ccp_holdover_t{
+    ccp_holdover_status_t status;     //!< Status
+    ccp_holdover_stats_t stats;       //!< Counters
+    uint16_t missed;                  //!< Beacons missed in a row
+    uint64_t local_epoch;             //!< Local time of the last beacon, received or predicted
+    uint64_t master_epoch;            //!< Whole part of the master time at local_epoch
+    uint64_t beacon;                  //!< Master timestamp of the last beacon, received or predicted
+    double theta;                     //!< Fractional part of the master time at local_epoch, dtu
+    double skew;                      //!< Master less local rate, in parts of the local rate
+    double P[2][2];                   //!< Covariance of theta (dtu^2) and skew
+    double q_phase;                   //!< Phase noise of the clocks, dtu^2/s
+    double q_skew;                    //!< Random walk of the skew, 1/s
+    double r;                         //!< Timestamp noise, dtu^2
+    double slew;                      //!< Step being slewed out of the master time at slew_epoch, dtu
+    double slew_span;                 //!< Local time the step is slewed over, dtu
+    uint64_t slew_epoch;              //!< Local time of the step
+}ccp_holdover_t;
+
+void ccp_holdover_init(ccp_holdover_t * ho);
+void ccp_holdover_reset(ccp_holdover_t * ho);
+void ccp_holdover_update(ccp_holdover_t * ho, uint64_t local, uint64_t master);
+uint64_t ccp_holdover_miss(ccp_holdover_t * ho, uint64_t interval);
+double ccp_holdover_sigma(ccp_holdover_t * ho, uint64_t dt);
+uint16_t ccp_holdover_guard(ccp_holdover_t * ho, uint64_t dt);
+uint8_t ccp_holdover_quality(ccp_holdover_t * ho);
+uint64_t ccp_holdover_local_to_master(ccp_holdover_t * ho, uint64_t local);
+uint64_t ccp_holdover_master_to_local(ccp_holdover_t * ho, uint64_t master);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CCP_HOLDOVER_H_ */
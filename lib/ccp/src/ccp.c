@@ -39,6 +39,7 @@
 #include <dw1000/dw1000_dev.h>
 #include <dw1000/dw1000_phy.h>
 #include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_time.h>
 #if MYNEWT_VAL(CCP_ENABLED)
 #include <ccp/ccp.h>
 #endif
@@ -103,6 +104,7 @@ STATS_NAME_START(ccp_stat_section)
     STATS_NAME(ccp_stat_section, tx_relay_error)
     STATS_NAME(ccp_stat_section, tx_relay_ok)
     STATS_NAME(ccp_stat_section, rx_timeout)
+    STATS_NAME(ccp_stat_section, rx_holdover)
     STATS_NAME(ccp_stat_section, reset)
 STATS_NAME_END(ccp_stat_section)
 
@@ -197,6 +199,25 @@ ccp_master_timer_ev_cb(struct dpl_event *ev) {
     }
 }
 
+/**
+ * @fn ccp_guard(dw1000_ccp_instance_t * ccp)
+ * @brief Guard the slave opens either side of the next beacon for the uncertainty of its clock.
+ *
+ * @param ccp  Pointer to dw1000_ccp_instance_t.
+ * @return guard in dwt usecs, 0 without holdover
+ */
+static uint16_t
+ccp_guard(dw1000_ccp_instance_t * ccp)
+{
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+    if (ccp->holdover.status.valid && !ccp->holdover.status.lost) {
+        uint16_t guard = ccp_holdover_guard(&ccp->holdover, dw1000_uus_to_dtu(ccp->period));
+        return guard < MYNEWT_VAL(CCP_HOLDOVER_MAX_GUARD) ? guard : MYNEWT_VAL(CCP_HOLDOVER_MAX_GUARD);
+    }
+#endif
+    return 0;
+}
+
 /**
  * @fn ccp_slave_timer_ev_cb(struct os_event *ev)
  * @brief The OS scheduler is not accurate enough for the timing requirement of an RTLS system.
@@ -226,17 +247,19 @@ ccp_slave_timer_ev_cb(struct dpl_event *ev) {
     CCP_STATS_INC(slave_cnt);
 #if MYNEWT_VAL(WCS_ENABLED)
     wcs_instance_t * wcs = ccp->wcs;
-    uint64_t dx_time = ccp->local_epoch +
-        (uint64_t) roundf((1.0l + wcs->skew) * (double)((uint64_t)ccp->period << 16)) -
-        ((uint64_t)ceilf(dw1000_usecs_to_dwt_usecs(dw1000_phy_SHR_duration(&inst->attrib))) << 16);
+    uint64_t dx_time = dw1000_dtu_add(ccp->local_epoch,
+        (int64_t) roundf((1.0l + wcs->skew) * (double)dw1000_uus_to_dtu(ccp->period)) -
+        (int64_t) dw1000_uus_to_dtu(ceilf(dw1000_usecs_to_dwt_usecs(dw1000_phy_SHR_duration(&inst->attrib)))));
 #else
-    uint64_t dx_time = ccp->local_epoch 
-             + ((uint64_t)ccp->period << 16)
-             - ((uint64_t)ceilf(dw1000_usecs_to_dwt_usecs(dw1000_phy_SHR_duration(&inst->attrib))) << 16);
+    uint64_t dx_time = dw1000_dtu_add(ccp->local_epoch,
+             dw1000_uus_to_dtu(ccp->period)
+             - dw1000_uus_to_dtu(ceilf(dw1000_usecs_to_dwt_usecs(dw1000_phy_SHR_duration(&inst->attrib)))));
 #endif
+    uint16_t guard = ccp_guard(ccp);
+    dx_time = dw1000_dtu_add(dx_time, -(int64_t)dw1000_uus_to_dtu(guard));
 
     uint16_t timeout = dw1000_phy_frame_duration(&inst->attrib, sizeof(ccp_blink_frame_t))
-                        + MYNEWT_VAL(XTALT_GUARD);
+                        + MYNEWT_VAL(XTALT_GUARD) + 2 * guard;
 
 #if MYNEWT_VAL(CCP_MAX_CASCADE_RPTS) != 0
     /* Adjust timeout if we're using cascading ccp in anchors */
@@ -259,6 +282,7 @@ reset_timer:
             - MYNEWT_VAL(OS_LATENCY)
             + (uint32_t)dw1000_dwt_usecs_to_usecs(ccp->period)
             - dw1000_phy_frame_duration(&inst->attrib, sizeof(ccp_blink_frame_t))
+            - (uint32_t)dw1000_dwt_usecs_to_usecs(ccp_guard(ccp))
             )
         );
 }
@@ -377,6 +401,14 @@ dw1000_ccp_init(struct _dw1000_dev_instance_t * inst, uint16_t nframes){
 
     dpl_error_t err = dpl_sem_init(&ccp->sem, 0x1);
     assert(err == DPL_OK);
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+    ccp_holdover_init(&ccp->holdover);
+#endif
+
+    /* Only the sequence number and timestamps change between frames, without room in the TX buffer
+     * the frames are written in full */
+    dw1000_tx_tmpl_alloc(inst, &ccp->tx_tmpl, sizeof(ccp_blink_frame_t));
+    dw1000_tx_tmpl_alloc(inst, &ccp->relay_tmpl, sizeof(ccp_blink_frame_t));
 
 #if MYNEWT_VAL(WCS_ENABLED)
     ccp->wcs = wcs_init(NULL, ccp);                       // Using wcs process
@@ -393,7 +425,9 @@ dw1000_ccp_init(struct _dw1000_dev_instance_t * inst, uint16_t nframes){
         .rx_timeout_cb = ccp_rx_timeout_cb,
         .rx_error_cb = ccp_error_cb,
         .tx_error_cb = ccp_error_cb,
-        .reset_cb = ccp_reset_cb
+        .reset_cb = ccp_reset_cb,
+        .status.rx_any = 1,
+        .rx_fctrl = FCNTL_IEEE_BLINK_CCP_64
     };
     dw1000_mac_append_interface(inst, &ccp->cbs);
 
@@ -505,23 +539,22 @@ ccp_postprocess(struct dpl_event * ev){
     assert(ev != NULL);
     assert(dpl_event_get_arg(ev));
 
+#if MYNEWT_VAL(CCP_VERBOSE)
     dw1000_ccp_instance_t * ccp = (dw1000_ccp_instance_t *) dpl_event_get_arg(ev);
     ccp_frame_t * previous_frame = ccp->frames[(uint16_t)(ccp->idx-1)%ccp->nframes];
     ccp_frame_t * frame = ccp->frames[(ccp->idx)%ccp->nframes];
     uint64_t delta = 0;
 
     if (ccp->config.role == CCP_ROLE_MASTER){
-        delta = (frame->transmission_timestamp.timestamp - previous_frame->transmission_timestamp.timestamp);
+        delta = dw1000_dtu_sub(frame->transmission_timestamp.timestamp, previous_frame->transmission_timestamp.timestamp);
     } else {
-        delta = (frame->reception_timestamp - previous_frame->reception_timestamp);
+        delta = dw1000_dtu_sub(frame->reception_timestamp, previous_frame->reception_timestamp);
     }
-    delta = delta & ((uint64_t)1<<63)?delta & 0xFFFFFFFFFF :delta;
 
-#if MYNEWT_VAL(CCP_VERBOSE)
     float clock_offset = dw1000_calc_clock_offset_ratio(ccp->dev_inst, frame->carrier_integrator);
     printf("{\"utime\": %lu,\"ccp\":[\"%llX\",\"%llX\"],\"clock_offset\": %lu,\"seq_num\" :%d}\n",
         os_cputime_ticks_to_usecs(os_cputime_get32()),
-        (uint64_t)frame->transmission_timestamp,
+        (uint64_t)frame->transmission_timestamp.timestamp,
         delta,
         *(uint32_t *)&clock_offset,
         frame->seq_num
@@ -550,7 +583,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
 {
     dw1000_ccp_instance_t * ccp = (dw1000_ccp_instance_t *)cbs->inst_ptr;
 
-    if (inst->fctrl_array[0] != FCNTL_IEEE_BLINK_CCP_64){
+    if (inst->frame_desc.fctrl != FCNTL_IEEE_BLINK_CCP_64){
         if(dpl_sem_get_count(&ccp->sem) == 0){
             dw1000_set_rx_timeout(inst, (uint16_t) 0xffff);
             return true;
@@ -595,6 +628,9 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
         ccp->status.valid = (MYNEWT_VAL(CCP_VALID_THRESHOLD)==0);
 #if MYNEWT_VAL(WCS_ENABLED)
         ccp->wcs->status.initialized = 0;
+#endif
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+        ccp_holdover_reset(&ccp->holdover);
 #endif
     } else {
         ccp->status.valid |= ccp->idx > (MYNEWT_VAL(CCP_VALID_THRESHOLD)-1);
@@ -602,7 +638,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
 
     ccp->master_epoch.timestamp = frame->transmission_timestamp.timestamp;
     ccp->local_epoch = frame->reception_timestamp = inst->rxtimestamp;
-    ccp->period = (frame->transmission_interval >> 16);
+    ccp->period = dw1000_dtu_to_uus(frame->transmission_interval);
     frame->carrier_integrator = inst->carrier_integrator;
     if (inst->config.rxttcko_enable) {
         frame->rxttcko = inst->rxttcko;
@@ -625,7 +661,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
         CCP_STATS_INC(rx_relayed);
         /* Assume ccp intervals are a multiple of 0x10000 dwt usec -> 0x100000000 dwunits */
         uint64_t master_interval = ((frame->transmission_interval/0x100000000UL+1)*0x100000000UL);
-        ccp->period = master_interval>>16;
+        ccp->period = dw1000_dtu_to_uus(master_interval);
         uint64_t repeat_dly = master_interval - frame->transmission_interval;
         ccp->master_epoch.timestamp = (ccp->master_epoch.timestamp - repeat_dly);
 
@@ -633,15 +669,29 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
         /* Compensate for skew before correcting our local timestamp for repeat delay. */
         repeat_dly *= (1.0l - ccp->wcs->skew);
 #endif
-        ccp->local_epoch = (ccp->local_epoch - repeat_dly) & 0x0FFFFFFFFFFUL;
+        ccp->local_epoch = dw1000_dtu_add(ccp->local_epoch, -(int64_t)repeat_dly);
         frame->reception_timestamp = ccp->local_epoch;
         /* master_interval and transmission_interval are expressed as dwt_usecs */
-        ccp->os_epoch -= os_cputime_usecs_to_ticks(dw1000_dwt_usecs_to_usecs((repeat_dly >> 16)));
+        ccp->os_epoch -= os_cputime_usecs_to_ticks(dw1000_dwt_usecs_to_usecs(dw1000_dtu_to_uus(repeat_dly)));
         /* Carrier integrator is only valid if direct from the master */
         frame->carrier_integrator = 0;
         frame->rxttcko = 0;
     }
 
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+    ccp_holdover_update(&ccp->holdover, ccp->local_epoch, ccp->master_epoch.lo);
+    ccp->status.holdover = 0;
+    if (ccp->holdover.slew != 0) {
+        /* While the step of a reacquisition is slewed out the epochs follow the holdover clock, to the local
+         * time its master time reaches the beacon, so the slave timer and tdma slots converge instead of stepping */
+        uint64_t epoch = ccp_holdover_master_to_local(&ccp->holdover, ccp->master_epoch.lo);
+        int64_t shift = dw1000_dtu_diff(epoch, ccp->local_epoch);
+        uint32_t ticks = os_cputime_usecs_to_ticks(dw1000_dwt_usecs_to_usecs(dw1000_dtu_to_uus(shift < 0 ? -shift : shift)));
+        ccp->local_epoch = epoch;
+        ccp->os_epoch = shift < 0 ? ccp->os_epoch - ticks : ccp->os_epoch + ticks;
+    }
+#endif
+
     /* Cascade relay of ccp packet */
     if (ccp->config.role == CCP_ROLE_RELAY && ccp->status.valid && frame->rpt_count < frame->rpt_max) {
         ccp_frame_t tx_frame;
@@ -650,16 +700,15 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
         /* Only replace the short id, retain the euid to know which master this originates from */
         tx_frame.short_address = inst->my_short_address;
         tx_frame.rpt_count++;
-        uint64_t tx_timestamp = frame->reception_timestamp;
-        tx_timestamp += tx_frame.rpt_count*((uint64_t)ccp->config.tx_holdoff_dly<<16);
-        tx_timestamp &= 0x0FFFFFFFE00UL;
+        uint64_t tx_timestamp = dw1000_dtu_dx_time(frame->reception_timestamp,
+                                    tx_frame.rpt_count*dw1000_uus_to_dtu(ccp->config.tx_holdoff_dly));
         dw1000_set_delay_start(inst, tx_timestamp);
 
         /* Need to add antenna delay */
-        tx_timestamp += inst->tx_antenna_delay;
+        tx_timestamp = dw1000_dtu_tx_stamp(tx_timestamp, inst->tx_antenna_delay);
 
         /* Calculate the transmission time of our packet in the masters reference */
-        uint64_t tx_delay = (tx_timestamp - frame->reception_timestamp);
+        uint64_t tx_delay = dw1000_dtu_sub(tx_timestamp, frame->reception_timestamp);
 #if MYNEWT_VAL(WCS_ENABLED)
         tx_delay *= (1.0l - ccp->wcs->skew);
 #endif
@@ -669,8 +718,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
          * original master's timestamp */
         tx_frame.transmission_interval = frame->transmission_interval - tx_delay;
 
-        dw1000_write_tx(inst, tx_frame.array, 0, sizeof(ccp_blink_frame_t));
-        dw1000_write_tx_fctrl(inst, sizeof(ccp_blink_frame_t), 0);
+        dw1000_tx_tmpl_write(inst, &ccp->relay_tmpl, tx_frame.array, sizeof(ccp_blink_frame_t));
         ccp->status.start_tx_error = dw1000_start_tx(inst).start_tx_error;
         if (ccp->status.start_tx_error){
             CCP_STATS_INC(tx_relay_error);
@@ -734,7 +782,7 @@ ccp_tx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t
     ccp->os_epoch = os_cputime_get32();
     ccp->local_epoch = frame->transmission_timestamp.lo;
     ccp->master_epoch = frame->transmission_timestamp;
-    ccp->period = (frame->transmission_interval >> 16);
+    ccp->period = dw1000_dtu_to_uus(frame->transmission_interval);
 
     if (ccp->status.timer_enabled){
         os_cputime_timer_start(&ccp->timer, ccp->os_epoch
@@ -796,7 +844,24 @@ ccp_rx_timeout_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t *
         return false;
 
     if (dpl_sem_get_count(&ccp->sem) == 0){
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+        uint64_t dt = 0;
+        if (ccp->config.role != CCP_ROLE_MASTER && !ccp->status.rx_timeout_error)
+            dt = ccp_holdover_miss(&ccp->holdover, dw1000_uus_to_dtu(ccp->period));
+        if (dt) {
+            /* Carry the epochs to where the beacon should have been, the slave timer and tdma run on them */
+            ccp->local_epoch = dw1000_dtu_add(ccp->local_epoch, dt);
+            ccp->master_epoch.timestamp += dw1000_uus_to_dtu(ccp->period);
+            ccp->os_epoch += os_cputime_usecs_to_ticks(dw1000_dwt_usecs_to_usecs(dw1000_dtu_to_uus(dt)));
+            ccp->status.holdover = 1;
+            CCP_STATS_INC(rx_holdover);
+        } else {
+            ccp->status.holdover = 0;
+            ccp->status.rx_timeout_error = 1;
+        }
+#else
         ccp->status.rx_timeout_error = 1;
+#endif
         dpl_error_t err = dpl_sem_release(&ccp->sem);
         assert(err == DPL_OK); 
         DIAGMSG("{\"utime\": %lu,\"msg\": \"ccp:rx_timeout_cb\"}\n",os_cputime_ticks_to_usecs(os_cputime_get32()));
@@ -856,9 +921,9 @@ dw1000_ccp_send(struct _dw1000_ccp_instance_t *ccp, dw1000_dev_modes_t mode)
     frame->rpt_max = MYNEWT_VAL(CCP_MAX_CASCADE_RPTS);
 
     uint64_t timestamp = previous_frame->transmission_timestamp.timestamp
-                        + ((uint64_t)ccp->period << 16);
+                        + dw1000_uus_to_dtu(ccp->period);
 
-    timestamp = timestamp & 0xFFFFFFFFFFFFFE00ULL; /* Mask off the last 9 bits */
+    timestamp = dw1000_dtu_dx_align(timestamp); /* Master epoch stays 64 bits wide */
     dw1000_set_delay_start(inst, timestamp);
     timestamp += inst->tx_antenna_delay;
     frame->transmission_timestamp.timestamp = timestamp;
@@ -866,16 +931,15 @@ dw1000_ccp_send(struct _dw1000_ccp_instance_t *ccp, dw1000_dev_modes_t mode)
     frame->seq_num = ++ccp->seq_num;
     frame->euid = inst->euid;
     frame->short_address = inst->my_short_address;
-    frame->transmission_interval = ((uint64_t)ccp->period << 16);
+    frame->transmission_interval = dw1000_uus_to_dtu(ccp->period);
 
-    dw1000_write_tx(inst, frame->array, 0, sizeof(ccp_blink_frame_t));
-    dw1000_write_tx_fctrl(inst, sizeof(ccp_blink_frame_t), 0);
+    dw1000_tx_tmpl_write(inst, &ccp->tx_tmpl, frame->array, sizeof(ccp_blink_frame_t));
     dw1000_set_wait4resp(inst, false);    
     ccp->status.start_tx_error = dw1000_start_tx(inst).start_tx_error;
     if (ccp->status.start_tx_error ){
         CCP_STATS_INC(tx_start_error);
         previous_frame->transmission_timestamp.timestamp = (frame->transmission_timestamp.timestamp 
-                        + ((uint64_t)ccp->period << 16));
+                        + dw1000_uus_to_dtu(ccp->period));
         ccp->idx++;
         err = dpl_sem_release(&ccp->sem);
         assert(err == DPL_OK);
@@ -953,8 +1017,8 @@ dw1000_ccp_start(dw1000_ccp_instance_t *ccp, dw1000_ccp_role_t role)
     ccp->config.role = role;
 
     /* Setup CCP to send/listen for the first packet ASAP */
-    uint64_t ts = (dw1000_read_systime(inst) - (((uint64_t)ccp->period)<<16))&0xFFFFFFFFFFULL;
-    ts += ((uint64_t)ccp->config.tx_holdoff_dly)<<16;
+    uint64_t ts = dw1000_dtu_add(dw1000_read_systime(inst), -(int64_t)dw1000_uus_to_dtu(ccp->period));
+    ts += dw1000_uus_to_dtu(ccp->config.tx_holdoff_dly);
 
     if (ccp->config.role == CCP_ROLE_MASTER){
         ccp->local_epoch = frame->transmission_timestamp.lo = ts;
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file ccp_holdover.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Holdover of the master clock across missed ccp beacons
+ *
+ * @details The master time is kept as a whole part in master_epoch and a fraction in theta so the
+ * filter runs in double without losing the dtu. The process noise is that of a clock with white
+ * frequency noise (q_phase) and a random walk in frequency (q_skew), so the phase uncertainty of a
+ * prediction grows with the interval to the power of 3/2. The timescale filter of wcs is left alone,
+ * it has no covariance to give.
+ */
+
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_time.h>
+#include <ccp/ccp_holdover.h>
+
+#define CCP_HOLDOVER_SKEW_VAR   (4e-10)     //!< Skew variance before the second beacon, 20ppm
+
+/**
+ * API to initialise the holdover, noise from syscfg.
+ *
+ * @param ho  Pointer to ccp_holdover_t.
+ * @return void
+ */
+void
+ccp_holdover_init(ccp_holdover_t * ho)
+{
+    assert(ho);
+    memset(ho, 0, sizeof(ccp_holdover_t));
+    ho->q_phase = MYNEWT_VAL(CCP_HOLDOVER_QPHASE);
+    ho->q_skew = MYNEWT_VAL(CCP_HOLDOVER_QSKEW);
+    ho->r = MYNEWT_VAL(CCP_HOLDOVER_RVAR);
+}
+
+/**
+ * API to forget the clock, on a change of master. Noise and counters are kept.
+ *
+ * @param ho  Pointer to ccp_holdover_t.
+ * @return void
+ */
+void
+ccp_holdover_reset(ccp_holdover_t * ho)
+{
+    ho->status = (ccp_holdover_status_t){0};
+    ho->missed = 0;
+    ho->slew = 0;
+}
+
+/* Carries the state dt of local time forward */
+static void
+ccp_holdover_predict(ccp_holdover_t * ho, int64_t dt)
+{
+    double dts = dt / CCP_HOLDOVER_DTU_PER_SEC;
+    double (* P)[2] = ho->P;
+
+    ho->theta += ho->skew * dt;
+    int64_t whole = llround(ho->theta);
+    ho->theta -= whole;
+    ho->master_epoch = dw1000_dtu_add(ho->master_epoch, dt + whole);
+    ho->local_epoch = dw1000_dtu_add(ho->local_epoch, dt);
+
+    P[0][0] += 2 * dt * P[0][1] + (double)dt * dt * P[1][1]
+             + ho->q_phase * dts + ho->q_skew * (double)dt * dt * dts / 3;
+    P[0][1] += dt * P[1][1] + ho->q_skew * dt * dts / 2;
+    P[1][0] = P[0][1];
+    P[1][1] += ho->q_skew * dts;
+}
+
+/* Part of the step still to be slewed out at local */
+static double
+ccp_holdover_slew_at(ccp_holdover_t * ho, uint64_t local)
+{
+    if (ho->slew == 0)
+        return 0;
+    int64_t d = dw1000_dtu_diff(local, ho->slew_epoch);
+    if (d <= 0)
+        return ho->slew;
+    if (d >= ho->slew_span)
+        return 0;
+    return ho->slew * (1 - d / ho->slew_span);
+}
+
+/**
+ * API to take a received beacon. After an outage within the holdover the master time of
+ * ccp_holdover_local_to_master() carries on from the prediction and converges over
+ * CCP_HOLDOVER_SLEW intervals; after a lost one the phase starts over and the skew is kept.
+ *
+ * @param ho      Pointer to ccp_holdover_t.
+ * @param local   Local reception time of the beacon.
+ * @param master  Master transmission time of the beacon.
+ * @return void
+ */
+void
+ccp_holdover_update(ccp_holdover_t * ho, uint64_t local, uint64_t master)
+{
+    double (* P)[2] = ho->P;
+
+    ho->stats.beacons++;
+    if (!ho->status.initialized || ho->status.lost) {
+        if (!ho->status.initialized) {
+            ho->skew = 0;
+            P[1][1] = CCP_HOLDOVER_SKEW_VAR;
+        }
+        ho->local_epoch = local & DW1000_DTU_MASK;
+        ho->master_epoch = ho->beacon = master & DW1000_DTU_MASK;
+        ho->theta = 0;
+        P[0][0] = ho->r;
+        P[0][1] = P[1][0] = 0;
+        ho->slew = 0;
+        ho->missed = 0;
+        ho->status.initialized = 1;
+        ho->status.lost = ho->status.holdover = 0;
+        return;
+    }
+
+    int64_t dt = dw1000_dtu_diff(local, ho->local_epoch);
+    ccp_holdover_predict(ho, dt);
+    double published = ho->theta + ccp_holdover_slew_at(ho, local);
+    if (ho->slew != 0 && ccp_holdover_slew_at(ho, local) == 0)
+        ho->slew = 0;
+
+    double y = (double)dw1000_dtu_diff(master, ho->master_epoch) - ho->theta;
+    double s = P[0][0] + ho->r;
+    double k0 = P[0][0] / s, k1 = P[0][1] / s;
+    ho->theta += k0 * y;
+    ho->skew += k1 * y;
+    P[1][1] -= k1 * P[0][1];
+    P[0][0] *= 1 - k0;
+    P[0][1] *= 1 - k0;
+    P[1][0] = P[0][1];
+
+    if (ho->missed && MYNEWT_VAL(CCP_HOLDOVER_SLEW) > 0) {
+        ho->slew = published - ho->theta;
+        ho->slew_epoch = ho->local_epoch;
+        ho->slew_span = (double)dt * MYNEWT_VAL(CCP_HOLDOVER_SLEW);
+    }
+    if (ho->missed)
+        ho->stats.reacquired++;
+    ho->beacon = master & DW1000_DTU_MASK;
+    ho->missed = 0;
+    ho->status.holdover = 0;
+    ho->status.valid = 1;
+}
+
+/**
+ * API to carry the clock over a missed beacon, to where it should have been received.
+ *
+ * @param ho        Pointer to ccp_holdover_t.
+ * @param interval  Beacon interval, master dtu.
+ * @return Local time from the last beacon to the predicted one, 0 once the holdover is lost
+ */
+uint64_t
+ccp_holdover_miss(ccp_holdover_t * ho, uint64_t interval)
+{
+    if (!ho->status.valid || ho->status.lost)
+        return 0;
+
+    if (ho->missed++ == 0)
+        ho->stats.holdovers++;
+    uint64_t beacon = dw1000_dtu_add(ho->beacon, interval);
+    double ahead = (double)dw1000_dtu_diff(beacon, ho->master_epoch) - ho->theta;
+    int64_t dt = llround(ahead / (1.0 + ho->skew));
+
+    if (ho->missed > MYNEWT_VAL(CCP_HOLDOVER_MAX_MISSED)
+        || ccp_holdover_guard(ho, dt) >= MYNEWT_VAL(CCP_HOLDOVER_MAX_GUARD)) {
+        ho->status.lost = 1;
+        ho->status.holdover = 0;
+        ho->stats.lost++;
+        return 0;
+    }
+    ccp_holdover_predict(ho, dt);
+    ho->beacon = beacon;
+    ho->status.holdover = 1;
+    ho->stats.missed++;
+    return dt;
+}
+
+/**
+ * API to get the uncertainty of the master time dt after the last beacon.
+ *
+ * @param ho  Pointer to ccp_holdover_t.
+ * @param dt  Local time after the last beacon, received or predicted.
+ * @return Standard deviation, dtu
+ */
+double
+ccp_holdover_sigma(ccp_holdover_t * ho, uint64_t dt)
+{
+    double (* P)[2] = ho->P;
+    double t = (double)dt, ts = t / CCP_HOLDOVER_DTU_PER_SEC;
+    double var = P[0][0] + 2 * t * P[0][1] + t * t * P[1][1]
+               + ho->q_phase * ts + ho->q_skew * t * t * ts / 3;
+
+    return var > 0 ? sqrt(var) : 0;
+}
+
+/**
+ * API to get the guard a receiver opens either side of a time dt after the last beacon,
+ * CCP_HOLDOVER_GUARD_SIGMA standard deviations.
+ *
+ * @param ho  Pointer to ccp_holdover_t.
+ * @param dt  Local time after the last beacon, received or predicted.
+ * @return Guard, uus
+ */
+uint16_t
+ccp_holdover_guard(ccp_holdover_t * ho, uint64_t dt)
+{
+    double guard = ceil(MYNEWT_VAL(CCP_HOLDOVER_GUARD_SIGMA) * ccp_holdover_sigma(ho, dt)
+                        / (1 << DW1000_DTU_UUS_SHIFT));
+
+    return guard < UINT16_MAX ? (uint16_t)guard : UINT16_MAX;
+}
+
+/**
+ * API to get the quality of the time now, the uncertainty of the master time at the last beacon on
+ * a log scale from the timestamp noise to a quarter of CCP_HOLDOVER_MAX_GUARD.
+ *
+ * @param ho  Pointer to ccp_holdover_t.
+ * @return Percent, 100 when locked and 0 without a clock
+ */
+uint8_t
+ccp_holdover_quality(ccp_holdover_t * ho)
+{
+    if (!ho->status.valid || ho->status.lost)
+        return 0;
+
+    double floor = sqrt(ho->r);
+    double ceiling = (double)MYNEWT_VAL(CCP_HOLDOVER_MAX_GUARD) * (1 << DW1000_DTU_UUS_SHIFT)
+                   / MYNEWT_VAL(CCP_HOLDOVER_GUARD_SIGMA);
+    double sigma = ccp_holdover_sigma(ho, 0);
+    if (sigma <= floor)
+        return 100;
+    if (sigma >= ceiling)
+        return 0;
+    return (uint8_t)lround(100 * (1 - log(sigma / floor) / log(ceiling / floor)));
+}
+
+/**
+ * API to convert a local time to master time, continuous across outages within the holdover.
+ *
+ * @param ho     Pointer to ccp_holdover_t.
+ * @param local  Local time.
+ * @return Master time
+ */
+uint64_t
+ccp_holdover_local_to_master(ccp_holdover_t * ho, uint64_t local)
+{
+    int64_t d = dw1000_dtu_diff(local, ho->local_epoch);
+    double m = ho->theta + ho->skew * d + ccp_holdover_slew_at(ho, local);
+
+    return dw1000_dtu_add(ho->master_epoch, d + llround(m));
+}
+
+/**
+ * API to convert a master time to the local time ccp_holdover_local_to_master() takes to it.
+ *
+ * @param ho      Pointer to ccp_holdover_t.
+ * @param master  Master time.
+ * @return Local time
+ */
+uint64_t
+ccp_holdover_master_to_local(ccp_holdover_t * ho, uint64_t master)
+{
+    double m = (double)dw1000_dtu_diff(master, ho->master_epoch) - ho->theta;
+    uint64_t local = dw1000_dtu_add(ho->local_epoch, llround(m / (1.0 + ho->skew)));
+
+    /* The slew moves by far less than a dtu per dtu, two corrections take it to the dtu */
+    for (int i = 0; i < 2; i++) {
+        int64_t e = dw1000_dtu_diff(ccp_holdover_local_to_master(ho, local), master);
+        local = dw1000_dtu_add(local, -llround(e / (1.0 + ho->skew)));
+    }
+    return local;
+}
@@ -72,6 +72,8 @@ typedef struct _cir_instance_t{
     float angle;
     uint64_t raw_ts;
     uint8_t resampler_delay;
+    uint8_t rcphase_reg;                    //!< RX_TTCKO octet 4, read with the accumulator
+    dw1000_async_req_t req;                 //!< Accumulator read
     cir_t cir;
 }cir_instance_t; 
 
@@ -0,0 +1,133 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_aoa.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Angle of arrival from the phase differences between 2 or 3 receivers
+ *
+ * @details The receivers share a clock and antenna 0 is the phase reference. The antennas lie in the
+ * plane of the board, at positions relative to antenna 0, and the board faces +z. A frame gives one
+ * phase difference per antenna besides antenna 0, corrected by the calibration offset of the channel;
+ * these are the projections of the direction of arrival on the antenna positions, from which the
+ * direction cosines ux, uy are solved: ux alone with 2 antennas, antenna 1 being on the x axis, both
+ * with 3. Azimuth is the angle off boresight in the x-z plane and elevation towards y.
+ *
+ * Each peer has a track, an alpha-beta filter on the direction cosines. With an antenna further than
+ * half a wavelength from antenna 0 the phase difference is ambiguous; the turn closest to the one the
+ * track predicts is taken. Frames off the prediction by more than the gate are outliers, the track
+ * restarts after CIR_AOA_OUTLIERS of them in a row.
+ */
+
+#ifndef _CIR_AOA_H_
+#define _CIR_AOA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <os/os.h>
+#include <dw1000/dw1000_dev.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CIR_AOA_MAX_ANT     (3)     //!< Receivers of an array
+#define CIR_AOA_NCHAN       (8)     //!< Calibration entries, indexed by channel number
+#define CIR_AOA_OUTLIERS    (3)     //!< Outliers in a row restarting a track
+
+//! Track of a peer.
+typedef struct _cir_aoa_track_t{
+    uint16_t peer;                  //!< Peer address
+    uint8_t valid:1;                //!< Track started
+    uint8_t outliers;               //!< Outliers in a row
+    uint32_t utime;                 //!< Last update, usec
+    float u[2];                     //!< Direction cosines ux, uy
+    float du[2];                    //!< Their rate of change, per second
+    uint32_t updates;               //!< Frames taken
+}cir_aoa_track_t;
+
+//! Angle of arrival of a frame.
+typedef struct _cir_aoa_result_t{
+    uint16_t peer;                          //!< Peer address
+    uint8_t valid:1;                        //!< The receivers had the CIR of the frame
+    uint8_t outlier:1;                      //!< Off the track, not taken
+    uint8_t unwrapped:1;                    //!< A phase difference was moved by a turn after the track
+    float pdoa[CIR_AOA_MAX_ANT - 1];        //!< Calibrated phase differences to antenna 0, rad
+    float azimuth;                          //!< Of this frame, rad
+    float elevation;                        //!< Of this frame, rad, 0 with 2 antennas
+    float azimuth_track;                    //!< Of the track, rad
+    float elevation_track;                  //!< Of the track, rad
+}cir_aoa_result_t;
+
+//! Statistics.
+typedef struct _cir_aoa_stats_t{
+    uint32_t frames;                //!< Frames processed
+    uint32_t invalid;               //!< Frames a receiver had no CIR for
+    uint32_t unwrapped;             //!< Frames unwrapped after the track
+    uint32_t outliers;              //!< Frames off their track
+    uint32_t restarts;              //!< Tracks restarted
+    uint32_t evictions;             //!< Tracks given to another peer
+}cir_aoa_stats_t;
+
+//! Angle of arrival engine.
+typedef struct _cir_aoa_t{
+    uint8_t nant;                                       //!< Antennas, 2 or 3
+    uint8_t selfmalloc:1;                               //!< Allocated by cir_aoa_init
+    struct _dw1000_dev_instance_t * inst[CIR_AOA_MAX_ANT];  //!< Receiver of each antenna
+    float pos[CIR_AOA_MAX_ANT][2];                      //!< Antenna positions in m, x and y relative to antenna 0
+    float cal[CIR_AOA_NCHAN][CIR_AOA_MAX_ANT - 1];      //!< Phase offset of each antenna to antenna 0 per channel, rad
+    float alpha;                                        //!< Track gain on the direction
+    float beta;                                         //!< Track gain on its rate of change
+    float gate;                                         //!< Largest distance to the prediction, in direction cosines
+    struct {
+        uint8_t active:1;                               //!< Accumulating
+        uint8_t channel;                                //!< Channel calibrated
+        float u[2];                                     //!< Direction of the calibration source
+        float c[CIR_AOA_MAX_ANT - 1];                   //!< Sum of the cosines of the residuals
+        float s[CIR_AOA_MAX_ANT - 1];                   //!< Sum of their sines
+        uint16_t n;                                     //!< Frames accumulated
+    } calib;                                            //!< Calibration in progress
+    cir_aoa_stats_t stats;                              //!< Statistics
+    cir_aoa_track_t tracks[MYNEWT_VAL(CIR_AOA_NPEERS)]; //!< Tracks
+}cir_aoa_t;
+
+cir_aoa_t * cir_aoa_init(cir_aoa_t * aoa, uint8_t nant, struct _dw1000_dev_instance_t ** inst);
+void cir_aoa_free(cir_aoa_t * aoa);
+float cir_aoa_wavelength(uint8_t channel);
+void cir_aoa_set_position(cir_aoa_t * aoa, uint8_t ant, float x, float y);
+void cir_aoa_set_cal(cir_aoa_t * aoa, uint8_t channel, uint8_t ant, float offset);
+bool cir_aoa_update(cir_aoa_t * aoa, uint8_t channel, uint16_t peer, uint32_t utime, const float * phase, cir_aoa_result_t * res);
+bool cir_aoa_process(cir_aoa_t * aoa, uint16_t peer, cir_aoa_result_t * res);
+void cir_aoa_cal_start(cir_aoa_t * aoa, uint8_t channel, float azimuth, float elevation);
+uint16_t cir_aoa_cal_finish(cir_aoa_t * aoa);
+cir_aoa_track_t * cir_aoa_track(cir_aoa_t * aoa, uint16_t peer);
+void cir_aoa_dump(cir_aoa_t * aoa, int (* print)(const char *, ...));
+#if MYNEWT_VAL(CIR_AOA_CONF)
+int cir_aoa_conf_init(cir_aoa_t * aoa);
+void cir_aoa_conf_save(cir_aoa_t * aoa);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CIR_AOA_H_ */
@@ -0,0 +1,128 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_stream.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Streaming CIR capture
+ *
+ * @details Captures a window of CIR_STREAM_LEN accumulator samples around the first path of every
+ * received frame, CIR_STREAM_PRE of them ahead of it, and queues it as a binary record on a ring of
+ * CIR_STREAM_RING_SLOTS records drained to a sink. The window is read in chunks of CIR_STREAM_CHUNK
+ * samples on two alternating asynchronous requests, each chunk being packed while the next one is on
+ * the bus. A record is a cir_stream_hdr_t followed by the chunks; with CIR_STREAM_BFP a chunk is a
+ * shift followed by the samples as int8_t real, imag pairs, the sample being the pair shifted left by
+ * it (block floating point), otherwise the samples are the int16_t real, imag pairs of the accumulator.
+ * All fields are little endian. A frame arriving while the ring is full is dropped before its
+ * accumulator is read.
+ */
+
+#ifndef _CIR_STREAM_H_
+#define _CIR_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <os/os.h>
+#include <dw1000/dw1000_dev.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CIR_STREAM_SYNC         (0x5243)    //!< "CR", first two octets of a record
+#define CIR_STREAM_VERSION      (1)         //!< Record format, low nibble of cir_stream_hdr_t.flags
+#define CIR_STREAM_FLAG_BFP     (0x80)      //!< Samples in block floating point
+#define CIR_STREAM_ACC_LEN      (1016)      //!< Accumulator samples at 64MHz PRF
+
+//! Chunks in a window
+#define CIR_STREAM_NCHUNKS ((MYNEWT_VAL(CIR_STREAM_LEN) + MYNEWT_VAL(CIR_STREAM_CHUNK) - 1) / MYNEWT_VAL(CIR_STREAM_CHUNK))
+#if MYNEWT_VAL(CIR_STREAM_BFP)
+#define CIR_STREAM_SAMPLES_LEN (CIR_STREAM_NCHUNKS + 2 * MYNEWT_VAL(CIR_STREAM_LEN))
+#else
+#define CIR_STREAM_SAMPLES_LEN (4 * MYNEWT_VAL(CIR_STREAM_LEN))
+#endif
+//! Longest record
+#define CIR_STREAM_RECORD_MAX (sizeof(cir_stream_hdr_t) + CIR_STREAM_SAMPLES_LEN)
+
+//! Record header.
+typedef struct _cir_stream_hdr_t{
+    uint16_t sync;                  //!< CIR_STREAM_SYNC
+    uint8_t flags;                  //!< CIR_STREAM_VERSION and CIR_STREAM_FLAG_BFP
+    uint8_t idx;                    //!< Instance the frame was received on
+    uint16_t len;                   //!< Record length, header included
+    uint16_t seq;                   //!< Record sequence number, a gap counts the records lost
+    uint32_t utime;                 //!< Capture time in usec
+    uint16_t fp_idx;                //!< First path index, 10.6 fixed point
+    uint16_t start;                 //!< Accumulator index of the first sample
+    uint16_t nsamples;              //!< Samples in the record
+    uint16_t chunk;                 //!< Samples in a chunk, the last one may be shorter
+} __attribute__((packed, aligned(1))) cir_stream_hdr_t;
+
+//! Consumer of the records, returns len once the record is out.
+typedef int (* cir_stream_sink_t)(void * arg, const uint8_t * buf, uint16_t len);
+
+//! Capture statistics.
+typedef struct _cir_stream_stats_t{
+    uint32_t captures;              //!< Records queued
+    uint32_t delivered;             //!< Records taken by the sink
+    uint32_t bytes;                 //!< Octets taken by the sink
+    uint32_t drops;                 //!< Frames not captured, the ring was full
+    uint32_t clipped;               //!< Frames not captured, the window left the accumulator
+    uint32_t sink_errors;           //!< Records the sink failed to take
+    uint32_t read_usec;             //!< Last capture, from the callback to the record queued
+    uint32_t read_usec_max;         //!< Longest capture
+    uint32_t start;                 //!< os_cputime of the first capture
+}cir_stream_stats_t;
+
+//! Streaming capture instance.
+typedef struct _cir_stream_t{
+    struct _dw1000_dev_instance_t * dev_inst;   //!< Instance captured
+    dw1000_mac_interface_t cbs;                 //!< cir_complete_cb
+    cir_stream_sink_t sink;                     //!< Record consumer
+    void * sink_arg;                            //!< Passed to the sink
+    struct dpl_eventq * evq;                    //!< Queue the drain event is posted to, records are left for cir_stream_flush() when NULL
+    struct dpl_event drain_ev;                  //!< Drains the ring to the sink
+    uint8_t enabled:1;                          //!< Capturing
+    uint8_t selfmalloc:1;                       //!< Allocated by cir_stream_init
+    uint16_t seq;                               //!< Sequence number of the next record
+    volatile uint32_t head;                     //!< Records queued
+    volatile uint32_t tail;                     //!< Records drained
+    cir_stream_stats_t stats;                   //!< Statistics
+    dw1000_async_req_t req[2];                  //!< Chunk reads, alternating
+    uint8_t chunk[2][1 + 4 * MYNEWT_VAL(CIR_STREAM_CHUNK)];     //!< Chunks read, dummy octet first
+    uint8_t ring[MYNEWT_VAL(CIR_STREAM_RING_SLOTS)][CIR_STREAM_RECORD_MAX]; //!< Records
+}cir_stream_t;
+
+cir_stream_t * cir_stream_init(struct _dw1000_dev_instance_t * inst, cir_stream_t * stream, cir_stream_sink_t sink, void * arg, struct dpl_eventq * evq);
+void cir_stream_free(cir_stream_t * stream);
+void cir_stream_enable(cir_stream_t * stream, bool enable);
+bool cir_stream_capture(cir_stream_t * stream);
+uint32_t cir_stream_flush(cir_stream_t * stream);
+uint32_t cir_stream_rate(cir_stream_t * stream);
+int cir_stream_fd_sink(void * arg, const uint8_t * buf, uint16_t len);
+void cir_stream_dump(cir_stream_t * stream, int (* print)(const char *, ...));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CIR_STREAM_H_ */
@@ -111,7 +111,10 @@ cir_reread_from_cir(dw1000_dev_instance_t * inst, cir_instance_t *master_cir)
     /* Override our local LDE result with the other LDE's result */
     cir->status.lde_override = 1;
 
-    dw1000_read_accdata(inst, (uint8_t *)&cir->cir, (fp_idx_override - MYNEWT_VAL(CIR_OFFSET)) * sizeof(cir_complex_t), sizeof(cir_t));
+    dw1000_async_init(&cir->req, NULL, NULL);
+    dw1000_read_accdata_async(inst, &cir->req, (uint8_t *)&cir->cir, (fp_idx_override - MYNEWT_VAL(CIR_OFFSET)) * sizeof(cir_complex_t), sizeof(cir_t));
+    dw1000_async_submit(inst, &cir->req);
+    dw1000_async_wait(inst, &cir->req, DPL_TIMEOUT_NEVER);
 
     /* No need to re-read rc-phase, it hasn't changed */
     cir->angle = atan2f((float)cir->cir.array[MYNEWT_VAL(CIR_OFFSET)].imag, (float)cir->cir.array[MYNEWT_VAL(CIR_OFFSET)].real);
@@ -192,9 +195,15 @@ cir_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
         /* Can't extract CIR from required offset, abort */
         return true;
     }
-    dw1000_read_accdata(inst, (uint8_t *)&cir->cir, (fp_idx - MYNEWT_VAL(CIR_OFFSET)) * sizeof(cir_complex_t), sizeof(cir_t));
-
-    float _rcphase = (float)((uint8_t)dw1000_read_reg(inst, RX_TTCKO_ID, 4, sizeof(uint8_t)) & 0x7F);
+    /* Accumulator and rcphase in one request, the first path power is worked out while it is on the bus */
+    dw1000_async_init(&cir->req, NULL, NULL);
+    dw1000_read_accdata_async(inst, &cir->req, (uint8_t *)&cir->cir, (fp_idx - MYNEWT_VAL(CIR_OFFSET)) * sizeof(cir_complex_t), sizeof(cir_t));
+    dw1000_xfer_list_read(&cir->req.list, RX_TTCKO_ID, 4, &cir->rcphase_reg, sizeof(uint8_t));
+    dw1000_async_submit(inst, &cir->req);
+    cir->fp_power = dw1000_get_fppl(inst);
+    dw1000_async_wait(inst, &cir->req, DPL_TIMEOUT_NEVER);
+
+    float _rcphase = (float)(cir->rcphase_reg & 0x7F);
     cir->rcphase = _rcphase * (M_PI/64.0f);
     cir->angle = atan2f((float)cir->cir.array[MYNEWT_VAL(CIR_OFFSET)].imag, (float)cir->cir.array[MYNEWT_VAL(CIR_OFFSET)].real);
     cir->status.valid = 1;
@@ -0,0 +1,410 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_aoa.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Angle of arrival from the phase differences between 2 or 3 receivers
+ *
+ * @details The phase of a receiver is that of the first path less the receiver clock phase, as in
+ * cir_get_pdoa(). A calibration points the array at a source in a known direction and takes the
+ * circular mean of the differences between the phase differences measured and those expected.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_dev.h>
+#include <cir/cir.h>
+#include <cir/cir_aoa.h>
+
+#define CIR_AOA_C_AIR       (299702547.0f)  //!< Speed of light in air, m/s
+#define CIR_AOA_STALE_USEC  (2000000)       //!< A track not updated for this long restarts
+
+//! Centre frequency by channel number, Hz
+static const float g_aoa_fc[CIR_AOA_NCHAN] = {
+    [1] = 3494.4e6f, [2] = 3993.6e6f, [3] = 4492.8e6f, [4] = 3993.6e6f, [5] = 6489.6e6f, [7] = 6489.6e6f,
+};
+
+static float
+cir_aoa_wrap(float a)
+{
+    a = fmodf(a, 2 * M_PI);
+    if (a > M_PI)
+        a -= 2 * M_PI;
+    else if (a < -M_PI)
+        a += 2 * M_PI;
+    return a;
+}
+
+static float
+cir_aoa_clamp(float v)
+{
+    return v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : v);
+}
+
+/* Azimuth and elevation of the direction cosines u */
+static void
+cir_aoa_angles(const float u[2], float * azimuth, float * elevation)
+{
+    *elevation = asinf(cir_aoa_clamp(u[1]));
+    float c = cosf(*elevation);
+    *azimuth = (c > 1e-6f) ? asinf(cir_aoa_clamp(u[0] / c)) : 0;
+}
+
+/* Phase difference of antenna ant to antenna 0 for direction u */
+static float
+cir_aoa_expected(cir_aoa_t * aoa, uint8_t ant, const float u[2], float k)
+{
+    return k * (aoa->pos[ant][0] * u[0] + aoa->pos[ant][1] * u[1]);
+}
+
+/* Direction cosines from the phase differences */
+static void
+cir_aoa_solve(cir_aoa_t * aoa, const float * pdoa, float k, float u[2])
+{
+    if (aoa->nant == 2) {
+        u[0] = pdoa[0] / (k * aoa->pos[1][0]);
+        u[1] = 0;
+    } else {
+        float x1 = aoa->pos[1][0], y1 = aoa->pos[1][1], x2 = aoa->pos[2][0], y2 = aoa->pos[2][1];
+        float b1 = pdoa[0] / k, b2 = pdoa[1] / k, det = x1 * y2 - x2 * y1;
+        u[0] = (b1 * y2 - b2 * y1) / det;
+        u[1] = (x1 * b2 - x2 * b1) / det;
+    }
+    float n = sqrtf(u[0] * u[0] + u[1] * u[1]);
+    if (n > 1.0f) {
+        u[0] /= n;
+        u[1] /= n;
+    }
+}
+
+/**
+ * API to look up the track of a peer.
+ *
+ * @param aoa   Pointer to cir_aoa_t.
+ * @param peer  Peer address.
+ * @return cir_aoa_track_t *, NULL if the peer has none
+ */
+cir_aoa_track_t *
+cir_aoa_track(cir_aoa_t * aoa, uint16_t peer)
+{
+    for (uint16_t i = 0; i < MYNEWT_VAL(CIR_AOA_NPEERS); i++)
+        if (aoa->tracks[i].updates && aoa->tracks[i].peer == peer)
+            return &aoa->tracks[i];
+    return NULL;
+}
+
+/* Track of a peer, a free one or the least recently updated one when it has none */
+static cir_aoa_track_t *
+cir_aoa_track_alloc(cir_aoa_t * aoa, uint16_t peer)
+{
+    cir_aoa_track_t * track = cir_aoa_track(aoa, peer), * oldest = &aoa->tracks[0];
+
+    if (track)
+        return track;
+    for (uint16_t i = 0; i < MYNEWT_VAL(CIR_AOA_NPEERS); i++) {
+        if (aoa->tracks[i].updates == 0) {
+            oldest = &aoa->tracks[i];
+            break;
+        }
+        if ((int32_t)(aoa->tracks[i].utime - oldest->utime) < 0)
+            oldest = &aoa->tracks[i];
+    }
+    if (oldest->updates)
+        aoa->stats.evictions++;
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->peer = peer;
+    return oldest;
+}
+
+/**
+ * API to work out the wavelength of a channel.
+ *
+ * @param channel  Channel number.
+ * @return Wavelength in air, m
+ */
+float
+cir_aoa_wavelength(uint8_t channel)
+{
+    float fc = (channel < CIR_AOA_NCHAN && g_aoa_fc[channel] > 0) ? g_aoa_fc[channel] : g_aoa_fc[5];
+    return CIR_AOA_C_AIR / fc;
+}
+
+/**
+ * API to take the phases of a frame, one per antenna, into the track of the peer.
+ *
+ * @param aoa      Pointer to cir_aoa_t.
+ * @param channel  Channel the frame was received on.
+ * @param peer     Peer address.
+ * @param utime    Reception time, usec.
+ * @param phase    Phase at each antenna, rad.
+ * @param res      Angle of arrival of the frame.
+ * @return true if the frame was taken into the track
+ */
+bool
+cir_aoa_update(cir_aoa_t * aoa, uint8_t channel, uint16_t peer, uint32_t utime, const float * phase, cir_aoa_result_t * res)
+{
+    uint8_t ch = channel < CIR_AOA_NCHAN ? channel : 0;
+    float k = 2 * M_PI / cir_aoa_wavelength(channel);
+    float raw[CIR_AOA_MAX_ANT - 1], u[2], pred[2] = {0, 0};
+
+    memset(res, 0, sizeof(*res));
+    res->peer = peer;
+    res->valid = 1;
+    aoa->stats.frames++;
+
+    for (uint8_t i = 0; i < aoa->nant - 1; i++) {
+        raw[i] = cir_aoa_wrap(phase[i + 1] - phase[0]);
+        res->pdoa[i] = cir_aoa_wrap(raw[i] - aoa->cal[ch][i]);
+    }
+
+    if (aoa->calib.active && aoa->calib.channel == channel) {
+        for (uint8_t i = 0; i < aoa->nant - 1; i++) {
+            float r = raw[i] - cir_aoa_expected(aoa, i + 1, aoa->calib.u, k);
+            aoa->calib.c[i] += cosf(r);
+            aoa->calib.s[i] += sinf(r);
+        }
+        aoa->calib.n++;
+    }
+
+    cir_aoa_track_t * track = cir_aoa_track_alloc(aoa, peer);
+    float dt = (utime - track->utime) * 1e-6f;
+    bool tracked = track->valid && (utime - track->utime) < CIR_AOA_STALE_USEC;
+
+    /* Take the turn of each phase difference closest to the one the track predicts */
+    if (tracked) {
+        for (uint8_t j = 0; j < 2; j++)
+            pred[j] = track->u[j] + track->du[j] * dt;
+        for (uint8_t i = 0; i < aoa->nant - 1; i++) {
+            float turns = roundf((cir_aoa_expected(aoa, i + 1, pred, k) - res->pdoa[i]) / (2 * M_PI));
+            if (turns != 0) {
+                res->pdoa[i] += 2 * M_PI * turns;
+                res->unwrapped = 1;
+            }
+        }
+        aoa->stats.unwrapped += res->unwrapped;
+    }
+    cir_aoa_solve(aoa, res->pdoa, k, u);
+    cir_aoa_angles(u, &res->azimuth, &res->elevation);
+
+    if (!tracked) {
+        memcpy(track->u, u, sizeof(track->u));
+        memset(track->du, 0, sizeof(track->du));
+        track->valid = 1;
+        track->outliers = 0;
+    } else {
+        float r[2] = {u[0] - pred[0], u[1] - pred[1]};
+        if (sqrtf(r[0] * r[0] + r[1] * r[1]) > aoa->gate) {
+            res->outlier = 1;
+            aoa->stats.outliers++;
+            if (++track->outliers >= CIR_AOA_OUTLIERS) {
+                memcpy(track->u, u, sizeof(track->u));
+                memset(track->du, 0, sizeof(track->du));
+                track->outliers = 0;
+                aoa->stats.restarts++;
+            } else {
+                memcpy(track->u, pred, sizeof(track->u));
+            }
+        } else {
+            for (uint8_t j = 0; j < 2; j++) {
+                track->u[j] = pred[j] + aoa->alpha * r[j];
+                if (dt > 0)
+                    track->du[j] += aoa->beta * r[j] / dt;
+            }
+            track->outliers = 0;
+        }
+    }
+    track->utime = utime;
+    track->updates++;
+    cir_aoa_angles(track->u, &res->azimuth_track, &res->elevation_track);
+    return !res->outlier;
+}
+
+/**
+ * API to take the frame just received by the receivers of the array, from their CIR instances, into
+ * the track of the peer. Called once every receiver has been through its cir_complete_cb.
+ *
+ * @param aoa   Pointer to cir_aoa_t.
+ * @param peer  Peer address, e.g. the source address of the frame.
+ * @param res   Angle of arrival of the frame.
+ * @return true if the frame was taken into the track
+ */
+bool
+cir_aoa_process(cir_aoa_t * aoa, uint16_t peer, cir_aoa_result_t * res)
+{
+    float phase[CIR_AOA_MAX_ANT];
+
+    for (uint8_t i = 0; i < aoa->nant; i++) {
+        cir_instance_t * cir = aoa->inst[i]->cir;
+        if (cir == NULL || !cir->status.valid) {
+            memset(res, 0, sizeof(*res));
+            res->peer = peer;
+            aoa->stats.invalid++;
+            return false;
+        }
+        phase[i] = cir->angle - cir->rcphase;
+    }
+    return cir_aoa_update(aoa, aoa->inst[0]->config.channel, peer,
+                          os_cputime_ticks_to_usecs(os_cputime_get32()), phase, res);
+}
+
+/**
+ * API to set the position of an antenna.
+ *
+ * @param aoa  Pointer to cir_aoa_t.
+ * @param ant  Antenna, 1 or 2.
+ * @param x    Position relative to antenna 0, m.
+ * @param y    Position relative to antenna 0, m; 0 for antenna 1 of a 2 antenna array.
+ * @return void
+ */
+void
+cir_aoa_set_position(cir_aoa_t * aoa, uint8_t ant, float x, float y)
+{
+    assert(ant > 0 && ant < aoa->nant);
+    aoa->pos[ant][0] = x;
+    aoa->pos[ant][1] = y;
+}
+
+/**
+ * API to set the phase offset of an antenna on a channel, as found by a calibration.
+ *
+ * @param aoa      Pointer to cir_aoa_t.
+ * @param channel  Channel number.
+ * @param ant      Antenna, 1 or 2.
+ * @param offset   Phase of the antenna less that of antenna 0 for a source at boresight, rad.
+ * @return void
+ */
+void
+cir_aoa_set_cal(cir_aoa_t * aoa, uint8_t channel, uint8_t ant, float offset)
+{
+    assert(channel < CIR_AOA_NCHAN && ant > 0 && ant < aoa->nant);
+    aoa->cal[channel][ant - 1] = cir_aoa_wrap(offset);
+}
+
+/**
+ * API to start a calibration: the frames received on the channel until cir_aoa_cal_finish() come
+ * from a source in the direction given.
+ *
+ * @param aoa        Pointer to cir_aoa_t.
+ * @param channel    Channel number.
+ * @param azimuth    Of the source, rad.
+ * @param elevation  Of the source, rad.
+ * @return void
+ */
+void
+cir_aoa_cal_start(cir_aoa_t * aoa, uint8_t channel, float azimuth, float elevation)
+{
+    memset(&aoa->calib, 0, sizeof(aoa->calib));
+    aoa->calib.channel = channel;
+    aoa->calib.u[0] = sinf(azimuth) * cosf(elevation);
+    aoa->calib.u[1] = sinf(elevation);
+    aoa->calib.active = 1;
+}
+
+/**
+ * API to end a calibration, the offsets of the channel become the mean differences between the phase
+ * differences measured and those expected.
+ *
+ * @param aoa  Pointer to cir_aoa_t.
+ * @return Frames the offsets were worked out from, they are left as they were if none
+ */
+uint16_t
+cir_aoa_cal_finish(cir_aoa_t * aoa)
+{
+    aoa->calib.active = 0;
+    if (aoa->calib.n == 0)
+        return 0;
+    for (uint8_t i = 0; i < aoa->nant - 1; i++)
+        cir_aoa_set_cal(aoa, aoa->calib.channel, i + 1, atan2f(aoa->calib.s[i], aoa->calib.c[i]));
+    return aoa->calib.n;
+}
+
+/**
+ * API to print the statistics and calibration as json.
+ *
+ * @param aoa    Pointer to cir_aoa_t.
+ * @param print  printf like output function, console_printf on target.
+ * @return void
+ */
+void
+cir_aoa_dump(cir_aoa_t * aoa, int (* print)(const char *, ...))
+{
+    cir_aoa_stats_t * stats = &aoa->stats;
+
+    assert(aoa && print);
+    print("{\"nant\":%u,\"frames\":%lu,\"invalid\":%lu,\"unwrapped\":%lu,\"outliers\":%lu,\"restarts\":%lu,\"evictions\":%lu,\"cal_mrad\":[",
+          aoa->nant, (unsigned long)stats->frames, (unsigned long)stats->invalid, (unsigned long)stats->unwrapped,
+          (unsigned long)stats->outliers, (unsigned long)stats->restarts, (unsigned long)stats->evictions);
+    for (uint8_t ch = 1; ch < CIR_AOA_NCHAN; ch++)
+        print("%s[%d,%d]", ch > 1 ? "," : "", (int)(aoa->cal[ch][0] * 1000), (int)(aoa->cal[ch][1] * 1000));
+    print("]}\n");
+}
+
+/**
+ * API to set up an angle of arrival engine, the antennas CIR_AOA_SEPARATION_MM from antenna 0 along
+ * x and, for the third, along y; uncalibrated.
+ *
+ * @param aoa   Pointer to cir_aoa_t, allocated when NULL.
+ * @param nant  Antennas, 2 or 3.
+ * @param inst  Receiver of each antenna, those of cir_aoa_process(); may be NULL with cir_aoa_update().
+ * @return cir_aoa_t *
+ */
+cir_aoa_t *
+cir_aoa_init(cir_aoa_t * aoa, uint8_t nant, struct _dw1000_dev_instance_t ** inst)
+{
+    assert(nant >= 2 && nant <= CIR_AOA_MAX_ANT);
+    if (aoa == NULL) {
+        aoa = (cir_aoa_t *) malloc(sizeof(cir_aoa_t));
+        assert(aoa);
+        memset(aoa, 0, sizeof(cir_aoa_t));
+        aoa->selfmalloc = 1;
+    }
+    aoa->nant = nant;
+    for (uint8_t i = 0; inst && i < nant; i++)
+        aoa->inst[i] = inst[i];
+    aoa->pos[1][0] = MYNEWT_VAL(CIR_AOA_SEPARATION_MM) * 1e-3f;
+    if (nant == 3)
+        aoa->pos[2][1] = MYNEWT_VAL(CIR_AOA_SEPARATION_MM) * 1e-3f;
+    aoa->alpha = MYNEWT_VAL(CIR_AOA_ALPHA_PCT) / 100.0f;
+    aoa->beta = MYNEWT_VAL(CIR_AOA_BETA_PCT) / 100.0f;
+    aoa->gate = MYNEWT_VAL(CIR_AOA_GATE_PCT) / 100.0f;
+    return aoa;
+}
+
+/**
+ * API to free an angle of arrival engine.
+ *
+ * @param aoa  Pointer to cir_aoa_t.
+ * @return void
+ */
+void
+cir_aoa_free(cir_aoa_t * aoa)
+{
+    assert(aoa);
+    if (aoa->selfmalloc)
+        free(aoa);
+}
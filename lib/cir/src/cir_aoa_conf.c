@@ -0,0 +1,174 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_aoa_conf.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Angle of arrival array geometry and calibration in config
+ *
+ * @details Values are "a,b" strings under "aoa": pos1 and pos2 the x,y position of antennas 1 and 2
+ * in um, cal1 to cal7 the offsets of antennas 1 and 2 on that channel in mrad. The board calibration
+ * is saved once with conf_save() after cir_aoa_cal_finish() and cir_aoa_conf_save().
+ */
+
+#include <os/os.h>
+
+#if MYNEWT_VAL(CIR_AOA_CONF)
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <config/config.h>
+
+#include <cir/cir_aoa.h>
+
+#define AOA_CONF_STRLEN (24)
+
+static char *aoa_conf_get(int argc, char **argv, char *val, int val_len_max);
+static int aoa_conf_set(int argc, char **argv, char *val);
+static int aoa_conf_commit(void);
+static int aoa_conf_export(void (*export_func)(char *name, char *val), enum conf_export_tgt tgt);
+
+static const char * _aoa_conf_str[] = {
+    "pos1", "pos2", "cal1", "cal2", "cal3", "cal4", "cal5", "cal6", "cal7"
+};
+#define AOA_CONF_MAX (sizeof(_aoa_conf_str) / sizeof(_aoa_conf_str[0]))
+
+static char aoa_config[AOA_CONF_MAX][AOA_CONF_STRLEN];
+static cir_aoa_t * g_aoa;
+
+static struct conf_handler aoa_conf_handler = {
+    .ch_name = "aoa",
+    .ch_get = aoa_conf_get,
+    .ch_set = aoa_conf_set,
+    .ch_commit = aoa_conf_commit,
+    .ch_export = aoa_conf_export,
+};
+
+static char *
+aoa_conf_get(int argc, char **argv, char *val, int val_len_max)
+{
+    if (argc == 1) {
+        for (int i = 0; i < AOA_CONF_MAX; i++)
+            if (!strcmp(argv[0], _aoa_conf_str[i])) return aoa_config[i];
+    }
+    return NULL;
+}
+
+static int
+aoa_conf_set(int argc, char **argv, char *val)
+{
+    if (argc == 1) {
+        for (int i = 0; i < AOA_CONF_MAX; i++)
+            if (!strcmp(argv[0], _aoa_conf_str[i]))
+                return CONF_VALUE_SET(val, CONF_STRING, aoa_config[i]);
+    }
+    return OS_ENOENT;
+}
+
+/* Parses "a,b", false if the value is unset or malformed */
+static bool
+aoa_conf_pair(const char * str, float * a, float * b)
+{
+    char * end;
+
+    if (str[0] == '\0')
+        return false;
+    *a = strtof(str, &end);
+    if (*end != ',')
+        return false;
+    *b = strtof(end + 1, &end);
+    return *end == '\0';
+}
+
+static int
+aoa_conf_commit(void)
+{
+    float a, b;
+
+    if (g_aoa == NULL)
+        return 0;
+    for (uint8_t ant = 1; ant < g_aoa->nant; ant++)
+        if (aoa_conf_pair(aoa_config[ant - 1], &a, &b))
+            cir_aoa_set_position(g_aoa, ant, a * 1e-6f, b * 1e-6f);
+    for (uint8_t ch = 1; ch < CIR_AOA_NCHAN; ch++) {
+        if (!aoa_conf_pair(aoa_config[ch + 1], &a, &b))
+            continue;
+        cir_aoa_set_cal(g_aoa, ch, 1, a * 1e-3f);
+        if (g_aoa->nant == 3)
+            cir_aoa_set_cal(g_aoa, ch, 2, b * 1e-3f);
+    }
+    return 0;
+}
+
+static int
+aoa_conf_export(void (*export_func)(char *name, char *val), enum conf_export_tgt tgt)
+{
+    char b[32];
+    for (int i = 0; i < AOA_CONF_MAX; i++) {
+        if (aoa_config[i][0] == '\0')
+            continue;
+        snprintf(b, sizeof(b), "%s/%s", aoa_conf_handler.ch_name, _aoa_conf_str[i]);
+        export_func(b, aoa_config[i]);
+    }
+    return 0;
+}
+
+/**
+ * API to copy the positions and calibration offsets of the engine to the config values, written out
+ * by the next conf_save().
+ *
+ * @param aoa  Pointer to cir_aoa_t.
+ * @return void
+ */
+void
+cir_aoa_conf_save(cir_aoa_t * aoa)
+{
+    for (uint8_t ant = 1; ant < CIR_AOA_MAX_ANT; ant++)
+        snprintf(aoa_config[ant - 1], AOA_CONF_STRLEN, "%d,%d",
+                 (int)lroundf(aoa->pos[ant][0] * 1e6f), (int)lroundf(aoa->pos[ant][1] * 1e6f));
+    for (uint8_t ch = 1; ch < CIR_AOA_NCHAN; ch++)
+        snprintf(aoa_config[ch + 1], AOA_CONF_STRLEN, "%d,%d",
+                 (int)lroundf(aoa->cal[ch][0] * 1e3f), (int)lroundf(aoa->cal[ch][1] * 1e3f));
+}
+
+/**
+ * API to have the engine take its positions and calibration offsets from config, on conf_load() and
+ * every commit after.
+ *
+ * @param aoa  Pointer to cir_aoa_t.
+ * @return 0 on success
+ */
+int
+cir_aoa_conf_init(cir_aoa_t * aoa)
+{
+    int rc;
+
+    g_aoa = aoa;
+    rc = conf_register(&aoa_conf_handler);
+    if (rc == 0)
+        aoa_conf_commit();
+    return rc;
+}
+
+#endif /* MYNEWT_VAL(CIR_AOA_CONF) */
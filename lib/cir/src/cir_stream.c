@@ -0,0 +1,334 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_stream.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Streaming CIR capture
+ *
+ * @details The capture runs from the cir_complete_cb, ahead of the receiver being enabled again, and
+ * only queues the record; the sink is called from the drain event or cir_stream_flush(). The ring has
+ * a single producer and a single consumer, head is only moved by the capture and tail by the drain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <cir/cir_stream.h>
+
+#if MYNEWT_VAL(CIR_STREAM_BFP)
+/* Shift and int8_t pairs of n samples, returns the end of the packed chunk */
+static uint8_t *
+cir_stream_pack(uint8_t * p, const uint8_t * acc, uint16_t n)
+{
+    int16_t v[2 * MYNEWT_VAL(CIR_STREAM_CHUNK)];
+    int32_t max = 0;
+    uint8_t shift = 0;
+
+    for (uint16_t i = 0; i < 2 * n; i++) {
+        v[i] = (int16_t)(acc[2 * i] | (acc[2 * i + 1] << 8));
+        int32_t a = v[i] < 0 ? -(int32_t)v[i] : v[i];
+        max = a > max ? a : max;
+    }
+    while ((max >> shift) > 127)
+        shift++;
+
+    *p++ = shift;
+    for (uint16_t i = 0; i < 2 * n; i++) {
+        int32_t q = shift ? (v[i] + (1 << (shift - 1))) >> shift : v[i];
+        *p++ = (uint8_t)(int8_t)(q > 127 ? 127 : q);
+    }
+    return p;
+}
+#else
+/* Accumulator pairs as read, returns the end of the packed chunk */
+static uint8_t *
+cir_stream_pack(uint8_t * p, const uint8_t * acc, uint16_t n)
+{
+    memcpy(p, acc, 4 * n);
+    return p + 4 * n;
+}
+#endif
+
+/* Samples in chunk k */
+static inline uint16_t
+cir_stream_chunk_len(uint16_t k)
+{
+    uint16_t left = MYNEWT_VAL(CIR_STREAM_LEN) - k * MYNEWT_VAL(CIR_STREAM_CHUNK);
+    return left < MYNEWT_VAL(CIR_STREAM_CHUNK) ? left : MYNEWT_VAL(CIR_STREAM_CHUNK);
+}
+
+/**
+ * API to capture the window around the first path of the frame just received into the ring. Called
+ * from the cir_complete_cb, the accumulator is lost once the receiver is enabled again.
+ *
+ * @param stream  Pointer to cir_stream_t.
+ * @return true if a record was queued
+ */
+bool
+cir_stream_capture(cir_stream_t * stream)
+{
+    dw1000_dev_instance_t * inst = stream->dev_inst;
+    uint32_t t0 = os_cputime_get32();
+
+    if (stream->head - stream->tail == MYNEWT_VAL(CIR_STREAM_RING_SLOTS)) {
+        stream->stats.drops++;
+        stream->seq++;
+        return false;
+    }
+
+    uint16_t fp_idx_reg = inst->rxdiag.fp_idx;
+    if(!inst->config.rxdiag_enable)
+        fp_idx_reg = (uint16_t)dw1000_read_reg(inst, RX_TIME_ID, RX_TIME_FP_INDEX_OFFSET, sizeof(uint16_t));
+    uint16_t fp_idx = (fp_idx_reg + 32) >> 6;
+    if (fp_idx < MYNEWT_VAL(CIR_STREAM_PRE) ||
+        fp_idx - MYNEWT_VAL(CIR_STREAM_PRE) + MYNEWT_VAL(CIR_STREAM_LEN) > CIR_STREAM_ACC_LEN) {
+        stream->stats.clipped++;
+        stream->seq++;
+        return false;
+    }
+
+    uint8_t * rec = stream->ring[stream->head % MYNEWT_VAL(CIR_STREAM_RING_SLOTS)];
+    cir_stream_hdr_t * hdr = (cir_stream_hdr_t *)rec;
+    uint8_t * p = rec + sizeof(cir_stream_hdr_t);
+    uint16_t start = fp_idx - MYNEWT_VAL(CIR_STREAM_PRE);
+    uint16_t pmsc_ctrl = (uint16_t) dw1000_read_reg(inst, PMSC_ID, PMSC_CTRL0_OFFSET, sizeof(uint16_t));
+
+    /* Chunk k goes on the bus while chunk k - 1 is packed */
+    for (uint16_t k = 0; k <= CIR_STREAM_NCHUNKS; k++) {
+        if (k < CIR_STREAM_NCHUNKS) {
+            dw1000_async_req_t * req = &stream->req[k & 1];
+            dw1000_async_init(req, NULL, NULL);
+            if (k == 0)
+                dw1000_accdata_clocks_queue(&req->list, pmsc_ctrl, true);
+            dw1000_xfer_list_read(&req->list, ACC_MEM_ID, (start + k * MYNEWT_VAL(CIR_STREAM_CHUNK)) * 4,
+                                  stream->chunk[k & 1], 1 + 4 * cir_stream_chunk_len(k));
+            if (k == CIR_STREAM_NCHUNKS - 1)
+                dw1000_accdata_clocks_queue(&req->list, pmsc_ctrl, false);
+            dw1000_async_submit(inst, req);
+        }
+        if (k > 0) {
+            dw1000_async_wait(inst, &stream->req[(k - 1) & 1], DPL_TIMEOUT_NEVER);
+            /* The first octet of each accumulator read is a dummy */
+            p = cir_stream_pack(p, stream->chunk[(k - 1) & 1] + 1, cir_stream_chunk_len(k - 1));
+        }
+    }
+
+    hdr->sync = CIR_STREAM_SYNC;
+    hdr->flags = CIR_STREAM_VERSION | (MYNEWT_VAL(CIR_STREAM_BFP) ? CIR_STREAM_FLAG_BFP : 0);
+    hdr->idx = inst->idx;
+    hdr->len = p - rec;
+    hdr->seq = stream->seq++;
+    hdr->utime = os_cputime_ticks_to_usecs(t0);
+    hdr->fp_idx = fp_idx_reg;
+    hdr->start = start;
+    hdr->nsamples = MYNEWT_VAL(CIR_STREAM_LEN);
+    hdr->chunk = MYNEWT_VAL(CIR_STREAM_CHUNK);
+
+    if (stream->stats.captures++ == 0)
+        stream->stats.start = t0;
+    stream->head++;
+    stream->stats.read_usec = os_cputime_ticks_to_usecs(os_cputime_get32() - t0);
+    if (stream->stats.read_usec > stream->stats.read_usec_max)
+        stream->stats.read_usec_max = stream->stats.read_usec;
+
+    if (stream->evq)
+        dpl_eventq_put(stream->evq, &stream->drain_ev);
+    return true;
+}
+
+static bool
+cir_stream_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    cir_stream_t * stream = (cir_stream_t *)cbs->inst_ptr;
+
+    if (stream->enabled)
+        cir_stream_capture(stream);
+    return false;
+}
+
+/**
+ * API to hand the queued records to the sink, oldest first.
+ *
+ * @param stream  Pointer to cir_stream_t.
+ * @return Records drained
+ */
+uint32_t
+cir_stream_flush(cir_stream_t * stream)
+{
+    uint32_t n = 0;
+
+    while (stream->tail != stream->head) {
+        uint8_t * rec = stream->ring[stream->tail % MYNEWT_VAL(CIR_STREAM_RING_SLOTS)];
+        uint16_t len = ((cir_stream_hdr_t *)rec)->len;
+
+        if (stream->sink(stream->sink_arg, rec, len) == len) {
+            stream->stats.delivered++;
+            stream->stats.bytes += len;
+        } else {
+            stream->stats.sink_errors++;
+        }
+        stream->tail++;
+        n++;
+    }
+    return n;
+}
+
+static void
+cir_stream_drain_ev_cb(struct dpl_event * ev)
+{
+    cir_stream_flush((cir_stream_t *)dpl_event_get_arg(ev));
+}
+
+/**
+ * API to work out the records delivered per second since the first capture.
+ *
+ * @param stream  Pointer to cir_stream_t.
+ * @return CIRs per second
+ */
+uint32_t
+cir_stream_rate(cir_stream_t * stream)
+{
+    if (stream->stats.captures == 0)
+        return 0;
+    uint32_t usec = os_cputime_ticks_to_usecs(os_cputime_get32() - stream->stats.start);
+    return usec ? (uint32_t)((uint64_t)stream->stats.delivered * 1000000 / usec) : 0;
+}
+
+/**
+ * Sink writing the records to a file descriptor, a file or pipe on Linux, the console on target.
+ *
+ * @param arg  File descriptor, cast to void *.
+ * @param buf  Record.
+ * @param len  Record length.
+ * @return len, or -1 if the descriptor failed
+ */
+int
+cir_stream_fd_sink(void * arg, const uint8_t * buf, uint16_t len)
+{
+    int fd = (int)(intptr_t)arg;
+    uint16_t done = 0;
+
+    while (done < len) {
+        ssize_t rc = write(fd, buf + done, len - done);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            return -1;
+        done += rc;
+    }
+    return len;
+}
+
+/**
+ * API to enable or disable the capture. Enabling sets config.cir_enable so every frame is captured.
+ *
+ * @param stream  Pointer to cir_stream_t.
+ * @param enable  true to capture.
+ * @return void
+ */
+void
+cir_stream_enable(cir_stream_t * stream, bool enable)
+{
+    stream->enabled = enable;
+    stream->dev_inst->config.cir_enable = enable;
+}
+
+/**
+ * API to print the capture statistics as json.
+ *
+ * @param stream  Pointer to cir_stream_t.
+ * @param print   printf like output function, console_printf on target.
+ * @return void
+ */
+void
+cir_stream_dump(cir_stream_t * stream, int (* print)(const char *, ...))
+{
+    cir_stream_stats_t * stats = &stream->stats;
+
+    assert(stream && print);
+    print("{\"captures\":%lu,\"delivered\":%lu,\"bytes\":%lu,\"drops\":%lu,\"clipped\":%lu,\"sink_errors\":%lu,"
+          "\"read_usec\":%lu,\"read_usec_max\":%lu,\"cirs_per_sec\":%lu}\n",
+          (unsigned long)stats->captures, (unsigned long)stats->delivered, (unsigned long)stats->bytes,
+          (unsigned long)stats->drops, (unsigned long)stats->clipped, (unsigned long)stats->sink_errors,
+          (unsigned long)stats->read_usec, (unsigned long)stats->read_usec_max,
+          (unsigned long)cir_stream_rate(stream));
+}
+
+/**
+ * API to set up a streaming capture on an instance, disabled until cir_stream_enable().
+ *
+ * @param inst    Pointer to dw1000_dev_instance_t.
+ * @param stream  Pointer to cir_stream_t, allocated when NULL.
+ * @param sink    Record consumer, e.g. cir_stream_fd_sink.
+ * @param arg     Passed to the sink.
+ * @param evq     Queue the sink is called from, NULL to drain with cir_stream_flush().
+ * @return cir_stream_t *
+ */
+cir_stream_t *
+cir_stream_init(struct _dw1000_dev_instance_t * inst, cir_stream_t * stream, cir_stream_sink_t sink, void * arg, struct dpl_eventq * evq)
+{
+    assert(inst && sink);
+    if (stream == NULL) {
+        stream = (cir_stream_t *) malloc(sizeof(cir_stream_t));
+        assert(stream);
+        memset(stream, 0, sizeof(cir_stream_t));
+        stream->selfmalloc = 1;
+    }
+    stream->dev_inst = inst;
+    stream->sink = sink;
+    stream->sink_arg = arg;
+    stream->evq = evq;
+    dpl_event_init(&stream->drain_ev, cir_stream_drain_ev_cb, (void *)stream);
+
+    memset(&stream->cbs, 0, sizeof(stream->cbs));
+    stream->cbs.id = DW1000_CIR_STREAM;
+    stream->cbs.inst_ptr = stream;
+    stream->cbs.cir_complete_cb = cir_stream_complete_cb;
+    dw1000_mac_append_interface(inst, &stream->cbs);
+    return stream;
+}
+
+/**
+ * API to stop the capture and free the resources.
+ *
+ * @param stream  Pointer to cir_stream_t.
+ * @return void
+ */
+void
+cir_stream_free(cir_stream_t * stream)
+{
+    assert(stream);
+    cir_stream_enable(stream, false);
+    dw1000_mac_remove_interface(stream->dev_inst, DW1000_CIR_STREAM);
+    if (stream->selfmalloc)
+        free(stream);
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_kernels.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Channel impulse response kernels
+ *
+ * @details Batch kernels over accumulator samples, int16_t real, imag pairs as read from the DW1000
+ * (the layout of cir_complex_t). Each kernel has a fixed point version and a float _ref version it is
+ * checked against. Angles are int16_t with DSP_CIR_PI standing for pi, so they wrap at +-pi like the
+ * phase they represent. On cores with the DSP extension the power of a sample is a single SMUAD.
+ */
+
+#ifndef _CIR_KERNELS_H_
+#define _CIR_KERNELS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DSP_CIR_PI          (32768)     //!< pi in angle units
+#define DSP_CIR_UPSAMPLE    (8)         //!< Samples out of dsp_cir_upsample() per accumulator sample
+#define DSP_CIR_TAPS        (8)         //!< Accumulator samples behind each upsampled one
+
+uint16_t dsp_isqrt32(uint32_t x);
+int16_t dsp_atan2(int32_t y, int32_t x);
+
+void dsp_cir_mag2(const int16_t * iq, uint32_t * mag2, uint16_t n);
+void dsp_cir_mag2_ref(const int16_t * iq, float * mag2, uint16_t n);
+void dsp_cir_mag(const int16_t * iq, uint16_t * mag, uint16_t n);
+void dsp_cir_mag_ref(const int16_t * iq, float * mag, uint16_t n);
+void dsp_cir_angle(const int16_t * iq, int16_t * angle, uint16_t n);
+void dsp_cir_angle_ref(const int16_t * iq, float * angle, uint16_t n);
+void dsp_cir_scale(int16_t * iq, uint16_t n, uint16_t div);
+void dsp_cir_scale_ref(int16_t * iq, uint16_t n, uint16_t div);
+void dsp_cir_upsample(const int16_t * iq, uint16_t n, uint16_t start, int16_t * out, uint16_t nout);
+void dsp_cir_upsample_ref(const int16_t * iq, uint16_t n, uint16_t start, float * out, uint16_t nout);
+uint32_t dsp_cir_noise2(const int16_t * iq, uint16_t n);
+int32_t dsp_cir_leading_edge(const int16_t * iq, uint16_t n, uint32_t thresh2);
+float dsp_cir_leading_edge_ref(const int16_t * iq, uint16_t n, float thresh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CIR_KERNELS_H_ */
@@ -0,0 +1,395 @@
+/**
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file cir_kernels.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Channel impulse response kernels
+ *
+ * @details The upsampler is a Hann windowed sinc of DSP_CIR_TAPS taps, one phase per output sample
+ * between two accumulator samples, each phase normalised to unit gain. The fixed point version keeps
+ * the phases as a Q14 table, the reference works the taps out for every output. The leading edge is
+ * the first sample whose magnitude reaches the threshold, refined by interpolating linearly with the
+ * sample before it; the fixed point version compares powers and only takes the square root of the
+ * two samples it interpolates between.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <dsp/cir_kernels.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//! Upsampler phases, Q14
+static const int16_t g_upsample[DSP_CIR_UPSAMPLE][DSP_CIR_TAPS] = {
+    {     0,      0,      0,  16384,      0,      0,      0,      0},
+    {   -72,    423,  -1449,  15920,   2021,   -584,    127,     -1},
+    {   -95,    659,  -2291,  14586,   4495,  -1257,    298,     -9},
+    {   -84,    718,  -2571,  12539,   7235,  -1908,    484,    -29},
+    {   -57,    642,  -2396,  10003,  10003,  -2396,    642,    -57},
+    {   -29,    484,  -1908,   7235,  12539,  -2571,    718,    -84},
+    {    -9,    298,  -1257,   4495,  14586,  -2291,    659,    -95},
+    {    -1,    127,   -584,   2021,  15920,  -1449,    423,    -72},
+};
+
+/* Power of a sample, re * re + im * im */
+static inline uint32_t
+dsp_cir_power(const int16_t * iq)
+{
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t v, r;
+    memcpy(&v, iq, sizeof(v));
+    __asm__ ("smuad %0, %1, %1" : "=r" (r) : "r" (v));
+    return r;
+#else
+    return (uint32_t)((int32_t)iq[0] * iq[0]) + (uint32_t)((int32_t)iq[1] * iq[1]);
+#endif
+}
+
+static inline int16_t
+dsp_sat16(int32_t v)
+{
+    return v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v);
+}
+
+/**
+ * API to take the integer square root.
+ *
+ * @param x  Value.
+ * @return floor(sqrt(x))
+ */
+uint16_t
+dsp_isqrt32(uint32_t x)
+{
+    uint32_t res = 0, bit = 1UL << 30;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+/**
+ * API to work out the angle of a vector. Octant reduction followed by the 9th order odd polynomial
+ * of Abramowitz and Stegun 4.4.47, within 5 units (0.0005 rad) of atan2f.
+ *
+ * @param y  Imaginary part.
+ * @param x  Real part, |x| and |y| at most 2^15.
+ * @return Angle, DSP_CIR_PI for pi
+ */
+int16_t
+dsp_atan2(int32_t y, int32_t x)
+{
+    //! Coefficients over pi, Q15
+    static const int32_t c[] = {10429, -3445, 1879, -888, 217};
+    int32_t ax = x < 0 ? -x : x, ay = y < 0 ? -y : y;
+    int32_t z, z2, p, a;
+
+    if (ax == 0 && ay == 0)
+        return 0;
+    z = (ay > ax) ? (ax << 15) / ay : (ay << 15) / ax;
+    z2 = (z * z) >> 15;
+    p = c[4];
+    for (int k = 3; k >= 0; k--)
+        p = c[k] + ((p * z2) >> 15);
+    a = (p * z) >> 15;
+    if (ay > ax)
+        a = DSP_CIR_PI / 2 - a;
+    if (x < 0)
+        a = DSP_CIR_PI - a;
+    return (int16_t)(y < 0 ? -a : a);
+}
+
+/**
+ * API to work out the power of n samples.
+ *
+ * @param iq    Samples, real and imaginary interleaved.
+ * @param mag2  Power of each sample.
+ * @param n     Samples.
+ * @return void
+ */
+void
+dsp_cir_mag2(const int16_t * iq, uint32_t * mag2, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        mag2[i] = dsp_cir_power(&iq[2 * i]);
+}
+
+/**
+ * API to work out the power of n samples, float reference of dsp_cir_mag2().
+ */
+void
+dsp_cir_mag2_ref(const int16_t * iq, float * mag2, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++) {
+        float re = iq[2 * i], im = iq[2 * i + 1];
+        mag2[i] = re * re + im * im;
+    }
+}
+
+/**
+ * API to work out the magnitude of n samples. The square root is the FPU one where there is an FPU,
+ * integer otherwise.
+ *
+ * @param iq   Samples, real and imaginary interleaved.
+ * @param mag  Magnitude of each sample, rounded down.
+ * @param n    Samples.
+ * @return void
+ */
+void
+dsp_cir_mag(const int16_t * iq, uint16_t * mag, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++) {
+#if !defined(__arm__) || defined(__ARM_FP)
+        mag[i] = (uint16_t)sqrtf((float)dsp_cir_power(&iq[2 * i]));
+#else
+        mag[i] = dsp_isqrt32(dsp_cir_power(&iq[2 * i]));
+#endif
+    }
+}
+
+/**
+ * API to work out the magnitude of n samples, float reference of dsp_cir_mag().
+ */
+void
+dsp_cir_mag_ref(const int16_t * iq, float * mag, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        mag[i] = sqrtf((float)iq[2 * i] * iq[2 * i] + (float)iq[2 * i + 1] * iq[2 * i + 1]);
+}
+
+/**
+ * API to work out the phase of n samples.
+ *
+ * @param iq     Samples, real and imaginary interleaved.
+ * @param angle  Phase of each sample, DSP_CIR_PI for pi.
+ * @param n      Samples.
+ * @return void
+ */
+void
+dsp_cir_angle(const int16_t * iq, int16_t * angle, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        angle[i] = dsp_atan2(iq[2 * i + 1], iq[2 * i]);
+}
+
+/**
+ * API to work out the phase of n samples, float reference of dsp_cir_angle() in radians.
+ */
+void
+dsp_cir_angle_ref(const int16_t * iq, float * angle, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        angle[i] = atan2f((float)iq[2 * i + 1], (float)iq[2 * i]);
+}
+
+/**
+ * API to divide n samples in place, e.g. by the preamble symbols accumulated. The division is a
+ * multiplication by a 32 bit reciprocal, exact for 16 bit samples and rounded towards zero like the
+ * C division.
+ *
+ * @param iq   Samples, real and imaginary interleaved.
+ * @param n    Samples.
+ * @param div  Divisor.
+ * @return void
+ */
+void
+dsp_cir_scale(int16_t * iq, uint16_t n, uint16_t div)
+{
+    assert(div);
+    if (div == 1)
+        return;
+    uint32_t m = (uint32_t)(((1ULL << 32) + div - 1) / div);
+    for (uint16_t i = 0; i < 2 * n; i++) {
+        int32_t v = iq[i], s = v >> 31;
+        uint32_t q = (uint32_t)(((uint64_t)(uint32_t)((v ^ s) - s) * m) >> 32);
+        iq[i] = ((int32_t)q ^ s) - s;
+    }
+}
+
+/**
+ * API to divide n samples in place, reference of dsp_cir_scale().
+ */
+void
+dsp_cir_scale_ref(int16_t * iq, uint16_t n, uint16_t div)
+{
+    assert(div);
+    for (uint16_t i = 0; i < 2 * n; i++)
+        iq[i] /= div;
+}
+
+/**
+ * API to upsample by DSP_CIR_UPSAMPLE from accumulator sample start, e.g. around the first path.
+ * Samples outside iq count as zero.
+ *
+ * @param iq     Samples, real and imaginary interleaved.
+ * @param n      Samples in iq.
+ * @param start  Sample of iq the first output falls on.
+ * @param out    Upsampled samples, real and imaginary interleaved.
+ * @param nout   Samples out.
+ * @return void
+ */
+void
+dsp_cir_upsample(const int16_t * iq, uint16_t n, uint16_t start, int16_t * out, uint16_t nout)
+{
+    for (uint16_t k = 0; k < nout; k++) {
+        const int16_t * h = g_upsample[k % DSP_CIR_UPSAMPLE];
+        int32_t base = start + k / DSP_CIR_UPSAMPLE - DSP_CIR_TAPS / 2 + 1;
+        int32_t re = 1 << 13, im = 1 << 13;
+
+        if (base >= 0 && base + DSP_CIR_TAPS <= n) {
+            const int16_t * x = &iq[2 * base];
+            for (uint16_t j = 0; j < DSP_CIR_TAPS; j++) {
+                re += h[j] * x[2 * j];
+                im += h[j] * x[2 * j + 1];
+            }
+        } else {
+            for (uint16_t j = 0; j < DSP_CIR_TAPS; j++) {
+                if (base + j < 0 || base + j >= n)
+                    continue;
+                re += h[j] * iq[2 * (base + j)];
+                im += h[j] * iq[2 * (base + j) + 1];
+            }
+        }
+        out[2 * k] = dsp_sat16(re >> 14);
+        out[2 * k + 1] = dsp_sat16(im >> 14);
+    }
+}
+
+/**
+ * API to upsample by DSP_CIR_UPSAMPLE, float reference of dsp_cir_upsample().
+ */
+void
+dsp_cir_upsample_ref(const int16_t * iq, uint16_t n, uint16_t start, float * out, uint16_t nout)
+{
+    for (uint16_t k = 0; k < nout; k++) {
+        float f = (float)(k % DSP_CIR_UPSAMPLE) / DSP_CIR_UPSAMPLE;
+        int32_t base = start + k / DSP_CIR_UPSAMPLE - DSP_CIR_TAPS / 2 + 1;
+        float h[DSP_CIR_TAPS], sum = 0, re = 0, im = 0;
+
+        for (uint16_t j = 0; j < DSP_CIR_TAPS; j++) {
+            float d = f + DSP_CIR_TAPS / 2 - 1 - j;
+            float s = (d == 0) ? 1.0f : sinf(M_PI * d) / (M_PI * d);
+            h[j] = s * 0.5f * (1.0f + cosf(M_PI * d / (DSP_CIR_TAPS / 2)));
+            sum += h[j];
+        }
+        for (uint16_t j = 0; j < DSP_CIR_TAPS; j++) {
+            if (base + j < 0 || base + j >= n)
+                continue;
+            re += h[j] / sum * iq[2 * (base + j)];
+            im += h[j] / sum * iq[2 * (base + j) + 1];
+        }
+        out[2 * k] = re;
+        out[2 * k + 1] = im;
+    }
+}
+
+/**
+ * API to work out the mean power of n samples, e.g. ahead of the first path for the noise floor of
+ * dsp_cir_leading_edge().
+ *
+ * @param iq  Samples, real and imaginary interleaved.
+ * @param n   Samples.
+ * @return Mean power
+ */
+uint32_t
+dsp_cir_noise2(const int16_t * iq, uint16_t n)
+{
+    uint64_t sum = 0;
+
+    for (uint16_t i = 0; i < n; i++)
+        sum += dsp_cir_power(&iq[2 * i]);
+    return n ? (uint32_t)(sum / n) : 0;
+}
+
+/* Magnitude with 4 fractional bits */
+static uint32_t
+dsp_mag_q4(uint32_t mag2)
+{
+#if !defined(__arm__) || defined(__ARM_FP)
+    return (uint32_t)(sqrtf((float)mag2) * 16.0f);
+#else
+    return mag2 < (1UL << 24) ? dsp_isqrt32(mag2 << 8) : (uint32_t)dsp_isqrt32(mag2) << 4;
+#endif
+}
+
+/**
+ * API to find the leading edge, the first sample whose power reaches thresh2.
+ *
+ * @param iq       Samples, real and imaginary interleaved.
+ * @param n        Samples.
+ * @param thresh2  Threshold on the power, e.g. a multiple of dsp_cir_noise2().
+ * @return Index of the leading edge in 10.6 fixed point like RX_TIME_FP_INDEX, -1 if not found
+ */
+int32_t
+dsp_cir_leading_edge(const int16_t * iq, uint16_t n, uint32_t thresh2)
+{
+    uint32_t prev = 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t p = dsp_cir_power(&iq[2 * i]);
+        if (p < thresh2) {
+            prev = p;
+            continue;
+        }
+        if (i == 0)
+            return 0;
+        uint32_t mp = dsp_mag_q4(prev), m = dsp_mag_q4(p), thr = dsp_mag_q4(thresh2);
+        uint32_t frac = (m > mp) ? (((thr - mp) << 6) + (m - mp) / 2) / (m - mp) : 0;
+        return ((int32_t)(i - 1) << 6) + frac;
+    }
+    return -1;
+}
+
+/**
+ * API to find the leading edge, float reference of dsp_cir_leading_edge().
+ *
+ * @return Index of the leading edge, -1 if not found
+ */
+float
+dsp_cir_leading_edge_ref(const int16_t * iq, uint16_t n, float thresh)
+{
+    float prev = 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        float m = sqrtf((float)iq[2 * i] * iq[2 * i] + (float)iq[2 * i + 1] * iq[2 * i + 1]);
+        if (m < thresh) {
+            prev = m;
+            continue;
+        }
+        if (i == 0)
+            return 0;
+        return (i - 1) + (thresh - prev) / (m - prev);
+    }
+    return -1;
+}
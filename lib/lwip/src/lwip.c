@@ -126,7 +126,8 @@ dw1000_lwip_init(dw1000_dev_instance_t * inst, dw1000_lwip_config_t * config, ui
         .rx_complete_cb = rx_complete_cb,
         .rx_timeout_cb = rx_timeout_cb,
         .rx_error_cb = rx_error_cb,
-		.complete_cb = complete_cb
+		.complete_cb = complete_cb,
+        .rx_fctrl = 'L' | 'W' << 8
     };
     dw1000_mac_append_interface(inst, &lwip->cbs);
 
@@ -90,12 +90,14 @@ static dw1000_mac_interface_t g_cbs[] = {
             .id = DW1000_NMGR_CMD,
             .rx_complete_cb = rx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
+            .rx_fctrl = NMGR_UWB_FCTRL
         },
 #if MYNEWT_VAL(DW1000_DEVICE_1)
         [1] = {
             .id = DW1000_NMGR_CMD,
             .rx_complete_cb = rx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
+            .rx_fctrl = NMGR_UWB_FCTRL
         },
 #endif
 #if MYNEWT_VAL(DW1000_DEVICE_2)
@@ -103,6 +105,7 @@ static dw1000_mac_interface_t g_cbs[] = {
             .id = DW1000_NMGR_CMD,
             .rx_complete_cb = rx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
+            .rx_fctrl = NMGR_UWB_FCTRL
         }
 #endif
 };
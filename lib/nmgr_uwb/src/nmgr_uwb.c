@@ -91,6 +91,8 @@ static dw1000_mac_interface_t g_cbs[] = {
             .rx_complete_cb = rx_complete_cb,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
+            .status.rx_any = 1,
+            .rx_fctrl = NMGR_UWB_FCTRL
         },
 #if MYNEWT_VAL(DW1000_DEVICE_1)
         [1] = {
@@ -98,6 +100,8 @@ static dw1000_mac_interface_t g_cbs[] = {
             .rx_complete_cb = rx_complete_cb,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
+            .status.rx_any = 1,
+            .rx_fctrl = NMGR_UWB_FCTRL
         },
 #endif
 #if MYNEWT_VAL(DW1000_DEVICE_2)
@@ -106,6 +110,8 @@ static dw1000_mac_interface_t g_cbs[] = {
             .rx_complete_cb = rx_complete_cb,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
+            .status.rx_any = 1,
+            .rx_fctrl = NMGR_UWB_FCTRL
         }
 #endif
 };
@@ -261,7 +267,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
     static uint16_t last_rpt_src=0;
     static uint8_t last_rpt_seq_num=0;
 
-    if(inst->fctrl != NMGR_UWB_FCTRL) {
+    if(inst->frame_desc.fctrl != NMGR_UWB_FCTRL) {
         goto early_ret;
     }
 
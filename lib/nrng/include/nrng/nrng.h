@@ -126,6 +126,7 @@ typedef struct _dw1000_nrng_instance_t{
     uint8_t seq_num;
     struct dpl_sem sem;                          //!< Structure of semaphores
     dw1000_mac_interface_t cbs;                 //!< MAC Layer Callbacks
+    dw1000_tx_tmpl_t req_tmpl;                  //!< Resident request frame
     dw1000_nrng_device_type_t device_type;
     dw1000_rng_status_t status;
     dw1000_rng_control_t control;
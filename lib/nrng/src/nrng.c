@@ -101,6 +101,7 @@ dw1000_nrng_init(dw1000_dev_instance_t * inst, dw1000_rng_config_t * config, dw1
     }
     dpl_error_t err = dpl_sem_init(&nrng->sem, 0x1); 
     assert(err == DPL_OK);
+    dw1000_tx_tmpl_alloc(inst, &nrng->req_tmpl, sizeof(nrng_request_frame_t));
 
     nrng->dev_inst = inst;
     nrng->nframes = nframes;
@@ -398,8 +399,7 @@ dw1000_nrng_request(dw1000_nrng_instance_t * nrng, uint16_t dst_address, dw1000_
     frame->start_slot_id = slot_mask;
 #endif
 
-    dw1000_write_tx(inst, frame->array, 0, sizeof(nrng_request_frame_t));
-    dw1000_write_tx_fctrl(inst, sizeof(nrng_request_frame_t), 0);
+    dw1000_tx_tmpl_write(inst, &nrng->req_tmpl, frame->array, sizeof(nrng_request_frame_t));
     dw1000_set_wait4resp(inst, true);
 
     uint16_t timeout = config->tx_holdoff_delay         // Remote side turn arround time.
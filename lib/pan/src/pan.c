@@ -149,7 +149,9 @@ static dw1000_mac_interface_t g_cbs[] = {
             .rx_complete_cb = rx_complete_cb,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
-            .reset_cb = reset_cb
+            .reset_cb = reset_cb,
+            .status.rx_any = 1,
+            .rx_fctrl = FCNTL_IEEE_BLINK_TAG_64
         },
 #if MYNEWT_VAL(DW1000_DEVICE_1)
         [1] = {
@@ -157,7 +159,9 @@ static dw1000_mac_interface_t g_cbs[] = {
             .rx_complete_cb = rx_complete_cb,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
-            .reset_cb = reset_cb
+            .reset_cb = reset_cb,
+            .status.rx_any = 1,
+            .rx_fctrl = FCNTL_IEEE_BLINK_TAG_64
         },
 #endif
 #if MYNEWT_VAL(DW1000_DEVICE_2)
@@ -166,7 +170,9 @@ static dw1000_mac_interface_t g_cbs[] = {
             .rx_complete_cb = rx_complete_cb,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
-            .reset_cb = reset_cb
+            .reset_cb = reset_cb,
+            .status.rx_any = 1,
+            .rx_fctrl = FCNTL_IEEE_BLINK_TAG_64
         }
 #endif
 };
@@ -394,7 +400,7 @@ static bool
 rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
     dw1000_pan_instance_t * pan = (dw1000_pan_instance_t *)cbs->inst_ptr;
-    if(inst->fctrl_array[0] != FCNTL_IEEE_BLINK_TAG_64) {
+    if(inst->frame_desc.fctrl != FCNTL_IEEE_BLINK_TAG_64) {
         if (pan->status.valid == false && pan->config->role == PAN_ROLE_SLAVE) {
             /* Grab all packets if we're not provisioned as slave */
             return true;
@@ -777,7 +783,7 @@ dw1000_pan_slot_timer_cb(struct dpl_event * ev)
             } else {
                 /* Only listen long enough to get any resets from master */
                 timeout = dw1000_phy_frame_duration(&inst->attrib, sizeof(sizeof(struct _pan_frame_t)))
-                    + MYNEWT_VAL(XTALT_GUARD);
+                    + MYNEWT_VAL(XTALT_GUARD) + 2 * tdma->guard_uus;
             }
             dw1000_set_rx_timeout(inst, timeout);
             dw1000_set_delay_start(inst, tdma_rx_slot_start(tdma, idx));
@@ -156,6 +156,7 @@ dw1000_provision_init(dw1000_dev_instance_t * inst, dw1000_provision_config_t co
         .rx_timeout_cb = provision_rx_timeout_cb,
         .rx_error_cb = provision_rx_error_cb,
         .tx_error_cb = provision_tx_error_cb,
+        .rx_fctrl = FCNTL_IEEE_PROVISION_16
     };
     dw1000_mac_append_interface(inst, &inst->provision->cbs);
 
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file rng_nlos.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Line of sight classifier on the receive diagnostics
+ *
+ * @details A feature vector is built per frame from the rxdiag registers and, when the accumulator was
+ * read, from the CIR around the first path. A logistic regression in fixed point maps it to the
+ * probability the frame came over the line of sight. Features are Q8 (dB, samples or percent), weights
+ * Q12 per feature unit and the probability Q15. The models are trained offline, see
+ * porting/dpl/linux/test/bench_rng_nlos.c.
+ */
+
+#ifndef _RNG_NLOS_H_
+#define _RNG_NLOS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <dw1000/dw1000_dev.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RNG_NLOS_ONE        (32768)     //!< Probability 1.0
+#define RNG_NLOS_NDIAG      (5)         //!< Features from rxdiag
+#define RNG_NLOS_NFEATURES  (8)         //!< Features from rxdiag and the CIR
+
+//! Features, Q8.
+typedef enum _rng_nlos_feature_t{
+    RNG_NLOS_PWR_DIFF,          //!< rssi less fppl, dB
+    RNG_NLOS_FP_SNR,            //!< First path power to noise, dB
+    RNG_NLOS_FP_RISE,           //!< fp_amp3 to fp_amp, dB
+    RNG_NLOS_PACC,              //!< Preamble symbols accumulated, percent of those sent
+    RNG_NLOS_NOISE,             //!< Noise standard deviation, dB
+    RNG_NLOS_CIR_PEAK,          //!< Strongest sample of the CIR window, samples after the first
+    RNG_NLOS_CIR_EARLY,         //!< Window energy in its first 3 samples, percent
+    RNG_NLOS_CIR_DELAY,         //!< Mean delay of the window energy, samples
+}rng_nlos_feature_t;
+
+//! Logistic regression, P(LOS) = 1 / (1 + exp(-(bias + sum(weight[i] * feature[i])))).
+typedef struct _rng_nlos_model_t{
+    uint8_t nfeatures;                      //!< RNG_NLOS_NDIAG or RNG_NLOS_NFEATURES
+    int32_t bias;                           //!< Q8
+    int16_t weight[RNG_NLOS_NFEATURES];     //!< Q12 per Q8 feature unit
+}rng_nlos_model_t;
+
+int32_t rng_nlos_db(uint64_t x);
+void rng_nlos_diag_features(const dw1000_dev_rxdiag_t * diag, uint16_t nsync, int32_t * feature);
+bool rng_nlos_cir_features(const int16_t * iq, uint16_t n, int32_t * feature);
+uint16_t rng_nlos_classify(const rng_nlos_model_t * model, const int32_t * feature);
+void rng_nlos_set_models(const rng_nlos_model_t * diag, const rng_nlos_model_t * cir);
+uint16_t rng_nlos_los(dw1000_dev_instance_t * inst);
+float rng_nlos_range_variance(dw1000_dev_instance_t * inst, float variance);
+void rng_nlos_record(dw1000_dev_instance_t * inst, uint8_t los, int (* print)(const char *, ...));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_NLOS_H_ */
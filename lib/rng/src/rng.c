@@ -190,6 +190,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [0] = {
             .id = DW1000_RNG,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR,
+            .rx_code_max = DWT_DS_TWR_EXT_END,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
 #if MYNEWT_VAL(RNG_VERBOSE)
@@ -201,6 +204,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [1] = {
             .id = DW1000_RNG,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR,
+            .rx_code_max = DWT_DS_TWR_EXT_END,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
 #if MYNEWT_VAL(RNG_VERBOSE)
@@ -213,6 +219,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [2] = {
             .id = DW1000_RNG,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR,
+            .rx_code_max = DWT_DS_TWR_EXT_END,
             .tx_complete_cb = tx_complete_cb,
             .rx_timeout_cb = rx_timeout_cb,
 #if MYNEWT_VAL(RNG_VERBOSE)
@@ -826,9 +835,6 @@ reset_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static bool
 rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
-    if (inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     dw1000_rng_instance_t * rng = (dw1000_rng_instance_t *)cbs->inst_ptr;
     if(dpl_sem_get_count(&rng->sem) == 1){
         // unsolicited inbound
@@ -839,23 +845,22 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
     if (inst->frame_len < sizeof(ieee_rng_request_frame_t))
        return false;
 
-    rng->code = ((ieee_rng_request_frame_t * ) inst->rxbuf)->code;
+    rng->code = inst->frame_desc.code;
     switch(rng->code) {
         case DWT_SS_TWR ... DWT_DS_TWR_EXT_END:
             {
+                // IEEE 802.15.4 standard ranging frames, software MAC filtering
+                if (inst->config.framefilter_enabled == false && inst->frame_desc.dst_address != inst->my_short_address)
+                    return true;
+
                 twr_frame_t * frame = rng->frames[(rng->idx+1)%rng->nframes]; // speculative frame advance
                 if (inst->frame_len <= sizeof(frame->array))
                     memcpy(frame->array, inst->rxbuf, inst->frame_len);
                 else
                     break;
-                // IEEE 802.15.4 standard ranging frames, software MAC filtering
-                if (inst->config.framefilter_enabled == false && frame->dst_address != inst->my_short_address){
-                    return true;
-                }else{
-                    RNG_STATS_INC(rx_complete); 
-                    rng->idx++;     // confirmed frame advance  
-                    return false;   // Allow sub extensions to handle event
-                }
+                RNG_STATS_INC(rx_complete); 
+                rng->idx++;     // confirmed frame advance  
+                return false;   // Allow sub extensions to handle event
             }
             break;
         default:
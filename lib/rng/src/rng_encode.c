@@ -31,6 +31,9 @@
 #if MYNEWT_VAL(WCS_ENABLED)
 #include <wcs/wcs.h>
 #endif
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+#include <rng/rng_nlos.h>
+#endif
 
 #if MYNEWT_VAL(RNG_VERBOSE)
 
@@ -298,7 +301,11 @@ _diag_encode(struct _dw1000_dev_instance_t * inst) {
 
     float rssi = dw1000_get_rssi(inst);
     float fppl = dw1000_get_fppl(inst);
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+    float nlos = (float)rng_nlos_los(inst) / RNG_NLOS_ONE;
+#else
     float nlos = dw1000_estimate_los(rssi, fppl);
+#endif
 
 #if MYNEWT_VAL(FLOAT_USER)
     char float_string[32]={0};
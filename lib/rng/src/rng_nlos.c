@@ -0,0 +1,259 @@
+/*
+ * Copyright 2018, Decawave Limited, All Rights Reserved
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file rng_nlos.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Line of sight classifier on the receive diagnostics
+ *
+ * @details rssi and fppl share the PRF constant and the preamble count, so their difference is the
+ * ratio of the max growth CIR to the first path power and needs no float. Levels are 10log10() in Q8
+ * from a log2 table, the probability a 33 entry sigmoid table.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <os/os.h>
+
+#include <dw1000/dw1000_dev.h>
+#include <rng/rng_nlos.h>
+#if MYNEWT_VAL(CIR_ENABLED)
+#include <cir/cir.h>
+#endif
+
+//! log2(1 + i/16), Q16
+static const uint32_t g_log2_tab[17] = {
+    0, 5732, 11136, 16248, 21098, 25711, 30109, 34312, 38336, 42196, 45904, 49472, 52911, 56229, 59434, 62534, 65536
+};
+
+//! 1 / (1 + exp(-i/4)), Q15
+static const uint16_t g_sigmoid_tab[33] = {
+    16384, 18421, 20397, 22255, 23955, 25471, 26790, 27917, 28862, 29644, 30282, 30799, 31214, 31545, 31807, 32015,
+    32179, 32307, 32408, 32487, 32549, 32597, 32635, 32664, 32687, 32705, 32719, 32730, 32738, 32745, 32750, 32754, 32757
+};
+
+//! Trained by bench_rng_nlos on its simulated frames, rxdiag alone
+static const rng_nlos_model_t g_rng_nlos_diag_default = {
+    .nfeatures = RNG_NLOS_NDIAG,
+    .bias = -1517,
+    .weight = {-1031, 517, -1604, 252, 179},
+};
+
+//! Trained by bench_rng_nlos on its simulated frames, rxdiag and an 8 sample CIR window from a sample ahead of the first path
+static const rng_nlos_model_t g_rng_nlos_cir_default = {
+    .nfeatures = RNG_NLOS_NFEATURES,
+    .bias = -1908,
+    .weight = {-545, 31, -1492, 320, 591, -3100, 148, -5071},
+};
+
+static const rng_nlos_model_t * g_rng_nlos_diag = &g_rng_nlos_diag_default;
+static const rng_nlos_model_t * g_rng_nlos_cir = &g_rng_nlos_cir_default;
+
+/**
+ * API to calculate 10log10(x) in fixed point, within 0.01 dB.
+ *
+ * @param x  Power, 0 is taken as 1.
+ * @return dB, Q8
+ */
+int32_t
+rng_nlos_db(uint64_t x)
+{
+    if (x == 0)
+        return 0;
+    int32_t msb = 63 - __builtin_clzll(x);
+    uint32_t m = (msb >= 15) ? (uint32_t)(x >> (msb - 15)) : (uint32_t)(x << (15 - msb));
+    uint32_t idx = (m >> 11) & 15, frac = m & 0x7ff;
+    uint32_t log2 = ((uint32_t)msb << 16) + g_log2_tab[idx] + (((g_log2_tab[idx + 1] - g_log2_tab[idx]) * frac) >> 11);
+    return (int32_t)(((uint64_t)log2 * 197283) >> 24);  /* 10log10(2) in Q16 */
+}
+
+/**
+ * API to build the rxdiag features of a frame.
+ *
+ * @param diag     Receive diagnostics of the frame.
+ * @param nsync    Preamble symbols sent, inst->attrib.nsync; 0 if unknown.
+ * @param feature  The first RNG_NLOS_NDIAG features, Q8.
+ * @return void
+ */
+void
+rng_nlos_diag_features(const dw1000_dev_rxdiag_t * diag, uint16_t nsync, int32_t * feature)
+{
+    uint64_t fp = (uint64_t)diag->fp_amp * diag->fp_amp + (uint64_t)diag->fp_amp2 * diag->fp_amp2
+                + (uint64_t)diag->fp_amp3 * diag->fp_amp3;
+    uint64_t noise = (uint64_t)diag->rx_std * diag->rx_std;
+    int32_t pacc = nsync ? (int32_t)(((uint32_t)diag->pacc_cnt * 100) << 8) / nsync : 100 << 8;
+
+    feature[RNG_NLOS_PWR_DIFF] = rng_nlos_db((uint64_t)diag->cir_pwr << 17) - rng_nlos_db(fp);
+    feature[RNG_NLOS_FP_SNR] = rng_nlos_db(fp) - rng_nlos_db(3 * noise);
+    feature[RNG_NLOS_FP_RISE] = rng_nlos_db((uint64_t)diag->fp_amp3 * diag->fp_amp3 + 1)
+                              - rng_nlos_db((uint64_t)diag->fp_amp * diag->fp_amp + 1);
+    feature[RNG_NLOS_PACC] = pacc > (200 << 8) ? (200 << 8) : pacc;
+    feature[RNG_NLOS_NOISE] = rng_nlos_db(noise);
+}
+
+/**
+ * API to build the CIR features of a frame.
+ *
+ * @param iq       Window of the accumulator, real and imag pairs, starting CIR_OFFSET samples ahead of the first path.
+ * @param n        Samples in the window.
+ * @param feature  Features, RNG_NLOS_NDIAG onwards are written, Q8.
+ * @return false if the window is empty
+ */
+bool
+rng_nlos_cir_features(const int16_t * iq, uint16_t n, int32_t * feature)
+{
+    uint64_t energy = 0, moment = 0, early = 0;
+    uint32_t peak = 0;
+    uint16_t ipeak = 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t p = (uint32_t)((int32_t)iq[2 * i] * iq[2 * i]) + (uint32_t)((int32_t)iq[2 * i + 1] * iq[2 * i + 1]);
+        energy += p;
+        moment += (uint64_t)p * i;
+        if (i < 3)
+            early += p;
+        if (p > peak) {
+            peak = p;
+            ipeak = i;
+        }
+    }
+    if (energy == 0)
+        return false;
+    feature[RNG_NLOS_CIR_PEAK] = (int32_t)ipeak << 8;
+    feature[RNG_NLOS_CIR_EARLY] = (int32_t)(((early * 100) << 8) / energy);
+    feature[RNG_NLOS_CIR_DELAY] = (int32_t)((moment << 8) / energy);
+    return true;
+}
+
+/**
+ * API to run a model on the features of a frame.
+ *
+ * @param model    Pointer to rng_nlos_model_t.
+ * @param feature  Features, Q8.
+ * @return Probability of line of sight, Q15
+ */
+uint16_t
+rng_nlos_classify(const rng_nlos_model_t * model, const int32_t * feature)
+{
+    int64_t acc = (int64_t)model->bias << 12;
+
+    for (uint8_t i = 0; i < model->nfeatures; i++)
+        acc += (int32_t)model->weight[i] * feature[i];
+
+    int32_t z = (int32_t)(acc >> 12);
+    uint32_t az = z < 0 ? -z : z;
+    uint32_t p;
+    if (az >= 32 << 6) {
+        p = RNG_NLOS_ONE;
+    } else {
+        uint32_t idx = az >> 6, frac = az & 63;
+        p = g_sigmoid_tab[idx] + (((g_sigmoid_tab[idx + 1] - g_sigmoid_tab[idx]) * frac) >> 6);
+    }
+    return z < 0 ? RNG_NLOS_ONE - p : p;
+}
+
+/**
+ * API to replace the models, e.g. with ones trained on recordings from the deployment.
+ *
+ * @param diag  Model on the rxdiag features, NULL for the default.
+ * @param cir   Model on the rxdiag and CIR features, NULL for the default.
+ * @return void
+ */
+void
+rng_nlos_set_models(const rng_nlos_model_t * diag, const rng_nlos_model_t * cir)
+{
+    assert(diag == NULL || diag->nfeatures == RNG_NLOS_NDIAG);
+    assert(cir == NULL || cir->nfeatures == RNG_NLOS_NFEATURES);
+    g_rng_nlos_diag = diag ? diag : &g_rng_nlos_diag_default;
+    g_rng_nlos_cir = cir ? cir : &g_rng_nlos_cir_default;
+}
+
+/**
+ * API to classify the last frame received, on its CIR too when cir_enable read it.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @return Probability of line of sight, Q15; RNG_NLOS_ONE without rxdiag_enable
+ */
+uint16_t
+rng_nlos_los(dw1000_dev_instance_t * inst)
+{
+    int32_t feature[RNG_NLOS_NFEATURES];
+
+    if (!inst->config.rxdiag_enable)
+        return RNG_NLOS_ONE;
+    rng_nlos_diag_features(&inst->rxdiag, inst->attrib.nsync, feature);
+#if MYNEWT_VAL(CIR_ENABLED)
+    cir_instance_t * cir = inst->cir;
+    if (cir && cir->status.valid) {
+        int16_t iq[2 * MYNEWT_VAL(CIR_SIZE)];
+        memcpy(iq, cir->cir.array, sizeof(iq));     /* cir_t is packed behind the errata octet */
+        if (rng_nlos_cir_features(iq, MYNEWT_VAL(CIR_SIZE), feature))
+            return rng_nlos_classify(g_rng_nlos_cir, feature);
+    }
+#endif
+    return rng_nlos_classify(g_rng_nlos_diag, feature);
+}
+
+/**
+ * API to print the diagnostics of the last frame received as a line of the recordings bench_rng_nlos
+ * trains on: label,prf,nsync,fp_amp,fp_amp2,fp_amp3,rx_std,cir_pwr,pacc_cnt then, when the accumulator
+ * was read, the real,imag pairs of the CIR window.
+ *
+ * @param inst   Pointer to dw1000_dev_instance_t.
+ * @param los    Label, 1 if the frame came over the line of sight, 0 if not.
+ * @param print  printf like output function, console_printf on target.
+ * @return void
+ */
+void
+rng_nlos_record(dw1000_dev_instance_t * inst, uint8_t los, int (* print)(const char *, ...))
+{
+    dw1000_dev_rxdiag_t * diag = &inst->rxdiag;
+
+    print("%u,%u,%u,%u,%u,%u,%u,%u,%u", los, inst->config.prf, inst->attrib.nsync, diag->fp_amp, diag->fp_amp2,
+          diag->fp_amp3, diag->rx_std, diag->cir_pwr, diag->pacc_cnt);
+#if MYNEWT_VAL(CIR_ENABLED)
+    cir_instance_t * cir = inst->cir;
+    if (cir && cir->status.valid) {
+        int16_t iq[2 * MYNEWT_VAL(CIR_SIZE)];
+        memcpy(iq, cir->cir.array, sizeof(iq));
+        for (uint16_t i = 0; i < 2 * MYNEWT_VAL(CIR_SIZE); i++)
+            print(",%d", iq[i]);
+    }
+#endif
+    print("\n");
+}
+
+/**
+ * API to widen the range variance of the last frame received by its likelihood of being NLOS, up to
+ * RNG_NLOS_VARIANCE_GAIN times for a certain NLOS frame.
+ *
+ * @param inst      Pointer to dw1000_dev_instance_t.
+ * @param variance  Range variance of a line of sight frame.
+ * @return Range variance
+ */
+float
+rng_nlos_range_variance(dw1000_dev_instance_t * inst, float variance)
+{
+    float nlos = (float)(RNG_NLOS_ONE - rng_nlos_los(inst)) / RNG_NLOS_ONE;
+    return variance * (1.0f + (MYNEWT_VAL(RNG_NLOS_VARIANCE_GAIN) - 1) * nlos);
+}
@@ -114,6 +114,8 @@ typedef struct _dw1000_rtdoa_instance_t{
     uint16_t nframes;
     struct os_sem sem;                          //!< Structure of semaphores
     dw1000_mac_interface_t cbs;                 //!< MAC Layer Callbacks
+    dw1000_tx_tmpl_t req_tmpl;                  //!< Resident request frame
+    dw1000_tx_tmpl_t resp_tmpl;                 //!< Resident response frame
     dw1000_rng_status_t status;
     dw1000_rng_control_t control;
     dw1000_rng_config_t config;
@@ -33,6 +33,7 @@
 #include <dw1000/dw1000_mac.h>
 #include <dw1000/dw1000_phy.h>
 #include <dw1000/dw1000_ftypes.h>
+#include <dw1000/dw1000_time.h>
 #include <rtdoa/rtdoa.h>
 #include <rng/rng.h>
 #include <wcs/wcs.h>
@@ -73,6 +74,8 @@ dw1000_rtdoa_init(dw1000_dev_instance_t * inst, dw1000_rng_config_t * config, ui
     }
     os_error_t err = os_sem_init(&rtdoa->sem, 0x1); 
     assert(err == OS_OK);
+    dw1000_tx_tmpl_alloc(inst, &rtdoa->req_tmpl, sizeof(rtdoa_request_frame_t));
+    dw1000_tx_tmpl_alloc(inst, &rtdoa->resp_tmpl, sizeof(rtdoa_response_frame_t));
 
     rtdoa->dev_inst = inst;
     rtdoa->nframes = nframes;
@@ -193,8 +196,8 @@ rtdoa_local_to_master64(dw1000_dev_instance_t * inst, uint64_t dtu_time, rtdoa_f
     dw1000_ccp_instance_t *ccp = (dw1000_ccp_instance_t*)dw1000_mac_find_cb_inst_ptr(inst, DW1000_CCP);
     wcs_instance_t * wcs = ccp->wcs;
 
-    double delta = ((dtu_time & 0x0FFFFFFFFFFUL) - (req_frame->rx_timestamp&0x0FFFFFFFFFFUL)) & 0x0FFFFFFFFFFUL;
-    uint64_t req_lo40 = (req_frame->tx_timestamp & 0x0FFFFFFFFFFUL);
+    double delta = dw1000_dtu_sub(dtu_time, req_frame->rx_timestamp);
+    uint64_t req_lo40 = dw1000_dtu_wrap(req_frame->tx_timestamp);
     if (wcs->status.valid) {
         /* No need to take special care of 40bit overflow as the timescale forward returns
          * a double value that can exceed the 40bit. */
@@ -202,7 +205,7 @@ rtdoa_local_to_master64(dw1000_dev_instance_t * inst, uint64_t dtu_time, rtdoa_f
     } else {
         req_lo40 += delta;
     }
-    return (req_frame->tx_timestamp & 0xFFFFFF0000000000UL) + req_lo40;
+    return (req_frame->tx_timestamp & ~DW1000_DTU_MASK) + req_lo40;
 }
 
 /**
@@ -221,7 +224,7 @@ dw1000_rtdoa_listen(dw1000_rtdoa_instance_t * rtdoa, dw1000_dev_modes_t mode, ui
     /* Setup start time and overall timeout */
     dw1000_set_delay_start(rtdoa->dev_inst, delay);
     dw1000_set_rx_timeout(rtdoa->dev_inst, timeout);
-    rtdoa->timeout = (delay + (((uint64_t)timeout)<<16))&0xFFFFFFFFFFUL;
+    rtdoa->timeout = dw1000_dtu_add(delay, dw1000_uus_to_dtu(timeout));
 
     RTDOA_STATS_INC(rtdoa_listen);
     if(dw1000_start_rx(rtdoa->dev_inst).start_rx_error){
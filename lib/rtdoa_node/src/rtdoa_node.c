@@ -65,6 +65,7 @@ static dw1000_mac_interface_t g_cbs = {
     .inst_ptr = 0,
     .tx_complete_cb = tx_complete_cb,
     .rx_complete_cb = rx_complete_cb,
+    .rx_fctrl = FCNTL_IEEE_RANGE_16,
     .rx_timeout_cb = rx_timeout_cb,
     .rx_error_cb = rx_error_cb,
     .reset_cb = reset_cb
@@ -138,8 +139,7 @@ dw1000_rtdoa_request(struct _dw1000_rtdoa_instance_t *rtdoa, uint64_t delay)
     /* Also set the local rx_timestamp to allow us to also transmit in the next part */
     rtdoa->req_frame->rx_timestamp = frame->tx_timestamp;
 
-    dw1000_write_tx(inst, frame->array, 0, sizeof(rtdoa_request_frame_t));
-    dw1000_write_tx_fctrl(inst, sizeof(rtdoa_request_frame_t), 0);
+    dw1000_tx_tmpl_write(inst, &rtdoa->req_tmpl, frame->array, sizeof(rtdoa_request_frame_t));
     dw1000_set_wait4resp(inst, false);
 
     if (dw1000_start_tx(inst).start_tx_error) {
@@ -191,8 +191,7 @@ tx_rtdoa_response(dw1000_rtdoa_instance_t * rtdoa)
                                                   inst->tx_antenna_delay,
                                                   rtdoa->req_frame);
 
-    dw1000_write_tx(inst, frame->array, 0, sizeof(rtdoa_response_frame_t));
-    dw1000_write_tx_fctrl(inst, sizeof(rtdoa_response_frame_t), 0);
+    dw1000_tx_tmpl_write(inst, &rtdoa->resp_tmpl, frame->array, sizeof(rtdoa_response_frame_t));
     dw1000_set_wait4resp(inst, false);
 
     if (dw1000_start_tx(inst).start_tx_error) {
@@ -322,9 +321,6 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
     dw1000_ccp_instance_t *ccp = rtdoa->ccp;
     wcs_instance_t * wcs = ccp->wcs;
 
-    if(inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     if(os_sem_get_count(&rtdoa->sem) == 1){ 
         // unsolicited inbound
         RTDOA_STATS_INC(rx_unsolicited);
@@ -332,14 +328,12 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
     }
 
     //dw1000_rng_config_t * config = &rtdoa->config;
-    rtdoa_request_frame_t * _frame = (rtdoa_request_frame_t * )inst->rxbuf;
-
-    if (_frame->dst_address != inst->my_short_address && _frame->dst_address != BROADCAST_ADDRESS)
+    if (inst->frame_desc.dst_address != inst->my_short_address && inst->frame_desc.dst_address != BROADCAST_ADDRESS)
         return true;
    
     RTDOA_STATS_INC(rx_complete);
 
-    switch(_frame->code){
+    switch(inst->frame_desc.code){
         case DWT_RTDOA_REQUEST:
             {
                 // This code executes on the device that is responding to a request
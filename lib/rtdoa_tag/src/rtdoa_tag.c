@@ -34,6 +34,7 @@
 #include <dw1000/dw1000_mac.h>
 #include <dw1000/dw1000_phy.h>
 #include <dw1000/dw1000_ftypes.h>
+#include <dw1000/dw1000_time.h>
 #include <ccp/ccp.h>
 #include <rtdoa/rtdoa.h>
 #include <rtdoa_tag/rtdoa_tag.h>
@@ -62,6 +63,7 @@ static bool reset_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static dw1000_mac_interface_t g_cbs = {
     .id = DW1000_RTDOA,
     .rx_complete_cb = rx_complete_cb,
+    .rx_fctrl = FCNTL_IEEE_RANGE_16,
     .rx_timeout_cb = rx_timeout_cb,
     .rx_error_cb = rx_error_cb,
     .reset_cb = reset_cb
@@ -187,25 +189,20 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
     dw1000_ccp_instance_t *ccp = rtdoa->ccp;
     wcs_instance_t * wcs = ccp->wcs;
 
-    if(inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     if(os_sem_get_count(&rtdoa->sem) == 1){ 
         // unsolicited inbound
         RTDOA_STATS_INC(rx_unsolicited);
         return false;
     }
 
-    rtdoa_request_frame_t * _frame = (rtdoa_request_frame_t * )inst->rxbuf;
-
-    if (_frame->dst_address != inst->my_short_address &&
-        _frame->dst_address != BROADCAST_ADDRESS) {
+    if (inst->frame_desc.dst_address != inst->my_short_address &&
+        inst->frame_desc.dst_address != BROADCAST_ADDRESS) {
         return true;
     }
    
     RTDOA_STATS_INC(rx_complete);
 
-    switch(_frame->code){
+    switch(inst->frame_desc.code){
         case DWT_RTDOA_REQUEST:
         {
             // The initial packet in the rtdoa sequence either from the master or
@@ -228,15 +225,15 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
             if (frame->rpt_count != 0) {
                 RTDOA_STATS_INC(rx_relayed);
                 repeat_dly = frame->rpt_count*rtdoa->config.tx_holdoff_delay;
-                frame->rx_timestamp -= (repeat_dly << 16)*(1.0l - wcs->skew);
+                frame->rx_timestamp -= dw1000_uus_to_dtu(repeat_dly)*(1.0l - wcs->skew);
             }
 
             /* A good rtdoa_req packet has been received, stop the receiver */
             dw1000_stop_rx(inst);
             /* Adjust timeout and delayed start to match when the responses will arrive */
             uint64_t dx_time = inst->rxtimestamp - repeat_dly;
-            dx_time += (rtdoa_usecs_to_response(inst, (rtdoa_request_frame_t*)rtdoa->req_frame, 0, &rtdoa->config,
-                            dw1000_phy_frame_duration(&inst->attrib, sizeof(rtdoa_response_frame_t))) << 16);
+            dx_time += dw1000_uus_to_dtu(rtdoa_usecs_to_response(inst, (rtdoa_request_frame_t*)rtdoa->req_frame, 0, &rtdoa->config,
+                            dw1000_phy_frame_duration(&inst->attrib, sizeof(rtdoa_response_frame_t))));
 
             /* Subtract the preamble time */
             dx_time -= dw1000_phy_SHR_duration(&inst->attrib);
@@ -247,7 +244,7 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
             }
 
             /* Set new timeout */
-            new_timeout = ((int64_t)rtdoa->timeout - (int64_t)inst->rxtimestamp) >> 16;
+            new_timeout = dw1000_dtu_diff(rtdoa->timeout, inst->rxtimestamp) >> DW1000_DTU_UUS_SHIFT;
             if (new_timeout < 1) new_timeout = 1;
             dw1000_set_rx_timeout(inst, (uint16_t)new_timeout);
             /* Early return as we don't need to adjust timeout again */
@@ -274,7 +271,7 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
     }
 
     /* Adjust existing timeout instead of resetting it (faster) */
-    new_timeout = ((int64_t)rtdoa->timeout - (int64_t)inst->rxtimestamp) >> 16;
+    new_timeout = dw1000_dtu_diff(rtdoa->timeout, inst->rxtimestamp) >> DW1000_DTU_UUS_SHIFT;
     if (new_timeout < 1) new_timeout = 1;
     dw1000_write_reg(inst, RX_FWTO_ID, RX_FWTO_OFFSET, (uint16_t)new_timeout, sizeof(uint16_t));
     return true;
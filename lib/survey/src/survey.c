@@ -155,7 +155,8 @@ survey_init(struct _dw1000_dev_instance_t * inst, uint16_t nnodes, uint16_t nfra
         .rx_complete_cb = rx_complete_cb,
         .tx_complete_cb = tx_complete_cb,
         .rx_timeout_cb = rx_timeout_cb,
-        .reset_cb = reset_cb
+        .reset_cb = reset_cb,
+        .rx_fctrl = FCNTL_IEEE_RANGE_16
     };
 
 #if MYNEWT_VAL(SURVEY_VERBOSE)
@@ -446,9 +447,6 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
 {   
     survey_instance_t * survey = (survey_instance_t *)cbs->inst_ptr;
 
-    if(inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     if(dpl_sem_get_count(&survey->sem) == 1){ // unsolicited inbound
         STATS_INC(survey->stat, rx_unsolicited);
         return false;
@@ -459,12 +457,12 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
 
     survey_broadcast_frame_t * frame = ((survey_broadcast_frame_t * ) inst->rxbuf);
 
-    if(frame->dst_address != 0xffff)
+    if(inst->frame_desc.dst_address != 0xffff)
         return false;
     if(survey->ccp->seq_num % survey->nnodes == 0)
         survey->idx++;  // advance the nrngs idx at begining of sequence.
 
-    switch(frame->code) {
+    switch(inst->frame_desc.code) {
         case DWT_SURVEY_BROADCAST:
             {   
                 if (frame->cell_id != inst->cell_id)
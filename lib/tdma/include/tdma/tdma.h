@@ -52,9 +52,15 @@ STATS_SECT_START(tdma_stat_section)
     STATS_SECT_ENTRY(superframe_cnt)
     STATS_SECT_ENTRY(rx_complete)
     STATS_SECT_ENTRY(tx_complete)
+    STATS_SECT_ENTRY(slot_arm_cnt)
+    STATS_SECT_ENTRY(slot_late_cnt)
+    STATS_SECT_ENTRY(superframe_sched_ticks)
+    STATS_SECT_ENTRY(holdover_cnt)
 STATS_SECT_END
 #endif
 
+#define TDMA_NO_SLOT (0xFFFF)                  //!< End of the occupied slot chain
+
 //! Structure of TDMA
 typedef struct _tdma_status_t{
     uint16_t selfmalloc:1;            //!< Internal flag for memory garbage collection
@@ -65,12 +71,20 @@ typedef struct _tdma_status_t{
 //! Structure of tdma_slot
 typedef struct _tdma_slot_t{
     struct _tdma_instance_t * parent;  //!< Pointer to _tdma_instance_ti
-    struct hal_timer timer;            //!< Timer
     struct dpl_event event;            //!< Sturcture of event
     uint16_t idx;                      //!< Slot number
+    uint16_t next;                     //!< Next occupied slot, TDMA_NO_SLOT for the last one
     void * arg;                        //!< Optional argument
 }tdma_slot_t; 
 
+//! Scheduling cost of the superframe start
+typedef struct _tdma_sched_metrics_t{
+    uint32_t superframe_ticks;         //!< cputime ticks spent starting the last superframe
+    uint32_t superframe_ticks_max;     //!< Worst superframe start
+    uint16_t slots_armed;              //!< Slot timer arms in the last superframe
+    uint16_t slots_late;               //!< Slots in the last superframe whose start had passed when armed
+}tdma_sched_metrics_t;
+
 //! Structure of tdma instance
 typedef struct _tdma_instance_t{
     struct _dw1000_dev_instance_t * dev_inst; //!< Pointer to _dw1000_dev_instance_t
@@ -86,6 +100,16 @@ typedef struct _tdma_instance_t{
     uint16_t idx;                            //!< Slot number
     uint16_t nslots;                         //!< Number of slots 
     uint32_t os_epoch;                       //!< Epoch timestamp
+    struct hal_timer timer;                  //!< Timer of the next occupied slot
+    uint16_t first_slot;                     //!< Head of the occupied slot chain
+    uint16_t armed_slot;                     //!< Slot the timer is armed for, TDMA_NO_SLOT when idle
+    float slot_usecs;                        //!< Slot period in usecs for the current superframe
+    uint32_t slot_offset;                    //!< Preamble, latency and guard allowance in usecs
+    uint16_t guard_uus;                      //!< Clock uncertainty at the end of the superframe in dwt usecs, rx slots open this early and need twice it on their timeout
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+    uint32_t holdover_missed;                //!< Beacons the ccp holdover had predicted at the last superframe
+#endif
+    tdma_sched_metrics_t metrics;            //!< Scheduling cost
     struct dpl_event superframe_event;        //!< Structure of superframe_event
 #ifdef TDMA_TASKS_ENABLE
     struct dpl_eventq eventq;                //!< Structure of events
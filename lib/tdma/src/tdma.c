@@ -39,6 +39,7 @@
 
 #include <dw1000/dw1000_dev.h>
 #include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_time.h>
 #include <tdma/tdma.h>
 
 #if MYNEWT_VAL(CCP_ENABLED)
@@ -61,11 +62,17 @@ STATS_NAME_START(tdma_stat_section)
     STATS_NAME(tdma_stat_section, superframe_cnt)
     STATS_NAME(tdma_stat_section, rx_complete)
     STATS_NAME(tdma_stat_section, tx_complete)
+    STATS_NAME(tdma_stat_section, slot_arm_cnt)
+    STATS_NAME(tdma_stat_section, slot_late_cnt)
+    STATS_NAME(tdma_stat_section, superframe_sched_ticks)
+    STATS_NAME(tdma_stat_section, holdover_cnt)
 STATS_NAME_END(tdma_stat_section)
 
 #define TDMA_STATS_INC(__X) STATS_INC(tdma->stat, __X)
+#define TDMA_STATS_INCN(__X, __Y) STATS_INCN(tdma->stat, __X, __Y)
 #else
 #define TDMA_STATS_INC(__X) {}
+#define TDMA_STATS_INCN(__X, __Y) {}
 #endif
 
 //#define DIAGMSG(s,u) printf(s,u)
@@ -75,8 +82,12 @@ STATS_NAME_END(tdma_stat_section)
 
 static void tdma_superframe_event_cb(struct dpl_event * ev);
 static void slot_timer_cb(void * arg);
+static void tdma_arm_slot(struct _tdma_instance_t * tdma, uint16_t idx);
 static bool rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t *);
 static bool tx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t *);
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+static bool rx_timeout_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t *);
+#endif
 
 #ifdef TDMA_TASKS_ENABLE
 static void tdma_tasks_init(struct _tdma_instance_t * inst);
@@ -117,7 +128,11 @@ tdma_init(struct _dw1000_dev_instance_t * inst, uint16_t nslots)
         .id = DW1000_TDMA,
         .inst_ptr = (void*)tdma,
         .tx_complete_cb = tx_complete_cb,
-        .rx_complete_cb = rx_complete_cb
+        .rx_complete_cb = rx_complete_cb,
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+        .rx_timeout_cb = rx_timeout_cb,
+#endif
+        .rx_fctrl = FCNTL_IEEE_BLINK_CCP_64
     };
     dw1000_mac_append_interface(inst, &tdma->cbs);
 
@@ -144,6 +159,11 @@ tdma_init(struct _dw1000_dev_instance_t * inst, uint16_t nslots)
 #endif
 
     dpl_event_init(&tdma->superframe_event, tdma_superframe_event_cb, (void *) tdma);
+    if (tdma->status.initialized == false) {
+        os_cputime_timer_init(&tdma->timer, slot_timer_cb, (void *) tdma);
+        tdma->first_slot = TDMA_NO_SLOT;
+        tdma->armed_slot = TDMA_NO_SLOT;
+    }
     tdma->status.initialized = true;
 
     tdma->os_epoch = os_cputime_get32();
@@ -330,6 +350,120 @@ tx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
     return false;
 }
 
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+/**
+ * @fn rx_timeout_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+ * @brief Interrupt context tdma_rx_timeout callback. A missed beacon the ccp holdover has predicted
+ * starts the superframe on the predicted epoch. Registered after ccp, which has advanced it by now.
+ *
+ * @param inst  Pointer to dw1000_dev_instance_t.
+ * @param cbs   Pointer to dw1000_mac_interface_t.
+ *
+ * @return bool based on the totality of the handling which is false this implementation.
+ */
+static bool
+rx_timeout_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    tdma_instance_t * tdma = (tdma_instance_t*)cbs->inst_ptr;
+    dw1000_ccp_instance_t *ccp = tdma->ccp;
+
+    if (ccp->status.valid && ccp->status.holdover && tdma->status.initialized
+        && tdma->holdover_missed != ccp->holdover.stats.missed) {
+        tdma->holdover_missed = ccp->holdover.stats.missed;
+        TDMA_STATS_INC(holdover_cnt);
+        tdma->os_epoch = ccp->os_epoch;
+#ifdef TDMA_TASKS_ENABLE
+        dpl_eventq_put(&tdma->eventq, &tdma->superframe_event);
+#else
+        dpl_eventq_put(&inst->eventq, &tdma->superframe_event);
+#endif
+    }
+    return false;   // TDMA is an observer and should not return true
+}
+#endif
+
+/**
+ * @fn tdma_link_slot(struct _tdma_instance_t * inst, uint16_t idx)
+ * @brief Insert a newly assigned slot into the chain of occupied slots, which is kept in slot order.
+ *
+ * @param inst   Pointer to _tdma_instance_t.
+ * @param idx    Slot number.
+ *
+ * @return void
+ */
+static void
+tdma_link_slot(struct _tdma_instance_t * inst, uint16_t idx)
+{
+    uint16_t prev = idx;
+
+    while (prev-- > 0 && inst->slot[prev] == NULL);
+
+    uint32_t sr = dpl_hw_enter_critical();
+    if (prev == TDMA_NO_SLOT) {
+        inst->slot[idx]->next = inst->first_slot;
+        inst->first_slot = idx;
+    } else {
+        inst->slot[idx]->next = inst->slot[prev]->next;
+        inst->slot[prev]->next = idx;
+    }
+    dpl_hw_exit_critical(sr);
+}
+
+/**
+ * @fn tdma_unlink_slot(struct _tdma_instance_t * inst, uint16_t idx)
+ * @brief Remove a slot from the chain of occupied slots. A timer armed for the slot is moved on to the next one.
+ *
+ * @param inst   Pointer to _tdma_instance_t.
+ * @param idx    Slot number.
+ *
+ * @return void
+ */
+static void
+tdma_unlink_slot(struct _tdma_instance_t * inst, uint16_t idx)
+{
+    uint16_t prev = idx;
+
+    while (prev-- > 0 && inst->slot[prev] == NULL);
+
+    uint32_t sr = dpl_hw_enter_critical();
+    uint16_t next = inst->slot[idx]->next;
+    if (prev == TDMA_NO_SLOT)
+        inst->first_slot = next;
+    else
+        inst->slot[prev]->next = next;
+    if (inst->armed_slot == idx) {
+        os_cputime_timer_stop(&inst->timer);
+        tdma_arm_slot(inst, next);
+    }
+    dpl_hw_exit_critical(sr);
+}
+
+/**
+ * @fn tdma_arm_slot(struct _tdma_instance_t * tdma, uint16_t idx)
+ * @brief Arm the slot timer for the start of slot idx in the current superframe. Called with interrupts disabled.
+ *
+ * @param tdma   Pointer to _tdma_instance_t.
+ * @param idx    Slot number, TDMA_NO_SLOT leaves the timer idle until the next superframe.
+ *
+ * @return void
+ */
+static void
+tdma_arm_slot(struct _tdma_instance_t * tdma, uint16_t idx)
+{
+    tdma->armed_slot = idx;
+    if (idx == TDMA_NO_SLOT)
+        return;
+
+    uint32_t tick = tdma->os_epoch + os_cputime_usecs_to_ticks((uint32_t) (idx * tdma->slot_usecs) - tdma->slot_offset);
+    tdma->metrics.slots_armed++;
+    TDMA_STATS_INC(slot_arm_cnt);
+    if ((int32_t)(tick - os_cputime_get32()) <= 0) {
+        tdma->metrics.slots_late++;
+        TDMA_STATS_INC(slot_late_cnt);
+    }
+    hal_timer_start_at(&tdma->timer, tick);
+}
+
 /**
  * @fn tdma_assign_slot(struct _tdma_instance_t * inst, void (* call_back )(struct os_event *), uint16_t idx, void * arg)
  * @brief API to intialise slot instance for the slot.Also initialise a timer and assigns callback for each slot.
@@ -353,8 +487,11 @@ tdma_assign_slot(struct _tdma_instance_t * inst, void (* call_back )(struct dpl_
         inst->slot[idx] = (tdma_slot_t  *) malloc(sizeof(struct _tdma_slot_t));
         assert(inst->slot[idx]);
         memset(inst->slot[idx], 0, sizeof(struct _tdma_slot_t));
+        tdma_link_slot(inst, idx);
     }else{
+        uint16_t next = inst->slot[idx]->next;
         memset(inst->slot[idx], 0, sizeof(struct _tdma_slot_t));
+        inst->slot[idx]->next = next;
     }
 
     inst->slot[idx]->idx = idx;
@@ -362,7 +499,6 @@ tdma_assign_slot(struct _tdma_instance_t * inst, void (* call_back )(struct dpl_
     inst->slot[idx]->arg = arg;
 
     dpl_event_init(&inst->slot[idx]->event, call_back, (void *) inst->slot[idx]);
-    os_cputime_timer_init(&inst->slot[idx]->timer, slot_timer_cb, (void *) inst->slot[idx]);
 }
 
 /**
@@ -379,7 +515,7 @@ tdma_release_slot(struct _tdma_instance_t * inst, uint16_t idx)
 {
     assert(idx < inst->nslots);
     if (inst->slot[idx]) {
-        os_cputime_timer_stop(&inst->slot[idx]->timer);
+        tdma_unlink_slot(inst, idx);
         free(inst->slot[idx]);
         inst->slot[idx] =  NULL;
     }
@@ -404,32 +540,39 @@ tdma_superframe_event_cb(struct dpl_event * ev){
     tdma_instance_t * tdma = (tdma_instance_t *) dpl_event_get_arg(ev);
     struct _dw1000_dev_instance_t * inst = tdma->dev_inst;
     dw1000_ccp_instance_t * ccp = tdma->ccp;
+    uint32_t start = os_cputime_get32();
     
     TDMA_STATS_INC(superframe_cnt);
 
-    for (uint16_t i = 0; i < tdma->nslots; i++) {
-        if (tdma->slot[i]){
-            os_cputime_timer_stop(&tdma->slot[i]->timer);
-        }
-    }
-    for (uint16_t i = 0; i < tdma->nslots; i++) {
-        if (tdma->slot[i]){
-            hal_timer_start_at(&tdma->slot[i]->timer, tdma->os_epoch
-                + os_cputime_usecs_to_ticks(
-                    (uint32_t) (i * dw1000_dwt_usecs_to_usecs(ccp->period/tdma->nslots))
-                    - (uint32_t)ceilf(dw1000_phy_SHR_duration(&inst->attrib)) 
-                    - MYNEWT_VAL(OS_LATENCY))
-            );
-        }
-    }
+    /* Only the first occupied slot is armed, each slot timer arms the next one */
+    uint32_t sr = dpl_hw_enter_critical();
+    os_cputime_timer_stop(&tdma->timer);
+    tdma->slot_usecs = dw1000_dwt_usecs_to_usecs(ccp->period/tdma->nslots);
+#if MYNEWT_VAL(CCP_HOLDOVER_ENABLED)
+    /* Slots late in a superframe carry the most uncertainty, all take that guard */
+    tdma->guard_uus = ccp->holdover.status.valid && !ccp->holdover.status.lost ?
+        ccp_holdover_guard(&ccp->holdover, dw1000_uus_to_dtu(ccp->period)) : 0;
+#endif
+    tdma->slot_offset = (uint32_t)ceilf(dw1000_phy_SHR_duration(&inst->attrib)) + MYNEWT_VAL(OS_LATENCY)
+                      + (uint32_t)ceilf(dw1000_dwt_usecs_to_usecs(tdma->guard_uus));
+    tdma->metrics.slots_armed = 0;
+    tdma->metrics.slots_late = 0;
+    tdma_arm_slot(tdma, tdma->first_slot);
+    dpl_hw_exit_critical(sr);
+
+    uint32_t cost = os_cputime_get32() - start;
+    tdma->metrics.superframe_ticks = cost;
+    if (cost > tdma->metrics.superframe_ticks_max)
+        tdma->metrics.superframe_ticks_max = cost;
+    TDMA_STATS_INCN(superframe_sched_ticks, cost);
 }
 
 /**
  * @fn slot_timer_cb(void * arg)
- * @brief API for each slot. This function then puts
- * the callback provided by the user in the tdma event queue.
+ * @brief Timer callback of the armed slot. Puts the callback provided by the user
+ * in the tdma event queue and arms the timer for the next occupied slot.
  *
- * @param arg    A void type argument.
+ * @param arg    Pointer to _tdma_instance_t.
  *
  * @return void
  */
@@ -438,12 +581,19 @@ slot_timer_cb(void * arg)
 {
     assert(arg);
 
-    tdma_slot_t * slot = (tdma_slot_t *) arg;
-    /* No point in continuing if this slot is NULL */
+    tdma_instance_t * tdma = (tdma_instance_t *) arg;
+    uint32_t sr = dpl_hw_enter_critical();
+    uint16_t idx = tdma->armed_slot;
+    tdma_slot_t * slot = (idx == TDMA_NO_SLOT) ? NULL : tdma->slot[idx];
+
+    /* No point in continuing if this slot has been released */
     if (slot == NULL) {
+        tdma->armed_slot = TDMA_NO_SLOT;
+        dpl_hw_exit_critical(sr);
         return;
     }
-    tdma_instance_t * tdma = slot->parent;
+    tdma_arm_slot(tdma, slot->next);
+    dpl_hw_exit_critical(sr);
 
     DIAGMSG("{\"utime\": %lu,\"msg\": \"slot_timer_cb\"}\n",os_cputime_ticks_to_usecs(os_cputime_get32()));
 
@@ -467,15 +617,18 @@ slot_timer_cb(void * arg)
 void
 tdma_stop(struct _tdma_instance_t * tdma)
 {
+    uint32_t sr = dpl_hw_enter_critical();
+    os_cputime_timer_stop(&tdma->timer);
+    tdma->armed_slot = TDMA_NO_SLOT;
+    dpl_hw_exit_critical(sr);
+
     for (uint16_t i = 0; i < tdma->nslots; i++) {
         if (tdma->slot[i]){
-            os_cputime_timer_stop(&tdma->slot[i]->timer);
             tdma_release_slot(tdma, i);
         }
     }
 }
 
-
 /**
  * Function for calculating the start of the slot for a tx operation
  *
@@ -491,10 +644,10 @@ tdma_tx_slot_start(struct _tdma_instance_t * tdma, float idx)
 
 #if MYNEWT_VAL(WCS_ENABLED)
     wcs_instance_t * wcs = ccp->wcs;
-    uint64_t dx_time = (ccp->local_epoch + (uint64_t) wcs_dtu_time_adjust(wcs, ((idx * ((uint64_t)ccp->period << 16))/tdma->nslots)));
+    uint64_t dx_time = dw1000_dtu_add(ccp->local_epoch, (uint64_t) wcs_dtu_time_adjust(wcs, ((idx * dw1000_uus_to_dtu(ccp->period))/tdma->nslots)));
     // uint64_t dx_time = (ccp->local_epoch + (uint64_t) roundf((1.0l + wcs->skew) * (double)((idx * (uint64_t)ccp->period * 65536)/tdma->nslots)));
 #else
-    uint64_t dx_time = (ccp->local_epoch + (uint64_t) ((idx * ((uint64_t)ccp->period << 16)/tdma->nslots)));
+    uint64_t dx_time = dw1000_dtu_add(ccp->local_epoch, (uint64_t) ((idx * dw1000_uus_to_dtu(ccp->period))/tdma->nslots));
 #endif
     return dx_time;
 }
@@ -502,7 +655,8 @@ tdma_tx_slot_start(struct _tdma_instance_t * tdma, float idx)
 /**
  * Function for calculating the start of the slot for a rx operation.
  * taking into account that the preamble needs to be sent before the
- * RMARKER, which marks the time of the frame, is sent.
+ * RMARKER, which marks the time of the frame, is sent, and opening
+ * guard_uus early while the clock is held over missed beacons.
  *
  * @param inst       Pointer to struct _dw1000_dev_instance_t
  * @param idx        Slot index
@@ -514,6 +668,7 @@ tdma_rx_slot_start(struct _tdma_instance_t * tdma, float idx)
 {
     uint64_t dx_time = tdma_tx_slot_start(tdma, idx);
     uint64_t rx_stable =  MYNEWT_VAL(TIME_TO_RX_STABLE);
-    dx_time = (dx_time - ((uint64_t)ceilf(dw1000_usecs_to_dwt_usecs(dw1000_phy_SHR_duration(&tdma->dev_inst->attrib) + rx_stable)) << 16));
+    dx_time = dw1000_dtu_add(dx_time, -(int64_t)dw1000_uus_to_dtu(ceilf(dw1000_usecs_to_dwt_usecs(dw1000_phy_SHR_duration(&tdma->dev_inst->attrib) + rx_stable))));
+    dx_time = dw1000_dtu_add(dx_time, -(int64_t)dw1000_uus_to_dtu(tdma->guard_uus));
     return dx_time;
 }
@@ -65,6 +65,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [0] = {
             .id = DW1000_RNG_DS,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_DS_TWR,
+            .rx_code_max = DWT_DS_TWR_FINAL,
             .reset_cb = reset_cb,
             .start_tx_error_cb = start_tx_error_cb
         },
@@ -72,6 +75,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [1] = {
             .id = DW1000_RNG_DS,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_DS_TWR,
+            .rx_code_max = DWT_DS_TWR_FINAL,
             .reset_cb = reset_cb,
             .start_tx_error_cb = start_tx_error_cb
         },
@@ -80,6 +86,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [2] = {
             .id = DW1000_RNG_DS,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_DS_TWR,
+            .rx_code_max = DWT_DS_TWR_FINAL,
             .reset_cb = reset_cb,
             .start_tx_error_cb = start_tx_error_cb
         }
@@ -217,9 +226,6 @@ reset_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static bool 
 rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
-    if (inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     dw1000_rng_instance_t * rng = (dw1000_rng_instance_t *)cbs->inst_ptr;
     assert(rng);
     if(dpl_sem_get_count(&rng->sem) == 1) {
@@ -227,7 +233,7 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
         return false;
     }
 
-    switch(rng->code){
+    switch(inst->frame_desc.code){
        case DWT_DS_TWR:
             {
                 // This code executes on the device that is responding to a original request
@@ -46,6 +46,9 @@
 #include <dw1000/dw1000_ftypes.h>
 #include <rng/rng.h>
 #include <dsp/polyval.h>
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+#include <rng/rng_nlos.h>
+#endif
 
 //#define DIAGMSG(s,u) printf(s,u)
 #ifndef DIAGMSG
@@ -61,6 +64,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [0] = {
             .id = DW1000_RNG_DS_EXT,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_DS_TWR_EXT,
+            .rx_code_max = DWT_DS_TWR_EXT_FINAL,
             .reset_cb = reset_cb,
             .final_cb = tx_final_cb,
             .start_tx_error_cb = start_tx_error_cb
@@ -69,6 +75,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [1] = {
             .id = DW1000_RNG_DS_EXT,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_DS_TWR_EXT,
+            .rx_code_max = DWT_DS_TWR_EXT_FINAL,
             .reset_cb = reset_cb,
             .final_cb = tx_final_cb,
             .start_tx_error_cb = start_tx_error_cb
@@ -78,6 +87,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [2] = {
             .id = DW1000_RNG_DS_EXT,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_DS_TWR_EXT,
+            .rx_code_max = DWT_DS_TWR_EXT_FINAL,
             .reset_cb = reset_cb,
             .final_cb = tx_final_cb,
             .start_tx_error_cb = start_tx_error_cb
@@ -198,7 +210,11 @@ tx_final_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 #else
     frame->spherical.range = dw1000_rng_tof_to_meters(dw1000_rng_twr_to_tof(rng,rng->idx));
 #endif
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+    frame->spherical_variance.range = rng_nlos_range_variance(inst, MYNEWT_VAL(RANGE_VARIANCE));
+#else
     frame->spherical_variance.range = MYNEWT_VAL(RANGE_VARIANCE);
+#endif
     frame->spherical_variance.azimuth = -1;
     frame->spherical_variance.zenith = -1;
     frame->utime = os_cputime_ticks_to_usecs(os_cputime_get32());
@@ -251,16 +267,13 @@ reset_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static bool 
 rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
-   if (inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     dw1000_rng_instance_t * rng = (dw1000_rng_instance_t *)cbs->inst_ptr;
     if(dpl_sem_get_count(&rng->sem) == 1){ 
         // unsolicited inbound
         return false;
     }
         
-    switch(rng->code){
+    switch(inst->frame_desc.code){
         case DWT_DS_TWR_EXT:
             {
                 // This code executes on the device that is responding to a original request
@@ -66,6 +66,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [0] = {
             .id = DW1000_RNG_SS,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR,
+            .rx_code_max = DWT_SS_TWR_FINAL,
             .start_tx_error_cb = start_tx_error_cb,
             .reset_cb = reset_cb
         },
@@ -73,6 +76,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [1] = {
             .id = DW1000_RNG_SS,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR,
+            .rx_code_max = DWT_SS_TWR_FINAL,
             .start_tx_error_cb = start_tx_error_cb,
             .reset_cb = reset_cb
         },
@@ -81,6 +87,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [2] = {
             .id = DW1000_RNG_SS,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR,
+            .rx_code_max = DWT_SS_TWR_FINAL,
             .start_tx_error_cb = start_tx_error_cb,
             .reset_cb = reset_cb
         }
@@ -218,9 +227,6 @@ reset_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static bool
 rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
-    if (inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     dw1000_rng_instance_t * rng = (dw1000_rng_instance_t *)cbs->inst_ptr;
     assert(rng);
     if(dpl_sem_get_count(&rng->sem) == 1) // unsolicited inbound
@@ -228,7 +234,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
 
     twr_frame_t * frame = rng->frames[(rng->idx)%rng->nframes]; // Frame already read within loader layers.
 
-    switch(rng->code){
+    switch(inst->frame_desc.code){
         case DWT_SS_TWR:
             {
                 // This code executes on the device that is responding to a request
@@ -46,6 +46,9 @@
 #include <dw1000/dw1000_ftypes.h>
 #include <rng/rng.h>
 #include <dsp/polyval.h>
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+#include <rng/rng_nlos.h>
+#endif
 
 #if MYNEWT_VAL(WCS_ENABLED)
 #include <wcs/wcs.h>
@@ -67,6 +70,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [0] = {
             .id = DW1000_RNG_SS_EXT,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR_EXT,
+            .rx_code_max = DWT_SS_TWR_EXT_FINAL,
             .start_tx_error_cb = start_tx_error_cb,
             .reset_cb = reset_cb,
             .final_cb = tx_final_cb
@@ -75,6 +81,9 @@ static dw1000_mac_interface_t g_cbs[] = {
         [1] = {
             .id = DW1000_RNG_SS_EXT,
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR_EXT,
+            .rx_code_max = DWT_SS_TWR_EXT_FINAL,
             .start_tx_error_cb = start_tx_error_cb,
             .reset_cb = reset_cb,
             .final_cb = tx_final_cb
@@ -83,6 +92,9 @@ static dw1000_mac_interface_t g_cbs[] = {
 #if MYNEWT_VAL(DW1000_DEVICE_2)
         [2] = {
             .rx_complete_cb = rx_complete_cb,
+            .rx_fctrl = FCNTL_IEEE_RANGE_16,
+            .rx_code_min = DWT_SS_TWR_EXT,
+            .rx_code_max = DWT_SS_TWR_EXT_FINAL,
             .start_tx_error_cb = start_tx_error_cb,
             .reset_cb = reset_cb,
             .final_cb = tx_final_cb
@@ -219,9 +231,6 @@ reset_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static bool
 rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
-    if (inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-
     dw1000_rng_instance_t * rng = (dw1000_rng_instance_t *)cbs->inst_ptr;
     assert(rng);
     if(dpl_sem_get_count(&rng->sem) == 1) // unsolicited inbound
@@ -229,7 +238,7 @@ rx_complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cb
 
     twr_frame_t * frame = rng->frames[(rng->idx)%rng->nframes]; // Frame already read within loader layers.
 
-    switch(rng->code){
+    switch(inst->frame_desc.code){
         case DWT_SS_TWR_EXT:
             {
                 // This code executes on the device that is responding to a request
@@ -336,7 +345,11 @@ tx_final_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t *cbs)
     frame->cartesian.y = MYNEWT_VAL(LOCAL_COORDINATE_Y);
     frame->cartesian.z = MYNEWT_VAL(LOCAL_COORDINATE_Z);
 
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+    frame->spherical_variance.range = rng_nlos_range_variance(inst, MYNEWT_VAL(RANGE_VARIANCE));
+#else
     frame->spherical_variance.range = MYNEWT_VAL(RANGE_VARIANCE);
+#endif
     frame->spherical_variance.azimuth = -1;
     frame->spherical_variance.zenith = -1;
     return true;
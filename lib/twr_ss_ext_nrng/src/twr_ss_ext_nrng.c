@@ -49,6 +49,9 @@
 #include <wcs/wcs.h>
 #endif
 #include <dsp/polyval.h>
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+#include <rng/rng_nlos.h>
+#endif
 #include <rng/slots.h>
 
 #define WCS_DTU MYNEWT_VAL(WCS_DTU)
@@ -308,7 +311,11 @@ tx_final_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t *cbs){
     frame->cartesian.y = MYNEWT_VAL(LOCAL_COORDINATE_Y);
     frame->cartesian.z = MYNEWT_VAL(LOCAL_COORDINATE_Z);
 
+#if MYNEWT_VAL(RNG_NLOS_ENABLED)
+    frame->spherical_variance.range = rng_nlos_range_variance(inst, MYNEWT_VAL(RANGE_VARIANCE));
+#else
     frame->spherical_variance.range = MYNEWT_VAL(RANGE_VARIANCE);
+#endif
     frame->spherical_variance.azimuth = -1;
     frame->spherical_variance.zenith = -1;
     return true;
@@ -43,6 +43,7 @@
 #include <dw1000/dw1000_mac.h>
 #include <dw1000/dw1000_phy.h>
 #include <dw1000/dw1000_ftypes.h>
+#include <dw1000/dw1000_time.h>
 #include <nrng/nrng.h>
 #if MYNEWT_VAL(WCS_ENABLED)
 #include <wcs/wcs.h>
@@ -65,6 +66,7 @@ static bool reset_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 static dw1000_mac_interface_t g_cbs = {
     .id = DW1000_NRNG_SS,
     .rx_complete_cb = rx_complete_cb,
+    .rx_fctrl = FCNTL_IEEE_RANGE_16,
     .rx_timeout_cb = rx_timeout_cb,
     .rx_error_cb = rx_error_cb,
     .reset_cb = reset_cb
@@ -206,9 +208,6 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
 {
     dw1000_nrng_instance_t * nrng = (dw1000_nrng_instance_t *)cbs->inst_ptr;
 
-    if(inst->fctrl != FCNTL_IEEE_RANGE_16)
-        return false;
-    
     if(dpl_sem_get_count(&nrng->sem) == 1){ 
         // unsolicited inbound
         NRNG_STATS_INC(rx_unsolicited);
@@ -218,12 +217,12 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
     dw1000_rng_config_t * config = dw1000_nrng_get_config(nrng, DWT_SS_TWR_NRNG);
     nrng_request_frame_t * _frame = (nrng_request_frame_t * )inst->rxbuf;
 
-    if (_frame->dst_address != inst->my_short_address && _frame->dst_address != BROADCAST_ADDRESS)
+    if (inst->frame_desc.dst_address != inst->my_short_address && inst->frame_desc.dst_address != BROADCAST_ADDRESS)
         return true;
    
     NRNG_STATS_INC(rx_complete);
 
-    switch(_frame->code){
+    switch(inst->frame_desc.code){
         case DWT_SS_TWR_NRNG:
             {
                 // This code executes on the device that is responding to a request
@@ -250,11 +249,11 @@ rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
                 memcpy(frame->array, inst->rxbuf, sizeof(nrng_request_frame_t));
 
                 uint64_t request_timestamp = inst->rxtimestamp;
-                uint64_t response_tx_delay = request_timestamp 
-                            + (((uint64_t)config->tx_holdoff_delay
+                uint64_t response_tx_delay = dw1000_dtu_dx_time(request_timestamp,
+                            dw1000_uus_to_dtu((uint64_t)config->tx_holdoff_delay
                             + (uint64_t)(slot_idx * ((uint64_t)config->tx_guard_delay
-                            + (uint64_t)(dw1000_usecs_to_dwt_usecs(dw1000_phy_frame_duration(&inst->attrib, sizeof(nrng_response_frame_t)))))))<< 16);
-                uint64_t response_timestamp = (response_tx_delay & 0xFFFFFFFE00UL) + inst->tx_antenna_delay;
+                            + (uint64_t)(dw1000_usecs_to_dwt_usecs(dw1000_phy_frame_duration(&inst->attrib, sizeof(nrng_response_frame_t))))))));
+                uint64_t response_timestamp = dw1000_dtu_tx_stamp(response_tx_delay, inst->tx_antenna_delay);
 
 #if MYNEWT_VAL(WCS_ENABLED)
                 dw1000_ccp_instance_t *ccp = (dw1000_ccp_instance_t*)dw1000_mac_find_cb_inst_ptr(inst, DW1000_CCP);
@@ -43,6 +43,22 @@ dpl_time_t dpl_callout_get_ticks(struct dpl_callout *co);
 dpl_time_t dpl_callout_remaining_ticks(struct dpl_callout *co, dpl_time_t time);
 void dpl_callout_set_arg(struct dpl_callout *co, void *arg);
 
+/*
+ * Callout service instrumentation, lateness is the time between the expiry
+ * tick and the event being posted (or the callback issued without a queue)
+ */
+#define DPL_CALLOUT_HIST_BINS   (16)
+
+struct dpl_callout_stats {
+    uint32_t fired;                     /* Expiries delivered */
+    uint32_t late_max_us;               /* Worst lateness */
+    uint64_t late_sum_us;               /* Sum of lateness, mean is late_sum_us / fired */
+    uint32_t late_hist[DPL_CALLOUT_HIST_BINS];  /* Bin n counts lateness below 2^n us, the last bin everything above */
+};
+
+void dpl_callout_stats(struct dpl_callout_stats *stats);
+void dpl_callout_stats_clear(void);
+
 #ifdef __cplusplus
 }
 #endif
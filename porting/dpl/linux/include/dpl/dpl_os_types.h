@@ -30,6 +30,7 @@
 
 #include "dpl/dpl_eventq.h"
 #include "dpl/dpl_time.h"
+#include "hal/hal_timer.h"
 
 #ifndef UINT32_MAX
 #define UINT32_MAX  0xFFFFFFFFUL
@@ -65,18 +66,22 @@ struct dpl_event {
     uint8_t             ev_queued;
     dpl_event_fn        *ev_cb;
     void                *ev_arg;
+    struct dpl_event    *ev_next;       /* Intrusive link, valid while ev_queued */
 };
 
 struct dpl_eventq {
-    void               *q;
+    struct dpl_event    *head;
+    struct dpl_event    *tail;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    uint16_t            waiters;        /* Tasks blocked in dpl_eventq_get */
+    uint8_t             inited;
 };
 
 struct dpl_callout {
     struct dpl_event    c_ev;
     struct dpl_eventq  *c_evq;
-    uint32_t    c_ticks;
-    timer_t     c_timer;
-    bool        c_active;
+    struct hal_timer    c_timer;        /* On the callout wheel, expiry in dpl ticks */
 };
 
 struct dpl_mutex {
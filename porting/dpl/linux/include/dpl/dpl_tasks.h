@@ -38,6 +38,8 @@ int dpl_task_init(struct dpl_task *t, const char *name, dpl_task_func_t func,
 int dpl_task_remove(struct dpl_task *t);
 uint8_t dpl_task_count(void);
 void dpl_task_yield(void);
+void *dpl_get_current_task_id(void);
+bool dpl_os_started(void);
 
 
 #ifdef __cplusplus
@@ -17,6 +17,11 @@
  * under the License.
  */
 
+/* The critical section nests, the recursive initializer is a GNU extension */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdint.h>
 #include <pthread.h>
 
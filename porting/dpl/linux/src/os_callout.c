@@ -18,24 +18,149 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
-#include <signal.h>
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
 
 #include "dpl/dpl_callout.h"
+#include "hal/hal_timer_wheel.h"
 
+/*
+ * All callouts share one timing wheel counted in dpl ticks (ms of
+ * CLOCK_MONOTONIC) and one service thread blocked on a timerfd, armed for
+ * the next tick the wheel needs servicing. Expired callouts are posted to
+ * their event queue from that thread, or called from it when they have none.
+ */
+#define NSECS_PER_TICK      (1000000ULL)
+#define CALLOUT_MAX_SLEEP   (1UL << 29)    /* Keeps the wheel cursor close to dpl_time_get() */
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;
+    pthread_t thread;
+    int fd;
+    uint32_t next;
+    uint8_t armed;
+    struct dpl_callout_stats stats;
+    struct hal_timer_wheel wheel;
+} s_callouts = {
+    .once = PTHREAD_ONCE_INIT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static uint64_t
+os_callout_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Monotonic time of a 32 bit tick */
+static uint64_t
+os_callout_tick_to_ns(uint32_t tick, uint64_t now_ns)
+{
+    uint64_t now = now_ns / NSECS_PER_TICK;
+    int64_t ticks = (int64_t)now + (int32_t)(tick - (uint32_t)now);
+
+    return (ticks < 0) ? 0 : (uint64_t)ticks * NSECS_PER_TICK;
+}
+
+/* Arm the timerfd for the wheel, called with the service lock held */
 static void
-os_callout_timer_cb(union sigval sv)
+os_callout_arm(void)
 {
-    struct dpl_callout *c = (struct dpl_callout *)sv.sival_ptr;
-    assert(c);
+    struct itimerspec its = {0};
+    uint32_t next;
+    int pending = hal_timer_wheel_next(&s_callouts.wheel, &next);
 
-    if (c->c_evq) {
-        dpl_eventq_put(c->c_evq, &c->c_ev);
-    } else {
-        c->c_ev.ev_cb(&c->c_ev);
+    if (pending && next - s_callouts.wheel.cursor > CALLOUT_MAX_SLEEP) {
+        next = s_callouts.wheel.cursor + CALLOUT_MAX_SLEEP;
+    }
+    if (pending == s_callouts.armed && (!pending || next == s_callouts.next)) {
+        return;
+    }
+    s_callouts.armed = pending;
+    s_callouts.next = next;
+    if (pending) {
+        uint64_t ns = os_callout_tick_to_ns(next, os_callout_now_ns());
+        its.it_value.tv_sec = ns / 1000000000ULL;
+        its.it_value.tv_nsec = ns % 1000000000ULL;
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+            its.it_value.tv_nsec = 1;       // All zero would disarm
+        }
+    }
+    timerfd_settime(s_callouts.fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void
+os_callout_record(uint64_t late_ns)
+{
+    struct dpl_callout_stats *st = &s_callouts.stats;
+    uint64_t late_us = late_ns / 1000;
+    int bin = 0;
+
+    while (bin < DPL_CALLOUT_HIST_BINS - 1 && late_us >= (1ULL << bin)) {
+        bin++;
+    }
+    st->fired++;
+    st->late_sum_us += late_us;
+    if (late_us > st->late_max_us) {
+        st->late_max_us = (late_us > UINT32_MAX) ? UINT32_MAX : late_us;
+    }
+    st->late_hist[bin]++;
+}
+
+static void *
+os_callout_task(void *arg)
+{
+    struct hal_timer *ht;
+    struct dpl_callout *c;
+    uint64_t expirations;
+    uint64_t now_ns;
+
+    while (1) {
+        if (read(s_callouts.fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+            assert(errno == EINTR);
+            continue;
+        }
+
+        pthread_mutex_lock(&s_callouts.lock);
+        s_callouts.armed = 0;
+        now_ns = os_callout_now_ns();
+        while ((ht = hal_timer_wheel_expire(&s_callouts.wheel, now_ns / NSECS_PER_TICK)) != NULL) {
+            c = (struct dpl_callout *)ht->cb_arg;
+            os_callout_record(now_ns - os_callout_tick_to_ns(ht->expiry, now_ns));
+            if (c->c_evq) {
+                dpl_eventq_put(c->c_evq, &c->c_ev);
+            } else {
+                /* The callback may reset or stop callouts */
+                pthread_mutex_unlock(&s_callouts.lock);
+                c->c_ev.ev_cb(&c->c_ev);
+                pthread_mutex_lock(&s_callouts.lock);
+            }
+            now_ns = os_callout_now_ns();
+        }
+        os_callout_arm();
+        pthread_mutex_unlock(&s_callouts.lock);
+    }
+    return NULL;
+}
+
+static void
+os_callout_service_init(void)
+{
+    hal_timer_wheel_init(&s_callouts.wheel, os_callout_now_ns() / NSECS_PER_TICK);
+    s_callouts.fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    assert(s_callouts.fd >= 0);
+    if (pthread_create(&s_callouts.thread, NULL, os_callout_task, NULL)) {
+        assert(0);
     }
 }
 
@@ -44,68 +169,63 @@ void dpl_callout_init(struct dpl_callout *c,
                           dpl_event_fn *ev_cb, 
                           void *ev_arg)
 {
-    struct sigevent         event;
+    pthread_once(&s_callouts.once, os_callout_service_init);
 
     /* Initialize the callout. */
     memset(c, 0, sizeof(*c));
     c->c_ev.ev_cb = ev_cb;
     c->c_ev.ev_arg = ev_arg;
     c->c_evq = evq;
-    c->c_active = false;
-
-    event.sigev_notify = SIGEV_THREAD;
-    event.sigev_value.sival_ptr = c;     // put callout obj in signal args
-    event.sigev_notify_function = os_callout_timer_cb;
-    event.sigev_notify_attributes = NULL;
-
-    timer_create(CLOCK_REALTIME, &event, &c->c_timer);
+    c->c_timer.bsp_timer = &s_callouts;
+    c->c_timer.cb_arg = c;
 }
 
 bool dpl_callout_is_active(struct dpl_callout *c)
 {
-    // TODO: seek native posix method to determine whether timer_t is active.
-    // TODO: fix bug where one-shot timer is still active after fired.
-    return c->c_active;
+    bool active;
+
+    pthread_mutex_lock(&s_callouts.lock);
+    active = hal_timer_wheel_queued(&c->c_timer);
+    pthread_mutex_unlock(&s_callouts.lock);
+    return active;
 }
 
 int dpl_callout_inited(struct dpl_callout *c)
 {
-    return (c->c_timer != NULL);
+    return (c->c_timer.bsp_timer != NULL);
 }
 
 dpl_error_t dpl_callout_reset(struct dpl_callout *c,
 				      dpl_time_t ticks)
 {
-    struct itimerspec its;
+    uint32_t now;
 
-    if (ticks < 0) {
+    if (!dpl_callout_inited(c)) {
         return DPL_EINVAL;
     }
-
-    if (ticks == 0) {
-        ticks = 1;
+    /* As in os_callout_reset, an expiry still sitting on the queue is dropped */
+    if (c->c_evq) {
+        dpl_eventq_remove(c->c_evq, &c->c_ev);
     }
 
-    c->c_ticks = dpl_time_get() + ticks;
-
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = 0;                     // one shot
-    its.it_value.tv_sec = (ticks / 1000);
-    its.it_value.tv_nsec = (ticks % 1000) * 1000000; // expiration
-    its.it_value.tv_nsec %= 1000000000;
-    c->c_active = true;
-    timer_settime(c->c_timer, 0, &its, NULL);
+    pthread_mutex_lock(&s_callouts.lock);
+    now = os_callout_now_ns() / NSECS_PER_TICK;
+    hal_timer_wheel_remove(&s_callouts.wheel, &c->c_timer);
+    if (s_callouts.wheel.count == 0) {
+        /* Idle wheel, catch the cursor up with the clock */
+        hal_timer_wheel_expire(&s_callouts.wheel, now);
+    }
+    c->c_timer.expiry = now + ticks;
+    hal_timer_wheel_insert(&s_callouts.wheel, &c->c_timer);
+    os_callout_arm();
+    pthread_mutex_unlock(&s_callouts.lock);
 
     return DPL_OK;
 }
 
 int dpl_callout_queued(struct dpl_callout *c)
 {
-    struct itimerspec its;
-    timer_gettime(c->c_timer, &its);
-
-    return ((its.it_value.tv_sec > 0) ||
-            (its.it_value.tv_nsec > 0));
+    return dpl_callout_is_active(c);
 }
 
 void dpl_callout_stop(struct dpl_callout *c)
@@ -114,19 +234,23 @@ void dpl_callout_stop(struct dpl_callout *c)
         return;
     }
 
-    struct itimerspec its;
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = 0;
-    its.it_value.tv_sec = 0;
-    its.it_value.tv_nsec = 0;
-    timer_settime(c->c_timer, 0, &its, NULL);
-    c->c_active = false;
+    pthread_mutex_lock(&s_callouts.lock);
+    if (hal_timer_wheel_queued(&c->c_timer)) {
+        hal_timer_wheel_remove(&s_callouts.wheel, &c->c_timer);
+        os_callout_arm();
+    }
+    pthread_mutex_unlock(&s_callouts.lock);
+
+    /* An expiry already posted is withdrawn as well */
+    if (c->c_evq) {
+        dpl_eventq_remove(c->c_evq, &c->c_ev);
+    }
 }
 
 dpl_time_t
 dpl_callout_get_ticks(struct dpl_callout *co)
 {
-    return co->c_ticks;
+    return co->c_timer.expiry;
 }
 
 void
@@ -139,19 +263,31 @@ uint32_t
 dpl_callout_remaining_ticks(struct dpl_callout *co,
                                dpl_time_t now)
 {
-    dpl_time_t rt;
-    uint32_t exp;
-
-    struct itimerspec its;
-    timer_gettime(co->c_timer, &its);
+    int32_t rt = (int32_t)(co->c_timer.expiry - now);
 
-    exp = its.it_value.tv_sec * 1000;
+    return (rt > 0) ? rt : 0;
+}
 
-    if (exp > now) {
-        rt = exp - now;
-    } else {
-        rt = 0;
-    }
+/**
+ * Read the callout service lateness statistics.
+ *
+ * @param stats  Copy of the statistics
+ */
+void
+dpl_callout_stats(struct dpl_callout_stats *stats)
+{
+    pthread_mutex_lock(&s_callouts.lock);
+    *stats = s_callouts.stats;
+    pthread_mutex_unlock(&s_callouts.lock);
+}
 
-    return rt;
+/**
+ * Clear the callout service lateness statistics.
+ */
+void
+dpl_callout_stats_clear(void)
+{
+    pthread_mutex_lock(&s_callouts.lock);
+    memset(&s_callouts.stats, 0, sizeof(s_callouts.stats));
+    pthread_mutex_unlock(&s_callouts.lock);
 }
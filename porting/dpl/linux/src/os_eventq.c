@@ -0,0 +1,216 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "dpl/dpl.h"
+
+/*
+ * Events are chained through ev_next, so queueing never allocates. Consumers
+ * block on a condition variable and are only signalled when one is waiting.
+ */
+
+static struct dpl_eventq dflt_evq = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .inited = 1,
+};
+
+struct dpl_eventq *
+dpl_eventq_dflt_get(void)
+{
+    return &dflt_evq;
+}
+
+void
+dpl_eventq_init(struct dpl_eventq *evq)
+{
+    evq->head = NULL;
+    evq->tail = NULL;
+    evq->waiters = 0;
+    pthread_mutex_init(&evq->lock, NULL);
+    pthread_cond_init(&evq->cond, NULL);
+    evq->inited = 1;
+}
+
+bool
+dpl_eventq_is_empty(struct dpl_eventq *evq)
+{
+    bool empty;
+
+    pthread_mutex_lock(&evq->lock);
+    empty = (evq->head == NULL);
+    pthread_mutex_unlock(&evq->lock);
+
+    return empty;
+}
+
+int
+dpl_eventq_inited(struct dpl_eventq *evq)
+{
+    return evq->inited;
+}
+
+void
+dpl_eventq_put(struct dpl_eventq *evq, struct dpl_event *ev)
+{
+    pthread_mutex_lock(&evq->lock);
+
+    if (ev->ev_queued) {
+        pthread_mutex_unlock(&evq->lock);
+        return;
+    }
+
+    ev->ev_queued = 1;
+    ev->ev_next = NULL;
+    if (evq->tail) {
+        evq->tail->ev_next = ev;
+    } else {
+        evq->head = ev;
+    }
+    evq->tail = ev;
+
+    if (evq->waiters) {
+        pthread_cond_signal(&evq->cond);
+    }
+    pthread_mutex_unlock(&evq->lock);
+}
+
+/* Unlink the head of the queue, called with the lock held */
+static struct dpl_event *
+dpl_eventq_pop(struct dpl_eventq *evq)
+{
+    struct dpl_event *ev = evq->head;
+
+    if (ev) {
+        evq->head = ev->ev_next;
+        if (evq->head == NULL) {
+            evq->tail = NULL;
+        }
+        ev->ev_next = NULL;
+        ev->ev_queued = 0;
+    }
+
+    return ev;
+}
+
+struct dpl_event *
+dpl_eventq_get(struct dpl_eventq *evq)
+{
+    struct dpl_event *ev;
+
+    pthread_mutex_lock(&evq->lock);
+    while (evq->head == NULL) {
+        evq->waiters++;
+        pthread_cond_wait(&evq->cond, &evq->lock);
+        evq->waiters--;
+    }
+    ev = dpl_eventq_pop(evq);
+    pthread_mutex_unlock(&evq->lock);
+
+    return ev;
+}
+
+struct dpl_event *
+dpl_eventq_get_no_wait(struct dpl_eventq *evq)
+{
+    struct dpl_event *ev;
+
+    pthread_mutex_lock(&evq->lock);
+    ev = dpl_eventq_pop(evq);
+    pthread_mutex_unlock(&evq->lock);
+
+    return ev;
+}
+
+void
+dpl_eventq_remove(struct dpl_eventq *evq, struct dpl_event *ev)
+{
+    struct dpl_event **pp;
+    struct dpl_event *prev = NULL;
+
+    pthread_mutex_lock(&evq->lock);
+    if (ev->ev_queued) {
+        for (pp = &evq->head; *pp; prev = *pp, pp = &(*pp)->ev_next) {
+            if (*pp == ev) {
+                *pp = ev->ev_next;
+                if (evq->tail == ev) {
+                    evq->tail = prev;
+                }
+                ev->ev_next = NULL;
+                ev->ev_queued = 0;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&evq->lock);
+}
+
+void
+dpl_eventq_run(struct dpl_eventq *evq)
+{
+    struct dpl_event *ev;
+
+    ev = dpl_eventq_get(evq);
+    dpl_event_run(ev);
+}
+
+
+// ========================================================================
+//                         Event Implementation
+// ========================================================================
+
+void
+dpl_event_init(struct dpl_event *ev, dpl_event_fn *fn,
+                   void *arg)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->ev_cb = fn;
+    ev->ev_arg = arg;
+}
+
+bool
+dpl_event_is_queued(struct dpl_event *ev)
+{
+    return ev->ev_queued;
+}
+
+void *
+dpl_event_get_arg(struct dpl_event *ev)
+{
+    return ev->ev_arg;
+}
+
+void
+dpl_event_set_arg(struct dpl_event *ev, void *arg)
+{
+    ev->ev_arg = arg;
+}
+
+void
+dpl_event_run(struct dpl_event *ev)
+{
+    if(ev == NULL)
+	return;
+    assert(ev->ev_cb != NULL);
+    ev->ev_cb(ev);
+}
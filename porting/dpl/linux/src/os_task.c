@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include <sched.h>
 #include "os/os.h"
 #include "dpl/dpl_tasks.h"
 
@@ -104,7 +105,7 @@ bool dpl_os_started(void)
 
 void dpl_task_yield(void)
 {
-    pthread_yield();
+    sched_yield();
 }
 
 #ifdef __cplusplus
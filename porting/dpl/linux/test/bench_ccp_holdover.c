@@ -0,0 +1,253 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  CCP holdover on a simulated slave clock:
+
+  The slave runs 12 ppm or so off the master, with white frequency
+  noise at CCP_HOLDOVER_QPHASE and a random walk in skew, and
+  timestamps beacons with 8 dtu of noise. After 60 beacons it misses
+  n in a row, then hears the next. The skew walks at CCP_HOLDOVER_QSKEW,
+  then 100 times that for a crystal out of a steady temperature, the
+  filter being told.
+
+  - Slot error growth: the error of the last slot of each superframe
+    in the outage against n, for the holdover and for a skew taken
+    from the last two beacons, with the uncertainty predicted, the
+    guard the slot gets and the part of the slots within
+    CCP_HOLDOVER_GUARD_SIGMA of the prediction.
+  - Reacquisition: the step the master time and the local epoch of the
+    beacon take on the beacon that ends the outage, the correction being
+    slewed and its rate.
+  - The holdover is lost past CCP_HOLDOVER_MAX_MISSED and comes back
+    on the next beacon.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "test_util.h"
+#include <os/os.h>
+#include <dw1000/dw1000_time.h>
+#include <ccp/ccp_holdover.h>
+
+#define INTERVAL    dw1000_uus_to_dtu(0x100000)     //!< CCP_PERIOD, about 1.07 s
+#define NSLOTS      (128)
+#define NLOCK       (60)
+#define NTRIALS     (400)
+#define NS(x)       ((x) * 1e9 / CCP_HOLDOVER_DTU_PER_SEC)
+
+static uint32_t s_seed = 1;
+static double
+frand(void)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return ((s_seed >> 8) & 0xffff) / 65536.0 + 1.0 / 131072;
+}
+
+static double
+gauss(void)
+{
+    return sqrt(-2.0 * log(frand())) * cos(2.0 * M_PI * frand());
+}
+
+//! Slave clock at the last beacon, local time unwrapped
+typedef struct {
+    double local;
+    double skew;
+    uint64_t master;
+}clk_t;
+
+static double s_q_skew = MYNEWT_VAL(CCP_HOLDOVER_QSKEW);
+
+static void
+clk_step(clk_t * c)
+{
+    double ts = INTERVAL / CCP_HOLDOVER_DTU_PER_SEC;
+    c->local += INTERVAL / (1.0 + c->skew) + sqrt(MYNEWT_VAL(CCP_HOLDOVER_QPHASE) * ts) * gauss();
+    c->skew += sqrt(s_q_skew * ts) * gauss();
+    c->master = dw1000_dtu_add(c->master, INTERVAL);
+}
+
+static uint64_t
+clk_stamp(clk_t * c)
+{
+    return (uint64_t)llround(c->local + 8 * gauss()) & DW1000_DTU_MASK;
+}
+
+/* True local time of the slot j after the beacon the clock is at */
+static double
+clk_slot(clk_t * c, int j)
+{
+    return c->local + (double)j * INTERVAL / NSLOTS / (1.0 + c->skew);
+}
+
+/* Error of the slot j as the holdover places it, relative to the beacon it last took or predicted */
+static double
+slot_error(ccp_holdover_t * ho, clk_t * c, int j)
+{
+    double est = (double)dw1000_dtu_diff(ho->local_epoch, (uint64_t)llround(c->local) & DW1000_DTU_MASK)
+               + c->local + (double)j * INTERVAL / NSLOTS / (1.0 + ho->skew);
+    return est - clk_slot(c, j);
+}
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const int s_missed[] = {0, 1, 2, 3, 5, 8, 10};
+#define NROWS (sizeof(s_missed) / sizeof(s_missed[0]))
+
+static ccp_holdover_t ho;
+
+/* Slot error against the beacons missed, the skew walking at q_skew */
+static void
+table(double q_skew)
+{
+    double se[NROWS] = {0}, se_naive[NROWS] = {0}, sigma[NROWS] = {0}, worst[NROWS] = {0};
+    double step_max = 0, epoch_step_max = 0, slew_se = 0, slew_rate_max = 0, naive_step_se = 0;
+    uint32_t covered[NROWS] = {0}, guard[NROWS] = {0}, quality[NROWS] = {0}, nslew = 0;
+
+    s_q_skew = q_skew;
+    printf("skew random walk %.1f ppb/sqrt(s)\n", sqrt(q_skew) * 1e9);
+    printf("missed  rms ns  worst ns  1sigma ns  guard uus  in 4sigma  quality  two beacon skew rms ns\n");
+    for (int row = 0; row < NROWS; row++) {
+        int n = s_missed[row];
+        for (int trial = 0; trial < NTRIALS; trial++) {
+            clk_t c = {.local = 1e9 * frand(), .skew = 12e-6 + 4e-6 * (frand() - 0.5), .master = 0};
+            uint64_t prev = 0, last = 0;
+            double last_local = 0;
+
+            ccp_holdover_init(&ho);
+            ho.q_skew = q_skew;
+            for (int k = 0; k < NLOCK; k++) {
+                prev = last;
+                last = clk_stamp(&c);
+                last_local = c.local + dw1000_dtu_diff(last, (uint64_t)llround(c.local) & DW1000_DTU_MASK);
+                ccp_holdover_update(&ho, last, c.master);
+                if (k + 1 < NLOCK)
+                    clk_step(&c);
+            }
+            double naive_skew = (double)INTERVAL / dw1000_dtu_sub(last, prev) - 1;
+            for (int i = 1; i <= n; i++) {
+                clk_step(&c);
+                VerifyOrQuit(ccp_holdover_miss(&ho, INTERVAL) != 0, "holdover: lost within the limit");
+            }
+
+            /* The last slot of the superframe, received or predicted */
+            double err = slot_error(&ho, &c, NSLOTS - 1);
+            double naive = last_local + ((double)n * INTERVAL + (double)(NSLOTS - 1) * INTERVAL / NSLOTS) / (1.0 + naive_skew)
+                         - clk_slot(&c, NSLOTS - 1);
+            uint16_t g = ccp_holdover_guard(&ho, INTERVAL);
+            se[row] += err * err;
+            se_naive[row] += naive * naive;
+            worst[row] = fmax(worst[row], fabs(err));
+            double sd = ccp_holdover_sigma(&ho, INTERVAL);
+            covered[row] += fabs(err) <= MYNEWT_VAL(CCP_HOLDOVER_GUARD_SIGMA) * sd;
+            sigma[row] += sd;
+            guard[row] += g;
+            quality[row] += ccp_holdover_quality(&ho);
+
+            /* The beacon after the outage */
+            if (n == 0)
+                continue;
+            clk_step(&c);
+            uint64_t stamp = clk_stamp(&c);
+            uint64_t before = ccp_holdover_local_to_master(&ho, stamp);
+            uint64_t epoch_before = ccp_holdover_master_to_local(&ho, c.master);
+            ccp_holdover_update(&ho, stamp, c.master);
+            uint64_t after = ccp_holdover_local_to_master(&ho, stamp);
+            /* The local epoch ccp hands tdma for the beacon */
+            uint64_t epoch_after = ccp_holdover_master_to_local(&ho, c.master);
+            VerifyOrQuit(llabs(dw1000_dtu_diff(ccp_holdover_local_to_master(&ho, epoch_after), c.master)) <= 1,
+                         "holdover: master_to_local does not invert local_to_master");
+            epoch_step_max = fmax(epoch_step_max, fabs((double)dw1000_dtu_diff(epoch_after, epoch_before)));
+            double naive_step = last_local + (double)(n + 1) * INTERVAL / (1.0 + naive_skew) - c.local;
+            step_max = fmax(step_max, fabs((double)dw1000_dtu_diff(after, before)));
+            slew_se += ho.slew * ho.slew;
+            naive_step_se += naive_step * naive_step;
+            slew_rate_max = fmax(slew_rate_max, fabs(ho.slew) / ho.slew_span);
+            nslew++;
+        }
+        printf("%6d  %6.2f  %8.2f  %9.2f  %9.2f  %8.1f%%  %7.1f  %22.2f\n", n,
+               NS(sqrt(se[row] / NTRIALS)), NS(worst[row]), NS(sigma[row] / NTRIALS),
+               (double)guard[row] / NTRIALS, 100.0 * covered[row] / NTRIALS, (double)quality[row] / NTRIALS,
+               NS(sqrt(se_naive[row] / NTRIALS)));
+        VerifyOrQuit(covered[row] >= NTRIALS * 99 / 100, "holdover: uncertainty does not cover the slots");
+    }
+    VerifyOrQuit(se[NROWS - 1] > 10 * se[1], "holdover: no error growth");
+    VerifyOrQuit(quality[0] > quality[1] && quality[1] > quality[NROWS - 1], "holdover: quality not falling");
+    VerifyOrQuit(se[NROWS - 1] < 1.2 * se_naive[NROWS - 1], "holdover: worse than two beacons");
+
+    printf("reacquisition: step %.3f ns, epoch step %.3f ns, correction rms %.2f ns slewed at up to %.2f ppb; "
+           "two beacon skew would step %.2f ns rms\n",
+           NS(step_max), NS(epoch_step_max), NS(sqrt(slew_se / nslew)), slew_rate_max * 1e9, NS(sqrt(naive_step_se / nslew)));
+    VerifyOrQuit(step_max <= 1, "holdover: master time steps on reacquisition");
+    VerifyOrQuit(epoch_step_max <= 2, "holdover: epoch steps on reacquisition");
+}
+
+int main(void)
+{
+    table(MYNEWT_VAL(CCP_HOLDOVER_QSKEW));
+    table(MYNEWT_VAL(CCP_HOLDOVER_QSKEW) * 100);
+
+    /* Past the limit the holdover is lost, the next beacon starts the phase over */
+    clk_t c = {.local = 0, .skew = 10e-6, .master = 0};
+    s_q_skew = MYNEWT_VAL(CCP_HOLDOVER_QSKEW);
+    ccp_holdover_init(&ho);
+    for (int k = 0; k < NLOCK; k++, clk_step(&c))
+        ccp_holdover_update(&ho, clk_stamp(&c), c.master);
+    int coasted = 0;
+    while (ccp_holdover_miss(&ho, INTERVAL))
+        coasted++;
+    printf("limit: coasted %d beacons, lost %u, quality %u\n", coasted, ho.status.lost, ccp_holdover_quality(&ho));
+    VerifyOrQuit(coasted == MYNEWT_VAL(CCP_HOLDOVER_MAX_MISSED) && ho.status.lost && ccp_holdover_quality(&ho) == 0,
+                 "holdover: limit");
+    for (int i = 0; i < 5; i++)
+        clk_step(&c);
+    ccp_holdover_update(&ho, clk_stamp(&c), c.master);
+    VerifyOrQuit(!ho.status.lost && ho.stats.lost == 1 && ho.stats.reacquired == 0, "holdover: restart");
+    clk_step(&c);
+    ccp_holdover_update(&ho, clk_stamp(&c), c.master);
+    printf("restart: quality %u, skew %.3f ppm\n", ccp_holdover_quality(&ho), ho.skew * 1e6);
+    VerifyOrQuit(ccp_holdover_quality(&ho) > 90, "holdover: quality after the restart");
+
+    double t0 = now_ns();
+    for (int i = 0; i < 100000; i++) {
+        clk_step(&c);
+        ccp_holdover_update(&ho, clk_stamp(&c), c.master);
+    }
+    double t1 = now_ns();
+    for (int i = 0; i < 100000; i++) {
+        ccp_holdover_local_to_master(&ho, (uint64_t)i << 20);
+        ccp_holdover_guard(&ho, INTERVAL);
+    }
+    printf("update: %.0f ns incl. the simulation, local_to_master and guard: %.0f ns\n",
+           (t1 - t0) / 100000, (now_ns() - t1) / 100000);
+
+    return PASS;
+}
@@ -0,0 +1,240 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Angle of arrival engine on synthetic phases:
+
+  Each frame gives every antenna the phase of a plane wave from the
+  direction under test, plus a random common phase, a fixed offset per
+  antenna and channel standing for the board, and gaussian noise.
+
+  - 2 antennas half a wavelength apart: calibrated at boresight, the
+    azimuth of single frames over -60..60 degrees.
+  - 3 antennas on channels 2 and 5, each calibrated: azimuth and
+    elevation of single frames over a grid.
+  - 2 antennas 0.8 wavelength apart and a peer sweeping past the point
+    where the phase difference wraps: the track against single frames.
+  - 2 peers interleaved: the tracks against single frames, injected
+    outliers rejected, a jump in direction restarting its track.
+  - Receivers with and without a CIR through cir_aoa_process().
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "test_util.h"
+#include <dw1000/dw1000_dev.h>
+#include <cir/cir.h>
+#include <cir/cir_aoa.h>
+
+#define DEG(x)  ((x) * 180.0f / (float)M_PI)
+#define RAD(x)  ((x) * (float)M_PI / 180.0f)
+
+static uint32_t s_seed = 1;
+static float
+frand(void)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return (float)((s_seed >> 8) & 0xffff) / 65536.0f;
+}
+
+static float
+gauss(void)
+{
+    return sqrtf(-2.0f * logf(frand() + 1e-6f)) * cosf(2.0f * M_PI * frand());
+}
+
+//! Board phase offset of antennas 1 and 2 by channel, unknown to the engine
+static const float s_offset[CIR_AOA_NCHAN][2] = {[2] = {-2.1f, 0.7f}, [5] = {0.9f, -1.4f}};
+
+/* Phases of the antennas for a source at az, el */
+static void
+frame(cir_aoa_t * aoa, uint8_t channel, float az, float el, float sigma, float * phase)
+{
+    float k = 2 * M_PI / cir_aoa_wavelength(channel);
+    float u[2] = {sinf(az) * cosf(el), sinf(el)};
+    float common = 2 * M_PI * frand();
+
+    phase[0] = common + sigma * gauss();
+    for (uint8_t i = 1; i < aoa->nant; i++)
+        phase[i] = common + k * (aoa->pos[i][0] * u[0] + aoa->pos[i][1] * u[1])
+                 + s_offset[channel][i - 1] + sigma * gauss();
+}
+
+static void
+calibrate(cir_aoa_t * aoa, uint8_t channel, float sigma)
+{
+    float phase[CIR_AOA_MAX_ANT];
+    cir_aoa_result_t res;
+
+    cir_aoa_cal_start(aoa, channel, 0, 0);
+    for (int i = 0; i < 100; i++) {
+        frame(aoa, channel, 0, 0, sigma, phase);
+        cir_aoa_update(aoa, channel, 0xcafe, i * 10000, phase, &res);
+    }
+    VerifyOrQuit(cir_aoa_cal_finish(aoa) == 100, "aoa: calibration frames");
+}
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    float phase[CIR_AOA_MAX_ANT], se, se_el, se_raw, max_raw;
+    cir_aoa_result_t res;
+    cir_aoa_t * aoa;
+    int n;
+
+    /* 2 antennas, channel 5, single frames after a boresight calibration */
+    aoa = cir_aoa_init(NULL, 2, NULL);
+    frame(aoa, 5, RAD(30), 0, 0, phase);
+    cir_aoa_update(aoa, 5, 1, 0, phase, &res);
+    float uncal = fabsf(DEG(res.azimuth) - 30);
+    calibrate(aoa, 5, 0.03f);
+    se = 0; n = 0;
+    for (int az = -60; az <= 60; az++, n++) {
+        frame(aoa, 5, RAD(az), 0, 0.03f, phase);
+        cir_aoa_update(aoa, 5, 0x100 + n, n * 1000, phase, &res);
+        se += powf(DEG(res.azimuth) - az, 2);
+    }
+    float rms2 = sqrtf(se / n);
+    printf("2 antennas: azimuth error %.1f deg uncalibrated, rms %.2f deg calibrated over -60..60\n", uncal, rms2);
+    VerifyOrQuit(uncal > 10, "aoa: offset not seen");
+    VerifyOrQuit(rms2 < 2, "aoa: 2 antenna azimuth");
+    VerifyOrQuit(aoa->stats.evictions > 0, "aoa: tracks not evicted");
+    cir_aoa_free(aoa);
+
+    /* 3 antennas, channels 2 and 5 each with its own calibration */
+    aoa = cir_aoa_init(NULL, 3, NULL);
+    calibrate(aoa, 2, 0.03f);
+    calibrate(aoa, 5, 0.03f);
+    se = se_el = 0; n = 0;
+    for (int az = -50; az <= 50; az += 10) {
+        for (int el = -40; el <= 40; el += 10) {
+            for (int i = 0; i < 4; i++, n++) {
+                uint8_t channel = (i & 1) ? 5 : 2;
+                frame(aoa, channel, RAD(az), RAD(el), 0.03f, phase);
+                cir_aoa_update(aoa, channel, 0x200 + n, n * 1000, phase, &res);
+                se += powf(DEG(res.azimuth) - az, 2);
+                se_el += powf(DEG(res.elevation) - el, 2);
+            }
+        }
+    }
+    float rms_az = sqrtf(se / n), rms_el = sqrtf(se_el / n);
+    printf("3 antennas: rms azimuth %.2f deg, elevation %.2f deg over a %d frame grid on channels 2 and 5\n", rms_az, rms_el, n);
+    VerifyOrQuit(rms_az < 3 && rms_el < 3, "aoa: 3 antenna azimuth and elevation");
+    cir_aoa_free(aoa);
+
+    /* 0.8 wavelength: a peer sweeping from -10 to 70 degrees at 20 deg/s, 100 frames/s */
+    aoa = cir_aoa_init(NULL, 2, NULL);
+    cir_aoa_set_position(aoa, 1, 0.8f * cir_aoa_wavelength(5), 0);
+    calibrate(aoa, 5, 0.03f);
+    float se_track = 0;
+    se = max_raw = 0; n = 0;
+    for (uint32_t t = 0; t <= 4000000; t += 10000, n++) {
+        float az = -10 + 20 * t * 1e-6f;
+        frame(aoa, 5, RAD(az), 0, 0.03f, phase);
+        cir_aoa_update(aoa, 5, 1, t, phase, &res);
+        se += powf(DEG(res.azimuth) - az, 2);
+        se_track += powf(DEG(res.azimuth_track) - az, 2);
+        cir_aoa_update(aoa, 5, 0x300 + n, t, phase, &res);
+        max_raw = fmaxf(max_raw, fabsf(DEG(res.azimuth) - az));
+    }
+    printf("0.8 wavelength sweep: rms %.2f deg per frame, %.2f deg track, %lu unwrapped; %.0f deg worst without a track\n",
+           sqrtf(se / n), sqrtf(se_track / n), (unsigned long)aoa->stats.unwrapped, max_raw);
+    VerifyOrQuit(sqrtf(se / n) < 2 && sqrtf(se_track / n) < 2, "aoa: unwrapping");
+    VerifyOrQuit(aoa->stats.unwrapped > 100 && max_raw > 30, "aoa: sweep did not wrap");
+    VerifyOrQuit(aoa->stats.outliers == 0, "aoa: outliers in the sweep");
+    cir_aoa_free(aoa);
+
+    /* 2 peers interleaved with 0.1 rad of noise */
+    aoa = cir_aoa_init(NULL, 2, NULL);
+    calibrate(aoa, 5, 0.03f);
+    int n_track = 0;
+    se_raw = se_track = 0; n = 0;
+    for (uint32_t t = 0; t < 2000000; t += 10000) {
+        for (int p = 0; p < 2; p++) {
+            float az = p ? -35 : 20;
+            frame(aoa, 5, RAD(az), 0, 0.1f, phase);
+            if (p == 0 && t % 500000 == 250000)
+                phase[1] += 2.0f;
+            bool taken = cir_aoa_update(aoa, 5, 0xa + p, t + p * 5000, phase, &res);
+            if (!taken)
+                continue;
+            se_raw += powf(DEG(res.azimuth) - az, 2);
+            n++;
+            if (t > 200000) {
+                se_track += powf(DEG(res.azimuth_track) - az, 2);
+                n_track++;
+            }
+        }
+    }
+    float rms_raw = sqrtf(se_raw / n), rms_track = sqrtf(se_track / n_track);
+    uint32_t outliers = aoa->stats.outliers;
+    printf("2 peers: rms %.2f deg per frame, %.2f deg track, %lu of 4 injected outliers rejected\n",
+           rms_raw, rms_track, (unsigned long)outliers);
+    VerifyOrQuit(rms_track < 0.7f * rms_raw, "aoa: tracks no better than frames");
+    VerifyOrQuit(outliers == 4 && aoa->stats.restarts == 0, "aoa: outliers");
+
+    for (uint32_t t = 2000000, i = 0; i < 20; t += 10000, i++) {
+        frame(aoa, 5, RAD(50), 0, 0.03f, phase);
+        cir_aoa_update(aoa, 5, 0xa, t, phase, &res);
+    }
+    printf("2 peers: jump to 50 deg, %lu restart, track at %.1f deg\n",
+           (unsigned long)aoa->stats.restarts, DEG(res.azimuth_track));
+    VerifyOrQuit(aoa->stats.restarts == 1 && fabsf(DEG(res.azimuth_track) - 50) < 2, "aoa: restart");
+    VerifyOrQuit(fabsf(DEG(asinf(cir_aoa_track(aoa, 0xb)->u[0])) + 35) < 2, "aoa: peer b moved");
+    cir_aoa_dump(aoa, printf);
+
+    double t0 = now_ns();
+    for (int i = 0; i < 100000; i++)
+        cir_aoa_update(aoa, 5, 0xa, 3000000 + i * 1000, phase, &res);
+    printf("update: %.0f ns\n", (now_ns() - t0) / 100000);
+    cir_aoa_free(aoa);
+
+    /* Through the CIR instances of 3 receivers, the phase being the first path angle less rcphase */
+    static dw1000_dev_instance_t devs[3];
+    static cir_instance_t cirs[3];
+    dw1000_dev_instance_t * inst[3] = {&devs[0], &devs[1], &devs[2]};
+    aoa = cir_aoa_init(NULL, 3, inst);
+    frame(aoa, 5, RAD(25), RAD(-15), 0, phase);
+    for (int i = 0; i < 3; i++) {
+        devs[i].config.channel = 5;
+        devs[i].cir = &cirs[i];
+        cirs[i].rcphase = 3 * frand();
+        cirs[i].angle = phase[i] - s_offset[5][0] * (i == 1) - s_offset[5][1] * (i == 2) + cirs[i].rcphase;
+        cirs[i].status.valid = i != 2;
+    }
+    VerifyOrQuit(!cir_aoa_process(aoa, 0x1, &res) && aoa->stats.invalid == 1, "aoa: process without a CIR");
+    cirs[2].status.valid = 1;
+    VerifyOrQuit(cir_aoa_process(aoa, 0x1, &res), "aoa: process");
+    printf("process: azimuth %.2f elevation %.2f deg\n", DEG(res.azimuth), DEG(res.elevation));
+    VerifyOrQuit(fabsf(DEG(res.azimuth) - 25) < 0.01f && fabsf(DEG(res.elevation) + 15) < 0.01f, "aoa: process angles");
+    cir_aoa_free(aoa);
+
+    return PASS;
+}
@@ -0,0 +1,229 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Correctness and speed of the CIR kernels:
+
+  Synthetic CIRs of 64 samples, noise plus a band limited first path at
+  a fractional index and two later echoes. Each fixed point kernel is
+  checked against its float reference: magnitudes within one unit,
+  angles within 0.001 rad, the division by the preamble count exact over
+  every 16 bit sample, the upsampled CIR within 8 units and the leading
+  edge within 2/64 of a sample and not after the first path. Then both
+  versions are timed over the same CIRs.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "test_util.h"
+#include <dsp/cir_kernels.h>
+
+#define NCIRS       (64)
+#define NSAMPLES    (64)
+#define NUP         (16 * DSP_CIR_UPSAMPLE)
+#define REPS        (200)
+
+static int16_t s_cir[NCIRS][2 * NSAMPLES];
+static float s_fp[NCIRS];
+static volatile float s_sink;
+
+static uint32_t s_seed = 1;
+static float
+frand(void)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return (float)((s_seed >> 8) & 0xffff) / 65536.0f;
+}
+
+static float
+gauss(void)
+{
+    return sqrtf(-2.0f * logf(frand() + 1e-6f)) * cosf(2.0f * M_PI * frand());
+}
+
+/* Band limited pulse of amplitude a and phase ph at t0, added to cir */
+static void
+add_path(int16_t * cir, float t0, float a, float ph)
+{
+    for (int i = 0; i < NSAMPLES; i++) {
+        float d = i - t0;
+        float s = fabsf(d) < 1e-6f ? 1.0f : sinf(M_PI * d) / (M_PI * d);
+        s *= expf(-d * d / 8.0f);
+        cir[2 * i] += (int16_t)(a * s * cosf(ph));
+        cir[2 * i + 1] += (int16_t)(a * s * sinf(ph));
+    }
+}
+
+static void
+make_cirs(void)
+{
+    for (int k = 0; k < NCIRS; k++) {
+        int16_t * cir = s_cir[k];
+        for (int i = 0; i < 2 * NSAMPLES; i++)
+            cir[i] = (int16_t)(30.0f * gauss());
+        s_fp[k] = 16.0f + 8.0f * frand();
+        add_path(cir, s_fp[k], 2000.0f + 14000.0f * frand(), 2.0f * M_PI * frand());
+        add_path(cir, s_fp[k] + 3.0f + 4.0f * frand(), 3000.0f * frand(), 2.0f * M_PI * frand());
+        add_path(cir, s_fp[k] + 10.0f + 10.0f * frand(), 2000.0f * frand(), 2.0f * M_PI * frand());
+    }
+}
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Nanoseconds per CIR of kernel k, fixed point when opt */
+static double
+timeit(int k, bool opt)
+{
+    uint32_t mag2[NSAMPLES];
+    uint16_t mag[NSAMPLES];
+    int16_t angle[NSAMPLES], up[2 * NUP], buf[2 * NSAMPLES];
+    float f[2 * NUP];
+    double t0 = now_ns();
+
+    for (int r = 0; r < REPS; r++) {
+        for (int c = 0; c < NCIRS; c++) {
+            const int16_t * cir = s_cir[c];
+            switch (k) {
+            case 0:
+                if (opt) { dsp_cir_mag2(cir, mag2, NSAMPLES); s_sink += mag2[3]; }
+                else { dsp_cir_mag2_ref(cir, f, NSAMPLES); s_sink += f[3]; }
+                break;
+            case 1:
+                if (opt) { dsp_cir_mag(cir, mag, NSAMPLES); s_sink += mag[3]; }
+                else { dsp_cir_mag_ref(cir, f, NSAMPLES); s_sink += f[3]; }
+                break;
+            case 2:
+                if (opt) { dsp_cir_angle(cir, angle, NSAMPLES); s_sink += angle[3]; }
+                else { dsp_cir_angle_ref(cir, f, NSAMPLES); s_sink += f[3]; }
+                break;
+            case 3:
+                memcpy(buf, cir, sizeof(buf));
+                if (opt) dsp_cir_scale(buf, NSAMPLES, 1000 + c);
+                else dsp_cir_scale_ref(buf, NSAMPLES, 1000 + c);
+                s_sink += buf[3];
+                break;
+            case 4:
+                if (opt) { dsp_cir_upsample(cir, NSAMPLES, 12, up, NUP); s_sink += up[3]; }
+                else { dsp_cir_upsample_ref(cir, NSAMPLES, 12, f, NUP); s_sink += f[3]; }
+                break;
+            case 5: {
+                uint32_t thresh2 = 36 * dsp_cir_noise2(cir, 8);
+                if (opt) s_sink += dsp_cir_leading_edge(cir, NSAMPLES, thresh2);
+                else s_sink += dsp_cir_leading_edge_ref(cir, NSAMPLES, sqrtf((float)thresh2));
+                break;
+            }
+            }
+        }
+    }
+    return (now_ns() - t0) / (REPS * NCIRS);
+}
+
+static float
+wrap(float a)
+{
+    while (a > M_PI) a -= 2 * M_PI;
+    while (a < -M_PI) a += 2 * M_PI;
+    return a;
+}
+
+int main(void)
+{
+    static const char * names[] = {"power", "magnitude", "angle", "scale", "upsample x8", "leading edge"};
+    uint32_t mag2[NSAMPLES];
+    uint16_t mag[NSAMPLES];
+    int16_t angle[NSAMPLES], up[2 * NUP];
+    float f[2 * NUP], max_angle = 0, max_up = 0, max_edge = 0;
+
+    make_cirs();
+    for (int c = 0; c < NCIRS; c++) {
+        const int16_t * cir = s_cir[c];
+
+        dsp_cir_mag2(cir, mag2, NSAMPLES);
+        dsp_cir_mag2_ref(cir, f, NSAMPLES);
+        for (int i = 0; i < NSAMPLES; i++)
+            VerifyOrQuit(fabsf(mag2[i] - f[i]) <= f[i] * 1e-6f, "dsp: power");
+
+        dsp_cir_mag(cir, mag, NSAMPLES);
+        dsp_cir_mag_ref(cir, f, NSAMPLES);
+        for (int i = 0; i < NSAMPLES; i++)
+            VerifyOrQuit(fabsf(mag[i] - f[i]) <= 1.0f, "dsp: magnitude");
+
+        dsp_cir_angle(cir, angle, NSAMPLES);
+        dsp_cir_angle_ref(cir, f, NSAMPLES);
+        for (int i = 0; i < NSAMPLES; i++) {
+            float err = fabsf(wrap(angle[i] * (float)M_PI / DSP_CIR_PI - f[i]));
+            max_angle = err > max_angle ? err : max_angle;
+        }
+
+        dsp_cir_upsample(cir, NSAMPLES, 0, up, NUP);
+        dsp_cir_upsample_ref(cir, NSAMPLES, 0, f, NUP);
+        for (int i = 0; i < 2 * NUP; i++) {
+            float err = fabsf(up[i] - f[i]);
+            max_up = err > max_up ? err : max_up;
+        }
+        for (int i = 0; i < NUP; i += DSP_CIR_UPSAMPLE)
+            VerifyOrQuit(up[2 * i] == cir[2 * (i / DSP_CIR_UPSAMPLE)], "dsp: upsampled sample moved");
+
+        uint32_t thresh2 = 36 * dsp_cir_noise2(cir, 8);
+        int32_t edge = dsp_cir_leading_edge(cir, NSAMPLES, thresh2);
+        float edge_ref = dsp_cir_leading_edge_ref(cir, NSAMPLES, sqrtf((float)thresh2));
+        VerifyOrQuit(edge >= 0 && edge_ref >= 0, "dsp: no leading edge");
+        VerifyOrQuit(edge / 64.0f <= s_fp[c], "dsp: leading edge after the first path");
+        float err = fabsf(edge / 64.0f - edge_ref);
+        max_edge = err > max_edge ? err : max_edge;
+    }
+    VerifyOrQuit(max_angle <= 0.001f, "dsp: angle");
+    VerifyOrQuit(max_up <= 8.0f, "dsp: upsample");
+    VerifyOrQuit(max_edge <= 2.0f / 64, "dsp: leading edge");
+
+    /* Integer square root, used where there is no FPU */
+    for (uint32_t x = 0; x < 0xffff0000; x += 65521) {
+        uint32_t r = dsp_isqrt32(x);
+        VerifyOrQuit((uint64_t)r * r <= x && (uint64_t)(r + 1) * (r + 1) > x, "dsp: isqrt");
+    }
+
+    /* Division by the preamble count, every sample and a spread of divisors */
+    static const uint16_t divs[] = {1, 2, 3, 7, 10, 64, 127, 1000, 1021, 4095, 65535};
+    for (int d = 0; d < sizeof(divs) / sizeof(divs[0]); d++) {
+        for (int32_t v = INT16_MIN; v <= INT16_MAX; v += 2) {
+            int16_t a[2] = {(int16_t)v, (int16_t)(v + 1)}, b[2] = {(int16_t)v, (int16_t)(v + 1)};
+            dsp_cir_scale(a, 1, divs[d]);
+            dsp_cir_scale_ref(b, 1, divs[d]);
+            VerifyOrQuit(a[0] == b[0] && a[1] == b[1], "dsp: scale");
+        }
+    }
+    printf("max error: angle %.5f rad, upsample %.2f, leading edge %.4f samples\n", max_angle, max_up, max_edge);
+
+    printf("%-14s %12s %12s %8s\n", "kernel", "ref ns/cir", "fixed ns/cir", "speedup");
+    for (int k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+        double ref = timeit(k, false), opt = timeit(k, true);
+        printf("%-14s %12.0f %12.0f %7.1fx\n", names[k], ref, opt, ref / opt);
+    }
+    return PASS;
+}
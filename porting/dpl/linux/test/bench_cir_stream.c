@@ -0,0 +1,187 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the streaming CIR capture:
+
+  Two instances on the simulated radio, clocked at 8MHz. The anchor
+  streams the CIR window of every frame from the tag into a pipe, drained
+  from an eventq run by another thread. Each record read from the pipe
+  must be in sequence, around the first path, and match the accumulator
+  read back in one blocking access within the block floating point step.
+  The capture time and record size are compared with the blocking read of
+  the same window printed as JSON, as with CIR_VERBOSE. With the drain
+  stopped, frames beyond the ring must be counted as drops and show as a
+  gap in the sequence numbers.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_regs.h>
+#include <cir/cir_stream.h>
+
+#define BENCH_SPI_HZ        (8000000)
+#define BENCH_FRAMES        (40)
+#define NSAMPLES            MYNEWT_VAL(CIR_STREAM_LEN)
+
+static struct dpl_eventq s_evq;
+static cir_stream_t s_stream;
+static void *
+drain_task(void * arg)
+{
+    while (1)
+        dpl_eventq_run(&s_evq);
+    return NULL;
+}
+
+/* Next record from the pipe, decoded into int16_t real, imag pairs */
+static cir_stream_hdr_t
+read_record(int fd, int16_t * samples)
+{
+    uint8_t rec[CIR_STREAM_RECORD_MAX];
+    cir_stream_hdr_t hdr;
+
+    VerifyOrQuit(read(fd, &hdr, sizeof(hdr)) == sizeof(hdr), "stream: no record");
+    VerifyOrQuit(hdr.sync == CIR_STREAM_SYNC && (hdr.flags & 0x0f) == CIR_STREAM_VERSION, "stream: sync");
+    VerifyOrQuit(hdr.len <= CIR_STREAM_RECORD_MAX && hdr.nsamples == NSAMPLES, "stream: length");
+    VerifyOrQuit(read(fd, rec, hdr.len - sizeof(hdr)) == hdr.len - sizeof(hdr), "stream: short record");
+
+    uint8_t * p = rec;
+    for (uint16_t i = 0; i < hdr.nsamples; i += hdr.chunk) {
+        uint16_t n = (hdr.nsamples - i < hdr.chunk) ? hdr.nsamples - i : hdr.chunk;
+        if (hdr.flags & CIR_STREAM_FLAG_BFP) {
+            uint8_t shift = *p++;
+            for (uint16_t j = 0; j < 2 * n; j++)
+                samples[2 * i + j] = (int16_t)((int8_t)*p++ * (1 << shift));
+        } else {
+            memcpy(&samples[2 * i], p, 4 * n);
+            p += 4 * n;
+        }
+    }
+    return hdr;
+}
+
+/* The window printed the way cir_encode() does, returns its length */
+static int
+json_len(const int16_t * samples, uint16_t fp_idx)
+{
+    char buf[16 * NSAMPLES + 128];
+    int n = snprintf(buf, sizeof(buf), "{\"utime\": %lu,\"cir\": {\"idx\": %u,\"power\": %u,\"real\": [",
+                     (unsigned long)os_cputime_get32(), fp_idx, 1107951616u);
+    for (int i = 0; i < NSAMPLES; i++)
+        n += snprintf(buf + n, sizeof(buf) - n, "%s%d", i ? "," : "", samples[2 * i]);
+    n += snprintf(buf + n, sizeof(buf) - n, "],\"imag\": [");
+    for (int i = 0; i < NSAMPLES; i++)
+        n += snprintf(buf + n, sizeof(buf) - n, "%s%d", i ? "," : "", samples[2 * i + 1]);
+    n += snprintf(buf + n, sizeof(buf) - n, "]}}\n");
+    return n;
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * tag = hal_dw1000_inst(0), * anchor = hal_dw1000_inst(1);
+    uint8_t acc[1 + 4 * NSAMPLES];
+    int16_t samples[2 * NSAMPLES], ref[2 * NSAMPLES];
+    uint32_t stream_usec = 0, block_usec = 0, stream_xfers = 0, block_xfers = 0, json_bytes = 0;
+    struct hal_dw1000_sim_stats s0, s1;
+    int fds[2];
+    pthread_t thread;
+
+    test_sim_init(2, BENCH_SPI_HZ, false);
+    test_sim_listen(anchor);
+
+    VerifyOrQuit(pipe(fds) == 0, "pipe");
+    dpl_eventq_init(&s_evq);
+    pthread_create(&thread, NULL, drain_task, NULL);
+    cir_stream_init(anchor, &s_stream, cir_stream_fd_sink, (void *)(intptr_t)fds[1], &s_evq);
+
+    /* Transfers of a frame without the capture */
+    hal_dw1000_sim_node_stats(anchor->idx, &s0);
+    VerifyOrQuit(test_sim_send(tag, anchor), "stream: frame lost");
+    hal_dw1000_sim_node_stats(anchor->idx, &s1);
+    uint32_t frame_xfers = s1.spi_xfers - s0.spi_xfers;
+    cir_stream_enable(&s_stream, true);
+
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        hal_dw1000_sim_node_stats(anchor->idx, &s0);
+        VerifyOrQuit(test_sim_send(tag, anchor), "stream: frame lost");
+        hal_dw1000_sim_node_stats(anchor->idx, &s1);
+        for (int i = 0; i < 100 && s_stream.stats.delivered != k + 1; i++)
+            usleep(1000);
+        VerifyOrQuit(s_stream.stats.delivered == k + 1, "stream: record not delivered");
+        stream_usec += s_stream.stats.read_usec;
+        stream_xfers += s1.spi_xfers - s0.spi_xfers - frame_xfers;
+
+        cir_stream_hdr_t hdr = read_record(fds[0], samples);
+        VerifyOrQuit(hdr.seq == k && hdr.idx == anchor->idx, "stream: sequence");
+        VerifyOrQuit(hdr.start + MYNEWT_VAL(CIR_STREAM_PRE) == (hdr.fp_idx + 32) >> 6, "stream: window");
+        VerifyOrQuit(samples[2 * MYNEWT_VAL(CIR_STREAM_PRE)] > 0, "stream: no first path");
+
+        /* The same window in one blocking read, as the verbose capture does */
+        uint32_t t0 = os_cputime_get32();
+        hal_dw1000_sim_node_stats(anchor->idx, &s0);
+        dw1000_read_accdata(anchor, acc, hdr.start * 4, sizeof(acc));
+        hal_dw1000_sim_node_stats(anchor->idx, &s1);
+        memcpy(ref, acc + 1, sizeof(ref));
+        json_bytes += json_len(ref, hdr.fp_idx);
+        block_usec += os_cputime_ticks_to_usecs(os_cputime_get32() - t0);
+        block_xfers += s1.spi_xfers - s0.spi_xfers;
+        for (int i = 0; i < 2 * NSAMPLES; i++) {
+            int err = samples[i] - ref[i];
+            VerifyOrQuit(err <= samples[2 * MYNEWT_VAL(CIR_STREAM_PRE)] / 127 + 1 &&
+                         -err <= samples[2 * MYNEWT_VAL(CIR_STREAM_PRE)] / 127 + 1, "stream: sample");
+        }
+    }
+    uint32_t rate = cir_stream_rate(&s_stream), bytes = s_stream.stats.bytes;
+
+    /* Drain stopped: the ring fills up and the rest is dropped */
+    s_stream.evq = NULL;
+    for (int k = 0; k < MYNEWT_VAL(CIR_STREAM_RING_SLOTS) + 4; k++)
+        VerifyOrQuit(test_sim_send(tag, anchor), "stream: frame lost");
+    VerifyOrQuit(s_stream.stats.drops == 4, "stream: drops");
+    VerifyOrQuit(cir_stream_flush(&s_stream) == MYNEWT_VAL(CIR_STREAM_RING_SLOTS), "stream: flush");
+    for (int k = 0; k < MYNEWT_VAL(CIR_STREAM_RING_SLOTS); k++)
+        read_record(fds[0], samples);
+    VerifyOrQuit(test_sim_send(tag, anchor), "stream: frame lost");
+    cir_stream_flush(&s_stream);
+    VerifyOrQuit(read_record(fds[0], samples).seq == BENCH_FRAMES + MYNEWT_VAL(CIR_STREAM_RING_SLOTS) + 4,
+                 "stream: drops not in the sequence");
+
+    printf("cir window of %d samples: streamed %lu usec %.1f octets, blocking read and json %lu usec %.1f octets\n",
+           NSAMPLES, (unsigned long)(stream_usec / BENCH_FRAMES), (double)bytes / BENCH_FRAMES,
+           (unsigned long)(block_usec / BENCH_FRAMES), (double)json_bytes / BENCH_FRAMES);
+    printf("spi xfers of the capture %.1f, blocking window read %.1f; %lu cirs/s over the run, capture bound %lu cirs/s\n",
+           (double)stream_xfers / BENCH_FRAMES, (double)block_xfers / BENCH_FRAMES, (unsigned long)rate,
+           (unsigned long)(1000000UL * BENCH_FRAMES / (stream_usec ? stream_usec : 1)));
+    cir_stream_dump(&s_stream, printf);
+    VerifyOrQuit(bytes * 2 < json_bytes, "stream: records not half the json");
+    return PASS;
+}
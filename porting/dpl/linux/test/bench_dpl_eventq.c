@@ -0,0 +1,159 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the dpl_eventq api:
+
+  Measures the put to dispatch latency and the process cpu usage of an
+  event queue served by a single task, first idle and then under a
+  periodic load of BENCH_RATE events per second.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "test_util.h"
+#include "dpl/dpl.h"
+
+#define BENCH_RATE          (10000)     //!< Events per second under load
+#define BENCH_SECONDS       (1)
+#define BENCH_EVENTS        (BENCH_RATE * BENCH_SECONDS)
+#define BENCH_NEVENTS       (256)       //!< Events in flight, re-used round robin
+#define BENCH_IDLE_CPU_MAX  (5.0)       //!< Percent of one core allowed while idle
+
+struct bench_event {
+    struct dpl_event ev;
+    uint64_t t_put;
+};
+
+static struct dpl_task s_task_dispatcher;
+static struct dpl_eventq s_eventq;
+static struct bench_event s_events[BENCH_NEVENTS];
+static uint32_t s_latency[BENCH_EVENTS];
+static volatile uint32_t s_dispatched;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t
+cpu_ns(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL
+        + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void
+on_event(struct dpl_event *ev)
+{
+    struct bench_event *bev = (struct bench_event *)dpl_event_get_arg(ev);
+    uint64_t dt = now_ns() - bev->t_put;
+
+    if (s_dispatched < BENCH_EVENTS)
+        s_latency[s_dispatched] = (dt > UINT32_MAX) ? UINT32_MAX : (uint32_t)dt;
+    s_dispatched++;
+}
+
+static void *
+task_dispatcher(void *arg)
+{
+    while (1) {
+        dpl_eventq_run(&s_eventq);
+    }
+    return NULL;
+}
+
+static double
+cpu_percent(uint64_t cpu0, uint64_t t0)
+{
+    return 100.0 * (double)(cpu_ns() - cpu0) / (double)(now_ns() - t0);
+}
+
+int main(void)
+{
+    struct timespec next;
+    uint64_t t0, cpu0, sum = 0;
+    double idle_cpu, load_cpu;
+
+    dpl_eventq_init(&s_eventq);
+    for (int i = 0; i < BENCH_NEVENTS; i++)
+        dpl_event_init(&s_events[i].ev, on_event, &s_events[i]);
+
+    SuccessOrQuit(dpl_task_init(&s_task_dispatcher, "task_dispatcher",
+                                task_dispatcher, NULL, 1, 0, NULL, 0),
+                  "task: error initializing");
+
+    /* Idle, the dispatcher should be blocked */
+    t0 = now_ns();
+    cpu0 = cpu_ns();
+    sleep(BENCH_SECONDS);
+    idle_cpu = cpu_percent(cpu0, t0);
+
+    /* Periodic load */
+    t0 = now_ns();
+    cpu0 = cpu_ns();
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int i = 0; i < BENCH_EVENTS; i++) {
+        next.tv_nsec += 1000000000L / BENCH_RATE;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        struct bench_event *bev = &s_events[i % BENCH_NEVENTS];
+        VerifyOrQuit(!dpl_event_is_queued(&bev->ev), "eventq: dispatcher fell behind");
+        bev->t_put = now_ns();
+        dpl_eventq_put(&s_eventq, &bev->ev);
+    }
+    while (s_dispatched < BENCH_EVENTS) {
+        usleep(1000);
+    }
+    load_cpu = cpu_percent(cpu0, t0);
+
+    for (int i = 0; i < BENCH_EVENTS; i++)
+        sum += s_latency[i];
+    qsort(s_latency, BENCH_EVENTS, sizeof(s_latency[0]), cmp_u32);
+
+    printf("idle cpu %.2f%%\n", idle_cpu);
+    printf("%d events/s cpu %.2f%%\n", BENCH_RATE, load_cpu);
+    printf("put->dispatch latency ns: mean %llu p50 %u p99 %u max %u\n",
+           (unsigned long long)(sum / BENCH_EVENTS), s_latency[BENCH_EVENTS / 2],
+           s_latency[BENCH_EVENTS * 99 / 100], s_latency[BENCH_EVENTS - 1]);
+
+    VerifyOrQuit(s_dispatched == BENCH_EVENTS, "eventq: events lost");
+    VerifyOrQuit(idle_cpu < BENCH_IDLE_CPU_MAX, "eventq: idle queue is busy polling");
+
+    return PASS;
+}
@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the DTU timestamp helpers:
+
+  Converts a buffer of 40-bit stamps, straddling the wrap, to signed ns
+  offsets from a reference, first the way the ranging code did it inline
+  (mask, sign test on bit 39, double multiply by DWT_TIME_UNITS) and then
+  with dw1000_dtu_diff_batch() and dw1000_dtu_to_ns_batch(). Both must agree
+  to within a nanosecond of rounding.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "test_util.h"
+#include "dw1000/dw1000_time.h"
+
+#define BENCH_STAMPS    (4096)
+#define BENCH_ROUNDS    (2000)
+#define DWT_TIME_UNITS  (1.0/499.2e6/128.0)
+
+static dw1000_dtu_t s_ts[BENCH_STAMPS];
+static int64_t s_dtu[BENCH_STAMPS];
+static int64_t s_ns[BENCH_STAMPS];
+static int64_t s_ref_ns[BENCH_STAMPS];
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Reference: the inline mask and double arithmetic */
+static void
+adhoc(const uint64_t * ts, uint64_t ref, int64_t * ns, int n)
+{
+    for (int i = 0; i < n; i++) {
+        uint64_t delta = (ts[i] - ref) & 0xFFFFFFFFFFULL;
+        double t = (delta & 0x8000000000ULL) ? -(double)(0x10000000000ULL - delta) : (double)delta;
+        ns[i] = (int64_t)llround(t * DWT_TIME_UNITS * 1e9);
+    }
+}
+
+static void
+library(const dw1000_dtu_t * ts, dw1000_dtu_t ref, int64_t * ns, int n)
+{
+    dw1000_dtu_diff_batch(ts, ref, s_dtu, n);
+    dw1000_dtu_to_ns_batch(s_dtu, ns, n);
+}
+
+static double
+bench(void (*convert)(const uint64_t *, uint64_t, int64_t *, int), int64_t * ns)
+{
+    uint64_t t0 = now_ns();
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        convert(s_ts, dw1000_dtu_wrap(r), ns, BENCH_STAMPS);
+    }
+    return (double)(now_ns() - t0) / BENCH_ROUNDS / BENCH_STAMPS;
+}
+
+int main(void)
+{
+    srand(1);
+    for (int i = 0; i < BENCH_STAMPS; i++) {
+        s_ts[i] = dw1000_dtu_add(0, ((int64_t)rand() << 8) - ((int64_t)RAND_MAX << 7));
+    }
+
+    double adhoc_ns = bench(adhoc, s_ref_ns);
+    double lib_ns = bench(library, s_ns);
+
+    printf("%12s %12s %8s\n", "inline ns", "library ns", "speedup");
+    printf("%12.2f %12.2f %7.1fx\n", adhoc_ns, lib_ns, adhoc_ns / lib_ns);
+    for (int i = 0; i < BENCH_STAMPS; i++) {
+        VerifyOrQuit(llabs(s_ns[i] - s_ref_ns[i]) <= 1, "dtu: library and inline conversion disagree");
+    }
+    return PASS;
+}
@@ -0,0 +1,156 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the hal_timer queue:
+
+  Compares the sorted list the native hal_timer used to keep with the
+  hierarchical timing wheel it keeps now, at 10, 100, 1000 and 10000
+  pending timers. Each round restarts a random timer (stop + start_at)
+  and advances time by one tick, expiring whatever is due and starting it
+  again, so the population stays constant. Both queues see the same
+  sequence and must expire the same timers.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "test_util.h"
+#include "hal/hal_timer_wheel.h"
+
+#define BENCH_ROUNDS        (100000)
+#define BENCH_SPAN          (100000)    //!< Expiries are spread over this many ticks
+#define BENCH_MAX_TIMERS    (10000)
+
+static const int s_sizes[] = {10, 100, 1000, 10000};
+
+static struct hal_timer s_timers[BENCH_MAX_TIMERS];
+static struct hal_timer_wheel s_wheel;
+static TAILQ_HEAD(, hal_timer) s_list;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Reference: the sorted insert hal_timer_start_at used to do */
+static void
+list_start_at(struct hal_timer *timer, uint32_t tick)
+{
+    struct hal_timer *ht;
+
+    if (timer->link.tqe_prev != NULL) {
+        TAILQ_REMOVE(&s_list, timer, link);
+    }
+    timer->expiry = tick;
+    TAILQ_FOREACH(ht, &s_list, link) {
+        if ((int32_t)(timer->expiry - ht->expiry) < 0) {
+            TAILQ_INSERT_BEFORE(ht, timer, link);
+            break;
+        }
+    }
+    if (!ht) {
+        TAILQ_INSERT_TAIL(&s_list, timer, link);
+    }
+}
+
+static struct hal_timer *
+list_expire(uint32_t now)
+{
+    struct hal_timer *ht = TAILQ_FIRST(&s_list);
+
+    if (ht == NULL || (int32_t)(now - ht->expiry) < 0) {
+        return NULL;
+    }
+    TAILQ_REMOVE(&s_list, ht, link);
+    ht->link.tqe_prev = NULL;
+    return ht;
+}
+
+static void
+wheel_start_at(struct hal_timer *timer, uint32_t tick)
+{
+    hal_timer_wheel_remove(&s_wheel, timer);
+    timer->expiry = tick;
+    hal_timer_wheel_insert(&s_wheel, timer);
+}
+
+static struct hal_timer *
+wheel_expire(uint32_t now)
+{
+    return hal_timer_wheel_expire(&s_wheel, now);
+}
+
+/* Next expiry of an expired timer, independent of the order timers due on the same tick come out in */
+static uint32_t
+rearm_tick(struct hal_timer *timer, uint32_t now)
+{
+    uint32_t h = (uint32_t)(timer - s_timers) * 2654435761U ^ now * 40503U;
+
+    return now + 1 + (h ^ (h >> 15)) % BENCH_SPAN;
+}
+
+/* Runs the same pseudo random sequence on either queue, returns ns per round */
+static double
+bench(int ntimers, void (*start_at)(struct hal_timer *, uint32_t),
+      struct hal_timer *(*expire)(uint32_t), uint64_t *checksum)
+{
+    struct hal_timer *ht;
+    uint32_t now = 0xFFFF0000;      // Crosses the 32-bit wrap
+    uint64_t t0, sum = 0;
+
+    srand(ntimers);
+    TAILQ_INIT(&s_list);
+    hal_timer_wheel_init(&s_wheel, now);
+    for (int i = 0; i < ntimers; i++) {
+        s_timers[i].link.tqe_prev = NULL;
+        start_at(&s_timers[i], now + 1 + rand() % BENCH_SPAN);
+    }
+
+    t0 = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start_at(&s_timers[rand() % ntimers], now + 1 + rand() % BENCH_SPAN);
+        now++;
+        while ((ht = expire(now)) != NULL) {
+            sum += (uint64_t)(ht - s_timers) * ht->expiry;
+            start_at(ht, rearm_tick(ht, now));
+        }
+    }
+    *checksum = sum;
+    return (double)(now_ns() - t0) / BENCH_ROUNDS;
+}
+
+int main(void)
+{
+    printf("%8s %14s %14s %8s\n", "timers", "list ns/round", "wheel ns/round", "speedup");
+    for (unsigned int i = 0; i < sizeof(s_sizes) / sizeof(s_sizes[0]); i++) {
+        uint64_t list_sum, wheel_sum;
+        double list_ns = bench(s_sizes[i], list_start_at, list_expire, &list_sum);
+        double wheel_ns = bench(s_sizes[i], wheel_start_at, wheel_expire, &wheel_sum);
+
+        printf("%8d %14.1f %14.1f %7.1fx\n", s_sizes[i], list_ns, wheel_ns, list_ns / wheel_ns);
+        VerifyOrQuit(list_sum == wheel_sum, "hal_timer: wheel and list expired different timers");
+    }
+    return PASS;
+}
@@ -0,0 +1,236 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the MAC callback dispatch:
+
+  Registers 1 to 12 services on an instance, each owning one frame code,
+  and delivers a frame owned by the last registered service, the worst
+  case for the list. Compares the SLIST walk the interrupt handler used
+  to do, dw1000_mac_dispatch() with services that register no filter and
+  dw1000_mac_dispatch() with services that register their fctrl and code,
+  where only the owner is called. Each is called through the same
+  function pointer and the fastest of BENCH_REPEATS runs is reported.
+  Every variant must deliver the frame to the owner exactly once per
+  round. Also times dw1000_mac_classify(), run
+  once per frame ahead of the dispatch, and checks which services are
+  offered the frame, the fallback chain and a blink route.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "test_util.h"
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_ftypes.h>
+
+#define BENCH_ROUNDS        (1000000)
+#define BENCH_REPEATS       (5)         //!< Timed runs of BENCH_ROUNDS, the fastest is reported
+#define BENCH_SERVICES      (12)
+#define BENCH_CODE          (0x40)      //!< Code of the first service
+
+static const int s_sizes[] = {1, 2, 4, 8, 12};
+
+//! Service owning one frame code, counts what it is offered so the checks hold without DW1000_MAC_STATS
+typedef struct _bench_service_t{
+    uint16_t code;                  //!< Frame code owned
+    uint32_t offered;               //!< Frames offered
+    uint32_t consumed;              //!< Of which consumed
+}bench_service_t;
+
+static dw1000_dev_instance_t s_inst;
+static dw1000_mac_interface_t s_cbs[BENCH_SERVICES];
+static bench_service_t s_svc[BENCH_SERVICES];
+static uint32_t s_delivered;
+static uint32_t s_fallback;
+static ieee_std_frame_t s_frame;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Typical service: checks the frame control and its code, consumes what it owns */
+static bool __attribute__((noinline))
+rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    bench_service_t * svc = (bench_service_t *) cbs->inst_ptr;
+
+    svc->offered++;
+    if (inst->fctrl != FCNTL_IEEE_RANGE_16)
+        return false;
+    if (((ieee_std_frame_t *) inst->rxbuf)->code != svc->code)
+        return false;
+    svc->consumed++;
+    s_delivered++;
+    return true;
+}
+
+static bool __attribute__((noinline))
+fallback_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    s_fallback++;
+    s_delivered++;
+    return true;
+}
+
+static bool __attribute__((noinline))
+reset_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    return false;
+}
+
+/* Reference: the walk dw1000_interrupt_ev_cb used to do, called as dw1000_mac_dispatch() is */
+static bool __attribute__((noinline))
+walk(dw1000_dev_instance_t * inst, dw1000_mac_event_t event)
+{
+    dw1000_mac_interface_t * cbs = NULL;
+    if(!(SLIST_EMPTY(&inst->interface_cbs))){
+        SLIST_FOREACH(cbs, &inst->interface_cbs, next){
+        if (cbs != NULL && cbs->rx_complete_cb)
+            if(cbs->rx_complete_cb(inst,cbs)) return true;
+        }
+    }
+    return false;
+}
+
+static void __attribute__((noinline))
+table(dw1000_dev_instance_t * inst)
+{
+    dw1000_mac_dispatch(inst, DW1000_MAC_EV_RX_COMPLETE);
+}
+
+/* Received frame, classified */
+static void
+receive(const uint8_t * frame, uint16_t len)
+{
+    memcpy(s_inst.rxbuf, frame, len);
+    s_inst.fctrl = ((ieee_std_frame_t *) s_inst.rxbuf)->fctrl;
+    s_inst.frame_len = len;
+    dw1000_mac_classify(&s_inst);
+}
+
+static void
+setup(int nservices, bool filter)
+{
+    memset(&s_inst, 0, sizeof(s_inst));
+    SLIST_INIT(&s_inst.interface_cbs);
+    for (int i = 0; i < nservices; i++) {
+        memset(&s_cbs[i], 0, sizeof(s_cbs[i]));
+        s_svc[i] = (bench_service_t){.code = BENCH_CODE + i};
+        s_cbs[i].id = DW1000_APP0 + i;
+        s_cbs[i].inst_ptr = &s_svc[i];
+        s_cbs[i].rx_complete_cb = rx_complete_cb;
+        s_cbs[i].reset_cb = (i & 1) ? reset_cb : NULL;
+        if (filter) {
+            s_cbs[i].rx_fctrl = FCNTL_IEEE_RANGE_16;
+            s_cbs[i].rx_code_min = s_cbs[i].rx_code_max = s_svc[i].code;
+        }
+        dw1000_mac_append_interface(&s_inst, &s_cbs[i]);
+    }
+    s_frame.fctrl = FCNTL_IEEE_RANGE_16;
+    s_frame.code = BENCH_CODE + nservices - 1;
+    receive(s_frame.array, sizeof(s_frame));
+}
+
+static double
+bench(int nservices, bool filter, bool (*dispatch)(dw1000_dev_instance_t *, dw1000_mac_event_t))
+{
+    uint64_t best = UINT64_MAX;
+
+    setup(nservices, filter);
+    s_delivered = 0;
+    for (int k = 0; k < BENCH_REPEATS; k++) {
+        uint64_t t0 = now_ns();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            dispatch(&s_inst, DW1000_MAC_EV_RX_COMPLETE);
+        }
+        uint64_t t = now_ns() - t0;
+        best = t < best ? t : best;
+    }
+    return (double)best / BENCH_ROUNDS;
+}
+
+int main(void)
+{
+    printf("%9s %10s %14s %16s\n", "services", "walk ns", "table ns", "table+demux ns");
+    for (unsigned int i = 0; i < sizeof(s_sizes) / sizeof(s_sizes[0]); i++) {
+        double walk_ns = bench(s_sizes[i], false, walk);
+        VerifyOrQuit(s_delivered == BENCH_REPEATS * BENCH_ROUNDS, "dispatch: walk lost frames");
+        double table_ns = bench(s_sizes[i], false, dw1000_mac_dispatch);
+        VerifyOrQuit(s_delivered == BENCH_REPEATS * BENCH_ROUNDS, "dispatch: table lost frames");
+        VerifyOrQuit(s_inst.dispatch.nhandlers[DW1000_MAC_EV_RESET] == s_sizes[i] / 2, "dispatch: NULL callbacks in the table");
+        double demux_ns = bench(s_sizes[i], true, dw1000_mac_dispatch);
+        VerifyOrQuit(s_delivered == BENCH_REPEATS * BENCH_ROUNDS, "dispatch: demux lost frames");
+        VerifyOrQuit(s_svc[s_sizes[i] - 1].consumed == BENCH_REPEATS * BENCH_ROUNDS && (s_sizes[i] == 1 || s_svc[0].offered == 0),
+                     "dispatch: demux offered the frame to other services");
+
+        printf("%9d %10.1f %14.1f %16.1f\n", s_sizes[i], walk_ns, table_ns, demux_ns);
+    }
+
+    uint64_t t0 = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        ((ieee_std_frame_t *) s_inst.rxbuf)->seq_num = r;
+        dw1000_mac_classify(&s_inst);
+    }
+    printf("classify %.1f ns/frame\n", (double)(now_ns() - t0) / BENCH_ROUNDS);
+    VerifyOrQuit(s_inst.frame_desc.type == DW1000_MAC_FTYPE_STD && s_inst.frame_desc.has_code &&
+                 s_inst.frame_desc.code == s_frame.code && s_inst.frame_desc.hdr_len == sizeof(s_frame),
+                 "classify: std frame header");
+
+    /* Frames nobody owns go to the fallback chain, after the owners */
+    dw1000_mac_interface_t fallback = {.id = DW1000_APP0 + BENCH_SERVICES, .rx_complete_cb = fallback_cb};
+    fallback.status.rx_fallback = 1;
+    setup(BENCH_SERVICES, true);
+    dw1000_mac_append_interface(&s_inst, &fallback);
+    s_delivered = s_fallback = 0;
+    table(&s_inst);
+    VerifyOrQuit(s_delivered == 1 && s_fallback == 0, "dispatch: fallback called before the owner");
+    s_frame.code = BENCH_CODE + BENCH_SERVICES;
+    receive(s_frame.array, sizeof(s_frame));
+    table(&s_inst);
+    VerifyOrQuit(s_delivered == 2 && s_fallback == 1, "dispatch: unclaimed frame lost");
+
+    /* A one octet rx_fctrl routes blinks */
+    ieee_blink_frame_t blink = {.fctrl = FCNTL_IEEE_BLINK_CCP_64, .seq_num = 7, .euid = 0x0123456789ABCDEFULL};
+    s_cbs[0].rx_fctrl = FCNTL_IEEE_BLINK_CCP_64;
+    s_cbs[0].rx_code_min = s_cbs[0].rx_code_max = 0;
+    dw1000_mac_dispatch_rebuild(&s_inst);
+    receive(blink.array, sizeof(blink));
+    VerifyOrQuit(s_inst.frame_desc.type == DW1000_MAC_FTYPE_BLINK && s_inst.frame_desc.euid == blink.euid,
+                 "classify: blink header");
+    s_svc[0].offered = s_svc[1].offered = 0;
+    table(&s_inst);
+    VerifyOrQuit(s_svc[0].offered == 1 && s_svc[1].offered == 0 && s_fallback == 2,
+                 "dispatch: blink not routed to its owner");
+
+    /* Removing a service takes it out of every table */
+    setup(BENCH_SERVICES, true);
+    dw1000_mac_remove_interface(&s_inst, DW1000_APP0 + BENCH_SERVICES - 1);
+    s_delivered = 0;
+    table(&s_inst);
+    VerifyOrQuit(s_delivered == 0 && s_inst.dispatch.nhandlers[DW1000_MAC_EV_RX_COMPLETE] == BENCH_SERVICES - 1,
+                 "dispatch: removed service still called");
+    return PASS;
+}
@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the precompiled PHY/MAC register profiles:
+
+  Two instances on the simulated radio, clocked at 8MHz, each with three
+  cached profiles: ranging at 6.8Mbps, data at 850kbps with the DW SFD,
+  and a hop to channel 2. Both radios cycle through the profiles and a
+  frame must get across after every switch, while a receiver left on
+  another channel must not hear it. The SPI transfers and the time of a
+  switch between cached profiles are compared with a full
+  reconfiguration, and the registers read back must match the profile.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_profile.h>
+
+#define BENCH_SPI_HZ        (8000000)
+#define BENCH_SWITCHES      (30)
+#define NPROFILES           (3)
+
+/* Ranging, data and channel 2 variants of the default configuration */
+static void
+make_profiles(dw1000_dev_instance_t * inst, dw1000_profile_t * profiles)
+{
+    dw1000_dev_config_t config = inst->config;
+
+    dw1000_profile_compile(&profiles[0], &config);
+
+    config.dataRate = DWT_BR_850K;
+    config.tx.preambleLength = DWT_PLEN_256;
+    config.rx.pacLength = DWT_PAC16;
+    config.rx.sfdType = 1;
+    config.rx.sfdTimeout = 256 + 1 + 16 - 16;
+    dw1000_profile_compile(&profiles[1], &config);
+
+    config = inst->config;
+    config.channel = 2;
+    config.rx.preambleCodeIndex = config.tx.preambleCodeIndex = 10;
+    config.txrf.PGdly = TC_PGDELAY_CH2;
+    dw1000_profile_compile(&profiles[2], &config);
+}
+
+/* Transfers spent applying the profile to the first instance */
+static uint32_t
+apply(dw1000_dev_instance_t * inst, dw1000_profile_t * profile)
+{
+    struct hal_dw1000_sim_stats s0, s1;
+
+    hal_dw1000_sim_node_stats(inst->idx, &s0);
+    dw1000_profile_apply(inst, profile);
+    hal_dw1000_sim_node_stats(inst->idx, &s1);
+    return s1.spi_xfers - s0.spi_xfers;
+}
+
+static void
+verify(dw1000_dev_instance_t * inst, dw1000_profile_t * profile)
+{
+    VerifyOrQuit((uint32_t)dw1000_read_reg(inst, CHAN_CTRL_ID, 0, sizeof(uint32_t)) == profile->regs[DW1000_PROFILE_CHAN_CTRL],
+                 "profile: CHAN_CTRL");
+    VerifyOrQuit((uint32_t)dw1000_read_reg(inst, DRX_CONF_ID, DRX_TUNE2_OFFSET, sizeof(uint32_t)) == profile->regs[DW1000_PROFILE_DRX_TUNE2],
+                 "profile: DRX_TUNE2");
+    VerifyOrQuit((uint32_t)dw1000_read_reg(inst, FS_CTRL_ID, FS_PLLCFG_OFFSET, sizeof(uint32_t)) == profile->regs[DW1000_PROFILE_FS_PLLCFG],
+                 "profile: FS_PLLCFG");
+    VerifyOrQuit((uint16_t)dw1000_read_reg(inst, LDE_IF_ID, LDE_REPC_OFFSET, sizeof(uint16_t)) == profile->regs[DW1000_PROFILE_LDE_REPC],
+                 "profile: LDE_REPC");
+    VerifyOrQuit((uint8_t)dw1000_read_reg(inst, TX_CAL_ID, TC_PGDELAY_OFFSET, sizeof(uint8_t)) == profile->regs[DW1000_PROFILE_TC_PGDELAY],
+                 "profile: TC_PGDELAY");
+    VerifyOrQuit(inst->config.channel == profile->config.channel && inst->config.dataRate == profile->config.dataRate,
+                 "profile: inst->config");
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * tag = hal_dw1000_inst(0), * anchor = hal_dw1000_inst(1);
+    dw1000_profile_t profiles[2][NPROFILES], again;
+    uint32_t full_xfers = 0, full_usec = 0, switch_xfers = 0, switch_usec = 0;
+
+    test_sim_init(2, BENCH_SPI_HZ, false);
+    for (int i = 0; i < 2; i++)
+        make_profiles(hal_dw1000_inst(i), profiles[i]);
+    test_sim_listen(anchor);
+
+    dw1000_profile_compile(&again, &tag->config);
+    VerifyOrQuit(dw1000_profile_equal(&again, &profiles[0][0]), "profile: same configuration differs");
+    VerifyOrQuit(!dw1000_profile_equal(&profiles[0][0], &profiles[0][1]), "profile: data equals ranging");
+    VerifyOrQuit(apply(tag, &profiles[0][0]) == 0, "profile: the configuration applied writes again");
+
+    /* Full reconfiguration, as after a reset */
+    for (int k = 0; k < BENCH_SWITCHES; k++) {
+        dw1000_profile_t * p = &profiles[0][k % NPROFILES];
+        dw1000_profile_invalidate(tag);
+        full_xfers += apply(tag, p);
+        full_usec += tag->profile.apply_usec;
+        verify(tag, p);
+        dw1000_profile_apply(anchor, &profiles[1][k % NPROFILES]);
+        VerifyOrQuit(test_sim_send(tag, anchor), "profile: frame lost after a full reconfiguration");
+    }
+
+    /* Switches between cached profiles */
+    for (int k = 0; k < BENCH_SWITCHES; k++) {
+        dw1000_profile_t * p = &profiles[0][k % NPROFILES];
+        switch_xfers += apply(tag, p);
+        switch_usec += tag->profile.apply_usec;
+        verify(tag, p);
+        dw1000_profile_apply(anchor, &profiles[1][k % NPROFILES]);
+        VerifyOrQuit(test_sim_send(tag, anchor), "profile: frame lost after a switch");
+    }
+
+    /* A receiver left on channel 5 does not hear channel 2 */
+    dw1000_profile_apply(tag, &profiles[0][2]);
+    dw1000_profile_apply(anchor, &profiles[1][0]);
+    VerifyOrQuit(!test_sim_send(tag, anchor), "profile: frame heard on another channel");
+
+    printf("reconfiguration: full %.1f spi xfers %lu usec, cached profile switch %.1f spi xfers %lu usec\n",
+           (double)full_xfers / BENCH_SWITCHES, (unsigned long)(full_usec / BENCH_SWITCHES),
+           (double)switch_xfers / BENCH_SWITCHES, (unsigned long)(switch_usec / BENCH_SWITCHES));
+    dw1000_profile_dump(tag, printf);
+    VerifyOrQuit(switch_xfers * 2 < full_xfers, "profile: switch costs more than half a full reconfiguration");
+    return PASS;
+}
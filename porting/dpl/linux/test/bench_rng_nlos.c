@@ -0,0 +1,424 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Training and evaluation of the line of sight classifier:
+
+    bench_rng_nlos [recording.csv]   train and evaluate on a recording
+    bench_rng_nlos -w                print the simulated set as a recording
+
+  A recording has one frame per line, as printed by rng_nlos_record():
+  label,prf,nsync,fp_amp,fp_amp2,fp_amp3,rx_std,cir_pwr,pacc_cnt and
+  optionally the real,imag pairs of the CIR window; label 1 is LOS.
+  Without one, frames are simulated: LOS frames with a sharp first path
+  a few dB under the total power, NLOS frames with an attenuated,
+  slowly rising first path and the energy arriving later.
+
+  Even frames train a logistic regression on the rng_nlos features,
+  odd frames evaluate it in float, in fixed point as rng_nlos runs it,
+  and against dw1000_estimate_los(). The fixed point models are printed
+  as initializers for rng_nlos.c. On the simulated set the library's
+  default models are run through rng_nlos_los() on a device instance.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "test_util.h"
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_mac.h>
+#include <cir/cir.h>
+#include <rng/rng_nlos.h>
+
+#define MAX_FRAMES  (20000)
+#define NCIR        (8)
+#define NSIM        (4000)
+
+typedef struct {
+    uint8_t los;
+    uint8_t prf;
+    uint16_t nsync;
+    dw1000_dev_rxdiag_t diag;
+    bool has_cir;
+    int16_t iq[2 * NCIR];
+    float f[RNG_NLOS_NFEATURES];
+    int32_t q[RNG_NLOS_NFEATURES];
+} record_t;
+
+static record_t s_rec[MAX_FRAMES];
+static int s_nrec;
+
+static uint32_t s_seed = 1;
+static float
+frand(void)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return (float)((s_seed >> 8) & 0xffff) / 65536.0f;
+}
+
+static float
+gauss(void)
+{
+    return sqrtf(-2.0f * logf(frand() + 1e-6f)) * cosf(2.0f * M_PI * frand());
+}
+
+static uint16_t
+sat16(float v)
+{
+    return v < 0 ? 0 : (v > 65535 ? 65535 : (uint16_t)v);
+}
+
+static void
+simulate(record_t * r)
+{
+    static const uint16_t nsyncs[] = {128, 256, 1024};
+    bool los = frand() < 0.5f;
+    float sigma = 40 + 80 * frand();
+    float snr = los ? 8 + 30 * frand() : 3 + 25 * frand();
+    float excess = los ? 1.5f + 5 * frand() + (frand() < 0.1f ? 4 : 0) : 5 + 9 * frand();
+    float shape[3] = {0.55f, 1.0f, 0.7f};
+
+    /* Some NLOS frames, e.g. through a thin wall, keep a sharp first path */
+    if (!los && frand() < 0.7f) {
+        shape[0] = 0.3f;
+        shape[1] = 0.7f;
+        shape[2] = 1.0f;
+    }
+    float s = 0;
+    for (int i = 0; i < 3; i++) {
+        shape[i] *= 1 + (los ? 0.15f : 0.25f) * gauss();
+        shape[i] = fabsf(shape[i]) + 0.05f;
+        s += shape[i] * shape[i];
+    }
+    float fp = 3 * sigma * sigma * powf(10, snr / 10);
+    memset(r, 0, sizeof(*r));
+    r->los = los;
+    r->prf = DWT_PRF_64M;
+    r->nsync = nsyncs[(int)(frand() * 3)];
+    r->diag.rx_std = sat16(sigma);
+    r->diag.fp_amp = sat16(shape[0] * sqrtf(fp / s));
+    r->diag.fp_amp2 = sat16(shape[1] * sqrtf(fp / s));
+    r->diag.fp_amp3 = sat16(shape[2] * sqrtf(fp / s));
+    r->diag.cir_pwr = sat16(fp * powf(10, excess / 10) / 131072);
+    r->diag.pacc_cnt = (uint16_t)(r->nsync * (los ? 0.7f + 0.3f * frand() : 0.55f + 0.45f * frand()));
+    r->diag.fp_idx = 745 << 6;
+
+    /* Window from a sample ahead of the first path, divided by the preamble count as cir.c does */
+    float a = sqrtf(fp / 3) / r->diag.pacc_cnt * 8, tau = los ? 0.7f + 1.3f * frand() : 1 + 2 * frand();
+    int peak = los ? 1 : 2 + (int)(5 * frand());
+    r->has_cir = true;
+    for (int i = 0; i < NCIR; i++) {
+        float amp = 0;
+        if (i >= 1)
+            amp = a * (los ? expf(-(i - 1) / tau) : (i < peak ? 0.3f * (i - 1 + 1) / peak : 1.5f * expf(-(i - peak) / tau)));
+        float ph = 2 * M_PI * frand(), n = sigma / r->diag.pacc_cnt * 8;
+        r->iq[2 * i] = (int16_t)(amp * cosf(ph) + n * gauss());
+        r->iq[2 * i + 1] = (int16_t)(amp * sinf(ph) + n * gauss());
+    }
+}
+
+static bool
+load(const char * path)
+{
+    FILE * f = fopen(path, "r");
+    char line[512];
+
+    if (f == NULL)
+        return false;
+    while (s_nrec < MAX_FRAMES && fgets(line, sizeof(line), f)) {
+        long v[9 + 2 * NCIR];
+        int n = 0;
+        char * p = line, * end;
+        if (line[0] == '#')
+            continue;
+        while (n < 9 + 2 * NCIR) {
+            v[n] = strtol(p, &end, 10);
+            if (end == p)
+                break;
+            n++;
+            p = (*end == ',') ? end + 1 : end;
+        }
+        if (n != 9 && n != 9 + 2 * NCIR)
+            continue;
+        record_t * r = &s_rec[s_nrec++];
+        memset(r, 0, sizeof(*r));
+        r->los = v[0] != 0;
+        r->prf = v[1];
+        r->nsync = v[2];
+        r->diag.fp_amp = v[3];
+        r->diag.fp_amp2 = v[4];
+        r->diag.fp_amp3 = v[5];
+        r->diag.rx_std = v[6];
+        r->diag.cir_pwr = v[7];
+        r->diag.pacc_cnt = v[8];
+        r->has_cir = n > 9;
+        for (int i = 0; r->has_cir && i < 2 * NCIR; i++)
+            r->iq[i] = v[9 + i];
+    }
+    fclose(f);
+    return s_nrec > 0;
+}
+
+static float
+sigmoid(float z)
+{
+    return 1 / (1 + expf(-z));
+}
+
+/* Logistic regression on standardised features, returned unstandardised: w[nf] is the bias */
+static void
+train(int nf, float * w)
+{
+    float mean[RNG_NLOS_NFEATURES] = {0}, sd[RNG_NLOS_NFEATURES] = {0}, ws[RNG_NLOS_NFEATURES + 1] = {0};
+    int n = 0;
+
+    for (int k = 0; k < s_nrec; k += 2, n++)
+        for (int i = 0; i < nf; i++)
+            mean[i] += s_rec[k].f[i];
+    for (int i = 0; i < nf; i++)
+        mean[i] /= n;
+    for (int k = 0; k < s_nrec; k += 2)
+        for (int i = 0; i < nf; i++)
+            sd[i] += powf(s_rec[k].f[i] - mean[i], 2);
+    for (int i = 0; i < nf; i++)
+        sd[i] = sqrtf(sd[i] / n) + 1e-6f;
+
+    for (int it = 0; it < 1500; it++) {
+        float g[RNG_NLOS_NFEATURES + 1] = {0};
+        for (int k = 0; k < s_nrec; k += 2) {
+            float z = ws[nf];
+            for (int i = 0; i < nf; i++)
+                z += ws[i] * (s_rec[k].f[i] - mean[i]) / sd[i];
+            float e = sigmoid(z) - s_rec[k].los;
+            for (int i = 0; i < nf; i++)
+                g[i] += e * (s_rec[k].f[i] - mean[i]) / sd[i];
+            g[nf] += e;
+        }
+        for (int i = 0; i <= nf; i++)
+            ws[i] -= 1.0f * (g[i] / n + (i < nf ? 1e-3f * ws[i] : 0));
+    }
+    w[nf] = ws[nf];
+    for (int i = 0; i < nf; i++) {
+        w[i] = ws[i] / sd[i];
+        w[nf] -= ws[i] * mean[i] / sd[i];
+    }
+}
+
+static void
+quantize(int nf, const float * w, rng_nlos_model_t * model)
+{
+    memset(model, 0, sizeof(*model));
+    model->nfeatures = nf;
+    model->bias = (int32_t)lroundf(w[nf] * 256);
+    for (int i = 0; i < nf; i++) {
+        float q = w[i] * 4096;
+        VerifyOrQuit(fabsf(q) < 32767, "nlos: weight out of Q12 range");
+        model->weight[i] = (int16_t)lroundf(q);
+    }
+}
+
+static void
+print_model(const char * name, const rng_nlos_model_t * model)
+{
+    printf("static const rng_nlos_model_t %s = {\n    .nfeatures = %s,\n    .bias = %ld,\n    .weight = {",
+           name, model->nfeatures == RNG_NLOS_NDIAG ? "RNG_NLOS_NDIAG" : "RNG_NLOS_NFEATURES", (long)model->bias);
+    for (int i = 0; i < model->nfeatures; i++)
+        printf("%s%d", i ? ", " : "", model->weight[i]);
+    printf("},\n};\n");
+}
+
+typedef struct {
+    float acc_float, acc_fixed, acc_heuristic, max_diff, nlos_recall;
+    int n;
+} eval_t;
+
+static eval_t
+evaluate(int nf, const float * w, const rng_nlos_model_t * model, bool need_cir)
+{
+    static dw1000_dev_instance_t inst;
+    eval_t e = {0};
+    int ok_float = 0, ok_fixed = 0, ok_heur = 0, nlos = 0, nlos_found = 0;
+
+    for (int k = 1; k < s_nrec; k += 2) {
+        record_t * r = &s_rec[k];
+        if (need_cir && !r->has_cir)
+            continue;
+        float z = w[nf];
+        for (int i = 0; i < nf; i++)
+            z += w[i] * r->f[i];
+        float pf = sigmoid(z), pq = (float)rng_nlos_classify(model, r->q) / RNG_NLOS_ONE;
+        inst.config.prf = r->prf;
+        float heur = dw1000_estimate_los(dw1000_calc_rssi(&inst, &r->diag), dw1000_calc_fppl(&inst, &r->diag));
+        ok_float += (pf > 0.5f) == r->los;
+        ok_fixed += (pq > 0.5f) == r->los;
+        ok_heur += (heur > 0.5f) == r->los;
+        if (!r->los) {
+            nlos++;
+            nlos_found += pq <= 0.5f;
+        }
+        e.max_diff = fmaxf(e.max_diff, fabsf(pf - pq));
+        e.n++;
+    }
+    e.acc_float = (float)ok_float / e.n;
+    e.acc_fixed = (float)ok_fixed / e.n;
+    e.acc_heuristic = (float)ok_heur / e.n;
+    e.nlos_recall = nlos ? (float)nlos_found / nlos : 0;
+    return e;
+}
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char ** argv)
+{
+    bool simulated = argc < 2 || !strcmp(argv[1], "-w");
+    float w_diag[RNG_NLOS_NFEATURES + 1], w_cir[RNG_NLOS_NFEATURES + 1];
+    rng_nlos_model_t diag_model, cir_model;
+    int ncir = 0;
+
+    if (simulated) {
+        for (s_nrec = 0; s_nrec < NSIM; s_nrec++)
+            simulate(&s_rec[s_nrec]);
+        if (argc > 1) {
+            printf("# label,prf,nsync,fp_amp,fp_amp2,fp_amp3,rx_std,cir_pwr,pacc_cnt,iq...\n");
+            for (int k = 0; k < s_nrec; k++) {
+                record_t * r = &s_rec[k];
+                printf("%u,%u,%u,%u,%u,%u,%u,%u,%u", r->los, r->prf, r->nsync, r->diag.fp_amp, r->diag.fp_amp2,
+                       r->diag.fp_amp3, r->diag.rx_std, r->diag.cir_pwr, r->diag.pacc_cnt);
+                for (int i = 0; i < 2 * NCIR; i++)
+                    printf(",%d", r->iq[i]);
+                printf("\n");
+            }
+            return PASS;
+        }
+    } else if (!load(argv[1])) {
+        printf("nlos: no frames in %s\n", argv[1]);
+        return FAIL;
+    }
+
+    /* Fixed point levels against 10log10() */
+    float max_db = 0;
+    for (uint64_t x = 1; x < (1ULL << 40); x = x * 3 / 2 + 1)
+        max_db = fmaxf(max_db, fabsf(rng_nlos_db(x) / 256.0f - 10 * log10f((float)x)));
+    VerifyOrQuit(max_db < 0.02f, "nlos: rng_nlos_db");
+
+    for (int k = 0; k < s_nrec; k++) {
+        record_t * r = &s_rec[k];
+        rng_nlos_diag_features(&r->diag, r->nsync, r->q);
+        if (r->has_cir && !rng_nlos_cir_features(r->iq, NCIR, r->q))
+            r->has_cir = false;
+        ncir += r->has_cir;
+        for (int i = 0; i < RNG_NLOS_NFEATURES; i++)
+            r->f[i] = r->q[i] / 256.0f;
+    }
+    printf("%d frames, %d with a CIR window, 10log10 within %.3f dB\n", s_nrec, ncir, max_db);
+
+    train(RNG_NLOS_NDIAG, w_diag);
+    quantize(RNG_NLOS_NDIAG, w_diag, &diag_model);
+    eval_t ed = evaluate(RNG_NLOS_NDIAG, w_diag, &diag_model, false);
+    printf("rxdiag model:       %d frames, accuracy float %.3f fixed %.3f heuristic %.3f, NLOS recall %.3f, max |p float - p fixed| %.4f\n",
+           ed.n, ed.acc_float, ed.acc_fixed, ed.acc_heuristic, ed.nlos_recall, ed.max_diff);
+
+    eval_t ec = {0};
+    if (ncir > 100) {
+        /* Train on the frames with a window only */
+        int n = s_nrec;
+        static record_t all[MAX_FRAMES];
+        memcpy(all, s_rec, sizeof(record_t) * n);
+        s_nrec = 0;
+        for (int k = 0; k < n; k++)
+            if (all[k].has_cir)
+                s_rec[s_nrec++] = all[k];
+        train(RNG_NLOS_NFEATURES, w_cir);
+        quantize(RNG_NLOS_NFEATURES, w_cir, &cir_model);
+        ec = evaluate(RNG_NLOS_NFEATURES, w_cir, &cir_model, true);
+        printf("rxdiag + CIR model: %d frames, accuracy float %.3f fixed %.3f heuristic %.3f, NLOS recall %.3f, max |p float - p fixed| %.4f\n",
+               ec.n, ec.acc_float, ec.acc_fixed, ec.acc_heuristic, ec.nlos_recall, ec.max_diff);
+        memcpy(s_rec, all, sizeof(record_t) * n);
+        s_nrec = n;
+    }
+
+    print_model("g_rng_nlos_diag_default", &diag_model);
+    if (ncir > 100)
+        print_model("g_rng_nlos_cir_default", &cir_model);
+
+    double t0 = now_ns();
+    volatile uint32_t sink = 0;
+    for (int rep = 0; rep < 50; rep++) {
+        for (int k = 0; k < s_nrec; k++) {
+            int32_t q[RNG_NLOS_NFEATURES];
+            rng_nlos_diag_features(&s_rec[k].diag, s_rec[k].nsync, q);
+            rng_nlos_cir_features(s_rec[k].iq, NCIR, q);
+            sink += rng_nlos_classify(ncir > 100 ? &cir_model : &diag_model, q);
+        }
+    }
+    double t_fixed = (now_ns() - t0) / (50.0 * s_nrec);
+    static dw1000_dev_instance_t inst;
+    inst.config.prf = DWT_PRF_64M;
+    t0 = now_ns();
+    for (int rep = 0; rep < 50; rep++)
+        for (int k = 0; k < s_nrec; k++)
+            sink += dw1000_estimate_los(dw1000_calc_rssi(&inst, &s_rec[k].diag), dw1000_calc_fppl(&inst, &s_rec[k].diag)) > 0.5f;
+    printf("per frame: features + model %.0f ns, rssi/fppl heuristic %.0f ns\n", t_fixed, (now_ns() - t0) / (50.0 * s_nrec));
+
+    if (!simulated)
+        return PASS;
+
+    VerifyOrQuit(ed.max_diff < 0.01f && ec.max_diff < 0.01f, "nlos: fixed point off the float model");
+    VerifyOrQuit(ed.acc_fixed > ed.acc_heuristic + 0.03f, "nlos: rxdiag model no better than the heuristic");
+    VerifyOrQuit(ec.acc_fixed > ed.acc_fixed, "nlos: CIR features did not help");
+
+    /* The library's default models through the device instance, on the evaluation frames */
+    static cir_instance_t cir;
+    int ok_diag = 0, ok_cir = 0, n = 0;
+    inst.cir = &cir;
+    inst.config.rxdiag_enable = 1;
+    for (int k = 1; k < s_nrec; k += 2, n++) {
+        inst.rxdiag = s_rec[k].diag;
+        inst.attrib.nsync = s_rec[k].nsync;
+        cir.status.valid = 0;
+        ok_diag += (rng_nlos_los(&inst) > RNG_NLOS_ONE / 2) == s_rec[k].los;
+        memcpy(cir.cir.array, s_rec[k].iq, sizeof(s_rec[k].iq));
+        cir.status.valid = 1;
+        ok_cir += (rng_nlos_los(&inst) > RNG_NLOS_ONE / 2) == s_rec[k].los;
+    }
+    float var[2] = {0, 0};
+    int nvar[2] = {0, 0};
+    for (int k = 1; k < s_nrec; k += 2) {
+        inst.rxdiag = s_rec[k].diag;
+        inst.attrib.nsync = s_rec[k].nsync;
+        memcpy(cir.cir.array, s_rec[k].iq, sizeof(s_rec[k].iq));
+        var[s_rec[k].los] += rng_nlos_range_variance(&inst, 1.0f);
+        nvar[s_rec[k].los]++;
+    }
+    printf("range variance multiplier: LOS frames %.2f, NLOS frames %.2f\n", var[1] / nvar[1], var[0] / nvar[0]);
+    VerifyOrQuit(var[0] / nvar[0] > 4 * var[1] / nvar[1], "nlos: variance not widened");
+    printf("default models: accuracy rxdiag %.3f, rxdiag + CIR %.3f\n", (float)ok_diag / n, (float)ok_cir / n);
+    VerifyOrQuit((float)ok_diag / n > ed.acc_heuristic + 0.03f && (float)ok_cir / n > (float)ok_diag / n, "nlos: default models");
+    return PASS;
+}
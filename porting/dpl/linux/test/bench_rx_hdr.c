@@ -0,0 +1,185 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the header first receive path with the stock services:
+
+  Both instances on the simulated radio run ccp and twr_ss over rng,
+  registered as their packages do; ccp takes every frame and only reads
+  the payload of its blinks. Instance 1 sends instance 0 long data
+  frames of four kinds:
+    - ranging frames to instance 0 or to every node, routed to rng and
+      read in full,
+    - ranging frames of two other nodes, offered to ccp with their
+      header only and never to rng,
+    - frames to instance 0 no service has a filter for, offered to ccp
+      with their header only,
+    - frames of another PAN, dropped on their header before any service
+      sees them.
+  The SPI octets the receiver spends on each kind are compared, a probe
+  registered ahead of the services checks what is offered.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_phy.h>
+#include <dw1000/dw1000_ftypes.h>
+#include <ccp/ccp.h>
+#include <rng/rng.h>
+#include <twr_ss/twr_ss.h>
+
+#define BENCH_FRAMES    (20)
+#define FRAME_LEN       (100)
+#define FOREIGN_PANID   (0x1234)
+#define OTHER_DST       (0x1234)
+#define OTHER_SRC       (0x4321)
+#define OTHER_CODE      (0x7F00)    //!< Outside every service's code range
+#define FRAME_WAIT_US   (5000)
+
+//! What the probe was offered
+static struct {
+    int cnt;                        //!< Frames
+    int hdr_only;                   //!< Of which with their header only
+} s_probe;
+
+static bool
+probe_rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    s_probe.cnt++;
+    s_probe.hdr_only += inst->frame_desc.hdr_only;
+    return false;
+}
+
+/* Every frame, the payload of none */
+static dw1000_mac_interface_t s_probe_cbs = {
+    .id = 100,
+    .rx_complete_cb = probe_rx_complete_cb,
+    .status.rx_any = 1,
+    .rx_fctrl = FCNTL_IEEE_BLINK_ANC_64
+};
+
+/* Range frame from OTHER_SRC, a node other than the receiver */
+static void
+make_frame(uint8_t * frame, int k, uint16_t panid, uint16_t dst, uint16_t code)
+{
+    uint16_t fctrl = FCNTL_IEEE_RANGE_16;
+    uint16_t src = OTHER_SRC;
+
+    memset(frame, 0, FRAME_LEN);
+    memcpy(&frame[0], &fctrl, 2);
+    frame[2] = (uint8_t)k;
+    memcpy(&frame[3], &panid, 2);
+    memcpy(&frame[5], &dst, 2);
+    memcpy(&frame[7], &src, 2);
+    memcpy(&frame[9], &code, 2);
+}
+
+/* SPI octets the receiver spends on the frame */
+static uint32_t
+send(dw1000_dev_instance_t * tx, dw1000_dev_instance_t * rx, uint8_t * frame)
+{
+    struct hal_dw1000_sim_stats s0, s1;
+
+    dw1000_start_rx(rx);
+    hal_dw1000_sim_node_stats(0, &s0);
+    dw1000_write_tx(tx, frame, 0, FRAME_LEN);
+    dw1000_write_tx_fctrl(tx, FRAME_LEN, 0);
+    test_sim_tx(tx);
+    usleep(FRAME_WAIT_US);
+    hal_dw1000_sim_node_stats(0, &s1);
+    dw1000_phy_forcetrxoff(rx);
+    VerifyOrQuit(s1.rx_frames == s0.rx_frames + 1, "rx_hdr: frame lost");
+    return s1.spi_bytes - s0.spi_bytes;
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * rx = hal_dw1000_inst(0), * tx = hal_dw1000_inst(1);
+    uint32_t routed = 0, other_node = 0, other = 0, foreign = 0;
+    uint8_t frame[FRAME_LEN];
+
+    test_sim_init(2, 0, false);
+    dw1000_mac_append_interface(rx, &s_probe_cbs);
+    /* rng_pkg_init() sets up both instances, with WCS_ENABLED each needs its ccp first */
+    dw1000_ccp_init(rx, 2);
+    dw1000_ccp_init(tx, 2);
+    rng_pkg_init();
+    twr_ss_pkg_init();
+    dw1000_mac_interface_t * ccp = dw1000_mac_get_interface(rx, DW1000_CCP);
+    dw1000_mac_interface_t * rng = dw1000_mac_get_interface(rx, DW1000_RNG);
+    VerifyOrQuit(ccp && rng, "rx_hdr: services");
+    VerifyOrQuit(rx->config.framefilter_enabled == 0, "rx_hdr: the receiver filters in software");
+    VerifyOrQuit(rx->my_short_address != OTHER_DST && rx->my_short_address != OTHER_SRC, "rx_hdr: receiver address");
+
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        make_frame(frame, k, rx->PANID, (k & 1) ? 0xFFFF : rx->my_short_address, DWT_SS_TWR);
+        routed += send(tx, rx, frame);
+    }
+    VerifyOrQuit(s_probe.cnt == BENCH_FRAMES && s_probe.hdr_only == 0, "rx_hdr: routed frames offered in full");
+#if MYNEWT_VAL(DW1000_MAC_STATS)
+    VerifyOrQuit(rng->rx_hits + rng->rx_misses == BENCH_FRAMES, "rx_hdr: routed frames reach rng");
+    uint32_t ccp_offered = ccp->rx_hits + ccp->rx_misses;
+#endif
+
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        make_frame(frame, k, rx->PANID, OTHER_DST, DWT_SS_TWR);
+        other_node += send(tx, rx, frame);
+    }
+    VerifyOrQuit(s_probe.cnt == 2 * BENCH_FRAMES && s_probe.hdr_only == BENCH_FRAMES,
+                 "rx_hdr: ranging frames of other nodes offered with their header");
+#if MYNEWT_VAL(DW1000_MAC_STATS)
+    VerifyOrQuit(rng->rx_hits + rng->rx_misses == BENCH_FRAMES, "rx_hdr: ranging frames of other nodes kept from rng");
+    VerifyOrQuit(ccp->rx_hits + ccp->rx_misses == ccp_offered + BENCH_FRAMES, "rx_hdr: ranging frames of other nodes reach ccp");
+#endif
+
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        make_frame(frame, k, rx->PANID, rx->my_short_address, OTHER_CODE);
+        other += send(tx, rx, frame);
+    }
+    VerifyOrQuit(s_probe.cnt == 3 * BENCH_FRAMES && s_probe.hdr_only == 2 * BENCH_FRAMES,
+                 "rx_hdr: other frames offered with their header");
+#if MYNEWT_VAL(DW1000_MAC_STATS)
+    VerifyOrQuit(ccp->rx_hits + ccp->rx_misses == ccp_offered + 2 * BENCH_FRAMES, "rx_hdr: other frames reach ccp");
+#endif
+
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        make_frame(frame, k, FOREIGN_PANID, rx->my_short_address, DWT_SS_TWR);
+        foreign += send(tx, rx, frame);
+    }
+    VerifyOrQuit(s_probe.cnt == 3 * BENCH_FRAMES, "rx_hdr: foreign PAN frames dropped");
+
+    printf("rx SPI octets per %d octet frame: routed %.1f, other node %.1f, header only %.1f, foreign PAN %.1f\n",
+           FRAME_LEN, (double)routed / BENCH_FRAMES, (double)other_node / BENCH_FRAMES, (double)other / BENCH_FRAMES,
+           (double)foreign / BENCH_FRAMES);
+    VerifyOrQuit(routed - other_node >= BENCH_FRAMES * (FRAME_LEN - sizeof(ieee_std_frame_t)),
+                 "rx_hdr: payload of ranging frames of other nodes read");
+    VerifyOrQuit(routed - other >= BENCH_FRAMES * (FRAME_LEN - sizeof(ieee_std_frame_t)), "rx_hdr: payload of other frames read");
+    VerifyOrQuit(routed - foreign >= BENCH_FRAMES * (FRAME_LEN - sizeof(ieee_std_frame_t)), "rx_hdr: payload of foreign PAN frames read");
+    return PASS;
+}
@@ -0,0 +1,216 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the shared SPI bus scheduler:
+
+  Two instances on one simulated bus clocked at 8MHz. The second radio
+  runs bulk reads, blocking ones of 512 bytes and asynchronous requests
+  of eight such accesses, while the interrupt task of the first radio is
+  made to read its status and a frame every couple of milliseconds. The
+  interrupt task must never wait for a whole bulk request, the bulk
+  readers must keep making progress and no two chip selects may overlap.
+  The same goes for asynchronous bulk requests on the first radio itself.
+  Then two tasks of the same class, one per radio, hammer the bus and
+  must get about the same number of grants.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_regs.h>
+
+#define BENCH_SPI_HZ        (8000000)
+#define BENCH_IRQS          (200)
+#define BULK_LEN            (512)
+#define BULK_XFERS          (8)
+#define FRAME_LEN           (32)
+#define FAIR_MSEC           (200)
+
+static struct dpl_sem s_irq_done;
+static struct dpl_event s_irq_ev;
+static uint8_t s_pattern[2][BULK_LEN];
+static volatile bool s_stop;
+static volatile uint32_t s_bulk_blocking, s_bulk_async, s_bulk_gap, s_errors;
+static volatile uint32_t s_reads[2];
+
+/* Status, frame info, timestamp and frame, the way the interrupt handler reads a reception */
+static void
+irq_ev_cb(struct dpl_event * ev)
+{
+    dw1000_dev_instance_t * inst = (dw1000_dev_instance_t *)dpl_event_get_arg(ev);
+    uint8_t frame[FRAME_LEN];
+
+    dw1000_read_reg(inst, SYS_STATUS_ID, 0, sizeof(uint32_t));
+    dw1000_read_reg(inst, RX_FINFO_ID, 0, sizeof(uint32_t));
+    dw1000_read_reg(inst, RX_TIME_ID, 0, 5);
+    dw1000_read(inst, TX_BUFFER_ID, 0, frame, sizeof(frame));
+    if (memcmp(frame, s_pattern[0], sizeof(frame)))
+        s_errors++;
+    dpl_sem_release(&s_irq_done);
+}
+
+static void *
+bulk_blocking(void * arg)
+{
+    dw1000_dev_instance_t * inst = arg;
+    uint8_t buf[BULK_LEN];
+
+    while (!s_stop) {
+        dw1000_read(inst, TX_BUFFER_ID, 0, buf, sizeof(buf));
+        if (memcmp(buf, s_pattern[1], sizeof(buf)))
+            s_errors++;
+        s_bulk_blocking++;
+    }
+    return NULL;
+}
+
+static void *
+bulk_async(void * arg)
+{
+    dw1000_dev_instance_t * inst = arg;
+    static uint8_t buf[BULK_XFERS][BULK_LEN];
+    dw1000_async_req_t req;
+
+    while (!s_stop) {
+        dw1000_async_init(&req, NULL, NULL);
+        for (int i = 0; i < BULK_XFERS; i++)
+            dw1000_xfer_list_read(&req.list, TX_BUFFER_ID, 0, buf[i], BULK_LEN);
+        dw1000_async_submit(inst, &req);
+        dw1000_async_wait(inst, &req, DPL_TIMEOUT_NEVER);
+        for (int i = 0; i < BULK_XFERS; i++)
+            if (memcmp(buf[i], s_pattern[inst->idx], BULK_LEN))
+                s_errors++;
+        s_bulk_async++;
+        /* The simulated SPI completes in the thread that hands the bus to the engine, without a
+         * pause the interrupt task would be left running every request submitted meanwhile */
+        if (s_bulk_gap)
+            usleep(s_bulk_gap);
+    }
+    return NULL;
+}
+
+static void *
+hammer(void * arg)
+{
+    dw1000_dev_instance_t * inst = arg;
+    uint8_t buf[64];
+
+    while (!s_stop) {
+        dw1000_read(inst, TX_BUFFER_ID, 0, buf, sizeof(buf));
+        if (memcmp(buf, s_pattern[inst->idx], sizeof(buf)))
+            s_errors++;
+        s_reads[inst->idx]++;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * inst[2] = {hal_dw1000_inst(0), hal_dw1000_inst(1)};
+    struct hal_dw1000_sim_stats stats[2];
+    pthread_t threads[2];
+    dpl_time_t timeout;
+
+    dpl_sem_init(&s_irq_done, 0);
+    test_sim_init(2, BENCH_SPI_HZ, true);
+    for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < BULK_LEN; k++)
+            s_pattern[i][k] = (uint8_t)(k * (i ? 7 : 13) + i);
+        dw1000_write(inst[i], TX_BUFFER_ID, 0, s_pattern[i], BULK_LEN);
+    }
+    VerifyOrQuit(inst[0]->bus == inst[1]->bus && inst[0]->bus->ndevs == 2, "bus: shared");
+
+    /* Interrupt task reads against bulk traffic on the other radio */
+    hal_dw1000_bus_clear(inst[0]);
+    pthread_create(&threads[0], NULL, bulk_blocking, inst[1]);
+    pthread_create(&threads[1], NULL, bulk_async, inst[1]);
+    dpl_event_init(&s_irq_ev, irq_ev_cb, inst[0]);
+    dpl_time_ms_to_ticks(1000, &timeout);
+    for (int n = 0; n < BENCH_IRQS; n++) {
+        dpl_eventq_put(&inst[0]->eventq, &s_irq_ev);
+        VerifyOrQuit(dpl_sem_pend(&s_irq_done, timeout) == DPL_OK, "bus: interrupt task stalled");
+        usleep(2000);
+    }
+    s_stop = true;
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    dw1000_bus_t * bus = inst[0]->bus;
+    uint32_t bulk_usec = (uint32_t)((uint64_t)BULK_XFERS * (BULK_LEN + 1) * 8000000 / BENCH_SPI_HZ);
+    printf("bulk: %lu blocking reads, %lu requests of %u usec\n",
+           (unsigned long)s_bulk_blocking, (unsigned long)s_bulk_async, (unsigned int)bulk_usec);
+    hal_dw1000_bus_dump(inst[0], printf);
+    VerifyOrQuit(s_errors == 0, "bus: data");
+    VerifyOrQuit(s_bulk_blocking && s_bulk_async, "bus: bulk starved");
+    VerifyOrQuit(bus->stats[DW1000_BUS_PRIO_IRQ].grants >= BENCH_IRQS * 4, "bus: interrupt task class");
+    VerifyOrQuit(bus->stats[DW1000_BUS_PRIO_IRQ].contended && bus->yields, "bus: no contention");
+    VerifyOrQuit(bus->stats[DW1000_BUS_PRIO_IRQ].wait_usec_max < bulk_usec, "bus: interrupt task waited for a bulk request");
+
+    /* Interrupt task reads against bulk requests of its own radio */
+    hal_dw1000_bus_clear(inst[0]);
+    s_stop = false;
+    s_bulk_async = 0;
+    s_bulk_gap = 1000;
+    pthread_create(&threads[0], NULL, bulk_async, inst[0]);
+    for (int n = 0; n < BENCH_IRQS; n++) {
+        dpl_eventq_put(&inst[0]->eventq, &s_irq_ev);
+        VerifyOrQuit(dpl_sem_pend(&s_irq_done, timeout) == DPL_OK, "bus: interrupt task stalled");
+        usleep(2000);
+    }
+    s_stop = true;
+    pthread_join(threads[0], NULL);
+
+    printf("own bulk: %lu requests, ", (unsigned long)s_bulk_async);
+    hal_dw1000_bus_dump(inst[0], printf);
+    VerifyOrQuit(s_errors == 0, "bus: data");
+    VerifyOrQuit(s_bulk_async, "bus: own bulk starved");
+    VerifyOrQuit(bus->stats[DW1000_BUS_PRIO_IRQ].contended && bus->yields, "bus: no contention with own bulk");
+    VerifyOrQuit(bus->stats[DW1000_BUS_PRIO_IRQ].wait_usec_max < bulk_usec, "bus: interrupt task waited for its own bulk request");
+
+    /* Two tasks of the same class, one per radio */
+    hal_dw1000_bus_clear(inst[0]);
+    s_stop = false;
+    for (int i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, hammer, inst[i]);
+    usleep(FAIR_MSEC * 1000);
+    s_stop = true;
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    printf("fairness: %lu and %lu reads, ", (unsigned long)s_reads[0], (unsigned long)s_reads[1]);
+    hal_dw1000_bus_dump(inst[0], printf);
+    VerifyOrQuit(s_errors == 0, "bus: data");
+    VerifyOrQuit(s_reads[0] * 4 > s_reads[1] * 3 && s_reads[1] * 4 > s_reads[0] * 3, "bus: round robin");
+
+    for (int i = 0; i < 2; i++) {
+        hal_dw1000_sim_node_stats(i, &stats[i]);
+        VerifyOrQuit(stats[i].spi_cs_overlaps == 0, "bus: chip selects overlap");
+    }
+    return PASS;
+}
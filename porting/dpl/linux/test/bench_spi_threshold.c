@@ -0,0 +1,189 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the blocking vs non-blocking SPI threshold:
+
+  Brings up a DW1000 instance on the simulated radio and times
+  hal_dw1000_read/_noblock and hal_dw1000_write/_noblock over
+  dw1000_spi_cal_sizes, the way dw1000_spi_calibrate() does, and prints
+  both cost curves and the thresholds dw1000_spi_cal_threshold() picks.
+  Then replays a mix of register and buffer accesses through dw1000_read()
+  and dw1000_write() with the syscfg thresholds and with the measured
+  ones; the measured ones must not be slower, within the margin the
+  calibration gives the non-blocking path. Also checks
+  dw1000_spi_cal_threshold() on synthetic curves.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "test_util.h"
+#include <os/os.h>
+#include <hal/hal_spi.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_regs.h>
+#include <dw1000/dw1000_spi_cal.h>
+
+#define BENCH_REPS          (200)
+#define BENCH_MIX_ROUNDS    (2000)
+#define BENCH_MIX_PASSES    (10)
+#define BENCH_TOLERANCE     (1.0625)    //!< Calibration margin allowed on the mixed workload
+
+/* Access sizes of a receive: status and info registers, timestamps, diagnostics and a frame */
+static const uint16_t s_mix[] = {4, 4, 5, 5, 8, 2, 2, 2, 4, 16, 20, 32, 64, 127};
+
+static struct dpl_sem s_spi_sem;
+static uint8_t s_buffer[128];
+
+typedef void (* xfer_t)(struct _dw1000_dev_instance_t *, const uint8_t *, uint8_t, uint8_t *, uint16_t);
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t
+time_xfer(dw1000_dev_instance_t * inst, xfer_t xfer, uint8_t cmd, uint16_t length)
+{
+    uint64_t best = UINT64_MAX;
+
+    for (int r = 0; r < 5; r++) {
+        uint64_t t0 = now_ns();
+        for (int n = 0; n < BENCH_REPS; n++)
+            xfer(inst, &cmd, 1, s_buffer, length);
+        uint64_t t = now_ns() - t0;
+        if (t < best)
+            best = t;
+    }
+    return (uint32_t)(best / BENCH_REPS);
+}
+
+static uint64_t
+time_mix(dw1000_dev_instance_t * inst, uint16_t rd, uint16_t wr)
+{
+    inst->spi_rd_noblock_min = rd;
+    inst->spi_wr_noblock_min = wr;
+
+    uint64_t t0 = now_ns();
+    for (int n = 0; n < BENCH_MIX_ROUNDS; n++) {
+        for (unsigned int i = 0; i < sizeof(s_mix) / sizeof(s_mix[0]); i++) {
+            dw1000_read(inst, RX_BUFFER_ID, 0, s_buffer, s_mix[i]);
+            dw1000_write(inst, TX_BUFFER_ID, i, s_buffer, s_mix[i]);
+        }
+    }
+    return now_ns() - t0;
+}
+
+static void
+test_threshold(void)
+{
+    uint32_t block[DW1000_SPI_CAL_NSIZES], noblock[DW1000_SPI_CAL_NSIZES];
+
+    /* 1600ns + 160ns/byte blocking, 1700ns + 170ns/byte with the margin, against 4700ns + 20ns/byte */
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++) {
+        block[i] = 1600 + 160 * dw1000_spi_cal_sizes[i];
+        noblock[i] = 4700 + 20 * dw1000_spi_cal_sizes[i];
+    }
+    VerifyOrQuit(dw1000_spi_cal_threshold(block, noblock) == 20, "spi_cal: interpolated crossover");
+
+    /* Equal costs are within the margin */
+    VerifyOrQuit(dw1000_spi_cal_threshold(block, block) == 1, "spi_cal: equal curves");
+
+    /* Blocking always faster and diverging */
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++)
+        noblock[i] = 2 * block[i];
+    VerifyOrQuit(dw1000_spi_cal_threshold(block, noblock) == UINT16_MAX, "spi_cal: blocking always");
+
+    /* Against 11700ns + 90ns/byte the crossing at 125 is between the two last points */
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++)
+        noblock[i] = 11700 + 90 * dw1000_spi_cal_sizes[i];
+    VerifyOrQuit(dw1000_spi_cal_threshold(block, noblock) == 125, "spi_cal: crossover at 125");
+
+    /* Against 12700ns + 90ns/byte the crossing at 137.5 is past the grid and extrapolated */
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++)
+        noblock[i] = 12700 + 90 * dw1000_spi_cal_sizes[i];
+    VerifyOrQuit(dw1000_spi_cal_threshold(block, noblock) == 138, "spi_cal: extrapolated crossover");
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * inst = hal_dw1000_inst(0);
+    dw1000_spi_cal_t cal;
+    uint16_t rd, wr;
+
+    test_threshold();
+
+    os_cputime_init(1000000);
+    struct hal_dw1000_sim_node_cfg nc = {.spi_num = 0, .ss_pin = inst->ss_pin, .irq_pin = inst->irq_pin,
+                                         .rst_pin = inst->rst_pin};
+    VerifyOrQuit(hal_dw1000_sim_node_add(&nc) == 0, "sim: node");
+    dpl_sem_init(&s_spi_sem, 1);
+    struct dw1000_dev_cfg cfg = {.spi_sem = &s_spi_sem, .spi_num = 0};
+    dw1000_dev_init((struct os_dev *)inst, &cfg);
+    hal_spi_init(0, NULL, 0);
+    VerifyOrQuit(dw1000_dev_config(inst) == OS_OK, "dw1000: config");
+
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++) {
+        uint16_t n = dw1000_spi_cal_sizes[i];
+        cal.rd_block_ns[i] = time_xfer(inst, hal_dw1000_read, RX_BUFFER_ID, n);
+        cal.rd_noblock_ns[i] = time_xfer(inst, hal_dw1000_read_noblock, RX_BUFFER_ID, n);
+        cal.wr_block_ns[i] = time_xfer(inst, hal_dw1000_write, 0x80 | TX_BUFFER_ID, n);
+        cal.wr_noblock_ns[i] = time_xfer(inst, hal_dw1000_write_noblock, 0x80 | TX_BUFFER_ID, n);
+    }
+    rd = dw1000_spi_cal_threshold(cal.rd_block_ns, cal.rd_noblock_ns);
+    wr = dw1000_spi_cal_threshold(cal.wr_block_ns, cal.wr_noblock_ns);
+    wr = (wr < UINT16_MAX) ? wr + 1 : wr;
+
+    printf("%6s %12s %12s %12s %12s\n", "bytes", "rd block ns", "rd nb ns", "wr block ns", "wr nb ns");
+    for (int i = 0; i < DW1000_SPI_CAL_NSIZES; i++) {
+        printf("%6u %12lu %12lu %12lu %12lu\n", dw1000_spi_cal_sizes[i],
+               (unsigned long)cal.rd_block_ns[i], (unsigned long)cal.rd_noblock_ns[i],
+               (unsigned long)cal.wr_block_ns[i], (unsigned long)cal.wr_noblock_ns[i]);
+    }
+    printf("thresholds: syscfg rd %u wr %u, measured rd %u wr %u\n",
+           MYNEWT_VAL(DW1000_DEVICE_SPI_RD_MAX_NOBLOCK), MYNEWT_VAL(DW1000_DEVICE_SPI_WR_MAX_NOBLOCK), rd, wr);
+#if MYNEWT_VAL(DW1000_SPI_CALIBRATE)
+    printf("dw1000_dev_config: ");
+    dw1000_spi_cal_dump(inst, printf);
+#endif
+
+    /* Alternate the two settings so both see the same load on the host */
+    uint64_t fixed = UINT64_MAX, measured = UINT64_MAX;
+    for (int r = 0; r < BENCH_MIX_PASSES; r++) {
+        uint64_t t = time_mix(inst, MYNEWT_VAL(DW1000_DEVICE_SPI_RD_MAX_NOBLOCK),
+                              MYNEWT_VAL(DW1000_DEVICE_SPI_WR_MAX_NOBLOCK));
+        fixed = (t < fixed) ? t : fixed;
+        t = time_mix(inst, rd, wr);
+        measured = (t < measured) ? t : measured;
+    }
+    double fixed_ns = (double)fixed / BENCH_MIX_ROUNDS;
+    double measured_ns = (double)measured / BENCH_MIX_ROUNDS;
+
+    printf("mixed workload: syscfg %.0f ns/round, measured %.0f ns/round (%.2fx)\n",
+           fixed_ns, measured_ns, fixed_ns / measured_ns);
+    VerifyOrQuit(measured_ns <= fixed_ns * BENCH_TOLERANCE, "spi_cal: measured thresholds slower than syscfg");
+    return PASS;
+}
@@ -0,0 +1,158 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the resident TX frame templates:
+
+  Two instances on the simulated radio, one sending a ccp like blink and
+  an nrng like request in turn, the other receiving them. The frames are
+  sent once with dw1000_write_tx() at offset 0 and once through one
+  template each, and the SPI octets the sender spends writing them,
+  TX_FCTRL included, are compared. Every received frame must match the
+  one sent, so switching templates through the TX_FCTRL offset is
+  covered as well. A dw1000_write_tx() into the template area must make
+  the next template write a full one.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_ftypes.h>
+#include <dw1000/dw1000_tx_tmpl.h>
+
+#define BENCH_FRAMES    (40)
+#define BLINK_LEN       (27)    //!< ccp_blink_frame_t
+#define REQUEST_LEN     (14)    //!< nrng_request_frame_t
+
+/* Blink with the sequence number and the transmission timestamp moving, the euid and interval fixed */
+static void
+make_blink(uint8_t * frame, int k)
+{
+    uint64_t ts = 0x123456789AULL + (uint64_t)k * 0x3F7A1200ULL;
+
+    memset(frame, 0, BLINK_LEN);
+    frame[0] = FCNTL_IEEE_BLINK_CCP_64;
+    frame[1] = (uint8_t)k;
+    memcpy(&frame[2], "\x01\x02\x03\x04\x05\x06\x07\x08", 8);
+    frame[10] = 0x34; frame[11] = 0x12;
+    memcpy(&frame[12], "\x00\x12\x7A\x3F\x00", 5);
+    memcpy(&frame[17], &ts, 8);
+    frame[26] = 2;
+}
+
+/* Range request with the sequence number and the slot mask moving */
+static void
+make_request(uint8_t * frame, int k)
+{
+    uint16_t fctrl = FCNTL_IEEE_RANGE_16, code = 0x0200;
+
+    memset(frame, 0, REQUEST_LEN);
+    memcpy(&frame[0], &fctrl, 2);
+    frame[2] = (uint8_t)k;
+    frame[3] = 0xCA; frame[4] = 0xDE;
+    frame[5] = 0xFF; frame[6] = 0xFF;
+    frame[7] = 0x34; frame[8] = 0x12;
+    memcpy(&frame[9], &code, 2);
+    frame[11] = 1;
+    frame[12] = (uint8_t)(k % 3 + 1);
+}
+
+/* SPI octets spent writing the frame */
+static uint32_t
+send(dw1000_dev_instance_t * inst, dw1000_tx_tmpl_t * tmpl, uint8_t * frame, uint16_t len)
+{
+    struct hal_dw1000_sim_stats s0, s1;
+    int rx_cnt = test_sim_rx.cnt;
+
+    hal_dw1000_sim_node_stats(0, &s0);
+    if (tmpl) {
+        dw1000_tx_tmpl_write(inst, tmpl, frame, len);
+    } else {
+        dw1000_write_tx(inst, frame, 0, len);
+        dw1000_write_tx_fctrl(inst, len, 0);
+    }
+    hal_dw1000_sim_node_stats(0, &s1);
+
+    test_sim_tx(inst);
+    VerifyOrQuit(test_sim_wait_rx(rx_cnt), "tx_tmpl: frame not received");
+    VerifyOrQuit(test_sim_rx.len == len && memcmp(test_sim_rx.frame, frame, len) == 0, "tx_tmpl: received frame differs");
+    return s1.spi_bytes - s0.spi_bytes;
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * tx = hal_dw1000_inst(0), * rx = hal_dw1000_inst(1);
+    dw1000_tx_tmpl_t blink_tmpl, request_tmpl, big_tmpl;
+    uint8_t blink[BLINK_LEN], request[REQUEST_LEN], fill[64] = {0};
+    uint32_t full = 0, patched = 0;
+
+    test_sim_init(2, 0, false);
+    test_sim_listen(rx);
+    dw1000_start_rx(rx);
+
+    memset(&blink_tmpl, 0, sizeof(blink_tmpl));
+    memset(&request_tmpl, 0, sizeof(request_tmpl));
+    memset(&big_tmpl, 0, sizeof(big_tmpl));
+    VerifyOrQuit(dw1000_tx_tmpl_alloc(tx, &blink_tmpl, BLINK_LEN) == DPL_OK, "tx_tmpl: alloc");
+    VerifyOrQuit(dw1000_tx_tmpl_alloc(tx, &request_tmpl, REQUEST_LEN) == DPL_OK, "tx_tmpl: alloc");
+    VerifyOrQuit(dw1000_tx_tmpl_alloc(tx, &blink_tmpl, BLINK_LEN) == DPL_OK && blink_tmpl.offset == DW1000_TX_TMPL_BASE,
+                 "tx_tmpl: realloc keeps the area");
+    VerifyOrQuit(request_tmpl.offset == DW1000_TX_TMPL_BASE + BLINK_LEN, "tx_tmpl: packed");
+    VerifyOrQuit(dw1000_tx_tmpl_alloc(tx, &big_tmpl, DW1000_TX_TMPL_LEN + 1) == DPL_ENOMEM, "tx_tmpl: too long");
+
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        make_blink(blink, k);
+        make_request(request, k);
+        full += send(tx, NULL, blink, BLINK_LEN);
+        full += send(tx, NULL, request, REQUEST_LEN);
+    }
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        make_blink(blink, k);
+        make_request(request, k);
+        patched += send(tx, &blink_tmpl, blink, BLINK_LEN);
+        patched += send(tx, &request_tmpl, request, REQUEST_LEN);
+    }
+    VerifyOrQuit(blink_tmpl.writes == BENCH_FRAMES && blink_tmpl.full_writes == 1, "tx_tmpl: blink counters");
+    VerifyOrQuit(request_tmpl.writes == BENCH_FRAMES && request_tmpl.full_writes == 1, "tx_tmpl: request counters");
+
+    printf("frame writes: full %.1f, template %.1f SPI octets per frame (blink %.1f, request %.1f saved)\n",
+           (double)full / (2 * BENCH_FRAMES), (double)patched / (2 * BENCH_FRAMES),
+           (double)blink_tmpl.bytes_saved / BENCH_FRAMES, (double)request_tmpl.bytes_saved / BENCH_FRAMES);
+    VerifyOrQuit(patched * 3 < full * 2, "tx_tmpl: less than two thirds of the octets");
+
+    /* A frame written over the template area drops the resident copies */
+    dw1000_write_tx(tx, fill, DW1000_TX_TMPL_BASE, sizeof(fill));
+    send(tx, &blink_tmpl, blink, BLINK_LEN);
+    VerifyOrQuit(blink_tmpl.full_writes == 2, "tx_tmpl: full write after overlap");
+    send(tx, &request_tmpl, request, REQUEST_LEN);
+    VerifyOrQuit(request_tmpl.full_writes == 2, "tx_tmpl: full write after overlap");
+
+    /* Without an area the template falls back to offset 0 */
+    send(tx, &big_tmpl, blink, BLINK_LEN);
+    VerifyOrQuit(big_tmpl.writes == 0, "tx_tmpl: fallback");
+    return PASS;
+}
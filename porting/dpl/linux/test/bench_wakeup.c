@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Benchmark for the wakeup configuration restore:
+
+  Two instances on the simulated radio. The first one is put to sleep and
+  woken up repeatedly, once falling back to the full restore of the
+  antenna delays and once from the snapshot taken by
+  dw1000_dev_enter_sleep(). Each cycle enables the receiver after the
+  wakeup, and the SPI transfers of the cycle and the time from
+  dw1000_dev_wakeup() to the receiver being ready are compared with the
+  fixed 7ms wait of the previous wakeup. The antenna delays lost in sleep
+  must come back and a frame sent after the last wakeup must be received
+  by the second instance. RX_FWTO, left at its reset value by the
+  configuration, must not be taken as kept until it survived a sleep
+  holding a timeout.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_phy.h>
+#include <dw1000/dw1000_regs.h>
+
+#define BENCH_CYCLES        (20)
+#define FIXED_WAIT_USEC     (7000)  //!< Chip select held 2ms then 5ms for the XTAL, before dw1000_dev_wakeup() polled
+#define RX_ANTD             (0x4015)
+#define TX_ANTD             (0x4017)
+#define WAKE_RX_FWTO        (1UL << 4)  //!< RX_FWTO in the registers checked across sleep
+#define RX_FWTO             (0x1234)
+
+/* Sleep, wake up and enable the receiver, with or without the snapshot; SPI transfers per cycle */
+static double
+cycle(dw1000_dev_instance_t * inst, bool snapshot, uint32_t * ready_usec)
+{
+    struct hal_dw1000_sim_stats s0, s1;
+    uint32_t total = 0;
+
+    hal_dw1000_sim_node_stats(0, &s0);
+    for (int n = 0; n < BENCH_CYCLES; n++) {
+        dw1000_dev_enter_sleep(inst);
+        VerifyOrQuit(hal_dw1000_get_rst(inst) == 0, "wake: device not asleep");
+        if (!snapshot)
+            inst->wake.armed = 0;
+        dw1000_dev_wakeup(inst);
+        VerifyOrQuit(!inst->status.sleeping, "wake: device still asleep");
+        dw1000_start_rx(inst);
+        total += inst->wake.ready_usec;
+        dw1000_phy_forcetrxoff(inst);
+        VerifyOrQuit((uint16_t)dw1000_read_reg(inst, LDE_IF_ID, LDE_RXANTD_OFFSET, sizeof(uint16_t)) == RX_ANTD,
+                     "wake: rx antenna delay");
+        VerifyOrQuit((uint16_t)dw1000_read_reg(inst, TX_ANTD_ID, TX_ANTD_OFFSET, sizeof(uint16_t)) == TX_ANTD,
+                     "wake: tx antenna delay");
+    }
+    hal_dw1000_sim_node_stats(0, &s1);
+    *ready_usec = total / BENCH_CYCLES;
+    /* Less the two antenna delay reads of the check */
+    return (double)(s1.spi_xfers - s0.spi_xfers) / BENCH_CYCLES - 2;
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * tag = hal_dw1000_inst(0), * anchor = hal_dw1000_inst(1);
+    uint32_t full_usec, snap_usec;
+    double full, snap;
+
+    test_sim_init(2, 0, false);
+    test_sim_listen(anchor);
+
+    tag->rx_antenna_delay = RX_ANTD;
+    tag->tx_antenna_delay = TX_ANTD;
+    dw1000_phy_set_rx_antennadelay(tag, tag->rx_antenna_delay);
+    dw1000_phy_set_tx_antennadelay(tag, tag->tx_antenna_delay);
+    tag->config.sleep_enable = 1;
+    dw1000_dev_configure_sleep(tag);
+
+    full = cycle(tag, false, &full_usec);
+    VerifyOrQuit(tag->wake.wakeups == 0, "wake: snapshot restored");
+    snap = cycle(tag, true, &snap_usec);
+    VerifyOrQuit(tag->wake.wakeups == BENCH_CYCLES, "wake: snapshot not restored");
+    VerifyOrQuit(tag->wake.lost == ((1UL << 8) | (1UL << 11)), "wake: lost registers");
+    VerifyOrQuit(tag->shadow.valid, "wake: shadow dropped");
+    VerifyOrQuit(!(tag->wake.kept & WAKE_RX_FWTO), "wake: register at its reset value taken as kept");
+
+    printf("wakeup to rx ready: fixed wait %u usec, polled with full restore %lu usec, with snapshot %lu usec\n",
+           FIXED_WAIT_USEC, (unsigned long)full_usec, (unsigned long)snap_usec);
+    printf("spi xfers per cycle: full restore %.2f, snapshot %.2f\n", full, snap);
+    dw1000_wake_dump(tag, printf);
+    VerifyOrQuit(snap < full, "wake: snapshot costs more transfers");
+    VerifyOrQuit(snap_usec < FIXED_WAIT_USEC, "wake: slower than the fixed wait");
+
+    /* A timeout written after the first wakeups is still checked, and kept */
+    dw1000_set_rx_timeout(tag, RX_FWTO);
+    cycle(tag, true, &snap_usec);
+    VerifyOrQuit((uint16_t)dw1000_read_reg(tag, RX_FWTO_ID, RX_FWTO_OFFSET, sizeof(uint16_t)) == RX_FWTO,
+                 "wake: rx timeout");
+    VerifyOrQuit(tag->wake.kept & WAKE_RX_FWTO, "wake: rx timeout not learned");
+    dw1000_set_rx_timeout(tag, 0);
+
+    /* The restored configuration still talks to the anchor */
+    VerifyOrQuit(test_sim_send(tag, anchor), "wake: frame not received");
+    return PASS;
+}
@@ -0,0 +1,156 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Stress test for the dpl_callout service:
+
+  TEST_CALLOUTS periodic callouts with periods between TEST_PERIOD_MIN
+  and TEST_PERIOD_MIN + TEST_PERIODS - 1 ms are served by one event queue
+  for TEST_DURATION ms. Each callout re-arms itself from its own expiry,
+  so it must fire once per period, never before its expiry, and no
+  thread may be created per expiry.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "dpl/dpl.h"
+
+#define TEST_CALLOUTS       (2000)
+#define TEST_PERIOD_MIN     (10)
+#define TEST_PERIODS        (50)
+#define TEST_DURATION       (2000)
+#define TEST_THREADS_MAX    (4)     //!< main, dispatcher task, callout service and slack
+
+struct test_callout {
+    struct dpl_callout co;
+    dpl_time_t period;
+    uint32_t fired;
+    uint32_t early;
+};
+
+static struct dpl_task s_task;
+static struct dpl_eventq s_eventq;
+static struct test_callout s_callouts[TEST_CALLOUTS];
+static volatile int s_threads_max;
+
+static int
+threads_now(void)
+{
+    char line[128];
+    int threads = -1;
+    FILE *f = fopen("/proc/self/status", "r");
+
+    if (f == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "Threads: %d", &threads) == 1)
+            break;
+    }
+    fclose(f);
+    return threads;
+}
+
+static void
+on_callout(struct dpl_event *ev)
+{
+    struct test_callout *tc = (struct test_callout *)dpl_event_get_arg(ev);
+    dpl_time_t now = dpl_time_get();
+    dpl_time_t expiry = dpl_callout_get_ticks(&tc->co);
+    int32_t next = (int32_t)(expiry + tc->period - now);
+
+    if ((int32_t)(now - expiry) < 0)
+        tc->early++;
+    tc->fired++;
+    dpl_callout_reset(&tc->co, (next > 0) ? next : 0);
+}
+
+static void *
+task_dispatcher(void *arg)
+{
+    while (1) {
+        dpl_eventq_run(&s_eventq);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    struct dpl_callout_stats stats;
+    uint32_t fired[TEST_CALLOUTS];
+    uint32_t early = 0, missed = 0;
+    int threads;
+
+    dpl_eventq_init(&s_eventq);
+    SuccessOrQuit(dpl_task_init(&s_task, "task_dispatcher", task_dispatcher,
+                                NULL, 1, 0, NULL, 0),
+                  "task: error initializing");
+
+    for (int i = 0; i < TEST_CALLOUTS; i++) {
+        s_callouts[i].period = TEST_PERIOD_MIN + i % TEST_PERIODS;
+        dpl_callout_init(&s_callouts[i].co, &s_eventq, on_callout, &s_callouts[i]);
+    }
+    dpl_callout_stats_clear();
+    for (int i = 0; i < TEST_CALLOUTS; i++)
+        SuccessOrQuit(dpl_callout_reset(&s_callouts[i].co, s_callouts[i].period),
+                      "callout: reset failed");
+
+    for (int t = 0; t < TEST_DURATION; t += 100) {
+        usleep(100 * 1000);
+        threads = threads_now();
+        if (threads > s_threads_max)
+            s_threads_max = threads;
+    }
+
+    for (int i = 0; i < TEST_CALLOUTS; i++)
+        dpl_callout_stop(&s_callouts[i].co);
+    for (int i = 0; i < TEST_CALLOUTS; i++) {
+        VerifyOrQuit(!dpl_callout_is_active(&s_callouts[i].co), "callout: active after stop");
+        fired[i] = s_callouts[i].fired;
+    }
+    usleep(100 * 1000);
+
+    for (int i = 0; i < TEST_CALLOUTS; i++) {
+        uint32_t expected = TEST_DURATION / s_callouts[i].period;
+
+        VerifyOrQuit(s_callouts[i].fired == fired[i], "callout: fired after stop");
+        if (fired[i] + 2 < expected || fired[i] > expected + 1)
+            missed++;
+        early += s_callouts[i].early;
+    }
+
+    dpl_callout_stats(&stats);
+    printf("%d callouts, %u expiries, lateness mean %.1fus max %uus, threads %d\n",
+           TEST_CALLOUTS, stats.fired, stats.fired ? (double)stats.late_sum_us / stats.fired : 0.0,
+           stats.late_max_us, s_threads_max);
+    for (int b = 0; b < DPL_CALLOUT_HIST_BINS; b++) {
+        if (stats.late_hist[b])
+            printf("  < %6uus: %u\n", 1U << b, stats.late_hist[b]);
+    }
+
+    VerifyOrQuit(early == 0, "callout: fired before expiry");
+    VerifyOrQuit(missed == 0, "callout: periodic callout missed or gained expiries");
+    VerifyOrQuit(s_threads_max <= TEST_THREADS_MAX, "callout: threads created per expiry");
+
+    printf("All tests passed\n");
+    return PASS;
+}
@@ -87,14 +87,38 @@ int test_put()
 
 int test_get_no_wait()
 {
-    //struct dpl_event *ev = dpl_eventq_get_no_wait(&s_eventq);
-    return FAIL;
+    struct dpl_event *ev = dpl_eventq_get_no_wait(&s_eventq);
+    VerifyOrQuit(ev == NULL, "eventq: event from empty q");
+
+    dpl_eventq_put(&s_eventq, &s_event);
+    dpl_eventq_put(&s_eventq, &s_event);
+    VerifyOrQuit(dpl_event_is_queued(&s_event), "eventq: event not queued");
+
+    ev = dpl_eventq_get_no_wait(&s_eventq);
+    VerifyOrQuit(ev == &s_event, "eventq: wrong event passed");
+    VerifyOrQuit(dpl_eventq_is_empty(&s_eventq), "eventq: event queued twice");
+
+    return PASS;
+}
+
+int test_remove()
+{
+    struct dpl_event other;
+
+    dpl_event_init(&other, on_event, &s_event_args);
+    dpl_eventq_put(&s_eventq, &s_event);
+    dpl_eventq_put(&s_eventq, &other);
+    dpl_eventq_remove(&s_eventq, &other);
+    VerifyOrQuit(!dpl_event_is_queued(&other), "eventq: removed event still queued");
+    VerifyOrQuit(dpl_eventq_get_no_wait(&s_eventq) == &s_event, "eventq: wrong event passed");
+    VerifyOrQuit(dpl_eventq_is_empty(&s_eventq), "eventq: q not empty after remove");
+
+    return PASS;
 }
 
 int test_get()
 {
-    struct dpl_event *ev = dpl_eventq_get(&s_eventq,
-						  DPL_WAIT_FOREVER);
+    struct dpl_event *ev = dpl_eventq_get(&s_eventq);
     VerifyOrQuit(ev == &s_event,
 		 "callout: wrong event passed");
 
@@ -107,6 +131,8 @@ void *task_test_runner(void *args)
     int count = 1000000000;
 
     SuccessOrQuit(test_init(), "eventq_init failed");
+    SuccessOrQuit(test_get_no_wait(), "eventq_get_no_wait failed");
+    SuccessOrQuit(test_remove(), "eventq_remove failed");
     SuccessOrQuit(test_put(),  "eventq_put failed");
     SuccessOrQuit(test_get(),  "eventq_get failed");
     SuccessOrQuit(test_put(),  "eventq_put failed");
@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Unit tests for the asynchronous register access API:
+  requests submitted back to back on the simulated radio must run and
+  complete in order, transfers longer than one hal_spi_txrx_noblock chunk
+  must be split and reassembled, complete_cb must run on the instance
+  eventq in submission order, the caller's event must be posted and a
+  blocking access issued after a submit must see its result. The
+  asynchronous accumulator read must leave the clocks as the blocking one.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include <os/os.h>
+#include <hal/hal_spi.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_regs.h>
+
+#define TEST_LEN    (600)       //!< More than two 255 byte chunks
+
+static struct dpl_sem s_spi_sem;
+static struct dpl_sem s_cb_sem;
+static uint8_t s_order[4];
+static int s_ncb;
+static uint8_t s_wr[TEST_LEN], s_rd[TEST_LEN];
+
+static void
+complete_cb(struct _dw1000_dev_instance_t * inst, dw1000_async_req_t * req)
+{
+    s_order[s_ncb++] = (uint8_t)(uintptr_t)req->arg;
+    if (s_ncb == 3)
+        dpl_sem_release(&s_cb_sem);
+}
+
+int main(void)
+{
+    dw1000_dev_instance_t * inst = hal_dw1000_inst(0);
+    dw1000_async_req_t req[3];
+    struct dpl_eventq evq;
+    struct dpl_event ev;
+    uint32_t sys_cfg = 0;
+    dpl_time_t timeout;
+
+    os_cputime_init(1000000);
+    struct hal_dw1000_sim_node_cfg nc = {.spi_num = 0, .ss_pin = inst->ss_pin, .irq_pin = inst->irq_pin,
+                                         .rst_pin = inst->rst_pin};
+    VerifyOrQuit(hal_dw1000_sim_node_add(&nc) == 0, "sim: node");
+    dpl_sem_init(&s_spi_sem, 1);
+    dpl_sem_init(&s_cb_sem, 0);
+    struct dw1000_dev_cfg cfg = {.spi_sem = &s_spi_sem, .spi_num = 0};
+    dw1000_dev_init((struct os_dev *)inst, &cfg);
+    hal_spi_init(0, NULL, 0);
+    VerifyOrQuit(dw1000_dev_config(inst) == OS_OK, "dw1000: config");
+
+    for (int i = 0; i < TEST_LEN; i++)
+        s_wr[i] = (uint8_t)(i * 7 + 1);
+
+    /* Write, read back and a register access, queued back to back */
+    for (int i = 0; i < 3; i++)
+        dw1000_async_init(&req[i], complete_cb, (void *)(uintptr_t)i);
+    dw1000_xfer_list_write(&req[0].list, TX_BUFFER_ID, 0, s_wr, TEST_LEN);
+    dw1000_xfer_list_read(&req[1].list, TX_BUFFER_ID, 0, s_rd, TEST_LEN);
+    dw1000_xfer_list_write_reg(&req[2].list, TX_BUFFER_ID, 0, 0xA5, sizeof(uint8_t));
+    dw1000_xfer_list_read(&req[2].list, SYS_CFG_ID, 0, (uint8_t *)&sys_cfg, sizeof(sys_cfg));
+    for (int i = 0; i < 3; i++)
+        dw1000_async_submit(inst, &req[i]);
+
+    VerifyOrQuit(dw1000_async_wait(inst, &req[2], DPL_TIMEOUT_NEVER) == DPL_OK, "async: wait");
+    VerifyOrQuit(req[0].done && req[1].done, "async: earlier requests done first");
+    VerifyOrQuit(memcmp(s_wr, s_rd, TEST_LEN) == 0, "async: chunked write and read back");
+    VerifyOrQuit(sys_cfg == (uint32_t)dw1000_read_reg(inst, SYS_CFG_ID, 0, sizeof(uint32_t)), "async: register read");
+    VerifyOrQuit((uint8_t)dw1000_read_reg(inst, TX_BUFFER_ID, 0, sizeof(uint8_t)) == 0xA5, "async: blocking read sees the write");
+
+    dpl_time_ms_to_ticks(1000, &timeout);
+    VerifyOrQuit(dpl_sem_pend(&s_cb_sem, timeout) == DPL_OK, "async: complete_cb");
+    VerifyOrQuit(s_order[0] == 0 && s_order[1] == 1 && s_order[2] == 2, "async: complete_cb in submission order");
+    VerifyOrQuit(inst->async.submitted == 3 && inst->async.completions == 3 && !inst->async.busy, "async: counters");
+
+    /* Completion posted to the caller's eventq, the same request submitted again */
+    dpl_eventq_init(&evq);
+    dpl_event_init(&ev, NULL, &req[1]);
+    req[1].complete_cb = NULL;
+    req[1].evq = &evq;
+    req[1].ev = &ev;
+    memset(s_rd, 0, sizeof(s_rd));
+    dw1000_async_submit(inst, &req[1]);
+    VerifyOrQuit(dpl_eventq_get(&evq) == &ev, "async: event posted");
+    VerifyOrQuit(req[1].done && s_rd[0] == 0xA5 && memcmp(s_wr + 1, s_rd + 1, TEST_LEN - 1) == 0, "async: resubmit");
+    VerifyOrQuit(dw1000_async_wait(inst, &req[1], 0) == DPL_OK, "async: wait on a done request");
+
+    /* Accumulator read, the ACC clocks are restored the same way as by dw1000_read_accdata */
+    uint8_t acc[2][64];
+    dw1000_read_accdata(inst, acc[0], 0, sizeof(acc[0]));
+    uint32_t pmsc = (uint32_t)dw1000_read_reg(inst, PMSC_ID, PMSC_CTRL0_OFFSET, sizeof(uint32_t));
+    dw1000_async_init(&req[0], NULL, NULL);
+    dw1000_read_accdata_async(inst, &req[0], acc[1], 0, sizeof(acc[1]));
+    VerifyOrQuit(req[0].list.nxfers == 3, "async: accumulator request");
+    dw1000_async_submit(inst, &req[0]);
+    VerifyOrQuit(dw1000_async_wait(inst, &req[0], DPL_TIMEOUT_NEVER) == DPL_OK, "async: accumulator wait");
+    VerifyOrQuit(memcmp(acc[0], acc[1], sizeof(acc[0])) == 0, "async: accumulator data");
+    VerifyOrQuit(pmsc == (uint32_t)dw1000_read_reg(inst, PMSC_ID, PMSC_CTRL0_OFFSET, sizeof(uint32_t)), "async: ACC clocks");
+
+    return PASS;
+}
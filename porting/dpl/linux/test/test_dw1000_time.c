@@ -0,0 +1,189 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Unit tests for the 40-bit DTU timestamp helpers (dw1000_time.h):
+  every timestamp within TEST_WINDOW of the 2^40 wrap combined with every
+  offset within TEST_WINDOW, the half range limits, 64-bit extension
+  across wraps, DX_TIME alignment and the exact ns/us conversions.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "test_util.h"
+#include "dw1000/dw1000_time.h"
+
+#define TEST_WINDOW     (2048)
+#define TEST_SPAN       (1ULL << 40)
+#define TEST_HALF       (1ULL << 39)
+#define TEST_RANDOM     (1000000)
+
+/* Reference: a + d reduced modulo 2^40 in wide arithmetic */
+static uint64_t
+ref_add(uint64_t a, int64_t d)
+{
+    __int128 r = ((__int128)a + d) % (__int128)TEST_SPAN;
+    return (uint64_t)(r < 0 ? r + TEST_SPAN : r);
+}
+
+/* Reference: round to nearest, half away from zero */
+static int64_t
+ref_div(__int128 num, __int128 den)
+{
+    return (int64_t)((num >= 0) ? (num * 2 + den) / (den * 2) : -((-num * 2 + den) / (den * 2)));
+}
+
+static uint64_t
+rnd64(void)
+{
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+static int
+test_wrap(void)
+{
+    for (int64_t i = -TEST_WINDOW; i < TEST_WINDOW; i++) {
+        uint64_t a = ref_add(0, i);
+        for (int64_t d = -TEST_WINDOW; d < TEST_WINDOW; d++) {
+            uint64_t b = dw1000_dtu_add(a, d);
+            VerifyOrQuit(b == ref_add(a, d), "dtu: add across the wrap");
+            VerifyOrQuit(dw1000_dtu_sub(b, a) == ref_add(0, d), "dtu: forward interval across the wrap");
+            VerifyOrQuit(dw1000_dtu_diff(b, a) == d, "dtu: signed interval across the wrap");
+            VerifyOrQuit(dw1000_dtu_before(b, a) == (d < 0), "dtu: before across the wrap");
+            VerifyOrQuit(dw1000_dtu_after(b, a) == (d > 0), "dtu: after across the wrap");
+        }
+    }
+    return PASS;
+}
+
+static int
+test_half_range(void)
+{
+    for (int i = 0; i < TEST_RANDOM; i++) {
+        uint64_t a = dw1000_dtu_wrap(rnd64());
+        VerifyOrQuit(dw1000_dtu_diff(dw1000_dtu_add(a, TEST_HALF - 1), a) == (int64_t)(TEST_HALF - 1), "dtu: largest positive interval");
+        VerifyOrQuit(dw1000_dtu_diff(dw1000_dtu_add(a, TEST_HALF), a) == -(int64_t)TEST_HALF, "dtu: half range is negative");
+        VerifyOrQuit(dw1000_dtu_sub(a, dw1000_dtu_add(a, 1)) == TEST_SPAN - 1, "dtu: forward interval wraps");
+        VerifyOrQuit(dw1000_dtu_wrap(a | ~DW1000_DTU_MASK) == a, "dtu: wrap drops the upper bits");
+    }
+    return PASS;
+}
+
+static int
+test_extend(void)
+{
+    uint64_t ts[TEST_WINDOW], out[TEST_WINDOW], ref64[TEST_WINDOW];
+
+    for (int k = 0; k < 4; k++) {
+        uint64_t ref = (uint64_t)k * TEST_SPAN;
+        for (int64_t d = -TEST_WINDOW; d < TEST_WINDOW; d++) {
+            if (ref == 0 && d < 0)
+                continue;
+            VerifyOrQuit(dw1000_dtu_extend(ref, dw1000_dtu_wrap(ref + d)) == ref + d, "dtu: extend across the wrap");
+        }
+    }
+
+    /* Monotonic sequence over several wraps in steps just below half the range */
+    uint64_t t = TEST_SPAN - 1000;
+    for (int i = 0; i < TEST_WINDOW; i++, t += TEST_HALF - 1 - (rand() & 0xFFFF)) {
+        ref64[i] = t;
+        ts[i] = dw1000_dtu_wrap(t);
+    }
+    uint64_t last = dw1000_dtu_extend_batch(TEST_SPAN - 1000, ts, out, TEST_WINDOW);
+    VerifyOrQuit(last == ref64[TEST_WINDOW - 1], "dtu: batch extend returns the last stamp");
+    for (int i = 0; i < TEST_WINDOW; i++)
+        VerifyOrQuit(out[i] == ref64[i], "dtu: batch extend across the wraps");
+    return PASS;
+}
+
+static int
+test_dx_time(void)
+{
+    for (int64_t i = -TEST_WINDOW; i < TEST_WINDOW; i++) {
+        uint64_t a = ref_add(0, i);
+        for (uint64_t delay = 0; delay < 4 * TEST_WINDOW; delay += 7) {
+            uint64_t dx = dw1000_dtu_dx_time(a, delay);
+            VerifyOrQuit((dx & DW1000_DTU_DX_MASK) == 0, "dtu: dx_time not aligned");
+            VerifyOrQuit(dx == (ref_add(a, delay) & ~DW1000_DTU_DX_MASK), "dtu: dx_time across the wrap");
+            VerifyOrQuit(dw1000_dtu_tx_stamp(dx, 0x4050) == ref_add(dx, 0x4050), "dtu: tx stamp across the wrap");
+        }
+    }
+    VerifyOrQuit(dw1000_dtu_dx_align(0x123456789ABCDEFULL) == 0x123456789ABCC00ULL, "dtu: dx_align changed upper bits");
+    VerifyOrQuit(dw1000_uus_to_dtu(1) == 0x10000 && dw1000_dtu_to_uus(0x1FFFF) == 1, "dtu: uus conversion");
+    return PASS;
+}
+
+static int
+test_conversion(void)
+{
+    int64_t dtu[TEST_WINDOW], ns[TEST_WINDOW];
+
+    VerifyOrQuit(dw1000_ns_to_dtu(625) == 39936, "dtu: ns ratio");
+    VerifyOrQuit(dw1000_dtu_to_us(63897600000LL) == 1000000, "dtu: one second in us");
+    VerifyOrQuit(dw1000_us_to_dtu(1000000) == 63897600000LL, "dtu: one second in dtu");
+
+    for (int i = 0; i < TEST_RANDOM; i++) {
+        int64_t d = (int64_t)(rnd64() % (2 * TEST_SPAN)) - (int64_t)TEST_SPAN;
+        int64_t n = dw1000_dtu_to_ns(d);
+        int64_t u = dw1000_dtu_to_us(d);
+
+        VerifyOrQuit(n == ref_div((__int128)d * 625, 39936), "dtu: dtu to ns rounding");
+        VerifyOrQuit(u == ref_div((__int128)d * 625, 39936000), "dtu: dtu to us rounding");
+        VerifyOrQuit(llabs(dw1000_ns_to_dtu(n) - d) <= 32, "dtu: ns round trip");
+        VerifyOrQuit(llabs(dw1000_us_to_dtu(u) - d) <= 31949, "dtu: us round trip");
+        VerifyOrQuit(dw1000_ns_to_dtu(n) == ref_div((__int128)n * 39936, 625), "dtu: ns to dtu rounding");
+    }
+
+    for (int i = 0; i < TEST_WINDOW; i++)
+        dtu[i] = (int64_t)(rnd64() % TEST_SPAN) - (int64_t)TEST_HALF;
+    dw1000_dtu_to_ns_batch(dtu, ns, TEST_WINDOW);
+    for (int i = 0; i < TEST_WINDOW; i++)
+        VerifyOrQuit(ns[i] == dw1000_dtu_to_ns(dtu[i]), "dtu: batch conversion");
+    return PASS;
+}
+
+static int
+test_diff_batch(void)
+{
+    uint64_t ts[TEST_WINDOW];
+    int64_t out[TEST_WINDOW];
+    uint64_t ref = TEST_SPAN - TEST_WINDOW / 2;
+
+    for (int i = 0; i < TEST_WINDOW; i++)
+        ts[i] = ref_add(ref, i - TEST_WINDOW / 4);
+    dw1000_dtu_diff_batch(ts, ref, out, TEST_WINDOW);
+    for (int i = 0; i < TEST_WINDOW; i++)
+        VerifyOrQuit(out[i] == i - TEST_WINDOW / 4, "dtu: batch interval across the wrap");
+    return PASS;
+}
+
+int main(void)
+{
+    srand(1);
+    SuccessOrQuit(test_wrap(), "wrap failed");
+    SuccessOrQuit(test_half_range(), "half range failed");
+    SuccessOrQuit(test_extend(), "extend failed");
+    SuccessOrQuit(test_dx_time(), "dx_time failed");
+    SuccessOrQuit(test_conversion(), "conversion failed");
+    SuccessOrQuit(test_diff_batch(), "diff batch failed");
+
+    printf("All tests passed\n");
+    return PASS;
+}
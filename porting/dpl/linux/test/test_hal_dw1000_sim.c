@@ -0,0 +1,206 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Unit tests for the virtual DW1000 (hal_dw1000_sim):
+  register access over hal_spi, interrupt delivery over hal_gpio and a
+  single sided two way ranging exchange between two simulated radios.
+*/
+
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "hal/hal_spi.h"
+#include "hal/hal_gpio.h"
+#include "hal/hal_dw1000_sim.h"
+#include "dw1000/dw1000_regs.h"
+
+#define TEST_DISTANCE_M     (30.0f)
+#define TEST_REPLY_DTU      (0x40000000ULL)     //!< ~16.8ms turn around
+#define TEST_TOF_TOLERANCE  (2)
+/* Channel 5, 64MHz PRF, preamble code 9 on both TX and RX */
+#define TEST_CHAN_CTRL      ((5 << CHAN_CTRL_TX_CHAN_SHIFT) | (5 << CHAN_CTRL_RX_CHAN_SHIFT) | \
+                             (2 << CHAN_CTRL_RXFPRF_SHIFT) | (9 << CHAN_CTRL_TX_PCOD_SHIFT) | \
+                             (9 << CHAN_CTRL_RX_PCOD_SHIFT))
+
+struct test_radio {
+    int spi_num;
+    int ss_pin;
+    int irq_pin;
+    int rst_pin;
+    volatile int irqs;
+};
+
+static struct test_radio radio[2] = {
+    {.spi_num = 0, .ss_pin = 10, .irq_pin = 20, .rst_pin = 30},
+    {.spi_num = 1, .ss_pin = 11, .irq_pin = 21, .rst_pin = 31}
+};
+
+static void
+radio_irq(void *arg)
+{
+    struct test_radio *r = (struct test_radio *)arg;
+    r->irqs++;
+}
+
+static void
+radio_xfer(struct test_radio *r, int write, uint8_t reg, uint16_t offset, uint8_t *buf, uint16_t len)
+{
+    uint8_t hdr[3] = {(uint8_t)((write << 7) | 0x40 | reg), (uint8_t)(0x80 | (offset & 0x7F)), (uint8_t)(offset >> 7)};
+
+    hal_gpio_write(r->ss_pin, 0);
+    hal_spi_txrx(r->spi_num, hdr, NULL, sizeof(hdr));
+    hal_spi_txrx(r->spi_num, write ? buf : NULL, write ? NULL : buf, len);
+    hal_gpio_write(r->ss_pin, 1);
+}
+
+static uint64_t
+radio_read(struct test_radio *r, uint8_t reg, uint16_t offset, uint8_t nbytes)
+{
+    uint8_t buf[8] = {0};
+    uint64_t val = 0;
+
+    radio_xfer(r, 0, reg, offset, buf, nbytes);
+    for (int i = nbytes - 1; i >= 0; i--)
+        val = (val << 8) | buf[i];
+    return val;
+}
+
+static void
+radio_write(struct test_radio *r, uint8_t reg, uint16_t offset, uint64_t val, uint8_t nbytes)
+{
+    uint8_t buf[8];
+
+    for (int i = 0; i < nbytes; i++, val >>= 8)
+        buf[i] = (uint8_t)val;
+    radio_xfer(r, 1, reg, offset, buf, nbytes);
+}
+
+static uint32_t
+radio_wait(struct test_radio *r, uint32_t bits)
+{
+    for (int i = 0; i < 1000; i++) {
+        uint32_t status = radio_read(r, SYS_STATUS_ID, 0, 4);
+        if (status & bits)
+            return status;
+        usleep(1000);
+    }
+    return 0;
+}
+
+static void
+radio_send(struct test_radio *r, const uint8_t *frame, uint16_t len, uint64_t dx_time)
+{
+    radio_xfer(r, 1, TX_BUFFER_ID, 0, (uint8_t *)frame, len);
+    /* 6.8Mbps, 64MHz PRF, 128 symbols preamble, length includes FCS */
+    radio_write(r, TX_FCTRL_ID, 0, 0x00164000 | (len + 2), 4);
+    if (dx_time) {
+        radio_write(r, DX_TIME_ID, 1, dx_time >> 8, 4);
+        radio_write(r, SYS_CTRL_ID, 0, SYS_CTRL_TXSTRT | SYS_CTRL_TXDLYS, 1);
+    } else {
+        radio_write(r, SYS_CTRL_ID, 0, SYS_CTRL_TXSTRT, 1);
+    }
+}
+
+static uint64_t
+dtu_delta(uint64_t a, uint64_t b)
+{
+    return (a - b) & 0xFFFFFFFFFFULL;
+}
+
+int
+main(void)
+{
+    struct hal_dw1000_sim_channel_cfg channel = {0};
+    struct hal_dw1000_sim_stats stats;
+    const uint8_t poll[] = {0x41, 0x88, 0x01, 0xCA, 0xDE, 0xFF, 0xFF, 0x01, 0x00, 0xE0};
+    const uint8_t resp[] = {0x41, 0x88, 0x02, 0xCA, 0xDE, 0x01, 0x00, 0x02, 0x00, 0xE1};
+    uint8_t rxbuf[sizeof(poll)];
+
+    SuccessOrQuit(hal_dw1000_sim_channel_config(&channel), "channel config failed");
+    for (int i = 0; i < 2; i++) {
+        struct hal_dw1000_sim_node_cfg node = {
+            .spi_num = radio[i].spi_num, .ss_pin = radio[i].ss_pin,
+            .irq_pin = radio[i].irq_pin, .rst_pin = radio[i].rst_pin,
+            .x = i * TEST_DISTANCE_M
+        };
+        VerifyOrQuit(hal_dw1000_sim_node_add(&node) == i, "node add failed");
+        hal_spi_init(radio[i].spi_num, NULL, HAL_SPI_TYPE_MASTER);
+        hal_spi_enable(radio[i].spi_num);
+        hal_gpio_init_out(radio[i].ss_pin, 1);
+        hal_gpio_irq_init(radio[i].irq_pin, radio_irq, &radio[i], HAL_GPIO_TRIG_RISING, HAL_GPIO_PULL_DOWN);
+        hal_gpio_irq_enable(radio[i].irq_pin);
+    }
+
+    /* Register file */
+    VerifyOrQuit(radio_read(&radio[0], DEV_ID_ID, 0, 4) == 0xDECA0130, "DEV_ID mismatch");
+    radio_write(&radio[0], PANADR_ID, 0, 0xDECA0001, 4);
+    VerifyOrQuit(radio_read(&radio[0], PANADR_ID, 0, 4) == 0xDECA0001, "PANADR write/read mismatch");
+    uint64_t t0 = radio_read(&radio[0], SYS_TIME_ID, 0, 5);
+    usleep(1000);
+    VerifyOrQuit(dtu_delta(radio_read(&radio[0], SYS_TIME_ID, 0, 5), t0) > 63897600ULL / 1000, "SYS_TIME not running");
+
+    /* Interrupts on TX done and RX good frame, receivers tuned to the PRF and code radio_send uses */
+    for (int i = 0; i < 2; i++) {
+        radio_write(&radio[i], SYS_MASK_ID, 0, SYS_STATUS_TXFRS | SYS_STATUS_RXFCG, 4);
+        radio_write(&radio[i], CHAN_CTRL_ID, 0, TEST_CHAN_CTRL, 4);
+    }
+
+    radio_write(&radio[1], SYS_CTRL_ID, 1, SYS_CTRL_RXENAB >> 8, 1);
+    radio_send(&radio[0], poll, sizeof(poll), 0);
+    VerifyOrQuit(radio_wait(&radio[0], SYS_STATUS_TXFRS), "initiator TXFRS not set");
+    VerifyOrQuit(radio_wait(&radio[1], SYS_STATUS_RXFCG), "responder RXFCG not set");
+    VerifyOrQuit(radio[0].irqs == 1 && radio[1].irqs == 1, "irq not delivered");
+
+    uint16_t len = radio_read(&radio[1], RX_FINFO_ID, 0, 2) & RX_FINFO_RXFLEN_MASK;
+    VerifyOrQuit(len == sizeof(poll) + 2, "RX_FINFO length mismatch");
+    radio_xfer(&radio[1], 0, RX_BUFFER_ID, 0, rxbuf, sizeof(rxbuf));
+    VerifyOrQuit(memcmp(rxbuf, poll, sizeof(poll)) == 0, "RX_BUFFER mismatch");
+
+    uint64_t poll_tx = radio_read(&radio[0], TX_TIME_ID, 0, 5);
+    uint64_t poll_rx = radio_read(&radio[1], RX_TIME_ID, 0, 5);
+    radio_write(&radio[0], SYS_STATUS_ID, 0, SYS_STATUS_ALL_TX, 4);
+    radio_write(&radio[1], SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_GOOD, 4);
+    VerifyOrQuit((radio_read(&radio[1], SYS_STATUS_ID, 0, 4) & SYS_STATUS_RXFCG) == 0, "SYS_STATUS not cleared");
+
+    /* Delayed response, initiator listens for it */
+    radio_write(&radio[0], SYS_CTRL_ID, 1, SYS_CTRL_RXENAB >> 8, 1);
+    radio_send(&radio[1], resp, sizeof(resp), (poll_rx + TEST_REPLY_DTU) & ~0x1FFULL);
+    VerifyOrQuit(radio_wait(&radio[0], SYS_STATUS_RXFCG), "initiator RXFCG not set");
+
+    uint64_t resp_tx = radio_read(&radio[1], TX_TIME_ID, 0, 5);
+    uint64_t resp_rx = radio_read(&radio[0], RX_TIME_ID, 0, 5);
+    VerifyOrQuit(resp_tx == ((poll_rx + TEST_REPLY_DTU) & ~0x1FFULL), "delayed TX stamp mismatch");
+
+    int64_t tof = (int64_t)(dtu_delta(resp_rx, poll_tx) - dtu_delta(resp_tx, poll_rx)) / 2;
+    int64_t expected = (int64_t)(TEST_DISTANCE_M / 0.299702547 * 63.8976 + 0.5);
+    printf("tof = %ld dtu, expected %ld dtu\n", (long)tof, (long)expected);
+    VerifyOrQuit(llabs(tof - expected) <= TEST_TOF_TOLERANCE, "time of flight mismatch");
+
+    /* Delayed TX in the past is rejected */
+    radio_send(&radio[0], poll, sizeof(poll), radio_read(&radio[0], SYS_TIME_ID, 0, 5) - 0x1000000ULL);
+    VerifyOrQuit(radio_read(&radio[0], SYS_STATUS_ID, 3, 1) & (SYS_STATUS_HPDWARN >> 24), "HPDWARN not set");
+
+    hal_dw1000_sim_node_stats(0, &stats);
+    VerifyOrQuit(stats.tx_frames == 1 && stats.rx_frames == 1 && stats.tx_late == 1, "node stats mismatch");
+
+    printf("All tests passed\n");
+    return PASS;
+}
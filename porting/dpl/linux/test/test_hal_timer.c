@@ -0,0 +1,165 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Unit tests for the native hal_timer:
+
+  Expiry order and precision of thousands of concurrent timers, timer
+  cancellation, timers started in the past and hal_timer_delay.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "test_util.h"
+#include "hal/hal_timer.h"
+#include "hal/hal_timer_native.h"
+
+#define TEST_FREQ           (1000000)   //!< 1us ticks
+#define TEST_NTIMERS        (4096)
+#define TEST_SPAN           (200000)    //!< Expiries spread over 200ms
+#define TEST_LEAD           (100000)    //!< Time allowed to start every timer before the first expiry
+#define TEST_MEAN_LATE_MAX  (2000000)   //!< Mean lateness bound in ns
+
+struct test_timer {
+    struct hal_timer timer;
+    uint32_t fired_at;
+    int fired;
+};
+
+static struct test_timer s_timers[TEST_NTIMERS];
+static struct test_timer * volatile s_order[TEST_NTIMERS];
+static volatile int s_nfired;
+
+static void
+on_timer(void *arg)
+{
+    struct test_timer *t = (struct test_timer *)arg;
+
+    t->fired_at = hal_timer_read(0);
+    t->fired++;
+    s_order[s_nfired++] = t;
+}
+
+static void
+test_reset(void)
+{
+    memset(s_timers, 0, sizeof(s_timers));
+    s_nfired = 0;
+    for (int i = 0; i < TEST_NTIMERS; i++) {
+        hal_timer_set_cb(0, &s_timers[i].timer, on_timer, &s_timers[i]);
+    }
+}
+
+int test_ordering()
+{
+    uint32_t base;
+
+    test_reset();
+    srand(1);
+    base = hal_timer_read(0) + TEST_LEAD;
+    for (int i = 0; i < TEST_NTIMERS; i++) {
+        SuccessOrQuit(hal_timer_start_at(&s_timers[i].timer, base + rand() % TEST_SPAN),
+                      "hal_timer_start_at failed");
+    }
+    usleep(TEST_LEAD + TEST_SPAN + 100000);
+
+    VerifyOrQuit(s_nfired == TEST_NTIMERS, "timer: not all timers fired");
+    for (int i = 0; i < TEST_NTIMERS; i++) {
+        struct test_timer *t = s_order[i];
+        VerifyOrQuit(t->fired == 1, "timer: fired more than once");
+        VerifyOrQuit((int32_t)(t->fired_at - t->timer.expiry) >= 0, "timer: fired early");
+        if (i) {
+            VerifyOrQuit((int32_t)(t->timer.expiry - s_order[i - 1]->timer.expiry) >= 0,
+                         "timer: fired out of order");
+        }
+    }
+    return PASS;
+}
+
+int test_stop()
+{
+    uint32_t base;
+
+    test_reset();
+    base = hal_timer_read(0) + 20000;
+    for (int i = 0; i < 100; i++) {
+        hal_timer_start_at(&s_timers[i].timer, base + i * 100);
+    }
+    for (int i = 0; i < 100; i += 2) {
+        hal_timer_stop(&s_timers[i].timer);
+    }
+    usleep(20000 + 100 * 100 + 50000);
+
+    VerifyOrQuit(s_nfired == 50, "timer: stopped timers fired");
+    for (int i = 0; i < 100; i++) {
+        VerifyOrQuit(s_timers[i].fired == (i & 1), "timer: wrong timer fired");
+    }
+    return PASS;
+}
+
+int test_past()
+{
+    test_reset();
+    hal_timer_start_at(&s_timers[0].timer, hal_timer_read(0) - 1000);
+    usleep(10000);
+    VerifyOrQuit(s_timers[0].fired == 1, "timer: timer in the past did not fire");
+    return PASS;
+}
+
+int test_delay()
+{
+    uint32_t t0 = hal_timer_read(0);
+
+    hal_timer_delay(0, 5000);
+    VerifyOrQuit(hal_timer_read(0) - t0 >= 5000, "timer: delay too short");
+    return PASS;
+}
+
+int main(void)
+{
+    struct hal_timer_native_stats stats;
+
+    SuccessOrQuit(hal_timer_config(0, TEST_FREQ), "hal_timer_config failed");
+    VerifyOrQuit(hal_timer_get_resolution(0) == 1000000000 / TEST_FREQ, "timer: wrong resolution");
+
+    hal_timer_native_stats_clear(0);
+    SuccessOrQuit(test_ordering(), "ordering failed");
+    hal_timer_native_stats(0, &stats);
+
+    double mean = (double)stats.late_sum_ns / stats.fired;
+    double jitter = sqrt((double)stats.late_sumsq_us / stats.fired - (mean / 1000) * (mean / 1000));
+    printf("%u timers, lateness mean %.1fus jitter %.1fus max %.1fus\n",
+           stats.fired, mean / 1000, jitter, stats.late_max_ns / 1000.0);
+    for (int i = 0; i < HAL_TIMER_NATIVE_HIST_BINS; i++) {
+        if (stats.late_hist[i])
+            printf("  < %6uus: %u\n", 1u << i, stats.late_hist[i]);
+    }
+    VerifyOrQuit(stats.fired == TEST_NTIMERS, "timer: stats miscounted");
+    VerifyOrQuit(mean < TEST_MEAN_LATE_MAX, "timer: mean lateness too high");
+
+    SuccessOrQuit(test_stop(), "stop failed");
+    SuccessOrQuit(test_past(), "past failed");
+    SuccessOrQuit(test_delay(), "delay failed");
+
+    printf("All tests passed\n");
+    return PASS;
+}
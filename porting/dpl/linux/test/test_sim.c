@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include "test_util.h"
+#include "test_sim.h"
+#include <os/os.h>
+#include <hal/hal_spi.h>
+#include <hal/hal_dw1000_sim.h>
+#include <dw1000/dw1000_dev.h>
+#include <dw1000/dw1000_hal.h>
+#include <dw1000/dw1000_mac.h>
+#include <dw1000/dw1000_phy.h>
+
+#define TEST_SIM_DISTANCE_M (10.0f)
+#define TEST_SIM_RX_WAIT_MS (100)
+
+test_sim_rx_t test_sim_rx;
+static struct dpl_sem s_spi_sem[TEST_SIM_NODES];
+
+static bool
+rx_complete_cb(dw1000_dev_instance_t * inst, dw1000_mac_interface_t * cbs)
+{
+    test_sim_rx.len = inst->frame_len < TEST_SIM_FRAME_MAX ? inst->frame_len : TEST_SIM_FRAME_MAX;
+    memcpy(test_sim_rx.frame, inst->rxbuf, test_sim_rx.len);
+    test_sim_rx.cnt++;
+    return true;
+}
+
+static dw1000_mac_interface_t s_cbs[TEST_SIM_NODES] = {
+    [0 ... TEST_SIM_NODES - 1] = {.id = 100, .rx_complete_cb = rx_complete_cb}
+};
+
+/* Simulated radios for instances 0 to nnodes - 1, configured */
+void
+test_sim_init(int nnodes, uint32_t spi_hz, bool shared_bus)
+{
+    assert(nnodes <= TEST_SIM_NODES);
+    os_cputime_init(1000000);
+    for (int i = 0; i < nnodes; i++) {
+        dw1000_dev_instance_t * inst = hal_dw1000_inst(i);
+        int bus = shared_bus ? 0 : i;
+        struct hal_dw1000_sim_node_cfg nc = {.spi_num = bus, .ss_pin = inst->ss_pin, .irq_pin = inst->irq_pin,
+                                             .rst_pin = inst->rst_pin, .x = i * TEST_SIM_DISTANCE_M, .spi_hz = spi_hz};
+        VerifyOrQuit(hal_dw1000_sim_node_add(&nc) == i, "sim: node");
+        if (bus == i)
+            dpl_sem_init(&s_spi_sem[bus], 1);
+        struct dw1000_dev_cfg cfg = {.spi_sem = &s_spi_sem[bus], .spi_num = bus};
+        dw1000_dev_init((struct os_dev *)inst, &cfg);
+    }
+    for (int i = 0; i < (shared_bus ? 1 : nnodes); i++)
+        hal_spi_init(i, NULL, 0);
+    for (int i = 0; i < nnodes; i++)
+        VerifyOrQuit(dw1000_dev_config(hal_dw1000_inst(i)) == OS_OK, "dw1000: config");
+}
+
+/* Count and keep the frames inst receives */
+void
+test_sim_listen(dw1000_dev_instance_t * inst)
+{
+    dw1000_mac_append_interface(inst, &s_cbs[inst->idx]);
+}
+
+/* Transmit what is in the TX buffer now and wait for the end of it */
+void
+test_sim_tx(dw1000_dev_instance_t * inst)
+{
+    dw1000_start_tx(inst);
+    dpl_sem_pend(&inst->tx_sem, DPL_TIMEOUT_NEVER);
+    dpl_sem_release(&inst->tx_sem);
+}
+
+/* True once a frame is received after cnt were */
+bool
+test_sim_wait_rx(int cnt)
+{
+    for (int i = 0; i < TEST_SIM_RX_WAIT_MS && test_sim_rx.cnt == cnt; i++)
+        usleep(1000);
+    return test_sim_rx.cnt == cnt + 1;
+}
+
+/* A data frame from tx, rx listening for it only meanwhile; true if it got across */
+bool
+test_sim_send(dw1000_dev_instance_t * tx, dw1000_dev_instance_t * rx)
+{
+    uint8_t frame[16] = {0x41, 0x88, 0, rx->PANID & 0xFF, rx->PANID >> 8};
+    int cnt = test_sim_rx.cnt;
+
+    dw1000_start_rx(rx);
+    dw1000_write_tx(tx, frame, 0, sizeof(frame));
+    dw1000_write_tx_fctrl(tx, sizeof(frame), 0);
+    test_sim_tx(tx);
+    bool received = test_sim_wait_rx(cnt);
+    dw1000_phy_forcetrxoff(rx);
+    return received;
+}
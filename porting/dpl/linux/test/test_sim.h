@@ -0,0 +1,63 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+  Fixture of the tests running the driver on the simulated radio:
+
+  test_sim_init() puts instances 0.. on simulated radios 10m apart,
+  each on its own SPI bus or all on bus 0, and brings them up through
+  dw1000_dev_init() and dw1000_dev_config(). test_sim_listen() counts
+  and keeps the frames an instance receives, test_sim_send() gets a
+  frame from one instance to another.
+*/
+
+#ifndef _TEST_SIM_H_
+#define _TEST_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <dw1000/dw1000_dev.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_SIM_NODES      (2)
+#define TEST_SIM_FRAME_MAX  (128)
+
+//! Frames received by the instances listening
+typedef struct _test_sim_rx_t{
+    volatile int cnt;                       //!< Frames received
+    uint16_t len;                           //!< Length of the last one
+    uint8_t frame[TEST_SIM_FRAME_MAX];      //!< The last one
+}test_sim_rx_t;
+
+extern test_sim_rx_t test_sim_rx;
+
+void test_sim_init(int nnodes, uint32_t spi_hz, bool shared_bus);
+void test_sim_listen(dw1000_dev_instance_t * inst);
+void test_sim_tx(dw1000_dev_instance_t * inst);
+bool test_sim_wait_rx(int cnt);
+bool test_sim_send(dw1000_dev_instance_t * tx, dw1000_dev_instance_t * rx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _TEST_SIM_H_ */
@@ -0,0 +1,116 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file hal_dw1000_sim.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Virtual DW1000 for the native (Linux) porting layer
+ *
+ * @details Register-level model of the DW1000 that sits behind the native hal_spi and hal_gpio
+ * implementations, and therefore behind hal_dw1000_read/hal_dw1000_write. Each simulated radio owns
+ * a register file, TX/RX buffers, a 40-bit system clock with configurable drift and a SYS_STATUS/SYS_MASK
+ * interrupt line. All radios share one channel that models propagation delay from node positions,
+ * an additional fixed delay and random frame loss.
+ *
+ * Radios are bound to the same spi_num/ss_pin/irq_pin/rst_pin that the driver instance uses, so the
+ * unmodified dw1000 driver and lib/ services run end-to-end on a host.
+ */
+
+/**
+ * @addtogroup HAL
+ * @{
+ *   @defgroup HALDw1000Sim HAL DW1000 simulator
+ *   @{
+ */
+
+#ifndef H_HAL_DW1000_SIM_
+#define H_HAL_DW1000_SIM_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef HAL_DW1000_SIM_MAX_NODES
+#define HAL_DW1000_SIM_MAX_NODES    (64)
+#endif
+
+/** Shared RF channel parameters */
+struct hal_dw1000_sim_channel_cfg {
+    uint32_t loss_ppm;          //!< Probability of losing a frame on any link, parts per million
+    int32_t delay_ps;           //!< Fixed delay added to the line-of-sight propagation on every link
+    uint32_t seed;              //!< Seed for the loss process, 0 selects a fixed default
+};
+
+/** Per-radio parameters */
+struct hal_dw1000_sim_node_cfg {
+    int spi_num;                //!< SPI bus the radio is attached to
+    int ss_pin;                 //!< Chip select pin
+    int irq_pin;                //!< Interrupt pin driven by the radio
+    int rst_pin;                //!< Reset pin, reads low while the radio is sleeping
+    float x, y, z;              //!< Antenna position in meters
+    float drift_ppm;            //!< Crystal offset relative to the host clock
+    uint32_t part_id;           //!< OTP part id, 0 selects a unique default
+    uint32_t lot_id;            //!< OTP lot id
+    uint32_t spi_hz;            //!< SPI clock, a byte takes 8 cycles of it; 0 clocks bytes in no time
+};
+
+/** Per-radio counters */
+struct hal_dw1000_sim_stats {
+    uint32_t spi_xfers;         //!< Chip select assertions
+    uint32_t spi_bytes;         //!< Bytes clocked over SPI, headers included
+    uint32_t spi_cs_overlaps;   //!< Chip select asserted while another radio on the bus was selected
+    uint32_t irqs;              //!< Rising edges on the interrupt line
+    uint32_t tx_frames;         //!< Frames put on air
+    uint32_t tx_late;           //!< Delayed TX/RX rejected with HPDWARN
+    uint32_t rx_frames;         //!< Frames delivered to the host with RXFCG
+    uint32_t rx_lost;           //!< Frames dropped by the channel loss process
+    uint32_t rx_missed;         //!< Frames that arrived while the receiver was off or acquiring too late
+    uint32_t rx_collisions;     //!< Frames that arrived while the receiver was locked to another frame
+    uint32_t rx_filtered;       //!< Frames rejected by frame filtering
+    uint32_t rx_timeouts;       //!< Frame wait timeouts
+};
+
+int hal_dw1000_sim_channel_config(const struct hal_dw1000_sim_channel_cfg * cfg);
+int hal_dw1000_sim_node_add(const struct hal_dw1000_sim_node_cfg * cfg);
+int hal_dw1000_sim_node_move(int node, float x, float y, float z);
+int hal_dw1000_sim_node_stats(int node, struct hal_dw1000_sim_stats * stats);
+uint64_t hal_dw1000_sim_systime(int node);
+void hal_dw1000_sim_reset(void);
+
+/*
+ * Native HAL glue, used by the native hal_spi and hal_gpio implementations.
+ */
+int hal_dw1000_sim_spi_txrx(int spi_num, const uint8_t * txbuf, uint8_t * rxbuf, int cnt);
+int hal_dw1000_sim_gpio_write(int pin, int val);
+int hal_dw1000_sim_gpio_read(int pin, int * val);
+void hal_gpio_native_drive(int pin, int val);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_HAL_DW1000_SIM_ */
+
+/**
+ *   @} HALDw1000Sim
+ * @} HAL
+ */
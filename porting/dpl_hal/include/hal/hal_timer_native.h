@@ -0,0 +1,58 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file hal_timer_native.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Native (Linux) hal_timer instrumentation
+ *
+ * @details The native hal_timer counts CLOCK_MONOTONIC at the frequency given to hal_timer_config and
+ * expires timers from a single dispatcher thread blocked on a timerfd. Every expiry records its lateness,
+ * the time between the expiry tick and the callback being issued, which is reported here.
+ */
+
+#ifndef H_HAL_TIMER_NATIVE_
+#define H_HAL_TIMER_NATIVE_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_TIMER_NATIVE_HIST_BINS  (16)
+
+/** Lateness of expired timers */
+struct hal_timer_native_stats {
+    uint32_t fired;                     //!< Callbacks issued
+    uint32_t late_max_ns;               //!< Worst lateness
+    uint64_t late_sum_ns;               //!< Sum of lateness, mean is late_sum_ns / fired
+    uint64_t late_sumsq_us;             //!< Sum of squared lateness in us^2, for the jitter
+    uint32_t late_hist[HAL_TIMER_NATIVE_HIST_BINS];  //!< Bin n counts lateness below 2^n us, the last bin everything above
+};
+
+int hal_timer_native_stats(int timer_num, struct hal_timer_native_stats * stats);
+void hal_timer_native_stats_clear(int timer_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_HAL_TIMER_NATIVE_ */
@@ -0,0 +1,85 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file hal_timer_wheel.h
+ * @author paul kettle
+ * @date 2019
+ * @brief Hierarchical timing wheel for struct hal_timer
+ *
+ * @details Four levels of 256 buckets cover the 32-bit tick space. A timer is filed at the level of the
+ * most significant byte in which its expiry differs from the wheel cursor, in the bucket selected by that
+ * byte of the expiry, so start and stop are O(1) whatever the number of pending timers. Each level keeps
+ * an occupancy bitmap; the next tick that needs attention is found by scanning at most four bitmaps, and
+ * a higher level bucket is cascaded down when the cursor reaches it.
+ *
+ * The wheel itself does no locking and keeps no notion of time beyond the cursor. The owner advances it
+ * with hal_timer_wheel_expire() from a critical section and arms its wakeup with hal_timer_wheel_next().
+ */
+
+#ifndef H_HAL_TIMER_WHEEL_
+#define H_HAL_TIMER_WHEEL_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "os/queue.h"
+#include "hal/hal_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_TIMER_WHEEL_LEVELS      (4)
+#define HAL_TIMER_WHEEL_BITS        (8)
+#define HAL_TIMER_WHEEL_BUCKETS     (1 << HAL_TIMER_WHEEL_BITS)
+
+TAILQ_HEAD(hal_timer_wheel_bucket, hal_timer);
+
+/** Timing wheel */
+struct hal_timer_wheel {
+    uint32_t cursor;                    //!< Next tick that has not been processed
+    uint32_t count;                     //!< Timers on the wheel, expired ones included
+    uint32_t map[HAL_TIMER_WHEEL_LEVELS][HAL_TIMER_WHEEL_BUCKETS / 32];    //!< Occupied buckets
+    struct hal_timer_wheel_bucket bucket[HAL_TIMER_WHEEL_LEVELS][HAL_TIMER_WHEEL_BUCKETS];
+    struct hal_timer_wheel_bucket expired;  //!< Timers due at or before the cursor
+};
+
+void hal_timer_wheel_init(struct hal_timer_wheel * wheel, uint32_t tick);
+void hal_timer_wheel_insert(struct hal_timer_wheel * wheel, struct hal_timer * timer);
+void hal_timer_wheel_remove(struct hal_timer_wheel * wheel, struct hal_timer * timer);
+int hal_timer_wheel_next(struct hal_timer_wheel * wheel, uint32_t * tick);
+struct hal_timer * hal_timer_wheel_expire(struct hal_timer_wheel * wheel, uint32_t now);
+
+/**
+ * API to test whether a timer is on a wheel.
+ *
+ * @param timer  Pointer to struct hal_timer
+ * @return int   Non zero while the timer is pending
+ */
+static inline int
+hal_timer_wheel_queued(struct hal_timer * timer)
+{
+    return timer->link.tqe_prev != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_HAL_TIMER_WHEEL_ */
@@ -0,0 +1,1283 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file hal_dw1000_sim.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Virtual DW1000 for the native (Linux) porting layer
+ *
+ * @details The model decodes the DW1000 SPI transaction header, keeps a register file per radio and applies the
+ * side effects the driver relies on: write-one-to-clear SYS_STATUS, self clearing SYS_CTRL commands, immediate and
+ * delayed TX/RX with HPDWARN/TXPUTE, frame wait timeout, wait-for-response, OTP reads, softreset, sleep/wakeup
+ * on chip select and the level sensitive interrupt line. A channel thread moves frames between radios in host time,
+ * every radio timestamps them against its own 40-bit clock.
+ *
+ * Limitations: double buffered RX is not modelled (the IC and host buffer pointers always compare equal), auto-ack,
+ * sniff mode and the external sync interface are not implemented and every delivered frame passes its FCS.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "hal/hal_dw1000_sim.h"
+#include "dw1000/dw1000_regs.h"
+
+#define SIM_DEVICE_ID           (0xDECA0130)
+#define SIM_MASK40              (0xFFFFFFFFFFULL)
+#define SIM_HALF_PERIOD         (0x8000000000ULL)
+#define SIM_DTU_PER_NS          (63.8976L)      //!< 499.2MHz * 128
+#define SIM_C_AIR_M_PER_NS      (0.299702547L)
+#define SIM_UUS_NS              (1025.641L)     //!< 512/499.2MHz, unit of RX_FWTO and W4R_TIM
+#define SIM_RX_ACQ_SYMBOLS      (16)            //!< Preamble symbols needed to acquire a frame
+#define SIM_WAKEUP_CS_NS        (500000)        //!< Chip select low time that wakes the radio
+#define SIM_FP_INDEX            (745)
+#define SIM_OTP_WORDS           (0x20)
+#define SIM_OTP_PARTID          (0x06)          //!< See dw1000_otp.h
+#define SIM_OTP_LOTID           (0x07)
+#define SIM_WRBUF_LEN           (4096)
+
+/* Register file layout, length in bytes of each register id */
+static const uint16_t sim_reg_len[0x40] = {
+    [DEV_ID_ID] = 4, [EUI_64_ID] = 8, [PANADR_ID] = 4, [SYS_CFG_ID] = 4,
+    [SYS_TIME_ID] = 5, [TX_FCTRL_ID] = 5, [TX_BUFFER_ID] = 1024, [DX_TIME_ID] = 5,
+    [RX_FWTO_ID] = 2, [SYS_CTRL_ID] = 4, [SYS_MASK_ID] = 4, [SYS_STATUS_ID] = 5,
+    [RX_FINFO_ID] = 4, [RX_BUFFER_ID] = 1024, [RX_FQUAL_ID] = 8, [RX_TTCKI_ID] = 4,
+    [RX_TTCKO_ID] = 5, [RX_TIME_ID] = 14, [TX_TIME_ID] = 10, [TX_ANTD_ID] = 2,
+    [SYS_STATE_ID] = 5, [ACK_RESP_T_ID] = 4, [RX_SNIFF_ID] = 4, [TX_POWER_ID] = 4,
+    [CHAN_CTRL_ID] = 4, [USR_SFD_ID] = 41, [AGC_CTRL_ID] = 33, [EXT_SYNC_ID] = 12,
+    [ACC_MEM_ID] = 4065, [GPIO_CTRL_ID] = 44, [DRX_CONF_ID] = 44, [RF_CONF_ID] = 58,
+    [TX_CAL_ID] = 52, [FS_CTRL_ID] = 21, [AON_ID] = 12, [OTP_IF_ID] = 19,
+    [LDE_IF_ID] = 0x2806, [0x2F] = 41, [PMSC_ID] = 48
+};
+
+typedef enum _sim_event_type_t {
+    SIM_EV_TX_DONE,
+    SIM_EV_RX_ON,
+    SIM_EV_RX_SFD,
+    SIM_EV_RX_END,
+    SIM_EV_RX_TIMEOUT
+} sim_event_type_t;
+
+typedef struct _sim_frame_t {
+    uint32_t refcnt;
+    uint16_t src;
+    uint16_t len;                   //!< Frame length including FCS
+    uint8_t psr;                    //!< Preamble symbols code (TX_FCTRL bits 18..21)
+    uint8_t prf;
+    uint8_t br;
+    uint8_t channel;
+    uint8_t pcode;                  //!< Preamble code
+    long double rmarker_ns;         //!< Host time the RMARKER left the transmit antenna
+    long double phr_data_ns;        //!< Airtime after the RMARKER
+    long double preamble_ns;        //!< Airtime of preamble and SFD
+    uint8_t data[];
+} sim_frame_t;
+
+typedef struct _sim_event_t {
+    int64_t time_ns;
+    uint64_t order;
+    sim_event_type_t type;
+    uint16_t node;
+    uint32_t seq;
+    long double arrival_ns;
+    sim_frame_t * frame;
+} sim_event_t;
+
+typedef struct _sim_node_t {
+    struct hal_dw1000_sim_node_cfg cfg;
+    struct hal_dw1000_sim_stats stats;
+    uint8_t * regs;
+    uint32_t regs_len;
+    uint32_t reg_base[0x40];
+    uint32_t otp[SIM_OTP_WORDS];
+    uint64_t clk_offset;            //!< Local clock at the simulation epoch
+    long double rate;               //!< Local DTU per host ns
+
+    /* SPI transaction state */
+    bool cs_active;
+    int64_t cs_low_ns;
+    uint8_t hdr[3];
+    uint8_t hdr_len;
+    bool hdr_done;
+    bool write;
+    uint8_t reg;
+    uint16_t offset;
+    uint16_t index;
+    uint16_t wrlen;
+    uint8_t wrbuf[SIM_WRBUF_LEN];
+
+    /* Radio state */
+    bool sleeping;
+    bool tx_active;
+    bool tx_wait;
+    uint32_t tx_seq;
+    bool w4r;
+    bool rx_active;
+    bool rx_wait;
+    int64_t rx_on_ns;
+    uint32_t rx_seq;
+    sim_frame_t * rx_lock;
+    bool irq_level;
+    bool irq_pending;
+} sim_node_t;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool started;
+    int64_t epoch_ns;
+    struct hal_dw1000_sim_channel_cfg channel;
+    uint32_t rand_state;
+    uint16_t nnodes;
+    sim_node_t * nodes[HAL_DW1000_SIM_MAX_NODES];
+    sim_event_t ** heap;
+    uint32_t heap_len;
+    uint32_t heap_size;
+    uint64_t order;
+} g_sim = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .rand_state = 0x2545F491
+};
+
+static void sim_node_irq_update(sim_node_t * node, bool retrigger);
+
+static int64_t
+sim_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec - g_sim.epoch_ns;
+}
+
+static uint32_t
+sim_rand(void)
+{
+    /* xorshift32, good enough for a loss process */
+    uint32_t x = g_sim.rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return g_sim.rand_state = x;
+}
+
+/*
+ * Register file helpers
+ */
+static inline uint8_t *
+sim_reg(sim_node_t * node, uint8_t reg, uint16_t offset)
+{
+    return &node->regs[node->reg_base[reg] + offset];
+}
+
+static uint64_t
+sim_reg_get(sim_node_t * node, uint8_t reg, uint16_t offset, uint8_t nbytes)
+{
+    uint64_t val = 0;
+    uint8_t * p = sim_reg(node, reg, offset);
+    for (int i = nbytes - 1; i >= 0; i--)
+        val = (val << 8) | p[i];
+    return val;
+}
+
+static void
+sim_reg_set(sim_node_t * node, uint8_t reg, uint16_t offset, uint64_t val, uint8_t nbytes)
+{
+    uint8_t * p = sim_reg(node, reg, offset);
+    for (int i = 0; i < nbytes; i++, val >>= 8)
+        p[i] = (uint8_t) val;
+}
+
+static inline uint64_t
+sim_status(sim_node_t * node)
+{
+    return sim_reg_get(node, SYS_STATUS_ID, 0, SYS_STATUS_LEN);
+}
+
+static inline void
+sim_status_set(sim_node_t * node, uint64_t bits)
+{
+    sim_reg_set(node, SYS_STATUS_ID, 0, sim_status(node) | bits, SYS_STATUS_LEN);
+}
+
+/*
+ * Clock helpers, every radio runs its own 40-bit clock derived from host time
+ */
+static uint64_t
+sim_local_dtu(sim_node_t * node, long double host_ns)
+{
+    return (node->clk_offset + (uint64_t) llroundl(host_ns * node->rate)) & SIM_MASK40;
+}
+
+static long double
+sim_dtu_to_ns(sim_node_t * node, uint64_t dtu)
+{
+    return (long double) dtu / node->rate;
+}
+
+/*
+ * Event queue, binary heap ordered by host time
+ */
+static bool
+sim_ev_before(sim_event_t * a, sim_event_t * b)
+{
+    return (a->time_ns < b->time_ns) || (a->time_ns == b->time_ns && a->order < b->order);
+}
+
+static sim_event_t *
+sim_ev_push(sim_event_type_t type, sim_node_t * node, uint16_t idx, int64_t time_ns, sim_frame_t * frame)
+{
+    sim_event_t * ev = (sim_event_t *) calloc(1, sizeof(sim_event_t));
+    assert(ev);
+    ev->type = type;
+    ev->node = idx;
+    ev->time_ns = time_ns;
+    ev->order = g_sim.order++;
+    ev->frame = frame;
+    if (frame)
+        frame->refcnt++;
+    switch (type) {
+    case SIM_EV_TX_DONE: ev->seq = node->tx_seq; break;
+    default: ev->seq = node->rx_seq; break;
+    }
+
+    if (g_sim.heap_len == g_sim.heap_size) {
+        g_sim.heap_size = g_sim.heap_size ? 2 * g_sim.heap_size : 64;
+        g_sim.heap = (sim_event_t **) realloc(g_sim.heap, g_sim.heap_size * sizeof(sim_event_t *));
+        assert(g_sim.heap);
+    }
+    uint32_t i = g_sim.heap_len++;
+    while (i && sim_ev_before(ev, g_sim.heap[(i - 1) / 2])) {
+        g_sim.heap[i] = g_sim.heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    g_sim.heap[i] = ev;
+    pthread_cond_signal(&g_sim.cond);
+    return ev;
+}
+
+static sim_event_t *
+sim_ev_pop(void)
+{
+    sim_event_t * top = g_sim.heap[0];
+    sim_event_t * last = g_sim.heap[--g_sim.heap_len];
+    uint32_t i = 0;
+
+    while (2 * i + 1 < g_sim.heap_len) {
+        uint32_t c = 2 * i + 1;
+        if (c + 1 < g_sim.heap_len && sim_ev_before(g_sim.heap[c + 1], g_sim.heap[c]))
+            c++;
+        if (!sim_ev_before(g_sim.heap[c], last))
+            break;
+        g_sim.heap[i] = g_sim.heap[c];
+        i = c;
+    }
+    if (g_sim.heap_len)
+        g_sim.heap[i] = last;
+    return top;
+}
+
+static void
+sim_frame_put(sim_frame_t * frame)
+{
+    if (frame && --frame->refcnt == 0)
+        free(frame);
+}
+
+/*
+ * PHY timing
+ */
+static uint16_t
+sim_preamble_symbols(uint8_t psr)
+{
+    switch (psr) {
+    case 0x0: return 16;
+    case 0x1: return 64;
+    case 0x5: return 128;
+    case 0x9: return 256;
+    case 0xD: return 512;
+    case 0x2: return 1024;
+    case 0x6: return 1536;
+    case 0xA: return 2048;
+    case 0x3: return 4096;
+    default:  return 128;
+    }
+}
+
+static long double
+sim_tpsym_ns(uint8_t prf)
+{
+    return (prf == 1) ? 993.59L : 1017.63L;
+}
+
+static long double
+sim_tbit_ns(uint8_t br)
+{
+    switch (br) {
+    case 0:  return 8205.13L;
+    case 1:  return 1025.64L;
+    default: return 128.21L;
+    }
+}
+
+static long double
+sim_preamble_ns(uint8_t psr, uint8_t prf, uint8_t br)
+{
+    uint16_t nsfd = (br == 0) ? 64 : 8;
+    return (sim_preamble_symbols(psr) + nsfd) * sim_tpsym_ns(prf);
+}
+
+static long double
+sim_phr_data_ns(uint16_t len, uint8_t br)
+{
+    /* PHR is always 21 bits at 850k (110k in 110k mode), data carries 48 RS parity bits per 330 */
+    long double phr = 21 * ((br == 0) ? sim_tbit_ns(0) : sim_tbit_ns(1));
+    return phr + len * 8 * (1.0L + 48.0L / 330.0L) * sim_tbit_ns(br);
+}
+
+static long double
+sim_channel_hz(uint8_t channel)
+{
+    switch (channel) {
+    case 1:  return 3494.4e6L;
+    case 2:  return 3993.6e6L;
+    case 3:  return 4492.8e6L;
+    case 4:  return 3993.6e6L;
+    case 7:  return 6489.6e6L;
+    default: return 6489.6e6L;
+    }
+}
+
+/*
+ * Register reset state
+ */
+static void
+sim_node_reset(sim_node_t * node)
+{
+    memset(node->regs, 0, node->regs_len);
+    sim_reg_set(node, DEV_ID_ID, 0, SIM_DEVICE_ID, 4);
+    sim_reg_set(node, EUI_64_ID, 0, ((uint64_t)node->otp[SIM_OTP_LOTID] << 32) | node->otp[SIM_OTP_PARTID], 8);
+    sim_reg_set(node, PANADR_ID, 0, 0xFFFFFFFF, 4);
+    sim_reg_set(node, SYS_CFG_ID, 0, SYS_CFG_HIRQ_POL | SYS_CFG_DIS_DRXB, 4);
+    sim_reg_set(node, TX_FCTRL_ID, 0, 0x0015400C, 4);
+    sim_reg_set(node, CHAN_CTRL_ID, 0, 0x00000055, 4);
+    sim_reg_set(node, SYS_STATUS_ID, 0, SYS_STATUS_CPLOCK, SYS_STATUS_LEN);
+    sim_reg_set(node, PMSC_ID, 0, 0xF0300200, 4);
+
+    node->tx_seq++;
+    node->rx_seq++;
+    node->tx_active = node->tx_wait = node->w4r = false;
+    node->rx_active = node->rx_wait = false;
+    sim_frame_put(node->rx_lock);
+    node->rx_lock = NULL;
+    node->sleeping = false;
+    node->irq_level = false;
+}
+
+static void
+sim_trx_off(sim_node_t * node)
+{
+    node->tx_seq++;
+    node->rx_seq++;
+    node->tx_active = node->tx_wait = node->w4r = false;
+    node->rx_active = node->rx_wait = false;
+    sim_frame_put(node->rx_lock);
+    node->rx_lock = NULL;
+}
+
+static void
+sim_enter_sleep(sim_node_t * node)
+{
+    sim_trx_off(node);
+    node->sleeping = true;
+    hal_gpio_native_drive(node->cfg.irq_pin, 0);
+    node->irq_level = false;
+}
+
+static void
+sim_wakeup(sim_node_t * node)
+{
+    node->sleeping = false;
+    /* Antenna delays live in the LDE and are not preserved by the AON block */
+    sim_reg_set(node, TX_ANTD_ID, 0, 0, TX_ANTD_LEN);
+    sim_reg_set(node, LDE_IF_ID, LDE_RXANTD_OFFSET, 0, LDE_RXANTD_LEN);
+    sim_status_set(node, SYS_STATUS_SLP2INIT | SYS_STATUS_CPLOCK);
+    sim_node_irq_update(node, false);
+}
+
+/*
+ * Receiver
+ */
+static uint16_t
+sim_node_index(sim_node_t * node)
+{
+    for (uint16_t i = 0; i < g_sim.nnodes; i++)
+        if (g_sim.nodes[i] == node)
+            return i;
+    assert(0);
+    return 0;
+}
+
+/* A receiver only acquires preambles sent on its channel, PRF and preamble code */
+static bool
+sim_rx_tuned(sim_node_t * node, sim_frame_t * frame)
+{
+    uint32_t chan_ctrl = sim_reg_get(node, CHAN_CTRL_ID, 0, 4);
+
+    return ((chan_ctrl & CHAN_CTRL_RX_CHAN_MASK) >> CHAN_CTRL_RX_CHAN_SHIFT) == frame->channel &&
+           ((chan_ctrl & CHAN_CTRL_RXFPRF_MASK) >> CHAN_CTRL_RXFPRF_SHIFT) == frame->prf &&
+           ((chan_ctrl & CHAN_CTRL_RX_PCOD_MASK) >> CHAN_CTRL_RX_PCOD_SHIFT) == frame->pcode;
+}
+
+static void
+sim_rx_enable(sim_node_t * node, int64_t now)
+{
+    node->rx_seq++;
+    node->rx_active = true;
+    node->rx_wait = false;
+    node->rx_on_ns = now;
+
+    uint32_t sys_cfg = sim_reg_get(node, SYS_CFG_ID, 0, 4);
+    uint16_t fwto = sim_reg_get(node, RX_FWTO_ID, 0, 2);
+    if ((sys_cfg & SYS_CFG_RXWTOE) && fwto) {
+        long double timeout = fwto * SIM_UUS_NS * SIM_DTU_PER_NS / node->rate;
+        sim_ev_push(SIM_EV_RX_TIMEOUT, node, sim_node_index(node), now + (int64_t) ceill(timeout), NULL);
+    }
+}
+
+static bool
+sim_rx_filter(sim_node_t * node, sim_frame_t * frame)
+{
+    uint32_t sys_cfg = sim_reg_get(node, SYS_CFG_ID, 0, 4);
+    if (!(sys_cfg & SYS_CFG_FFE) || frame->len < 3)
+        return true;
+
+    uint16_t fctrl = frame->data[0] | (frame->data[1] << 8);
+    uint8_t ftype = fctrl & 0x7;
+    static const uint32_t allow[8] = {
+        SYS_CFG_FFAB, SYS_CFG_FFAD, SYS_CFG_FFAA, SYS_CFG_FFAM,
+        SYS_CFG_FFA4, SYS_CFG_FFA5, SYS_CFG_FFAR, SYS_CFG_FFAR
+    };
+    if (!(sys_cfg & allow[ftype]))
+        return false;
+    if (ftype != 1 && ftype != 3)
+        return true;
+
+    uint16_t panid = sim_reg_get(node, PANADR_ID, PANADR_PAN_ID_OFFSET, 2);
+    uint8_t dst_mode = (fctrl >> 10) & 0x3;
+    if (dst_mode == 0)
+        return (sys_cfg & SYS_CFG_FFBC) != 0;
+    if (frame->len < 5)
+        return false;
+    uint16_t dst_pan = frame->data[3] | (frame->data[4] << 8);
+    if (dst_pan != 0xFFFF && dst_pan != panid)
+        return false;
+    if (dst_mode == 2 && frame->len >= 7) {
+        uint16_t dst = frame->data[5] | (frame->data[6] << 8);
+        uint16_t short_addr = sim_reg_get(node, PANADR_ID, PANADR_SHORT_ADDR_OFFSET, 2);
+        return dst == 0xFFFF || dst == short_addr;
+    }
+    if (dst_mode == 3 && frame->len >= 13) {
+        uint64_t dst = 0;
+        for (int i = 12; i >= 5; i--)
+            dst = (dst << 8) | frame->data[i];
+        return dst == sim_reg_get(node, EUI_64_ID, 0, 8);
+    }
+    return false;
+}
+
+/**
+ * Populate the RX register set with the frame, timestamps and diagnostics consistent with
+ * a line-of-sight free space link.
+ */
+static void
+sim_rx_deliver(sim_node_t * node, sim_frame_t * frame, long double arrival_ns)
+{
+    sim_node_t * src = g_sim.nodes[frame->src];
+    uint16_t rxantd = sim_reg_get(node, LDE_IF_ID, LDE_RXANTD_OFFSET, 2);
+
+    memcpy(sim_reg(node, RX_BUFFER_ID, 0), frame->data, frame->len);
+
+    uint16_t pacc = sim_preamble_symbols(frame->psr);
+    pacc = (pacc > 0xFFF) ? 0xFFF : pacc;
+    uint32_t finfo = frame->len | ((uint32_t)frame->br << RX_FINFO_RXBR_SHIFT)
+                   | ((uint32_t)frame->prf << RX_FINFO_RXPRF_SHIFT) | ((uint32_t)pacc << RX_FINFO_RXPACC_SHIFT);
+    sim_reg_set(node, RX_FINFO_ID, 0, finfo, 4);
+
+    /* Timestamps, adjusted stamp is referenced to the antenna */
+    uint64_t rx_stamp = sim_local_dtu(node, arrival_ns);
+    sim_reg_set(node, RX_TIME_ID, RX_TIME_RX_STAMP_OFFSET, rx_stamp, 5);
+    sim_reg_set(node, RX_TIME_ID, RX_TIME_FP_RAWST_OFFSET, (rx_stamp + rxantd) & SIM_MASK40, 5);
+
+    /* Received power from free space path loss, reported through the rxdiag registers */
+    long double dx = src->cfg.x - node->cfg.x, dy = src->cfg.y - node->cfg.y, dz = src->cfg.z - node->cfg.z;
+    long double d = sqrtl(dx * dx + dy * dy + dz * dz);
+    d = (d < 0.1L) ? 0.1L : d;
+    long double fspl = 20.0L * log10l(4.0L * M_PI * d * sim_channel_hz(frame->channel) / (SIM_C_AIR_M_PER_NS * 1e9L));
+    long double A = (frame->prf == 1) ? 113.77L : 121.74L;
+    long double p = powl(10.0L, (-14.3L - fspl + A) / 10.0L) * pacc * pacc;
+    long double cir_pwr = p / 131072.0L;
+    long double fp_ampl = sqrtl(p / 3.0L);
+    cir_pwr = (cir_pwr > 0xFFFF) ? 0xFFFF : cir_pwr;
+    fp_ampl = (fp_ampl > 0xFFFF) ? 0xFFFF : fp_ampl;
+
+    sim_reg_set(node, RX_TIME_ID, RX_TIME_FP_INDEX_OFFSET, SIM_FP_INDEX << 6, 2);
+    sim_reg_set(node, RX_TIME_ID, RX_TIME_FP_AMPL1_OFFSET, (uint16_t) fp_ampl, 2);
+    uint64_t fqual = 40 | ((uint64_t)(uint16_t) fp_ampl << 16) | ((uint64_t)(uint16_t) fp_ampl << 32)
+                   | ((uint64_t)(uint16_t) cir_pwr << 48);
+    sim_reg_set(node, RX_FQUAL_ID, 0, fqual, 8);
+
+    /* Accumulator, a single dominant path at the first path index */
+    memset(sim_reg(node, ACC_MEM_ID, 0), 0, sim_reg_len[ACC_MEM_ID]);
+    for (int i = 0; i < 3; i++)
+        sim_reg_set(node, ACC_MEM_ID, 1 + 4 * (SIM_FP_INDEX + i), (uint16_t)((int)fp_ampl >> i), 2);
+
+    /* Clock offset seen by the receiver: carrier integrator and time tracking offset */
+    long double ratio = (src->rate - node->rate) / node->rate;
+    long double fom = (998.4e6L / 2.0L / ((frame->br == 0) ? 8192.0L : 1024.0L) / 131072.0L);
+    long double hz_to_ppm = -1.0e6L / sim_channel_hz(frame->channel);
+    int32_t ci = (int32_t) llroundl(ratio / (fom * hz_to_ppm / 1.0e6L));
+    sim_reg_set(node, DRX_CONF_ID, DRX_CARRIER_INT_OFFSET, (uint32_t) ci & DRX_CARRIER_INT_MASK, DRX_CARRIER_INT_LEN);
+    int32_t denom = (frame->prf == 1) ? 0x01F00000 : 0x01FC0000;
+    int32_t ttcko = (int32_t) llroundl(-ratio * denom);
+    sim_reg_set(node, RX_TTCKI_ID, 0, denom, 4);
+    sim_reg_set(node, RX_TTCKO_ID, 0, (uint32_t) ttcko & RX_TTCKO_RXTOFS_MASK, 3);
+
+    sim_status_set(node, SYS_STATUS_RXPRD | SYS_STATUS_RXSFDD | SYS_STATUS_LDEDONE | SYS_STATUS_RXPHD
+                       | SYS_STATUS_RXDFR | SYS_STATUS_RXFCG);
+    node->stats.rx_frames++;
+}
+
+/*
+ * Transmitter
+ */
+static void
+sim_tx_start(sim_node_t * node, uint8_t sys_ctrl, int64_t now)
+{
+    uint64_t fctrl = sim_reg_get(node, TX_FCTRL_ID, 0, 5);
+    uint16_t len = fctrl & TX_FCTRL_FLE_MASK;
+    uint16_t txboffs = (fctrl & TX_FCTRL_TXBOFFS_MASK) >> TX_FCTRL_TXBOFFS_SHFT;
+    uint8_t br = (fctrl & TX_FCTRL_TXBR_MASK) >> TX_FCTRL_TXBR_SHFT;
+    uint8_t prf = (fctrl & TX_FCTRL_TXPRF_MASK) >> TX_FCTRL_TXPRF_SHFT;
+    uint8_t psr = (fctrl & TX_FCTRL_TXPSR_PE_MASK) >> TX_FCTRL_TXPSR_SHFT;
+    uint16_t txantd = sim_reg_get(node, TX_ANTD_ID, 0, 2);
+    uint16_t idx = sim_node_index(node);
+
+    if (len < 2 || txboffs + len - 2 > TX_BUFFER_LEN) {
+        sim_status_set(node, SYS_STATUS_TXBERR);
+        return;
+    }
+
+    long double preamble_ns = sim_preamble_ns(psr, prf, br);
+    uint64_t t0 = sim_local_dtu(node, now);
+    uint64_t raw;
+    long double rmarker_ns;
+    if (sys_ctrl & SYS_CTRL_TXDLYS) {
+        raw = sim_reg_get(node, DX_TIME_ID, 0, 5) & ~0x1FFULL;
+        uint64_t delta = (raw + txantd - t0) & SIM_MASK40;
+        if (delta >= SIM_HALF_PERIOD) {
+            sim_status_set(node, SYS_STATUS_HPDWARN);
+            node->stats.tx_late++;
+            return;
+        }
+        rmarker_ns = now + sim_dtu_to_ns(node, delta);
+        if (rmarker_ns - preamble_ns - sim_dtu_to_ns(node, txantd) < now) {
+            sim_status_set(node, SYS_STATUS_TXPUTE);
+            node->stats.tx_late++;
+            return;
+        }
+        node->tx_wait = true;
+    } else {
+        raw = (t0 + (uint64_t) llroundl(preamble_ns * node->rate)) & SIM_MASK40;
+        rmarker_ns = now + preamble_ns + sim_dtu_to_ns(node, txantd);
+    }
+    sim_reg_set(node, TX_TIME_ID, TX_TIME_TX_STAMP_OFFSET, (raw + txantd) & SIM_MASK40, 5);
+    sim_reg_set(node, TX_TIME_ID, TX_TIME_TX_RAWST_OFFSET, raw, 5);
+
+    sim_frame_t * frame = (sim_frame_t *) calloc(1, sizeof(sim_frame_t) + len);
+    assert(frame);
+    frame->src = idx;
+    frame->len = len;
+    frame->psr = psr;
+    frame->prf = prf;
+    frame->br = br;
+    uint32_t chan_ctrl = sim_reg_get(node, CHAN_CTRL_ID, 0, 4);
+    frame->channel = (chan_ctrl & CHAN_CTRL_TX_CHAN_MASK) >> CHAN_CTRL_TX_CHAN_SHIFT;
+    frame->pcode = (chan_ctrl & CHAN_CTRL_TX_PCOD_MASK) >> CHAN_CTRL_TX_PCOD_SHIFT;
+    frame->rmarker_ns = rmarker_ns;
+    frame->preamble_ns = preamble_ns;
+    frame->phr_data_ns = sim_phr_data_ns(len, br);
+    memcpy(frame->data, sim_reg(node, TX_BUFFER_ID, txboffs), len - 2);
+
+    node->tx_seq++;
+    node->tx_active = true;
+    node->w4r = (sys_ctrl & SYS_CTRL_WAIT4RESP) != 0;
+    node->stats.tx_frames++;
+    sim_ev_push(SIM_EV_TX_DONE, node, idx, (int64_t) ceill(rmarker_ns + frame->phr_data_ns), NULL);
+
+    /* Put the frame on the channel */
+    frame->refcnt++;
+    for (uint16_t i = 0; i < g_sim.nnodes; i++) {
+        sim_node_t * rx = g_sim.nodes[i];
+        if (rx == node)
+            continue;
+        if (g_sim.channel.loss_ppm && (sim_rand() % 1000000) < g_sim.channel.loss_ppm) {
+            rx->stats.rx_lost++;
+            continue;
+        }
+        long double dx = rx->cfg.x - node->cfg.x, dy = rx->cfg.y - node->cfg.y, dz = rx->cfg.z - node->cfg.z;
+        long double arrival = rmarker_ns + sqrtl(dx * dx + dy * dy + dz * dz) / SIM_C_AIR_M_PER_NS
+                            + g_sim.channel.delay_ps / 1000.0L;
+        /* Event time is coarse, the antenna arrival is kept with sub-ns resolution for timestamping */
+        sim_ev_push(SIM_EV_RX_SFD, rx, i, (int64_t) floorl(arrival), frame)->arrival_ns = arrival;
+    }
+    sim_frame_put(frame);
+}
+
+static void
+sim_rx_start(sim_node_t * node, uint16_t sys_ctrl, int64_t now)
+{
+    if (sys_ctrl & SYS_CTRL_RXDLYE) {
+        uint64_t t0 = sim_local_dtu(node, now);
+        uint64_t delta = ((sim_reg_get(node, DX_TIME_ID, 0, 5) & ~0x1FFULL) - t0) & SIM_MASK40;
+        if (delta >= SIM_HALF_PERIOD) {
+            sim_status_set(node, SYS_STATUS_HPDWARN);
+            node->stats.tx_late++;
+            return;
+        }
+        node->rx_seq++;
+        node->rx_wait = true;
+        sim_ev_push(SIM_EV_RX_ON, node, sim_node_index(node), now + (int64_t) ceill(sim_dtu_to_ns(node, delta)), NULL);
+    } else {
+        sim_rx_enable(node, now);
+    }
+}
+
+/*
+ * Register side effects, applied when chip select is released
+ */
+static void
+sim_write_commit(sim_node_t * node)
+{
+    uint8_t reg = node->reg;
+    uint16_t offset = node->offset;
+    uint16_t len = node->wrlen;
+    uint16_t size = sim_reg_len[reg];
+    int64_t now = sim_now_ns();
+
+    if (offset >= size || len == 0)
+        return;
+    if (offset + len > size)
+        len = size - offset;
+
+    switch (reg) {
+    case DEV_ID_ID:
+    case SYS_TIME_ID:
+    case SYS_STATE_ID:
+    case RX_TIME_ID:
+    case TX_TIME_ID:
+        return;
+    case SYS_STATUS_ID: {
+        /* Write one to clear */
+        uint8_t * p = sim_reg(node, SYS_STATUS_ID, offset);
+        for (uint16_t i = 0; i < len; i++)
+            p[i] &= ~node->wrbuf[i];
+        sim_node_irq_update(node, true);
+        return;
+    }
+    case SYS_CTRL_ID: {
+        uint8_t cmd[SYS_CTRL_LEN] = {0};
+        memcpy(&cmd[offset], node->wrbuf, len);
+        uint32_t sys_ctrl = cmd[0] | (cmd[1] << 8) | (cmd[2] << 16) | ((uint32_t)cmd[3] << 24);
+        if (sys_ctrl & SYS_CTRL_TRXOFF)
+            sim_trx_off(node);
+        if (sys_ctrl & SYS_CTRL_TXSTRT)
+            sim_tx_start(node, sys_ctrl, now);
+        if (sys_ctrl & SYS_CTRL_RXENAB)
+            sim_rx_start(node, sys_ctrl, now);
+        sim_node_irq_update(node, false);
+        return;
+    }
+    default:
+        break;
+    }
+
+    memcpy(sim_reg(node, reg, offset), node->wrbuf, len);
+
+    switch (reg) {
+    case SYS_MASK_ID:
+        sim_node_irq_update(node, true);
+        break;
+    case PMSC_ID:
+        if (offset <= PMSC_CTRL0_SOFTRESET_OFFSET && offset + len > PMSC_CTRL0_SOFTRESET_OFFSET) {
+            uint8_t softreset = node->wrbuf[PMSC_CTRL0_SOFTRESET_OFFSET - offset];
+            if (softreset == PMSC_CTRL0_RESET_ALL) {
+                sim_node_reset(node);
+            } else if (softreset == PMSC_CTRL0_RESET_RX) {
+                node->rx_seq++;
+                node->rx_active = node->rx_wait = false;
+                sim_frame_put(node->rx_lock);
+                node->rx_lock = NULL;
+            }
+            *sim_reg(node, PMSC_ID, PMSC_CTRL0_SOFTRESET_OFFSET) = PMSC_CTRL0_RESET_CLEAR;
+        }
+        break;
+    case AON_ID:
+        if (offset <= AON_CTRL_OFFSET && offset + len > AON_CTRL_OFFSET) {
+            /* A save with the wake up sources cleared is the upload preceding a softreset, not a sleep request */
+            uint8_t cfg0 = *sim_reg(node, AON_ID, AON_CFG0_OFFSET);
+            if ((node->wrbuf[AON_CTRL_OFFSET - offset] & AON_CTRL_SAVE) &&
+                (cfg0 & (AON_CFG0_SLEEP_EN | AON_CFG0_WAKE_PIN | AON_CFG0_WAKE_SPI | AON_CFG0_WAKE_CNT)))
+                sim_enter_sleep(node);
+            *sim_reg(node, AON_ID, AON_CTRL_OFFSET) = 0;
+        }
+        break;
+    case OTP_IF_ID:
+        if (offset <= OTP_CTRL && offset + len > OTP_CTRL) {
+            if (node->wrbuf[OTP_CTRL - offset] & OTP_CTRL_OTPREAD) {
+                uint16_t addr = sim_reg_get(node, OTP_IF_ID, OTP_ADDR, 2);
+                sim_reg_set(node, OTP_IF_ID, OTP_RDAT, (addr < SIM_OTP_WORDS) ? node->otp[addr] : 0, 4);
+            }
+            *sim_reg(node, OTP_IF_ID, OTP_CTRL) &= ~OTP_CTRL_OTPREAD;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Refresh registers whose content is derived from the radio state, called once the read header is decoded.
+ */
+static void
+sim_read_refresh(sim_node_t * node, uint8_t reg, int64_t now)
+{
+    switch (reg) {
+    case SYS_TIME_ID:
+        /* SYS_TIME counts in units of 512 DTU */
+        sim_reg_set(node, SYS_TIME_ID, 0, sim_local_dtu(node, now) & ~0x1FFULL, 5);
+        break;
+    case SYS_STATE_ID: {
+        uint8_t pmsc = PMSC_STATE_IDLE;
+        if (node->tx_active)
+            pmsc = node->tx_wait ? PMSC_STATE_TX_WAIT : PMSC_STATE_TX;
+        else if (node->rx_wait)
+            pmsc = PMSC_STATE_RX_WAIT;
+        else if (node->rx_active)
+            pmsc = PMSC_STATE_RX;
+        sim_reg_set(node, SYS_STATE_ID, PMSC_STATE_OFFSET, pmsc, 1);
+        sim_reg_set(node, SYS_STATE_ID, RX_STATE_OFFSET, node->rx_active ? RX_STATE_RX_RDY : RX_STATE_IDLE, 1);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * Re-evaluate the level of the interrupt line. The line is level sensitive on the IC, the driver however
+ * arms a rising edge. When retrigger is set (after the host cleared status or changed the mask) and the line
+ * is still high, it is pulsed so that events raised while the host was servicing the previous ones are not lost.
+ */
+static void
+sim_node_irq_update(sim_node_t * node, bool retrigger)
+{
+    uint64_t status = sim_status(node);
+    uint32_t mask = sim_reg_get(node, SYS_MASK_ID, 0, 4);
+    bool level = (status & mask & 0xFFFFFFFEUL) != 0;
+
+    status = level ? (status | SYS_STATUS_IRQS) : (status & ~(uint64_t)SYS_STATUS_IRQS);
+    sim_reg_set(node, SYS_STATUS_ID, 0, status, SYS_STATUS_LEN);
+
+    if (level && (!node->irq_level || retrigger))
+        node->irq_pending = true;
+    node->irq_level = level;
+}
+
+/**
+ * Deliver interrupt edges, must be called without holding the simulator lock.
+ */
+static void
+sim_irq_flush(void)
+{
+    int pins[HAL_DW1000_SIM_MAX_NODES];
+    uint16_t n = 0;
+
+    pthread_mutex_lock(&g_sim.mutex);
+    for (uint16_t i = 0; i < g_sim.nnodes; i++) {
+        sim_node_t * node = g_sim.nodes[i];
+        if (node->irq_pending) {
+            node->irq_pending = false;
+            node->stats.irqs++;
+            pins[n++] = node->cfg.irq_pin;
+        }
+    }
+    pthread_mutex_unlock(&g_sim.mutex);
+
+    for (uint16_t i = 0; i < n; i++) {
+        hal_gpio_native_drive(pins[i], 0);
+        hal_gpio_native_drive(pins[i], 1);
+    }
+}
+
+/*
+ * Channel thread
+ */
+static void
+sim_event_process(sim_event_t * ev)
+{
+    sim_node_t * node = g_sim.nodes[ev->node];
+
+    switch (ev->type) {
+    case SIM_EV_TX_DONE:
+        if (ev->seq != node->tx_seq || !node->tx_active)
+            break;
+        node->tx_active = node->tx_wait = false;
+        sim_status_set(node, SYS_STATUS_TXFRB | SYS_STATUS_TXPRS | SYS_STATUS_TXPHS | SYS_STATUS_TXFRS);
+        if (sim_reg_get(node, PMSC_ID, PMSC_CTRL1_OFFSET, 4) & PMSC_CTRL1_ATXSLP) {
+            sim_enter_sleep(node);
+            break;
+        }
+        if (node->w4r) {
+            node->w4r = false;
+            uint32_t w4r_tim = sim_reg_get(node, ACK_RESP_T_ID, 0, 4) & ACK_RESP_T_W4R_TIM_MASK;
+            if (w4r_tim) {
+                node->rx_seq++;
+                node->rx_wait = true;
+                sim_ev_push(SIM_EV_RX_ON, node, ev->node, ev->time_ns + (int64_t)(w4r_tim * SIM_UUS_NS), NULL);
+            } else {
+                sim_rx_enable(node, ev->time_ns);
+            }
+        }
+        break;
+    case SIM_EV_RX_ON:
+        if (ev->seq != node->rx_seq || !node->rx_wait)
+            break;
+        sim_rx_enable(node, ev->time_ns);
+        break;
+    case SIM_EV_RX_SFD: {
+        sim_frame_t * frame = ev->frame;
+        long double acquire = ev->arrival_ns - (frame->preamble_ns
+                            - sim_preamble_symbols(frame->psr) * sim_tpsym_ns(frame->prf))
+                            - SIM_RX_ACQ_SYMBOLS * sim_tpsym_ns(frame->prf);
+        if (node->sleeping || !node->rx_active || node->rx_on_ns > acquire || !sim_rx_tuned(node, frame)) {
+            node->stats.rx_missed++;
+            break;
+        }
+        if (node->rx_lock) {
+            node->stats.rx_collisions++;
+            break;
+        }
+        node->rx_lock = frame;
+        frame->refcnt++;
+        sim_ev_push(SIM_EV_RX_END, node, ev->node, (int64_t) ceill(ev->arrival_ns + frame->phr_data_ns),
+                    frame)->arrival_ns = ev->arrival_ns;
+        break;
+    }
+    case SIM_EV_RX_END:
+        if (ev->seq != node->rx_seq || node->rx_lock != ev->frame)
+            break;
+        sim_frame_put(node->rx_lock);
+        node->rx_lock = NULL;
+        if (!sim_rx_filter(node, ev->frame)) {
+            node->stats.rx_filtered++;
+            sim_status_set(node, SYS_STATUS_AFFREJ);
+            break;
+        }
+        node->rx_seq++;
+        node->rx_active = false;
+        sim_rx_deliver(node, ev->frame, ev->arrival_ns);
+        if (sim_reg_get(node, PMSC_ID, PMSC_CTRL1_OFFSET, 4) & PMSC_CTRL1_ARXSLP)
+            sim_enter_sleep(node);
+        break;
+    case SIM_EV_RX_TIMEOUT:
+        if (ev->seq != node->rx_seq || !node->rx_active)
+            break;
+        node->rx_seq++;
+        node->rx_active = false;
+        sim_frame_put(node->rx_lock);
+        node->rx_lock = NULL;
+        node->stats.rx_timeouts++;
+        sim_status_set(node, SYS_STATUS_RXRFTO);
+        break;
+    }
+    if (!node->sleeping)
+        sim_node_irq_update(node, false);
+}
+
+static void *
+sim_channel_task(void *arg)
+{
+    pthread_mutex_lock(&g_sim.mutex);
+    while (1) {
+        int64_t now = sim_now_ns();
+        if (g_sim.heap_len == 0) {
+            pthread_cond_wait(&g_sim.cond, &g_sim.mutex);
+            continue;
+        }
+        if (g_sim.heap[0]->time_ns > now) {
+            struct timespec ts;
+            int64_t abs = g_sim.heap[0]->time_ns + g_sim.epoch_ns;
+            ts.tv_sec = abs / 1000000000LL;
+            ts.tv_nsec = abs % 1000000000LL;
+            pthread_cond_timedwait(&g_sim.cond, &g_sim.mutex, &ts);
+            continue;
+        }
+        sim_event_t * ev = sim_ev_pop();
+        sim_event_process(ev);
+        sim_frame_put(ev->frame);
+        free(ev);
+
+        pthread_mutex_unlock(&g_sim.mutex);
+        sim_irq_flush();
+        pthread_mutex_lock(&g_sim.mutex);
+    }
+    return NULL;
+}
+
+static void
+sim_start(void)
+{
+    pthread_condattr_t attr;
+
+    if (g_sim.started)
+        return;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    g_sim.epoch_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_sim.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    int rc = pthread_create(&g_sim.thread, NULL, sim_channel_task, NULL);
+    assert(rc == 0);
+    g_sim.started = true;
+}
+
+/*
+ * Public API
+ */
+
+/**
+ * API to configure the shared channel.
+ *
+ * @param cfg   Pointer to struct hal_dw1000_sim_channel_cfg.
+ * @return 0 on success
+ */
+int
+hal_dw1000_sim_channel_config(const struct hal_dw1000_sim_channel_cfg * cfg)
+{
+    assert(cfg);
+    pthread_mutex_lock(&g_sim.mutex);
+    g_sim.channel = *cfg;
+    g_sim.rand_state = cfg->seed ? cfg->seed : 0x2545F491;
+    pthread_mutex_unlock(&g_sim.mutex);
+    return 0;
+}
+
+/**
+ * API to add a radio to the channel. Must be called before the driver instance bound to the same pins is configured.
+ *
+ * @param cfg   Pointer to struct hal_dw1000_sim_node_cfg.
+ * @return node index, -1 if the simulator is full
+ */
+int
+hal_dw1000_sim_node_add(const struct hal_dw1000_sim_node_cfg * cfg)
+{
+    assert(cfg);
+    pthread_mutex_lock(&g_sim.mutex);
+    sim_start();
+    if (g_sim.nnodes == HAL_DW1000_SIM_MAX_NODES) {
+        pthread_mutex_unlock(&g_sim.mutex);
+        return -1;
+    }
+
+    sim_node_t * node = (sim_node_t *) calloc(1, sizeof(sim_node_t));
+    assert(node);
+    uint32_t base = 0;
+    for (int reg = 0; reg < 0x40; reg++) {
+        node->reg_base[reg] = base;
+        base += sim_reg_len[reg];
+    }
+    node->regs_len = base;
+    node->regs = (uint8_t *) calloc(1, base);
+    assert(node->regs);
+    node->cfg = *cfg;
+
+    int idx = g_sim.nnodes;
+    node->otp[SIM_OTP_PARTID] = cfg->part_id ? cfg->part_id : 0x10000000 + idx + 1;
+    node->otp[SIM_OTP_LOTID] = cfg->lot_id;
+    node->rate = SIM_DTU_PER_NS * (1.0L + cfg->drift_ppm * 1e-6L);
+    node->clk_offset = ((uint64_t) sim_rand() << 8) & SIM_MASK40;
+    node->cs_active = false;
+
+    g_sim.nodes[g_sim.nnodes++] = node;
+    sim_node_reset(node);
+    pthread_mutex_unlock(&g_sim.mutex);
+    return idx;
+}
+
+/**
+ * API to move a radio, takes effect for frames transmitted after the call.
+ *
+ * @param node  Node index returned by hal_dw1000_sim_node_add.
+ * @param x,y,z New antenna position in meters.
+ * @return 0 on success
+ */
+int
+hal_dw1000_sim_node_move(int node, float x, float y, float z)
+{
+    if (node < 0 || node >= g_sim.nnodes)
+        return -1;
+    pthread_mutex_lock(&g_sim.mutex);
+    g_sim.nodes[node]->cfg.x = x;
+    g_sim.nodes[node]->cfg.y = y;
+    g_sim.nodes[node]->cfg.z = z;
+    pthread_mutex_unlock(&g_sim.mutex);
+    return 0;
+}
+
+/**
+ * API to read the counters of a radio.
+ *
+ * @param node  Node index returned by hal_dw1000_sim_node_add.
+ * @param stats Pointer to struct hal_dw1000_sim_stats.
+ * @return 0 on success
+ */
+int
+hal_dw1000_sim_node_stats(int node, struct hal_dw1000_sim_stats * stats)
+{
+    if (node < 0 || node >= g_sim.nnodes)
+        return -1;
+    pthread_mutex_lock(&g_sim.mutex);
+    *stats = g_sim.nodes[node]->stats;
+    pthread_mutex_unlock(&g_sim.mutex);
+    return 0;
+}
+
+/**
+ * API to read the 40-bit system clock of a radio without going through SPI.
+ *
+ * @param node  Node index returned by hal_dw1000_sim_node_add.
+ * @return Local time in DTU
+ */
+uint64_t
+hal_dw1000_sim_systime(int node)
+{
+    assert(node >= 0 && node < g_sim.nnodes);
+    pthread_mutex_lock(&g_sim.mutex);
+    uint64_t t = sim_local_dtu(g_sim.nodes[node], sim_now_ns());
+    pthread_mutex_unlock(&g_sim.mutex);
+    return t;
+}
+
+/**
+ * API to remove all radios and pending events.
+ *
+ * @return void
+ */
+void
+hal_dw1000_sim_reset(void)
+{
+    pthread_mutex_lock(&g_sim.mutex);
+    while (g_sim.heap_len) {
+        sim_event_t * ev = sim_ev_pop();
+        sim_frame_put(ev->frame);
+        free(ev);
+    }
+    for (uint16_t i = 0; i < g_sim.nnodes; i++) {
+        sim_frame_put(g_sim.nodes[i]->rx_lock);
+        free(g_sim.nodes[i]->regs);
+        free(g_sim.nodes[i]);
+        g_sim.nodes[i] = NULL;
+    }
+    g_sim.nnodes = 0;
+    pthread_mutex_unlock(&g_sim.mutex);
+}
+
+/*
+ * Native HAL glue
+ */
+static sim_node_t *
+sim_node_by_pin(int pin)
+{
+    for (uint16_t i = 0; i < g_sim.nnodes; i++)
+        if (g_sim.nodes[i]->cfg.ss_pin == pin || g_sim.nodes[i]->cfg.rst_pin == pin)
+            return g_sim.nodes[i];
+    return NULL;
+}
+
+/**
+ * Clock bytes through the radio selected on a bus.
+ *
+ * @param spi_num   SPI bus
+ * @param txbuf     Bytes sent, NULL sends zeros
+ * @param rxbuf     Bytes received, may be NULL
+ * @param cnt       Number of bytes
+ * @return 0 on success, -1 if no radio is selected
+ */
+int
+hal_dw1000_sim_spi_txrx(int spi_num, const uint8_t * txbuf, uint8_t * rxbuf, int cnt)
+{
+    sim_node_t * node = NULL;
+
+    pthread_mutex_lock(&g_sim.mutex);
+    for (uint16_t i = 0; i < g_sim.nnodes; i++)
+        if (g_sim.nodes[i]->cfg.spi_num == spi_num && g_sim.nodes[i]->cs_active)
+            node = g_sim.nodes[i];
+    if (node == NULL) {
+        pthread_mutex_unlock(&g_sim.mutex);
+        if (rxbuf)
+            memset(rxbuf, 0, cnt);
+        return -1;
+    }
+
+    node->stats.spi_bytes += cnt;
+    int64_t busy_ns = node->cfg.spi_hz ? (int64_t)cnt * 8000000000LL / node->cfg.spi_hz : 0;
+    for (int i = 0; i < cnt; i++) {
+        uint8_t tx = txbuf ? txbuf[i] : 0;
+        uint8_t rx = 0;
+
+        if (node->sleeping) {
+            /* SPI is dead while asleep */
+        } else if (!node->hdr_done) {
+            node->hdr[node->hdr_len++] = tx;
+            bool subindex = node->hdr[0] & 0x40;
+            bool extended = node->hdr_len > 1 && (node->hdr[1] & 0x80);
+            if (node->hdr_len == 1 && !subindex) {
+                node->hdr_done = true;
+            } else if (node->hdr_len == 2 && !extended) {
+                node->hdr_done = true;
+            } else if (node->hdr_len == 3) {
+                node->hdr_done = true;
+            }
+            if (node->hdr_done) {
+                node->write = (node->hdr[0] & 0x80) != 0;
+                node->reg = node->hdr[0] & 0x3F;
+                node->offset = 0;
+                if (node->hdr_len > 1)
+                    node->offset = node->hdr[1] & 0x7F;
+                if (node->hdr_len > 2)
+                    node->offset |= (uint16_t) node->hdr[2] << 7;
+                node->index = 0;
+                node->wrlen = 0;
+                if (!node->write)
+                    sim_read_refresh(node, node->reg, sim_now_ns());
+            }
+        } else if (node->write) {
+            if (node->wrlen < SIM_WRBUF_LEN)
+                node->wrbuf[node->wrlen++] = tx;
+        } else {
+            uint32_t off = (uint32_t) node->offset + node->index++;
+            if (off < sim_reg_len[node->reg])
+                rx = *sim_reg(node, node->reg, off);
+        }
+        if (rxbuf)
+            rxbuf[i] = rx;
+    }
+    pthread_mutex_unlock(&g_sim.mutex);
+
+    /* Hold the caller for as long as the bytes take on the wire */
+    if (busy_ns) {
+        int64_t end = sim_now_ns() + busy_ns;
+        while (sim_now_ns() < end)
+            ;
+    }
+    return 0;
+}
+
+/**
+ * Observe an output pin, chip select frames transactions and rst low resets the radio.
+ *
+ * @param pin   Pin number
+ * @param val   New level
+ * @return 0 if the pin belongs to a radio, -1 otherwise
+ */
+int
+hal_dw1000_sim_gpio_write(int pin, int val)
+{
+    pthread_mutex_lock(&g_sim.mutex);
+    sim_node_t * node = sim_node_by_pin(pin);
+    if (node == NULL) {
+        pthread_mutex_unlock(&g_sim.mutex);
+        return -1;
+    }
+
+    int64_t now = sim_now_ns();
+    if (pin == node->cfg.rst_pin) {
+        if (!val)
+            sim_node_reset(node);
+    } else if (!val && !node->cs_active) {
+        for (uint16_t i = 0; i < g_sim.nnodes; i++)
+            if (g_sim.nodes[i] != node && g_sim.nodes[i]->cfg.spi_num == node->cfg.spi_num && g_sim.nodes[i]->cs_active)
+                node->stats.spi_cs_overlaps++;
+        node->cs_active = true;
+        node->cs_low_ns = now;
+        node->hdr_len = 0;
+        node->hdr_done = false;
+        node->wrlen = 0;
+        node->stats.spi_xfers++;
+    } else if (val && node->cs_active) {
+        node->cs_active = false;
+        if (node->sleeping) {
+            if (now - node->cs_low_ns >= SIM_WAKEUP_CS_NS)
+                sim_wakeup(node);
+        } else if (node->hdr_done && node->write) {
+            sim_write_commit(node);
+        }
+    }
+    pthread_mutex_unlock(&g_sim.mutex);
+    sim_irq_flush();
+    return 0;
+}
+
+/**
+ * Sample an input pin driven by a radio, the reset pin reads low while asleep.
+ *
+ * @param pin   Pin number
+ * @param val   Level read
+ * @return 0 if the pin belongs to a radio, -1 otherwise
+ */
+int
+hal_dw1000_sim_gpio_read(int pin, int * val)
+{
+    int rc = -1;
+
+    pthread_mutex_lock(&g_sim.mutex);
+    for (uint16_t i = 0; i < g_sim.nnodes; i++) {
+        sim_node_t * node = g_sim.nodes[i];
+        if (node->cfg.rst_pin == pin) {
+            *val = !node->sleeping;
+            rc = 0;
+        } else if (node->cfg.irq_pin == pin) {
+            *val = node->irq_level;
+            rc = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_sim.mutex);
+    return rc;
+}
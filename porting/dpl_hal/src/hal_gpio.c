@@ -0,0 +1,177 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "hal/hal_gpio.h"
+#include "hal/hal_dw1000_sim.h"
+
+/*
+ * For native cpu implementation. Outputs are forwarded to the virtual DW1000
+ * (chip select, reset) and inputs are driven by it (irq, reset).
+ */
+#define NATIVE_GPIO_PINS    (256)
+
+struct native_gpio {
+    int8_t mode;
+    uint8_t val;
+    uint8_t irq_enabled;
+    hal_gpio_irq_trig_t trig;
+    hal_gpio_irq_handler_t handler;
+    void *arg;
+} native_gpios[NATIVE_GPIO_PINS];
+
+static pthread_mutex_t native_gpio_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int
+hal_gpio_init_in(int pin, hal_gpio_pull_t pull)
+{
+    if (pin < 0 || pin >= NATIVE_GPIO_PINS) {
+        return -1;
+    }
+    native_gpios[pin].mode = HAL_GPIO_MODE_IN;
+    native_gpios[pin].val = (pull == HAL_GPIO_PULL_UP);
+    return 0;
+}
+
+int
+hal_gpio_init_out(int pin, int val)
+{
+    if (pin < 0 || pin >= NATIVE_GPIO_PINS) {
+        return -1;
+    }
+    native_gpios[pin].mode = HAL_GPIO_MODE_OUT;
+    hal_gpio_write(pin, val);
+    return 0;
+}
+
+void
+hal_gpio_write(int pin, int val)
+{
+    assert(pin >= 0 && pin < NATIVE_GPIO_PINS);
+    native_gpios[pin].val = (val != 0);
+    hal_dw1000_sim_gpio_write(pin, val != 0);
+}
+
+int
+hal_gpio_read(int pin)
+{
+    int val;
+
+    assert(pin >= 0 && pin < NATIVE_GPIO_PINS);
+    if (hal_dw1000_sim_gpio_read(pin, &val) == 0) {
+        return val;
+    }
+    return native_gpios[pin].val;
+}
+
+int
+hal_gpio_toggle(int pin)
+{
+    int val = !hal_gpio_read(pin);
+
+    hal_gpio_write(pin, val);
+    return val;
+}
+
+int
+hal_gpio_irq_init(int pin, hal_gpio_irq_handler_t handler, void *arg,
+                  hal_gpio_irq_trig_t trig, hal_gpio_pull_t pull)
+{
+    if (pin < 0 || pin >= NATIVE_GPIO_PINS) {
+        return -1;
+    }
+    pthread_mutex_lock(&native_gpio_mutex);
+    native_gpios[pin].mode = HAL_GPIO_MODE_IN;
+    native_gpios[pin].handler = handler;
+    native_gpios[pin].arg = arg;
+    native_gpios[pin].trig = trig;
+    native_gpios[pin].irq_enabled = 0;
+    pthread_mutex_unlock(&native_gpio_mutex);
+    return 0;
+}
+
+void
+hal_gpio_irq_release(int pin)
+{
+    assert(pin >= 0 && pin < NATIVE_GPIO_PINS);
+    pthread_mutex_lock(&native_gpio_mutex);
+    native_gpios[pin].handler = NULL;
+    native_gpios[pin].irq_enabled = 0;
+    pthread_mutex_unlock(&native_gpio_mutex);
+}
+
+void
+hal_gpio_irq_enable(int pin)
+{
+    assert(pin >= 0 && pin < NATIVE_GPIO_PINS);
+    native_gpios[pin].irq_enabled = 1;
+}
+
+void
+hal_gpio_irq_disable(int pin)
+{
+    assert(pin >= 0 && pin < NATIVE_GPIO_PINS);
+    native_gpios[pin].irq_enabled = 0;
+}
+
+/**
+ * Drive an input pin from a device model. The registered handler is called
+ * from the caller's context, which stands in for the interrupt context.
+ *
+ * @param pin   Pin number
+ * @param val   New level
+ * @return void
+ */
+void
+hal_gpio_native_drive(int pin, int val)
+{
+    struct native_gpio *gpio;
+    hal_gpio_irq_handler_t handler = NULL;
+    void *arg = NULL;
+    int fire;
+
+    if (pin < 0 || pin >= NATIVE_GPIO_PINS) {
+        return;
+    }
+    gpio = &native_gpios[pin];
+
+    pthread_mutex_lock(&native_gpio_mutex);
+    val = (val != 0);
+    switch (gpio->trig) {
+    case HAL_GPIO_TRIG_RISING:  fire = !gpio->val && val; break;
+    case HAL_GPIO_TRIG_FALLING: fire = gpio->val && !val; break;
+    case HAL_GPIO_TRIG_BOTH:    fire = gpio->val != val; break;
+    case HAL_GPIO_TRIG_LOW:     fire = !val; break;
+    case HAL_GPIO_TRIG_HIGH:    fire = val; break;
+    default:                    fire = 0; break;
+    }
+    gpio->val = val;
+    if (fire && gpio->irq_enabled && gpio->handler) {
+        handler = gpio->handler;
+        arg = gpio->arg;
+    }
+    pthread_mutex_unlock(&native_gpio_mutex);
+
+    if (handler) {
+        handler(arg);
+    }
+}
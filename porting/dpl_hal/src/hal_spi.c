@@ -0,0 +1,165 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "hal/hal_spi.h"
+#include "hal/hal_dw1000_sim.h"
+
+/*
+ * For native cpu implementation. SPI busses have no hardware behind them,
+ * every transfer is clocked into the virtual DW1000 selected on that bus.
+ */
+#define NATIVE_SPI_MAX  (4)
+
+struct native_spi {
+    struct hal_spi_settings settings;
+    hal_spi_txrx_cb txrx_cb;
+    void *txrx_cb_arg;
+    uint8_t enabled;
+} native_spis[NATIVE_SPI_MAX];
+
+int
+hal_spi_init(int spi_num, void *cfg, uint8_t spi_type)
+{
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    memset(&native_spis[spi_num], 0, sizeof(struct native_spi));
+    return 0;
+}
+
+int
+hal_spi_config(int spi_num, struct hal_spi_settings *psettings)
+{
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    native_spis[spi_num].settings = *psettings;
+    return 0;
+}
+
+int
+hal_spi_set_txrx_cb(int spi_num, hal_spi_txrx_cb txrx_cb, void *arg)
+{
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    native_spis[spi_num].txrx_cb = txrx_cb;
+    native_spis[spi_num].txrx_cb_arg = arg;
+    return 0;
+}
+
+int
+hal_spi_enable(int spi_num)
+{
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    native_spis[spi_num].enabled = 1;
+    return 0;
+}
+
+int
+hal_spi_disable(int spi_num)
+{
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    native_spis[spi_num].enabled = 0;
+    return 0;
+}
+
+uint16_t
+hal_spi_tx_val(int spi_num, uint16_t val)
+{
+    uint8_t tx = (uint8_t) val;
+    uint8_t rx = 0;
+
+    hal_dw1000_sim_spi_txrx(spi_num, &tx, &rx, 1);
+    return rx;
+}
+
+int
+hal_spi_txrx(int spi_num, void *txbuf, void *rxbuf, int cnt)
+{
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    hal_dw1000_sim_spi_txrx(spi_num, txbuf, rxbuf, cnt);
+    return 0;
+}
+
+/**
+ * Non-blocking transfers complete immediately, the callback is issued from
+ * the calling context just like a DMA completion interrupt would be.
+ */
+int
+hal_spi_txrx_noblock(int spi_num, void *txbuf, void *rxbuf, int cnt)
+{
+    struct native_spi *spi;
+
+    if (spi_num < 0 || spi_num >= NATIVE_SPI_MAX) {
+        return -1;
+    }
+    spi = &native_spis[spi_num];
+    hal_dw1000_sim_spi_txrx(spi_num, txbuf, rxbuf, cnt);
+    if (spi->txrx_cb) {
+        spi->txrx_cb(spi->txrx_cb_arg, cnt);
+    }
+    return 0;
+}
+
+int
+hal_spi_slave_set_def_tx_val(int spi_num, uint16_t val)
+{
+    return -1;
+}
+
+int
+hal_spi_abort(int spi_num)
+{
+    return 0;
+}
+
+int
+hal_spi_data_mode_breakout(uint8_t data_mode, int *out_cpol, int *out_cpha)
+{
+    switch (data_mode) {
+    case HAL_SPI_MODE0:
+        *out_cpol = 0;
+        *out_cpha = 0;
+        return 0;
+    case HAL_SPI_MODE1:
+        *out_cpol = 0;
+        *out_cpha = 1;
+        return 0;
+    case HAL_SPI_MODE2:
+        *out_cpol = 1;
+        *out_cpha = 0;
+        return 0;
+    case HAL_SPI_MODE3:
+        *out_cpol = 1;
+        *out_cpha = 1;
+        return 0;
+    default:
+        return -1;
+    }
+}
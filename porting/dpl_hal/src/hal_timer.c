@@ -17,75 +17,159 @@
  * under the License.
  */
 
-//#ifdef REMOVE
+
 #include <stdint.h>
+#include <string.h>
 #include <assert.h>
-#include"dpl/dpl.h"
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include "dpl/dpl.h"
 #include "hal/hal_timer.h"
-#include"os/os.h"
+#include "hal/hal_timer_native.h"
+#include "hal/hal_timer_wheel.h"
+#include "os/os.h"
 
 /*
- * For native cpu implementation.
+ * For native cpu implementation. The counter is CLOCK_MONOTONIC scaled to the
+ * configured frequency, timers are kept on a hierarchical timing wheel and a
+ * single dispatcher thread sleeps on a timerfd armed for the next tick the
+ * wheel needs servicing.
  */
-static uint8_t native_timer_task_started;
-#define NATIVE_TIMER_STACK_SIZE   (1024)
-static dpl_stack_t native_timer_stack[NATIVE_TIMER_STACK_SIZE];
-static struct dpl_task native_timer_task_struct;
-static struct dpl_eventq native_timer_evq;
-#define OS_TICKS_PER_SEC    (128)
+#define NSECS_PER_SEC   (1000000000ULL)
+#define NATIVE_TIMER_MAX_SLEEP  (1UL << 29)    //!< Keeps the wheel cursor close to the counter
 
 struct native_timer {
-    struct dpl_callout callout;
-    uint32_t ticks_per_ostick;
-    uint32_t cnt;
-    uint32_t last_ostime;
+    uint32_t freq;
+    uint64_t epoch_ns;
     int num;
-    TAILQ_HEAD(hal_timer_qhead, hal_timer) timers;
+    int fd;
+    pthread_t thread;
+    uint8_t started;
+    struct hal_timer_native_stats stats;
+    uint32_t next;
+    uint8_t armed;
+    struct hal_timer_wheel wheel;
 } native_timers[1];
-/**
- * This is the function called when the timer fires.
- *
- * @param arg
- */
 
+static uint64_t
+native_timer_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSECS_PER_SEC + ts.tv_nsec;
+}
+
+/* Ticks elapsed since the timer was configured, 64 bits wide */
+static uint64_t
+native_timer_ticks(struct native_timer *nt, uint64_t now_ns)
+{
+    uint64_t ns = now_ns - nt->epoch_ns;
+
+    return (ns / NSECS_PER_SEC) * nt->freq + (ns % NSECS_PER_SEC) * nt->freq / NSECS_PER_SEC;
+}
+
+/* Monotonic time of a 32 bit tick, rounded up so a timer never fires early */
+static uint64_t
+native_timer_tick_to_ns(struct native_timer *nt, uint32_t tick, uint64_t now_ns)
+{
+    uint64_t now = native_timer_ticks(nt, now_ns);
+    uint64_t ticks = now + (int32_t)(tick - (uint32_t)now);
+
+    if ((int64_t)ticks < 0) {
+        ticks = 0;
+    }
+    return nt->epoch_ns + (ticks / nt->freq) * NSECS_PER_SEC
+        + ((ticks % nt->freq) * NSECS_PER_SEC + nt->freq - 1) / nt->freq;
+}
+
+/*
+ * Arm the timerfd for the next tick the wheel needs servicing, called from a
+ * critical section. The syscall is skipped when that tick has not changed.
+ */
 static void
-native_timer_cb(struct dpl_event *ev)
+native_timer_arm(struct native_timer *nt)
 {
-    struct native_timer *nt = (struct native_timer *)ev->ev_arg;
-    uint32_t cnt;
-    struct hal_timer *ht;
-    os_sr_t sr;
+    struct itimerspec its = {0};
+    uint32_t next;
+    int pending = hal_timer_wheel_next(&nt->wheel, &next);
 
-    OS_ENTER_CRITICAL(sr);
-    cnt = hal_timer_read(nt->num);
-    while ((ht = TAILQ_FIRST(&nt->timers)) != NULL) {
-        if (((int32_t)(cnt - ht->expiry)) >= 0) {
-            TAILQ_REMOVE(&nt->timers, ht, link);
-            ht->link.tqe_prev = NULL;
-            ht->cb_func(ht->cb_arg);
-        } else {
-            break;
-        }
+    if (pending && next - nt->wheel.cursor > NATIVE_TIMER_MAX_SLEEP) {
+        next = nt->wheel.cursor + NATIVE_TIMER_MAX_SLEEP;
     }
-    ht = TAILQ_FIRST(&nt->timers);
-    if (ht) {
-        dpl_callout_reset(&nt->callout,
-          (ht->expiry - hal_timer_read(nt->num)) / nt->ticks_per_ostick);
+    if (pending == nt->armed && (!pending || next == nt->next)) {
+        return;
     }
-    OS_EXIT_CRITICAL(sr);
+    nt->armed = pending;
+    nt->next = next;
+    if (pending) {
+        uint64_t ns = native_timer_tick_to_ns(nt, next, native_timer_now_ns());
+        its.it_value.tv_sec = ns / NSECS_PER_SEC;
+        its.it_value.tv_nsec = ns % NSECS_PER_SEC;
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+            its.it_value.tv_nsec = 1;       // All zero would disarm
+        }
+    }
+    timerfd_settime(nt->fd, TFD_TIMER_ABSTIME, &its, NULL);
 }
 
+static void
+native_timer_record(struct native_timer *nt, uint64_t late_ns)
+{
+    struct hal_timer_native_stats *st = &nt->stats;
+    uint64_t late_us = late_ns / 1000;
+    int bin = 0;
 
+    while (bin < HAL_TIMER_NATIVE_HIST_BINS - 1 && late_us >= (1ULL << bin)) {
+        bin++;
+    }
+    st->fired++;
+    st->late_sum_ns += late_ns;
+    st->late_sumsq_us += late_us * late_us;
+    if (late_ns > st->late_max_ns) {
+        st->late_max_ns = (late_ns > UINT32_MAX) ? UINT32_MAX : late_ns;
+    }
+    st->late_hist[bin]++;
+}
+
+/**
+ * Dispatcher thread, issues the callbacks of every expired timer each time
+ * the timerfd fires.
+ *
+ * @param arg   Pointer to struct native_timer
+ */
 static void *
 native_timer_task(void *arg)
 {
+    struct native_timer *nt = (struct native_timer *)arg;
+    struct hal_timer *ht;
+    uint64_t expirations;
+    uint64_t now_ns;
+    os_sr_t sr;
+
     while (1) {
-        dpl_eventq_run(&native_timer_evq);
+        if (read(nt->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+            assert(errno == EINTR);
+            continue;
+        }
+
+        OS_ENTER_CRITICAL(sr);
+        nt->armed = 0;
+        now_ns = native_timer_now_ns();
+        while ((ht = hal_timer_wheel_expire(&nt->wheel, (uint32_t)native_timer_ticks(nt, now_ns))) != NULL) {
+            native_timer_record(nt, now_ns - native_timer_tick_to_ns(nt, ht->expiry, now_ns));
+            ht->cb_func(ht->cb_arg);
+            now_ns = native_timer_now_ns();
+        }
+        native_timer_arm(nt);
+        OS_EXIT_CRITICAL(sr);
     }
     return NULL;
 }
 
-
 int
 hal_timer_init(int num, void *cfg)
 {
@@ -96,33 +180,30 @@ int
 hal_timer_config(int num, uint32_t clock_freq)
 {
     struct native_timer *nt;
+    os_sr_t sr;
 
-    if (num != 0) {
+    if (num != 0 || clock_freq == 0) {
         return -1;
     }
     nt = &native_timers[num];
-    /* Set the clock frequency */
-    nt->ticks_per_ostick = clock_freq / OS_TICKS_PER_SEC;
-    if (!nt->ticks_per_ostick) {
-        nt->ticks_per_ostick = 1;
-    }
+
+    OS_ENTER_CRITICAL(sr);
     nt->num = num;
-    nt->cnt = 0;
-
-    nt->last_ostime = dpl_time_get();
-        dpl_eventq_init(&native_timer_evq);
-    if (!native_timer_task_started) {
-        dpl_task_init(&native_timer_task_struct, "native_timer",
-          native_timer_task, NULL, OS_TASK_PRI_HIGHEST, OS_WAIT_FOREVER,
-          native_timer_stack, NATIVE_TIMER_STACK_SIZE);
-
-        /* Initialize the eventq and task */
-        dpl_eventq_init(&native_timer_evq);
-        native_timer_task_started = 1;
+    nt->freq = clock_freq;
+    nt->epoch_ns = native_timer_now_ns();
+    if (!nt->started) {
+        hal_timer_wheel_init(&nt->wheel, 0);
+        nt->fd = timerfd_create(CLOCK_MONOTONIC, 0);
+        assert(nt->fd >= 0);
+        if (pthread_create(&nt->thread, NULL, native_timer_task, nt)) {
+            OS_EXIT_CRITICAL(sr);
+            return -1;
+        }
+        nt->started = 1;
     }
-
-    /* Initialize the callout function */
-    dpl_callout_init(&nt->callout, &native_timer_evq, native_timer_cb, nt);
+    nt->armed = 0;
+    native_timer_arm(nt);
+    OS_EXIT_CRITICAL(sr);
 
     return 0;
 }
@@ -131,13 +212,24 @@ int
 hal_timer_deinit(int num)
 {
     struct native_timer *nt;
+    struct hal_timer *ht;
+    os_sr_t sr;
 
     if (num != 0) {
         return -1;
     }
     nt = &native_timers[num];
 
-    dpl_callout_stop(&nt->callout);
+    OS_ENTER_CRITICAL(sr);
+    if (nt->started) {
+        /* Drain everything pending, then bring the idle cursor back to the counter */
+        while ((ht = hal_timer_wheel_expire(&nt->wheel, nt->wheel.cursor + INT32_MAX)) != NULL) {
+            ;
+        }
+        hal_timer_wheel_expire(&nt->wheel, hal_timer_read(num));
+        native_timer_arm(nt);
+    }
+    OS_EXIT_CRITICAL(sr);
     return 0;
 }
 
@@ -155,11 +247,14 @@ hal_timer_get_resolution(int num)
 {
     struct native_timer *nt;
 
-    if (num >= 0) {
+    if (num != 0) {
         return 0;
     }
     nt = &native_timers[num];
-    return 1000000000 / (nt->ticks_per_ostick * OS_TICKS_PER_SEC);
+    if (nt->freq == 0) {
+        return 0;
+    }
+    return NSECS_PER_SEC / nt->freq;
 }
 
 /**
@@ -172,34 +267,17 @@ hal_timer_get_resolution(int num)
 uint32_t
 hal_timer_read(int num)
 {
-    struct native_timer *nt;
-    os_sr_t sr;
-    uint32_t ostime;
-    uint32_t delta_osticks;
-
     if (num != 0) {
         return -1;
     }
-
-
-    nt = &native_timers[num];
-    OS_ENTER_CRITICAL(sr);
-    ostime = dpl_time_get();
-    delta_osticks = (uint32_t)(ostime - nt->last_ostime);
-    if (delta_osticks) {
-        nt->last_ostime = ostime;
-        nt->cnt += nt->ticks_per_ostick * delta_osticks;
-
-    }
-    OS_EXIT_CRITICAL(sr);
-
-    return (uint32_t)nt->cnt;
+    return (uint32_t)native_timer_ticks(&native_timers[num], native_timer_now_ns());
 }
 
 /**
  * hal timer delay
  *
- * Blocking delay for n ticks
+ * Blocking delay for n ticks, the calling thread sleeps until the counter
+ * has advanced by at least ticks.
  *
  * @param timer_num
  * @param ticks
@@ -209,14 +287,21 @@ hal_timer_read(int num)
 int
 hal_timer_delay(int num, uint32_t ticks)
 {
-    uint32_t until;
+    struct native_timer *nt;
+    struct timespec ts;
+    uint64_t now_ns;
+    uint64_t until;
 
     if (num != 0) {
         return -1;
     }
+    nt = &native_timers[num];
 
-    until = hal_timer_read(0) + ticks;
-    while ((int32_t)(hal_timer_read(0) - until) <= 0) {
+    now_ns = native_timer_now_ns();
+    until = native_timer_tick_to_ns(nt, (uint32_t)native_timer_ticks(nt, now_ns) + ticks, now_ns);
+    ts.tv_sec = until / NSECS_PER_SEC;
+    ts.tv_nsec = until % NSECS_PER_SEC;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
         ;
     }
     return 0;
@@ -284,43 +369,19 @@ int
 hal_timer_start_at(struct hal_timer *timer, uint32_t tick)
 {
     struct native_timer *nt;
-    struct hal_timer *ht;
-    uint32_t curtime;
-    uint32_t osticks;
     os_sr_t sr;
 
     nt = (struct native_timer *)timer->bsp_timer;
 
-    timer->expiry = tick;
-
     OS_ENTER_CRITICAL(sr);
-
-    if (TAILQ_EMPTY(&nt->timers)) {
-        TAILQ_INSERT_HEAD(&nt->timers, timer, link);
-    } else {
-        TAILQ_FOREACH(ht, &nt->timers, link) {
-            if ((int32_t)(timer->expiry - ht->expiry) < 0) {
-                TAILQ_INSERT_BEFORE(ht, timer, link);
-                break;
-            }
-        }
-        if (!ht) {
-            TAILQ_INSERT_TAIL(&nt->timers, timer, link);
-        }
-    }
-
-    curtime = hal_timer_read(nt->num);
-    if ((int32_t)(tick - curtime) <= 0) {
-        /*
-         * Event in the past (should be the case if it was just inserted).
-         */
-        dpl_callout_reset(&nt->callout, 0);
-    } else {
-        if (timer == TAILQ_FIRST(&nt->timers)) {
-            osticks = (tick - curtime) / nt->ticks_per_ostick;
-            dpl_callout_reset(&nt->callout, osticks);
-        }
+    hal_timer_wheel_remove(&nt->wheel, timer);
+    if (nt->wheel.count == 0) {
+        /* Idle wheel, catch the cursor up with the counter */
+        hal_timer_wheel_expire(&nt->wheel, hal_timer_read(nt->num));
     }
+    timer->expiry = tick;
+    hal_timer_wheel_insert(&nt->wheel, timer);
+    native_timer_arm(nt);
     OS_EXIT_CRITICAL(sr);
 
     return 0;
@@ -339,36 +400,56 @@ int
 hal_timer_stop(struct hal_timer *timer)
 {
     struct native_timer *nt;
-    struct hal_timer *ht;
-    int reset_ocmp;
     os_sr_t sr;
 
     OS_ENTER_CRITICAL(sr);
 
     nt = (struct native_timer *)timer->bsp_timer;
-    if (timer->link.tqe_prev != NULL) {
-        reset_ocmp = 0;
-        if (timer == TAILQ_FIRST(&nt->timers)) {
-            /* If first on queue, we will need to reset OCMP */
-            ht = TAILQ_NEXT(timer, link);
-            reset_ocmp = 1;
-        }
-        TAILQ_REMOVE(&nt->timers, timer, link);
-        timer->link.tqe_prev = NULL;
-        if (reset_ocmp) {
-            if (ht) {
-                dpl_callout_reset(&nt->callout,
-                  (ht->expiry - hal_timer_read(nt->num)) /
-                    nt->ticks_per_ostick);
-            } else {
-                dpl_callout_stop(&nt->callout);
-            }
-        }
+    if (hal_timer_wheel_queued(timer)) {
+        hal_timer_wheel_remove(&nt->wheel, timer);
+        native_timer_arm(nt);
     }
     OS_EXIT_CRITICAL(sr);
 
     return 0;
 }
 
-//#endif
+/**
+ * Read the lateness statistics of a timer.
+ *
+ * @param num    Timer number
+ * @param stats  Copy of the statistics
+ *
+ * @return int 0 on success, -1 for an unknown timer
+ */
+int
+hal_timer_native_stats(int num, struct hal_timer_native_stats *stats)
+{
+    os_sr_t sr;
+
+    if (num != 0) {
+        return -1;
+    }
+    OS_ENTER_CRITICAL(sr);
+    *stats = native_timers[num].stats;
+    OS_EXIT_CRITICAL(sr);
+    return 0;
+}
+
+/**
+ * Clear the lateness statistics of a timer.
+ *
+ * @param num    Timer number
+ */
+void
+hal_timer_native_stats_clear(int num)
+{
+    os_sr_t sr;
 
+    if (num != 0) {
+        return;
+    }
+    OS_ENTER_CRITICAL(sr);
+    memset(&native_timers[num].stats, 0, sizeof(native_timers[num].stats));
+    OS_EXIT_CRITICAL(sr);
+}
@@ -0,0 +1,251 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file hal_timer_wheel.c
+ * @author paul kettle
+ * @date 2019
+ * @brief Hierarchical timing wheel for struct hal_timer
+ *
+ * @details Invariant: every timer with an expiry before the cursor is on the expired list, every other
+ * timer sits at the level and bucket computed from its expiry and the current cursor. The cursor is only
+ * ever moved up to the next occupied bound, where the bucket reached is cascaded, which keeps the invariant
+ * and lets hal_timer_wheel_remove() find a timer's bucket without storing it.
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include "hal/hal_timer_wheel.h"
+
+#define WHEEL_MASK      (HAL_TIMER_WHEEL_BUCKETS - 1)
+#define WHEEL_WORDS     (HAL_TIMER_WHEEL_BUCKETS / 32)
+
+static struct hal_timer_wheel_bucket *
+wheel_bucket(struct hal_timer_wheel * wheel, uint32_t expiry, int * level, int * idx)
+{
+    uint32_t diff = expiry ^ wheel->cursor;
+    int lvl = 0;
+
+    if ((int32_t)(expiry - wheel->cursor) < 0) {
+        *level = -1;
+        return &wheel->expired;
+    }
+    while (lvl < HAL_TIMER_WHEEL_LEVELS - 1 && (diff >> (HAL_TIMER_WHEEL_BITS * (lvl + 1))) != 0) {
+        lvl++;
+    }
+    *level = lvl;
+    *idx = (expiry >> (HAL_TIMER_WHEEL_BITS * lvl)) & WHEEL_MASK;
+    return &wheel->bucket[lvl][*idx];
+}
+
+static void
+wheel_place(struct hal_timer_wheel * wheel, struct hal_timer * timer)
+{
+    int level, idx;
+    struct hal_timer_wheel_bucket * head = wheel_bucket(wheel, timer->expiry, &level, &idx);
+
+    TAILQ_INSERT_TAIL(head, timer, link);
+    if (level >= 0) {
+        wheel->map[level][idx / 32] |= 1UL << (idx % 32);
+    }
+}
+
+/* First occupied bucket at or above start, -1 if none */
+static int
+wheel_find(const uint32_t * map, unsigned int start)
+{
+    for (unsigned int w = start / 32; w < WHEEL_WORDS; w++) {
+        uint32_t bits = map[w];
+        if (w == start / 32) {
+            bits &= ~0UL << (start % 32);
+        }
+        if (bits) {
+            return w * 32 + __builtin_ctz(bits);
+        }
+    }
+    return -1;
+}
+
+/* Move the cursor, which must not pass the next bound, cascading the buckets it reaches */
+static void
+wheel_jump(struct hal_timer_wheel * wheel, uint32_t to)
+{
+    uint32_t from = wheel->cursor;
+    struct hal_timer_wheel_bucket * head;
+    struct hal_timer * timer;
+
+    wheel->cursor = to;
+    for (int lvl = HAL_TIMER_WHEEL_LEVELS - 1; lvl > 0; lvl--) {
+        int idx = (to >> (HAL_TIMER_WHEEL_BITS * lvl)) & WHEEL_MASK;
+
+        if (((from ^ to) >> (HAL_TIMER_WHEEL_BITS * lvl)) == 0 ||
+            (wheel->map[lvl][idx / 32] & (1UL << (idx % 32))) == 0) {
+            continue;
+        }
+        head = &wheel->bucket[lvl][idx];
+        wheel->map[lvl][idx / 32] &= ~(1UL << (idx % 32));
+        while ((timer = TAILQ_FIRST(head)) != NULL) {
+            TAILQ_REMOVE(head, timer, link);
+            wheel_place(wheel, timer);
+        }
+    }
+}
+
+/**
+ * API to initialise an empty wheel.
+ *
+ * @param wheel  Pointer to struct hal_timer_wheel
+ * @param tick   Current tick, the first one the wheel will process
+ * @return void
+ */
+void
+hal_timer_wheel_init(struct hal_timer_wheel * wheel, uint32_t tick)
+{
+    for (int lvl = 0; lvl < HAL_TIMER_WHEEL_LEVELS; lvl++) {
+        for (int idx = 0; idx < HAL_TIMER_WHEEL_BUCKETS; idx++) {
+            TAILQ_INIT(&wheel->bucket[lvl][idx]);
+        }
+        for (int w = 0; w < WHEEL_WORDS; w++) {
+            wheel->map[lvl][w] = 0;
+        }
+    }
+    TAILQ_INIT(&wheel->expired);
+    wheel->cursor = tick;
+    wheel->count = 0;
+}
+
+/**
+ * API to add a timer to the wheel, in constant time. The timer must not be queued and its expiry
+ * must already be set; an expiry before the cursor is returned by the next hal_timer_wheel_expire().
+ *
+ * @param wheel  Pointer to struct hal_timer_wheel
+ * @param timer  Pointer to struct hal_timer
+ * @return void
+ */
+void
+hal_timer_wheel_insert(struct hal_timer_wheel * wheel, struct hal_timer * timer)
+{
+    assert(!hal_timer_wheel_queued(timer));
+    wheel_place(wheel, timer);
+    wheel->count++;
+}
+
+/**
+ * API to take a pending timer off the wheel, in constant time.
+ *
+ * @param wheel  Pointer to struct hal_timer_wheel
+ * @param timer  Pointer to struct hal_timer, ignored when not queued
+ * @return void
+ */
+void
+hal_timer_wheel_remove(struct hal_timer_wheel * wheel, struct hal_timer * timer)
+{
+    int level, idx;
+    struct hal_timer_wheel_bucket * head;
+
+    if (!hal_timer_wheel_queued(timer)) {
+        return;
+    }
+    head = wheel_bucket(wheel, timer->expiry, &level, &idx);
+    TAILQ_REMOVE(head, timer, link);
+    timer->link.tqe_prev = NULL;
+    if (level >= 0 && TAILQ_EMPTY(head)) {
+        wheel->map[level][idx / 32] &= ~(1UL << (idx % 32));
+    }
+    wheel->count--;
+}
+
+/**
+ * API to find the next tick at which the wheel needs servicing, either to expire timers or to
+ * cascade a bucket. It is never later than the earliest pending expiry.
+ *
+ * @param wheel  Pointer to struct hal_timer_wheel
+ * @param tick   Next tick, the cursor itself when expired timers are waiting
+ * @return int   0 when the wheel is empty, 1 otherwise
+ */
+int
+hal_timer_wheel_next(struct hal_timer_wheel * wheel, uint32_t * tick)
+{
+    if (wheel->count == 0) {
+        return 0;
+    }
+    if (!TAILQ_EMPTY(&wheel->expired)) {
+        *tick = wheel->cursor;
+        return 1;
+    }
+    /* Any bound on a lower level comes before every bound on a higher one */
+    for (int lvl = 0; lvl < HAL_TIMER_WHEEL_LEVELS; lvl++) {
+        int shift = HAL_TIMER_WHEEL_BITS * lvl;
+        unsigned int c = (wheel->cursor >> shift) & WHEEL_MASK;
+        int idx = wheel_find(wheel->map[lvl], lvl ? c + 1 : c);
+        uint32_t base = 0;
+
+        if (idx < 0 && lvl == HAL_TIMER_WHEEL_LEVELS - 1) {
+            idx = wheel_find(wheel->map[lvl], 0);   // Expiry past the 32-bit wrap
+        }
+        if (idx < 0) {
+            continue;
+        }
+        if (lvl < HAL_TIMER_WHEEL_LEVELS - 1) {
+            base = wheel->cursor & ~((1UL << (shift + HAL_TIMER_WHEEL_BITS)) - 1);
+        }
+        *tick = base | ((uint32_t)idx << shift);
+        return 1;
+    }
+    assert(0);
+    return 0;
+}
+
+/**
+ * API to advance the wheel to now and take off the next expired timer. Call repeatedly until it
+ * returns NULL; the cursor is then now + 1. The cursor must be kept within 2^31 ticks of the
+ * timers started, an empty wheel simply moves to now.
+ *
+ * @param wheel  Pointer to struct hal_timer_wheel
+ * @param now    Current tick
+ * @return struct hal_timer * Expired timer, NULL when nothing is due
+ */
+struct hal_timer *
+hal_timer_wheel_expire(struct hal_timer_wheel * wheel, uint32_t now)
+{
+    struct hal_timer_wheel_bucket * head;
+    struct hal_timer * timer;
+    uint32_t tick;
+
+    while ((timer = TAILQ_FIRST(&wheel->expired)) == NULL) {
+        if (!hal_timer_wheel_next(wheel, &tick) || (int32_t)(tick - now) > 0) {
+            if (wheel->count == 0 || (int32_t)(now + 1 - wheel->cursor) > 0) {
+                wheel_jump(wheel, now + 1);
+            }
+            return NULL;
+        }
+        wheel_jump(wheel, tick);
+        head = &wheel->bucket[0][tick & WHEEL_MASK];
+        while ((timer = TAILQ_FIRST(head)) != NULL) {
+            TAILQ_REMOVE(head, timer, link);
+            TAILQ_INSERT_TAIL(&wheel->expired, timer, link);
+        }
+        wheel->map[0][(tick & WHEEL_MASK) / 32] &= ~(1UL << ((tick & WHEEL_MASK) % 32));
+        wheel_jump(wheel, tick + 1);
+    }
+    TAILQ_REMOVE(&wheel->expired, timer, link);
+    timer->link.tqe_prev = NULL;
+    wheel->count--;
+    return timer;
+}